@@ -1,4 +1,13 @@
 COMPONENT_ADD_INCLUDEDIRS = src
 COMPONENT_SRCDIRS = src
 COMPONENT_DEPENDS = log esp_http_server
-COMPONENT_EMBED_FILES := src/style.css src/code.js src/index.html
+COMPONENT_EXTRA_CLEAN := web_assets.h
+CFLAGS += -I$(COMPONENT_BUILD_DIR)
+
+WEB_ASSETS := $(COMPONENT_PATH)/src/index.html $(COMPONENT_PATH)/src/code.js $(COMPONENT_PATH)/src/style.css
+
+# Web UI gzipped at build time, http_app.c serves it straight from flash
+src/http_app.o: web_assets.h
+
+web_assets.h: $(COMPONENT_PATH)/web_assets.py $(WEB_ASSETS)
+	$(PYTHON) $< -o $@ $(WEB_ASSETS)
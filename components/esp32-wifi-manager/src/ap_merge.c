@@ -0,0 +1,188 @@
+/**
+@file ap_merge.c
+@brief Merges Wi-Fi scans into a short list of access points
+
+@see ap_merge.h
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "ap_merge.h"
+
+
+/* empty slot of the index, capacity is at most a few hundred */
+#define AP_MERGE_EMPTY						UINT16_MAX
+
+typedef struct{
+	uint16_t i;
+	uint8_t age;
+	int8_t rssi;
+} ap_merge_eviction_t;
+
+/**
+ * @brief FNV-1a of an SSID and its authmode, the key of the access point list.
+ */
+static uint32_t ap_merge_hash(const uint8_t *ssid, uint8_t auth){
+	uint32_t hash = 2166136261u;
+
+	for(int i = 0; i < AP_MERGE_SSID_SIZE && ssid[i]; i++){
+		hash = (hash ^ ssid[i]) * 16777619u;
+	}
+
+	return (hash ^ auth) * 16777619u;
+}
+
+/* strongest first */
+static int ap_merge_record_cmp(const void *a, const void *b){
+	return ((const wifi_ap_record_t*)b)->rssi - ((const wifi_ap_record_t*)a)->rssi;
+}
+
+/* the access points not seen for the longest time first, the weakest of them before the others */
+static int ap_merge_eviction_cmp(const void *a, const void *b){
+	const ap_merge_eviction_t *ap_a = a;
+	const ap_merge_eviction_t *ap_b = b;
+
+	if(ap_a->age != ap_b->age){
+		return ap_b->age - ap_a->age;
+	}
+
+	return ap_a->rssi - ap_b->rssi;
+}
+
+/* slots hold an index in the list, open addressing with linear probing */
+static void ap_merge_index_insert(uint16_t *index, uint16_t size, const wifi_manager_ap_t *aps, uint16_t i){
+	uint16_t slot = aps[i].hash % size;
+
+	while(index[slot] != AP_MERGE_EMPTY){
+		slot = (slot + 1) % size;
+	}
+	index[slot] = i;
+}
+
+/* backward shift deletion, so probes never run over slots of access points that are gone */
+static void ap_merge_index_remove(uint16_t *index, uint16_t size, const wifi_manager_ap_t *aps, uint16_t i){
+	uint16_t hole = aps[i].hash % size;
+	uint16_t slot;
+
+	while(index[hole] != i){
+		hole = (hole + 1) % size;
+	}
+	for(slot = (hole + 1) % size; index[slot] != AP_MERGE_EMPTY; slot = (slot + 1) % size){
+		uint16_t home = aps[index[slot]].hash % size;
+
+		/* an entry can move back into the hole unless it would then sit before its home slot */
+		bool stays = (hole <= slot) ? (hole < home && home <= slot) : (hole < home || home <= slot);
+		if(!stays){
+			index[hole] = index[slot];
+			hole = slot;
+		}
+	}
+	index[hole] = AP_MERGE_EMPTY;
+}
+
+bool ap_merge_scan(ap_list_t *list, wifi_ap_record_t *records, uint16_t count){
+	/* twice the capacity, the index only ever holds the listed access points */
+	uint16_t size = 2 * list->capacity;
+	uint16_t *index = malloc(size * sizeof(uint16_t));
+	ap_merge_eviction_t *eviction = malloc(list->capacity * sizeof(ap_merge_eviction_t));
+	uint16_t eviction_count = list->count;
+	uint16_t eviction_next = 0;
+	wifi_manager_ap_t *aps = list->aps;
+
+	if(index == NULL || eviction == NULL){
+		free(index);
+		free(eviction);
+		return false;
+	}
+
+	memset(index, 0xff, size * sizeof(uint16_t));
+	for(uint16_t i = 0; i < list->count; i++){
+		wifi_manager_ap_t *ap = &aps[i];
+
+		if(ap->age < UINT8_MAX) ap->age++;
+		ap_merge_index_insert(index, size, aps, i);
+		eviction[i] = (ap_merge_eviction_t){ .i = i, .age = ap->age, .rssi = ap->rssi };
+	}
+	qsort(eviction, eviction_count, sizeof(ap_merge_eviction_t), ap_merge_eviction_cmp);
+
+	/* the first record of an access point is then its best one, and a full list only makes room for newcomers that are stronger than what this scan already brought */
+	if(count > 0){
+		qsort(records, count, sizeof(wifi_ap_record_t), ap_merge_record_cmp);
+	}
+
+	for(int r = 0; r < count; r++){
+		wifi_ap_record_t *record = &records[r];
+		wifi_manager_ap_t *ap = NULL;
+		uint32_t hash;
+		uint16_t slot;
+		uint16_t i;
+
+		/* hidden networks can't be picked from the list */
+		if(record->ssid[0] == '\0') continue;
+
+		hash = ap_merge_hash(record->ssid, record->authmode);
+		for(slot = hash % size; index[slot] != AP_MERGE_EMPTY; slot = (slot + 1) % size){
+			wifi_manager_ap_t *candidate = &aps[index[slot]];
+			if(candidate->hash == hash && candidate->auth == record->authmode &&
+			   strncmp((const char*)candidate->ssid, (const char*)record->ssid, AP_MERGE_SSID_SIZE) == 0){
+				ap = candidate;
+				break;
+			}
+		}
+
+		if(ap){
+			/* a weaker copy of an access point of this scan, e.g. another node of a mesh */
+			if(ap->age == 0) continue;
+
+			/* seen by the previous scan as well: smooth the RSSI so the order does not flicker */
+			ap->rssi = (ap->age == 1) ? (ap->rssi + record->rssi) / 2 : record->rssi;
+			ap->chan = record->primary;
+			ap->age = 0;
+			continue;
+		}
+
+		if(list->count < list->capacity){
+			i = list->count++;
+		}
+		else{
+			/* replace the stalest access point, the ones seen by this scan stay */
+			while(eviction_next < eviction_count && aps[eviction[eviction_next].i].age == 0){
+				eviction_next++;
+			}
+			if(eviction_next == eviction_count) continue;
+			i = eviction[eviction_next++].i;
+			ap_merge_index_remove(index, size, aps, i);
+		}
+
+		ap = &aps[i];
+		memcpy(ap->ssid, record->ssid, AP_MERGE_SSID_SIZE);
+		ap->ssid[AP_MERGE_SSID_SIZE] = '\0';
+		ap->rssi = record->rssi;
+		ap->chan = record->primary;
+		ap->auth = record->authmode;
+		ap->age = 0;
+		ap->hash = hash;
+		ap_merge_index_insert(index, size, aps, i);
+	}
+	free(index);
+	free(eviction);
+
+	/* drop what was not seen for too long and sort by RSSI. Insertion sort: the list is nearly sorted from the
+	 * previous scan, and access points of equal strength keep their place */
+	uint16_t kept = 0;
+	for(uint16_t i = 0; i < list->count; i++){
+		wifi_manager_ap_t ap = aps[i];
+		int j;
+
+		if(ap.age > list->max_age) continue;
+
+		for(j = kept++; j > 0 && aps[j - 1].rssi < ap.rssi; j--){
+			aps[j] = aps[j - 1];
+		}
+		aps[j] = ap;
+	}
+	list->count = kept;
+
+	return true;
+}
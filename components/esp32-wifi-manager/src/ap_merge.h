@@ -0,0 +1,65 @@
+/**
+@file ap_merge.h
+@brief Merges Wi-Fi scans into a short list of access points
+
+Scans are merged instead of replacing the list, so it does not flicker when
+an access point misses one. Access points are unique by SSID and authmode
+and the list is kept sorted by RSSI. The merge only touches the list it is
+given, so it runs on the host against made up scans.
+
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#ifndef WIFI_MANAGER_AP_MERGE_H_INCLUDED
+#define WIFI_MANAGER_AP_MERGE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_wifi_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Longest SSID, MAX_SSID_SIZE of the wifi manager */
+#define AP_MERGE_SSID_SIZE					32
+
+/**
+ * @brief One access point of the scan list, only what /ap.json shows.
+ */
+typedef struct{
+	uint8_t ssid[AP_MERGE_SSID_SIZE + 1];
+	int8_t rssi;
+	uint8_t chan;
+	uint8_t auth;
+	uint8_t age;		/**< scans since it was last seen */
+	uint32_t hash;		/**< of ssid and auth, see ap_merge_scan */
+} wifi_manager_ap_t;
+
+/**
+ * @brief The list scans are merged into.
+ */
+typedef struct{
+	wifi_manager_ap_t *aps;		/**< room for capacity access points */
+	uint16_t count;
+	uint16_t capacity;
+	uint8_t max_age;			/**< scans an access point stays listed after it was last seen */
+} ap_list_t;
+
+/**
+ * @brief Merges the records of a scan into the list.
+ *
+ * The strongest record of an access point wins, an access point seen by the previous scan as well gets the
+ * average of both. One missing from the scan stays listed for max_age scans. When the list is full, the
+ * access points not seen for the longest time make room first, the weakest of them before the others;
+ * the ones of this scan always stay.
+ * @param records the scan, reordered by RSSI in place.
+ * @return false if the index could not be allocated, the list is then unchanged.
+ */
+bool ap_merge_scan(ap_list_t *list, wifi_ap_record_t *records, uint16_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_AP_MERGE_H_INCLUDED */
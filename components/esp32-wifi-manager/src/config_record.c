@@ -0,0 +1,83 @@
+/**
+@file config_record.c
+@brief One versioned, CRC checked record holding the whole configuration
+
+@see config_record.h
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+#include "config_record.h"
+
+
+static const char TAG[] = "config_record";
+
+static uint32_t config_record_crc(const uint8_t *record, size_t size){
+	return esp_rom_crc32_le(0, record + sizeof(config_record_header_t), size - sizeof(config_record_header_t));
+}
+
+bool config_record_load(config_record_t *config, void *record, size_t size){
+	config_record_header_t *header = (config_record_header_t*)config->image;
+	size_t sz = sizeof(config->image);
+
+	/* whatever was in the image is no longer what storage holds */
+	config->image_size = 0;
+	if(config->storage->read(config->storage->ctx, config->image, &sz) != ESP_OK){
+		return false;
+	}
+	if(sz < config->min_size || sz < sizeof(config_record_header_t) || header->size != sz ||
+	   header->version != config->version || header->crc != config_record_crc(config->image, sz)){
+		ESP_LOGE(TAG, "config record of %u bytes is not valid, ignored", (unsigned)sz);
+		return false;
+	}
+	config->image_size = sz;
+
+	/* an earlier firmware wrote less: what it did not know keeps its default */
+	memcpy(record, config->image, sz < size ? sz : size);
+
+	return true;
+}
+
+esp_err_t config_record_save(config_record_t *config, const void *record, size_t size){
+	size_t total = (config->image_size > size) ? config->image_size : size;
+	config_record_header_t *header;
+	uint8_t *image;
+	esp_err_t esp_err;
+
+	if(size < sizeof(config_record_header_t) || size > CONFIG_RECORD_MAX_SIZE){
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	image = (uint8_t*)malloc(CONFIG_RECORD_MAX_SIZE);
+	if(image == NULL){
+		return ESP_ERR_NO_MEM;
+	}
+
+	/* the tail a later firmware appended is written back as it was */
+	memset(image, 0x00, CONFIG_RECORD_MAX_SIZE);
+	memcpy(image, config->image, config->image_size);
+	memcpy(image, record, size);
+	header = (config_record_header_t*)image;
+	header->version = config->version;
+	header->size = total;
+	header->crc = config_record_crc(image, total);
+
+	/* the CRC settles nearly every comparison, the bytes only when it matches */
+	if(total == config->image_size && header->crc == ((config_record_header_t*)config->image)->crc &&
+	   memcmp(image, config->image, total) == 0){
+		free(image);
+		return ESP_OK;
+	}
+
+	esp_err = config->storage->write(config->storage->ctx, image, total);
+	if(esp_err == ESP_OK){
+		memcpy(config->image, image, total);
+		config->image_size = total;
+	}
+
+	free(image);
+	return esp_err;
+}
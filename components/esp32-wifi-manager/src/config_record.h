@@ -0,0 +1,82 @@
+/**
+@file config_record.h
+@brief One versioned, CRC checked record holding the whole configuration
+
+The record is written with a single blob write. Fields are only ever
+appended: a record from a later firmware is longer, the bytes this one does
+not know are kept and written back unchanged. One from an earlier firmware is
+shorter, the fields it did not have keep their defaults. A copy of the last
+record read or written stays in RAM, so saving an unchanged configuration
+costs no flash write.
+
+The record logic only talks to the flash through a config_record_storage_t,
+so it runs on the host against an in-memory store.
+
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#ifndef WIFI_MANAGER_CONFIG_RECORD_H_INCLUDED
+#define WIFI_MANAGER_CONFIG_RECORD_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Largest record in bytes, room for the fields later firmware appends */
+#define CONFIG_RECORD_MAX_SIZE				512
+
+/**
+ * @brief Start of every record, the CRC covers everything after it.
+ */
+typedef struct {
+	uint16_t version;
+	uint16_t size;							/**< bytes of the whole record, header included */
+	uint32_t crc;							/**< CRC-32 of the bytes after the header */
+} config_record_header_t;
+
+/**
+ * @brief Where the record is stored. The wifi manager plugs one NVS blob in.
+ */
+typedef struct {
+	void *ctx;
+	esp_err_t (*read)(void *ctx, void *record, size_t *size);			/**< size holds the room on entry, the blob size on return */
+	esp_err_t (*write)(void *ctx, const void *record, size_t size);		/**< written and committed at once */
+} config_record_storage_t;
+
+/**
+ * @brief A record and the copy of it last seen in storage.
+ */
+typedef struct {
+	uint16_t version;						/**< layout version, only bumped for incompatible changes */
+	uint16_t min_size;						/**< shortest record accepted, the fields every firmware wrote */
+	const config_record_storage_t *storage;
+	uint8_t image[CONFIG_RECORD_MAX_SIZE];
+	size_t image_size;						/**< 0 when storage holds no valid record */
+} config_record_t;
+
+/**
+ * @brief Reads the record from storage into record, which starts with a config_record_header_t.
+ *
+ * record holds the defaults on entry. Fields missing from a shorter record keep them, bytes of a longer
+ * record beyond size are only kept in the image.
+ * @return false if there is no record or it is corrupted or of another version, record is then untouched.
+ */
+bool config_record_load(config_record_t *config, void *record, size_t size);
+
+/**
+ * @brief Writes record to storage unless it matches the image. The header is filled in on the way, bytes
+ * of a later firmware are carried over from the image.
+ * @return ESP_OK when written or unchanged. On an error the image is left as it was, so the next save retries.
+ */
+esp_err_t config_record_save(config_record_t *config, const void *record, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_CONFIG_RECORD_H_INCLUDED */
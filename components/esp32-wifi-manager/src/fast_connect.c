@@ -0,0 +1,214 @@
+/**
+@file fast_connect.c
+@brief Reconnects straight to the last access point, skipping the full scan
+
+@see fast_connect.h
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <string.h>
+#include <esp_log.h>
+#include <mbedtls/version.h>
+#include <mbedtls/md.h>
+#include <mbedtls/pkcs5.h>
+#include "fast_connect.h"
+
+
+static const char TAG[] = "fast_connect";
+
+#define BSSIDSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+#define BSSID2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+static const fast_connect_driver_t *fast_connect_driver = NULL;
+static fast_connect_state_t fast_connect_state = FAST_CONNECT_IDLE;
+static fast_connect_cache_t fast_connect_cache;
+static bool fast_connect_cache_valid = false;
+
+/* the plain attempt, kept to fall back on after a targeted one */
+static wifi_config_t fast_connect_config;
+
+
+/* FNV-1a of the ssid and password, a record of other credentials is useless */
+static uint32_t fast_connect_credentials(const wifi_config_t *config){
+	uint32_t hash = 2166136261u;
+
+	for(int i = 0; i < sizeof(config->sta.ssid) && config->sta.ssid[i]; i++){
+		hash = (hash ^ config->sta.ssid[i]) * 16777619u;
+	}
+	hash = (hash ^ 0xff) * 16777619u;
+	for(int i = 0; i < sizeof(config->sta.password) && config->sta.password[i]; i++){
+		hash = (hash ^ config->sta.password[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/* the authentications where the PMK comes from the passphrase alone. SAE derives it per connection */
+static bool fast_connect_uses_psk(uint8_t authmode){
+	return authmode == WIFI_AUTH_WPA_PSK || authmode == WIFI_AUTH_WPA2_PSK || authmode == WIFI_AUTH_WPA_WPA2_PSK;
+}
+
+/* the pinned attempt may have failed because the PMK is wrong, e.g. the password was changed on the access point */
+static bool fast_connect_is_auth_failure(uint8_t reason){
+	switch(reason){
+	case WIFI_REASON_AUTH_EXPIRE:
+	case WIFI_REASON_MIC_FAILURE:
+	case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+	case WIFI_REASON_802_1X_AUTH_FAILED:
+	case WIFI_REASON_AUTH_FAIL:
+	case WIFI_REASON_HANDSHAKE_TIMEOUT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static esp_err_t fast_connect_attempt(wifi_config_t *config){
+	esp_err_t err = fast_connect_driver->set_config(fast_connect_driver->ctx, config);
+
+	if(err == ESP_OK){
+		err = fast_connect_driver->connect(fast_connect_driver->ctx);
+	}
+
+	return err;
+}
+
+
+esp_err_t fast_connect_derive_pmk(const wifi_config_t *config, uint8_t *pmk){
+	const uint8_t *ssid = config->sta.ssid;
+	const uint8_t *password = config->sta.password;
+	size_t ssid_len = strnlen((const char*)ssid, sizeof(config->sta.ssid));
+	size_t password_len = strnlen((const char*)password, sizeof(config->sta.password));
+	int ret;
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+	ret = mbedtls_pkcs5_pbkdf2_hmac_ext(MBEDTLS_MD_SHA1, password, password_len, ssid, ssid_len, 4096, FAST_CONNECT_PMK_SIZE, pmk);
+#else
+	mbedtls_md_context_t md;
+	mbedtls_md_init(&md);
+	ret = mbedtls_md_setup(&md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+	if(ret == 0){
+		ret = mbedtls_pkcs5_pbkdf2_hmac(&md, password, password_len, ssid, ssid_len, 4096, FAST_CONNECT_PMK_SIZE, pmk);
+	}
+	mbedtls_md_free(&md);
+#endif
+
+	return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+void fast_connect_init(const fast_connect_driver_t *driver){
+	fast_connect_driver = driver;
+	fast_connect_state = FAST_CONNECT_IDLE;
+	fast_connect_cache_valid = driver->load(driver->ctx, &fast_connect_cache) == ESP_OK &&
+			fast_connect_cache.version == FAST_CONNECT_CACHE_VERSION;
+
+	if(fast_connect_cache_valid){
+		ESP_LOGI(TAG, "last access point: "BSSIDSTR" on channel %u", BSSID2STR(fast_connect_cache.bssid), fast_connect_cache.channel);
+	}
+}
+
+esp_err_t fast_connect_start(const wifi_config_t *config){
+	static const char hex[] = "0123456789abcdef";
+
+	fast_connect_config = *config;
+	fast_connect_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+	fast_connect_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+	fast_connect_config.sta.bssid_set = false;
+	fast_connect_config.sta.channel = 0;
+
+	if(!fast_connect_cache_valid || fast_connect_cache.credentials != fast_connect_credentials(config)){
+		fast_connect_state = FAST_CONNECT_FULL_SCAN;
+		return fast_connect_attempt(&fast_connect_config);
+	}
+
+	wifi_config_t targeted = fast_connect_config;
+	targeted.sta.scan_method = WIFI_FAST_SCAN;
+	targeted.sta.bssid_set = true;
+	memcpy(targeted.sta.bssid, fast_connect_cache.bssid, sizeof(targeted.sta.bssid));
+	targeted.sta.channel = fast_connect_cache.channel;
+
+	/* 64 hex digits are taken as the PSK itself */
+	if(fast_connect_cache.pmk_set){
+		for(int i = 0; i < FAST_CONNECT_PMK_SIZE; i++){
+			targeted.sta.password[2 * i] = hex[fast_connect_cache.pmk[i] >> 4];
+			targeted.sta.password[2 * i + 1] = hex[fast_connect_cache.pmk[i] & 0x0f];
+		}
+	}
+
+	ESP_LOGI(TAG, "targeted attempt at "BSSIDSTR" on channel %u", BSSID2STR(targeted.sta.bssid), targeted.sta.channel);
+	fast_connect_state = FAST_CONNECT_TARGETED;
+	return fast_connect_attempt(&targeted);
+}
+
+bool fast_connect_on_disconnected(uint8_t reason){
+	if(fast_connect_state != FAST_CONNECT_TARGETED){
+		fast_connect_state = FAST_CONNECT_IDLE;
+		return false;
+	}
+
+	ESP_LOGI(TAG, "targeted attempt failed with reason %u, scanning all channels", reason);
+	if(fast_connect_is_auth_failure(reason)){
+		/* the next success writes a new record */
+		fast_connect_cache_valid = false;
+	}
+
+	fast_connect_state = FAST_CONNECT_FULL_SCAN;
+	if(fast_connect_attempt(&fast_connect_config) != ESP_OK){
+		fast_connect_state = FAST_CONNECT_IDLE;
+		return false;
+	}
+
+	return true;
+}
+
+void fast_connect_on_connected(const wifi_config_t *config){
+	wifi_ap_record_t ap;
+	fast_connect_cache_t cache;
+
+	fast_connect_state = FAST_CONNECT_IDLE;
+	if(fast_connect_driver->get_ap_info(fast_connect_driver->ctx, &ap) != ESP_OK){
+		return;
+	}
+
+	memset(&cache, 0x00, sizeof(cache));
+	cache.version = FAST_CONNECT_CACHE_VERSION;
+	cache.channel = ap.primary;
+	cache.authmode = ap.authmode;
+	memcpy(cache.bssid, ap.bssid, sizeof(cache.bssid));
+	cache.credentials = fast_connect_credentials(config);
+
+	/* a password of 64 characters already is the PSK */
+	if(fast_connect_uses_psk(ap.authmode) && strnlen((const char*)config->sta.password, sizeof(config->sta.password)) < sizeof(config->sta.password)){
+		if(fast_connect_cache_valid && fast_connect_cache.pmk_set && fast_connect_cache.credentials == cache.credentials){
+			memcpy(cache.pmk, fast_connect_cache.pmk, sizeof(cache.pmk));
+			cache.pmk_set = true;
+		}
+		else if(fast_connect_derive_pmk(config, cache.pmk) == ESP_OK){
+			cache.pmk_set = true;
+		}
+	}
+
+	/* same access point as last time: spare the flash */
+	if(fast_connect_cache_valid && memcmp(&cache, &fast_connect_cache, sizeof(cache)) == 0){
+		return;
+	}
+
+	fast_connect_cache = cache;
+	fast_connect_cache_valid = true;
+	if(fast_connect_driver->store(fast_connect_driver->ctx, &cache) != ESP_OK){
+		ESP_LOGE(TAG, "could not save the last access point");
+	}
+}
+
+void fast_connect_forget(){
+	fast_connect_state = FAST_CONNECT_IDLE;
+	fast_connect_cache_valid = false;
+	memset(&fast_connect_cache, 0x00, sizeof(fast_connect_cache));
+
+	/* version 0 is never loaded back */
+	fast_connect_driver->store(fast_connect_driver->ctx, &fast_connect_cache);
+}
+
+fast_connect_state_t fast_connect_get_state(){
+	return fast_connect_state;
+}
@@ -0,0 +1,104 @@
+/**
+@file fast_connect.h
+@brief Reconnects straight to the last access point, skipping the full scan
+
+The BSSID, channel and PMK of the last access point that gave us an IP are
+kept in a small record. The next connection with the same credentials is
+first attempted pinned to that BSSID and channel, with the PMK instead of the
+passphrase so the 4096 rounds of PBKDF2 are skipped as well. If that attempt
+fails the regular all channel scan follows right away.
+
+The state machine only talks to the radio and the flash through a
+fast_connect_driver_t, so it runs on the host against a fake driver.
+
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#ifndef WIFI_MANAGER_FAST_CONNECT_H_INCLUDED
+#define WIFI_MANAGER_FAST_CONNECT_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_wifi_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Layout version of fast_connect_cache_t, records of another version are ignored */
+#define FAST_CONNECT_CACHE_VERSION			1
+
+/** @brief Length in bytes of a WPA2 pairwise master key */
+#define FAST_CONNECT_PMK_SIZE				32
+
+/**
+ * @brief What is remembered of the last access point, stored as is.
+ */
+typedef struct {
+	uint8_t version;
+	uint8_t channel;
+	uint8_t authmode;
+	uint8_t pmk_set;						/**< pmk is only used on WPA/WPA2 personal networks */
+	uint8_t bssid[6];
+	uint8_t reserved[2];
+	uint32_t credentials;					/**< hash of the ssid and password this record belongs to */
+	uint8_t pmk[FAST_CONNECT_PMK_SIZE];
+} fast_connect_cache_t;
+
+typedef enum fast_connect_state_t {
+	FAST_CONNECT_IDLE = 0,
+	FAST_CONNECT_TARGETED = 1,				/**< attempt pinned to the cached BSSID and channel */
+	FAST_CONNECT_FULL_SCAN = 2				/**< regular attempt, all channels, best signal */
+} fast_connect_state_t;
+
+/**
+ * @brief Radio and storage used by the state machine. The wifi_manager plugs esp_wifi and NVS in.
+ */
+typedef struct {
+	void *ctx;
+	esp_err_t (*set_config)(void *ctx, wifi_config_t *config);
+	esp_err_t (*connect)(void *ctx);
+	esp_err_t (*get_ap_info)(void *ctx, wifi_ap_record_t *ap);
+	esp_err_t (*load)(void *ctx, fast_connect_cache_t *cache);
+	esp_err_t (*store)(void *ctx, const fast_connect_cache_t *cache);
+} fast_connect_driver_t;
+
+/**
+ * @brief Loads the cache through the driver. The driver must outlive the state machine.
+ */
+void fast_connect_init(const fast_connect_driver_t *driver);
+
+/**
+ * @brief Starts a connection with the given credentials, targeted when the cache matches them.
+ */
+esp_err_t fast_connect_start(const wifi_config_t *config);
+
+/**
+ * @brief To be called on every STA disconnection.
+ * @return true when a failed targeted attempt was followed by a full scan attempt: the disconnection is not a failure yet.
+ */
+bool fast_connect_on_disconnected(uint8_t reason);
+
+/**
+ * @brief To be called once an IP is obtained, remembers the access point. Derives the PMK when the credentials changed.
+ */
+void fast_connect_on_connected(const wifi_config_t *config);
+
+/**
+ * @brief Forgets the access point, in RAM and in storage.
+ */
+void fast_connect_forget();
+
+fast_connect_state_t fast_connect_get_state();
+
+/**
+ * @brief Derives the WPA2 PMK of a passphrase: PBKDF2-HMAC-SHA1, 4096 rounds, salted with the SSID.
+ */
+esp_err_t fast_connect_derive_pmk(const wifi_config_t *config, uint8_t *pmk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_FAST_CONNECT_H_INCLUDED */
@@ -45,6 +45,7 @@ function to process requests, decode URLs, serve files, etc. etc.
 
 #include "wifi_manager.h"
 #include "http_app.h"
+#include "http_etag.h"
 
 
 /* @brief tag used for ESP serial console messages */
@@ -67,21 +68,24 @@ static char* http_ap_url = NULL;
 static char* http_status_url = NULL;
 
 /**
- * @brief embedded binary data.
- * @see file "component.mk"
- * @see https://docs.espressif.com/projects/esp-idf/en/latest/api-guides/build-system.html#embedding-binary-data
+ * @brief gzipped web assets and their ETags, generated at build time.
+ * @see file "web_assets.py"
  */
-extern const uint8_t style_css_start[] asm("_binary_style_css_start");
-extern const uint8_t style_css_end[]   asm("_binary_style_css_end");
-extern const uint8_t code_js_start[] asm("_binary_code_js_start");
-extern const uint8_t code_js_end[] asm("_binary_code_js_end");
-extern const uint8_t index_html_start[] asm("_binary_index_html_start");
-extern const uint8_t index_html_end[] asm("_binary_index_html_end");
+#include "web_assets.h"
+
+/* @brief a web asset kept gzipped in flash */
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	const char *etag;
+	const char *content_type;
+} http_asset_t;
 
 
 /* const httpd related values stored in ROM */
 const static char http_200_hdr[] = "200 OK";
 const static char http_302_hdr[] = "302 Found";
+const static char http_304_hdr[] = "304 Not Modified";
 const static char http_400_hdr[] = "400 Bad Request";
 const static char http_404_hdr[] = "404 Not Found";
 const static char http_503_hdr[] = "503 Service Unavailable";
@@ -92,10 +96,18 @@ const static char http_content_type_css[] = "text/css";
 const static char http_content_type_json[] = "application/json";
 const static char http_cache_control_hdr[] = "Cache-Control";
 const static char http_cache_control_no_cache[] = "no-store, no-cache, must-revalidate, max-age=0";
-const static char http_cache_control_cache[] = "public, max-age=31536000";
+const static char http_cache_control_revalidate[] = "no-cache";
+const static char http_content_encoding_hdr[] = "Content-Encoding";
+const static char http_content_encoding_gzip[] = "gzip";
+const static char http_etag_hdr[] = "ETag";
+const static char http_if_none_match_hdr[] = "If-None-Match";
 const static char http_pragma_hdr[] = "Pragma";
 const static char http_pragma_no_cache[] = "no-cache";
 
+static const http_asset_t http_index_html = { index_html_gz, sizeof(index_html_gz), index_html_etag, http_content_type_html };
+static const http_asset_t http_code_js = { code_js_gz, sizeof(code_js_gz), code_js_etag, http_content_type_js };
+static const http_asset_t http_style_css = { style_css_gz, sizeof(style_css_gz), style_css_etag, http_content_type_css };
+
 
 
 esp_err_t http_app_set_handler_hook( httpd_method_t method,  esp_err_t (*handler)(httpd_req_t *r)  ){
@@ -209,6 +221,42 @@ static esp_err_t http_server_post_handler(httpd_req_t *req){
 }
 
 
+/**
+ * @brief sends a web asset gzipped and straight from flash, or a 304 when the browser already holds this version.
+ * The browser revalidates every time so a firmware update is picked up at once; a match costs a few header bytes.
+ */
+static esp_err_t http_app_send_asset(httpd_req_t *req, const http_asset_t *asset){
+
+	char if_none_match[HTTP_APP_ETAG_HDR_MAX];
+	esp_err_t ret;
+
+	httpd_resp_set_hdr(req, http_etag_hdr, asset->etag);
+	httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_revalidate);
+
+	/* a header too long for the buffer is just treated as no match */
+	if(httpd_req_get_hdr_value_str(req, http_if_none_match_hdr, if_none_match, sizeof(if_none_match)) == ESP_OK &&
+	   http_etag_match(if_none_match, asset->etag)){
+		httpd_resp_set_status(req, http_304_hdr);
+		return httpd_resp_send(req, NULL, 0);
+	}
+
+	httpd_resp_set_status(req, http_200_hdr);
+	httpd_resp_set_type(req, asset->content_type);
+	httpd_resp_set_hdr(req, http_content_encoding_hdr, http_content_encoding_gzip);
+	for(size_t offset = 0; offset < asset->size; offset += HTTP_APP_CHUNK_SIZE){
+		size_t len = asset->size - offset;
+		if(len > HTTP_APP_CHUNK_SIZE) len = HTTP_APP_CHUNK_SIZE;
+		ret = httpd_resp_send_chunk(req, (const char*)asset->data + offset, len);
+		if(ret != ESP_OK){
+			ESP_LOGW(TAG, "sending %s aborted (%s)", req->uri, esp_err_to_name(ret));
+			return ret;
+		}
+	}
+
+	return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+
 static esp_err_t http_server_get_handler(httpd_req_t *req){
 
     char* host = NULL;
@@ -229,9 +277,7 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
     }
 
 	/* determine if Host is from the STA IP address */
-	wifi_manager_lock_sta_ip_string(portMAX_DELAY);
-	bool access_from_sta_ip = (host != NULL) ? (strstr(host, wifi_manager_get_sta_ip_string())) : false;
-	wifi_manager_unlock_sta_ip_string();
+	bool access_from_sta_ip = wifi_manager_match_sta_ip(host);
 
 
 	if (host != NULL && !strstr(host, DEFAULT_AP_IP) && !access_from_sta_ip) {
@@ -247,41 +293,34 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 
 		/* GET /  */
 		if(strcmp(req->uri, http_root_url) == 0){
-			httpd_resp_set_status(req, http_200_hdr);
-			httpd_resp_set_type(req, http_content_type_html);
-			httpd_resp_send(req, (char*)index_html_start, index_html_end - index_html_start);
+			http_app_send_asset(req, &http_index_html);
 		}
 		/* GET /code.js */
 		else if(strcmp(req->uri, http_js_url) == 0){
-			httpd_resp_set_status(req, http_200_hdr);
-			httpd_resp_set_type(req, http_content_type_js);
-			httpd_resp_send(req, (char*)code_js_start, code_js_end - code_js_start);
+			http_app_send_asset(req, &http_code_js);
 		}
 		/* GET /style.css */
 		else if(strcmp(req->uri, http_css_url) == 0){
-			httpd_resp_set_status(req, http_200_hdr);
-			httpd_resp_set_type(req, http_content_type_css);
-			httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_cache);
-			httpd_resp_send(req, (char*)style_css_start, style_css_end - style_css_start);
+			http_app_send_asset(req, &http_style_css);
 		}
 		/* GET /ap.json */
 		else if(strcmp(req->uri, http_ap_url) == 0){
 
-			/* if we can get the mutex, write the last version of the AP list */
-			if(wifi_manager_lock_json_buffer(( TickType_t ) 10)){
-
+			/* send the last version of the AP list, the wifi manager can refresh it meanwhile */
+			size_t len;
+			const char *ap_json = wifi_manager_acquire_ap_list_json(&len);
+			if(ap_json){
 				httpd_resp_set_status(req, http_200_hdr);
 				httpd_resp_set_type(req, http_content_type_json);
 				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
 				httpd_resp_set_hdr(req, http_pragma_hdr, http_pragma_no_cache);
-				char* ap_buf = wifi_manager_get_ap_list_json();
-				httpd_resp_send(req, ap_buf, strlen(ap_buf));
-				wifi_manager_unlock_json_buffer();
+				httpd_resp_send(req, ap_json, len);
+				wifi_manager_release_json(ap_json);
 			}
 			else{
 				httpd_resp_set_status(req, http_503_hdr);
 				httpd_resp_send(req, NULL, 0);
-				ESP_LOGE(TAG, "http_server_netconn_serve: GET /ap.json failed to obtain mutex");
+				ESP_LOGE(TAG, "http_server_netconn_serve: GET /ap.json: nothing published yet");
 			}
 
 			/* request a wifi scan */
@@ -290,25 +329,20 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 		/* GET /status.json */
 		else if(strcmp(req->uri, http_status_url) == 0){
 
-			if(wifi_manager_lock_json_buffer(( TickType_t ) 10)){
-				char *buff = wifi_manager_get_ip_info_json();
-				if(buff){
-					httpd_resp_set_status(req, http_200_hdr);
-					httpd_resp_set_type(req, http_content_type_json);
-					httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
-					httpd_resp_set_hdr(req, http_pragma_hdr, http_pragma_no_cache);
-					httpd_resp_send(req, buff, strlen(buff));
-					wifi_manager_unlock_json_buffer();
-				}
-				else{
-					httpd_resp_set_status(req, http_503_hdr);
-					httpd_resp_send(req, NULL, 0);
-				}
+			size_t len;
+			const char *ip_info_json = wifi_manager_acquire_ip_info_json(&len);
+			if(ip_info_json){
+				httpd_resp_set_status(req, http_200_hdr);
+				httpd_resp_set_type(req, http_content_type_json);
+				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+				httpd_resp_set_hdr(req, http_pragma_hdr, http_pragma_no_cache);
+				httpd_resp_send(req, ip_info_json, len);
+				wifi_manager_release_json(ip_info_json);
 			}
 			else{
 				httpd_resp_set_status(req, http_503_hdr);
 				httpd_resp_send(req, NULL, 0);
-				ESP_LOGE(TAG, "http_server_netconn_serve: GET /status.json failed to obtain mutex");
+				ESP_LOGE(TAG, "http_server_netconn_serve: GET /status.json: nothing published yet");
 			}
 		}
 		else{
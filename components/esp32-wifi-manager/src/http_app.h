@@ -48,6 +48,12 @@ extern "C" {
  */
 #define WEBAPP_LOCATION 					CONFIG_WEBAPP_LOCATION
 
+/** @brief Bytes of a web asset handed to the socket per chunk, one TCP segment with the chunk framing. Sent from flash as is, no copy is made. */
+#define HTTP_APP_CHUNK_SIZE					1436
+
+/** @brief Longest If-None-Match header checked against an ETag. Longer ones are answered with the full asset. */
+#define HTTP_APP_ETAG_HDR_MAX				128
+
 
 /** 
  * @brief spawns the http server 
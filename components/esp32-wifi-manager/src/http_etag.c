@@ -0,0 +1,38 @@
+/**
+@file http_etag.c
+@brief Entity tag matching for conditional GET requests
+
+@see http_etag.h
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include "http_etag.h"
+
+
+bool http_etag_match(const char *if_none_match, const char *etag){
+
+	size_t etag_len = strlen(etag);
+	const char *p = if_none_match;
+
+	while(*p != '\0'){
+		while(*p == ' ' || *p == '\t' || *p == ',') p++;
+		if(*p == '*') return true;
+		if(p[0] == 'W' && p[1] == '/') p += 2;
+
+		/* an entity tag is a quoted string, it may hold commas */
+		const char *end = p;
+		if(*end == '"'){
+			end = strchr(end + 1, '"');
+			if(end == NULL) return false;
+			end++;
+		}
+		if((size_t)(end - p) == etag_len && strncmp(p, etag, etag_len) == 0) return true;
+
+		p = end;
+		while(*p != '\0' && *p != ',') p++;
+	}
+
+	return false;
+}
@@ -0,0 +1,33 @@
+/**
+@file http_etag.h
+@brief Entity tag matching for conditional GET requests
+
+Kept out of http_app.c so it builds without the HTTP server, on the host too.
+
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#ifndef HTTP_ETAG_H_INCLUDED
+#define HTTP_ETAG_H_INCLUDED
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief checks an If-None-Match header value against an ETag.
+ * Uses the weak comparison required for If-None-Match: W/ prefixes are ignored and "*" matches anything.
+ * @param if_none_match the header value, a comma separated list of entity tags.
+ * @param etag the current entity tag, quotes included.
+ * @return true if the client copy is current and a 304 can be sent.
+ */
+bool http_etag_match(const char *if_none_match, const char *etag);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -32,112 +32,151 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "json.h"
 
 
-bool json_print_string(const unsigned char *input, unsigned char *output_buffer)
+void json_writer_init(json_writer_t *writer, char *buf, size_t size)
 {
-	const unsigned char *input_pointer = NULL;
-	unsigned char *output = NULL;
-	unsigned char *output_pointer = NULL;
-	size_t output_length = 0;
-	/* numbers of additional characters needed for escaping */
-	size_t escape_characters = 0;
-
-	if (output_buffer == NULL)
+	writer->buf = buf;
+	writer->size = size;
+	writer->len = 0;
+	writer->overflow = (size == 0);
+	if (size > 0)
 	{
-		return false;
+		buf[0] = '\0';
 	}
+}
 
-	/* empty string */
-	if (input == NULL)
+void json_writer_rewind(json_writer_t *writer, size_t len)
+{
+	if (len <= writer->len && writer->size > 0)
 	{
-		//output = ensure(output_buffer, sizeof("\"\""), hooks);
-		if (output == NULL)
-		{
-			return false;
-		}
-		strcpy((char*)output, "\"\"");
-
-		return true;
+		writer->len = len;
+		writer->buf[len] = '\0';
+		writer->overflow = false;
 	}
+}
 
-	/* set "flag" to 1 if something needs to be escaped */
-	for (input_pointer = input; *input_pointer; input_pointer++)
+bool json_write_raw(json_writer_t *writer, const char *data, size_t n)
+{
+	if (writer->overflow || n >= writer->size - writer->len)
 	{
-		if (strchr("\"\\\b\f\n\r\t", *input_pointer))
-		{
-			/* one character escape sequence */
-			escape_characters++;
-		}
-		else if (*input_pointer < 32)
-		{
-			/* UTF-16 escape sequence uXXXX */
-			escape_characters += 5;
-		}
+		writer->overflow = true;
+		return false;
 	}
-	output_length = (size_t)(input_pointer - input) + escape_characters;
+	memcpy(writer->buf + writer->len, data, n);
+	writer->len += n;
+	writer->buf[writer->len] = '\0';
 
-	/* in the original cJSON it is possible to realloc here in case output buffer is too small.
-	 * This is overkill for an embedded system. */
-	output = output_buffer;
+	return true;
+}
+
+bool json_write_str(json_writer_t *writer, const char *str)
+{
+	return json_write_raw(writer, str, strlen(str));
+}
 
-	/* no characters have to be escaped */
-	if (escape_characters == 0)
+bool json_write_int(json_writer_t *writer, int value)
+{
+	char digits[12];
+	char *p = digits + sizeof(digits);
+	unsigned int u = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+
+	do
+	{
+		*--p = (char)('0' + u % 10);
+		u /= 10;
+	} while (u > 0);
+	if (value < 0)
 	{
-		output[0] = '\"';
-		memcpy(output + 1, input, output_length);
-		output[output_length + 1] = '\"';
-		output[output_length + 2] = '\0';
+		*--p = '-';
+	}
+
+	return json_write_raw(writer, p, (size_t)(digits + sizeof(digits) - p));
+}
 
-		return true;
+bool json_write_string(json_writer_t *writer, const unsigned char *input, size_t max_len)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t start = writer->len;
+	size_t i;
+
+	if (!json_write_raw(writer, "\"", 1))
+	{
+		return false;
 	}
 
-	output[0] = '\"';
-	output_pointer = output + 1;
-	/* copy the string */
-	for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+	for (i = 0; input != NULL && i < max_len && input[i] != '\0'; i++)
 	{
-		if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
-		{
-			/* normal character, copy */
-			*output_pointer = *input_pointer;
-		}
-		else
+		unsigned char c = input[i];
+		char escaped[6] = { '\\', c, 0, 0, 0, 0 };
+		size_t n = 2;
+
+		switch (c)
 		{
-			/* character needs to be escaped */
-			*output_pointer++ = '\\';
-			switch (*input_pointer)
+		case '\\':
+		case '\"':
+			break;
+		case '\b':
+			escaped[1] = 'b';
+			break;
+		case '\f':
+			escaped[1] = 'f';
+			break;
+		case '\n':
+			escaped[1] = 'n';
+			break;
+		case '\r':
+			escaped[1] = 'r';
+			break;
+		case '\t':
+			escaped[1] = 't';
+			break;
+		default:
+			if (c > 31)
+			{
+				/* normal character, copy */
+				escaped[0] = (char)c;
+				n = 1;
+			}
+			else
 			{
-			case '\\':
-				*output_pointer = '\\';
-				break;
-			case '\"':
-				*output_pointer = '\"';
-				break;
-			case '\b':
-				*output_pointer = 'b';
-				break;
-			case '\f':
-				*output_pointer = 'f';
-				break;
-			case '\n':
-				*output_pointer = 'n';
-				break;
-			case '\r':
-				*output_pointer = 'r';
-				break;
-			case '\t':
-				*output_pointer = 't';
-				break;
-			default:
 				/* escape and print as unicode codepoint */
-				sprintf((char*)output_pointer, "u%04x", *input_pointer);
-				output_pointer += 4;
-				break;
+				escaped[1] = 'u';
+				escaped[2] = '0';
+				escaped[3] = '0';
+				escaped[4] = hex[c >> 4];
+				escaped[5] = hex[c & 0xf];
+				n = 6;
 			}
+			break;
+		}
+
+		if (!json_write_raw(writer, escaped, n))
+		{
+			break;
 		}
 	}
-	output[output_length + 1] = '\"';
-	output[output_length + 2] = '\0';
+
+	if (writer->overflow || !json_write_raw(writer, "\"", 1))
+	{
+		/* never leave half a string behind */
+		writer->len = start;
+		writer->buf[start] = '\0';
+		writer->overflow = true;
+		return false;
+	}
 
 	return true;
 }
 
+bool json_print_string(const unsigned char *input, unsigned char *output_buffer, size_t size)
+{
+	json_writer_t writer;
+
+	if (output_buffer == NULL)
+	{
+		return false;
+	}
+
+	json_writer_init(&writer, (char*)output_buffer, size);
+
+	return json_write_string(&writer, input, (size_t)-1);
+}
@@ -28,17 +28,70 @@ OTHER DEALINGS IN THE SOFTWARE.
 #ifndef JSON_H_INCLUDED
 #define JSON_H_INCLUDED
 
+#include <stddef.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Append-only JSON output into a fixed buffer.
+ * The cursor is tracked so nothing is ever rescanned, and the buffer is always NUL terminated.
+ * A write that does not fit sets overflow and leaves the output cut at the last complete write.
+ */
+typedef struct {
+	char *buf;
+	size_t size;		/* bytes in buf, terminator included */
+	size_t len;			/* current length of the output */
+	bool overflow;
+} json_writer_t;
+
+/**
+ * @brief Starts writing at the beginning of buf.
+ */
+void json_writer_init(json_writer_t *writer, char *buf, size_t size);
+
+/**
+ * @brief Appends n bytes as they are.
+ * @return false if they do not fit.
+ */
+bool json_write_raw(json_writer_t *writer, const char *data, size_t n);
+
+/**
+ * @brief Appends a NUL terminated string as it is, for JSON punctuation and keys.
+ * @return false if it does not fit.
+ */
+bool json_write_str(json_writer_t *writer, const char *str);
+
+/**
+ * @brief Appends a quoted, escaped JSON string in a single pass.
+ * @param input the string, NULL is written as "".
+ * @param max_len stops at max_len bytes when the input is not NUL terminated before, e.g. a 32 byte SSID field.
+ * @return false if it does not fit.
+ */
+bool json_write_string(json_writer_t *writer, const unsigned char *input, size_t max_len);
+
+/**
+ * @brief Appends a decimal integer.
+ * @return false if it does not fit.
+ */
+bool json_write_int(json_writer_t *writer, int value);
+
+/**
+ * @brief Moves the cursor back to an earlier length, e.g. to drop an element that did not fit.
+ */
+void json_writer_rewind(json_writer_t *writer, size_t len);
+
 /**
  * @brief Render the cstring provided to a JSON escaped version that can be printed.
  * @param input the input buffer to be escaped.
- * @param output_buffer the output buffer to write to. You must ensure it is big enough to contain the final string.
+ * @param output_buffer the output buffer to write to.
+ * @param size bytes in output_buffer, terminator included.
+ * @return false if the quoted string does not fit, output_buffer is then empty.
  * @see cJSON equivlaent static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
  */
-bool json_print_string(const unsigned char *input, unsigned char *output_buffer);
+bool json_print_string(const unsigned char *input, unsigned char *output_buffer, size_t size);
 
 #ifdef __cplusplus
 }
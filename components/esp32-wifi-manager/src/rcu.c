@@ -0,0 +1,107 @@
+/**
+@file rcu.c
+@brief Lock-free publication of immutable snapshots, read-copy-update style
+
+@see rcu.h
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stddef.h>
+#include "rcu.h"
+
+/* the only RTOS call: a writer waiting for readers lets them run */
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+static inline void rcu_yield(void){
+	vTaskDelay(1);
+}
+#else
+#include <sched.h>
+static inline void rcu_yield(void){
+	sched_yield();
+}
+#endif
+
+
+void rcu_init(rcu_domain_t *domain, bool (*reclaim)(void *ptr)){
+	atomic_init(&domain->epoch, 0);
+	atomic_init(&domain->readers[0], 0);
+	atomic_init(&domain->readers[1], 0);
+	domain->retired_count = 0;
+	domain->reclaim = reclaim;
+}
+
+uint32_t rcu_read_lock(rcu_domain_t *domain){
+	for(;;){
+		uint32_t epoch = atomic_load(&domain->epoch);
+		atomic_fetch_add(&domain->readers[epoch & 1], 1);
+		/* the epoch moved on before we were counted: the writer may already have found this counter empty */
+		if(atomic_load(&domain->epoch) == epoch){
+			return epoch;
+		}
+		atomic_fetch_sub(&domain->readers[epoch & 1], 1);
+	}
+}
+
+void rcu_read_unlock(rcu_domain_t *domain, uint32_t token){
+	atomic_fetch_sub(&domain->readers[token & 1], 1);
+}
+
+/* the next epoch reuses the counter of the previous one, it must have drained */
+static bool rcu_advance(rcu_domain_t *domain){
+	uint32_t epoch = atomic_load(&domain->epoch);
+
+	if(atomic_load(&domain->readers[(epoch + 1) & 1]) != 0){
+		return false;
+	}
+	atomic_store(&domain->epoch, epoch + 1);
+	return true;
+}
+
+uint8_t rcu_poll(rcu_domain_t *domain){
+	if(domain->retired_count == 0){
+		return 0;
+	}
+
+	if(rcu_advance(domain)){
+		rcu_advance(domain);
+	}
+
+	uint32_t epoch = atomic_load(&domain->epoch);
+	for(int i = 0; i < domain->retired_count; ){
+		rcu_retired_t *r = &domain->retired[i];
+		if(epoch - r->epoch >= 2 && domain->reclaim(r->ptr)){
+			*r = domain->retired[--domain->retired_count];
+		}
+		else{
+			i++;
+		}
+	}
+
+	return domain->retired_count;
+}
+
+void rcu_publish(rcu_domain_t *domain, rcu_ptr_t *slot, void *ptr){
+	void *old = atomic_exchange(slot, ptr);
+
+	if(old == NULL){
+		return;
+	}
+
+	/* a full list means long lived readers: wait for one of them to let go */
+	while(rcu_poll(domain) == RCU_MAX_RETIRED){
+		rcu_yield();
+	}
+
+	domain->retired[domain->retired_count].ptr = old;
+	domain->retired[domain->retired_count].epoch = atomic_load(&domain->epoch);
+	domain->retired_count++;
+	rcu_poll(domain);
+}
+
+void rcu_synchronize(rcu_domain_t *domain){
+	while(rcu_poll(domain) > 0){
+		rcu_yield();
+	}
+}
@@ -0,0 +1,96 @@
+/**
+@file rcu.h
+@brief Lock-free publication of immutable snapshots, read-copy-update style
+
+A writer builds a new version of an object off to the side and publishes it
+with one atomic pointer swap. Readers take the pointer inside a read section
+and never block. The old version is retired and handed back to its owner once
+every read section that could have seen it has ended.
+
+Grace periods are tracked with a two-phase epoch: a reader registers in the
+counter of the current epoch parity, the epoch only moves on once the other
+parity has drained, so an object retired in epoch E is unreachable once the
+epoch reaches E + 2. Plain C11 atomics, no RTOS call on the read side, so the
+same code runs on the host under pthreads.
+
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#ifndef WIFI_MANAGER_RCU_H_INCLUDED
+#define WIFI_MANAGER_RCU_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Retired objects a domain keeps before a publish has to wait for readers */
+#define RCU_MAX_RETIRED						8
+
+/** @brief A published pointer */
+typedef _Atomic(void*) rcu_ptr_t;
+
+typedef struct {
+	void *ptr;
+	uint32_t epoch;
+} rcu_retired_t;
+
+/**
+ * @brief Readers and retired objects of a set of published pointers.
+ * Read side functions can be called from any task at any time. Publish, poll and synchronize
+ * must be serialized by the caller, e.g. with the mutex that already orders the writers.
+ */
+typedef struct {
+	_Atomic uint32_t epoch;
+	_Atomic uint32_t readers[2];
+	rcu_retired_t retired[RCU_MAX_RETIRED];
+	uint8_t retired_count;
+	/** Called once ptr is unreachable from read sections. Returning false keeps it retired, to be asked again later. */
+	bool (*reclaim)(void *ptr);
+} rcu_domain_t;
+
+void rcu_init(rcu_domain_t *domain, bool (*reclaim)(void *ptr));
+
+/**
+ * @brief Enters a read section. Lock-free, never waits for a writer.
+ * @return a token for rcu_read_unlock.
+ */
+uint32_t rcu_read_lock(rcu_domain_t *domain);
+
+/**
+ * @brief Leaves a read section. Pointers loaded inside it must not be used afterwards.
+ */
+void rcu_read_unlock(rcu_domain_t *domain, uint32_t token);
+
+/**
+ * @brief Loads a published pointer, only valid inside a read section.
+ */
+static inline void* rcu_dereference(rcu_ptr_t *slot){
+	return atomic_load(slot);
+}
+
+/**
+ * @brief Makes ptr the published version and retires the previous one.
+ * Only blocks when RCU_MAX_RETIRED old versions are all still in use.
+ */
+void rcu_publish(rcu_domain_t *domain, rcu_ptr_t *slot, void *ptr);
+
+/**
+ * @brief Advances the epoch when readers allow it and reclaims what became unreachable.
+ * @return the number of objects still retired.
+ */
+uint8_t rcu_poll(rcu_domain_t *domain);
+
+/**
+ * @brief Waits until every retired object has been reclaimed.
+ */
+void rcu_synchronize(rcu_domain_t *domain);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_RCU_H_INCLUDED */
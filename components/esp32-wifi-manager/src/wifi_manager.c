@@ -34,6 +34,7 @@ Contains the freeRTOS task and all necessary support
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <esp_system.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
@@ -56,6 +57,8 @@ Contains the freeRTOS task and all necessary support
 
 
 #include "json.h"
+#include "rcu.h"
+#include "fast_connect.h"
 #include "dns_server.h"
 #include "nvs_sync.h"
 #include "wifi_manager.h"
@@ -73,13 +76,31 @@ TimerHandle_t wifi_manager_retry_timer = NULL;
  * There is no point hogging a hardware timer for a functionality like this which only needs to be 'accurate enough' */
 TimerHandle_t wifi_manager_shutdown_ap_timer = NULL;
 
+/* @brief orders the writers of the published snapshots, readers never take it */
 SemaphoreHandle_t wifi_manager_json_mutex = NULL;
 SemaphoreHandle_t wifi_manager_sta_ip_mutex = NULL;
-char *wifi_manager_sta_ip = NULL;
-uint16_t ap_num = MAX_AP_NUM;
-wifi_ap_record_t *accessp_records;
-char *accessp_json = NULL;
-char *ip_info_json = NULL;
+uint16_t ap_num = 0;
+wifi_manager_ap_t *accessp_records;
+
+/**
+ * @brief an immutable version of a string shared with other tasks: the AP list, the connection status or the STA IP.
+ * A new version is built on the side and published with a pointer swap, see rcu.h. Readers that keep it past
+ * their read section, like an HTTP response, hold a reference and the old version is freed once they let go.
+ */
+typedef struct {
+	uint32_t version;
+	_Atomic uint32_t refs;
+	size_t len;
+	char data[];
+} wifi_manager_snapshot_t;
+
+static rcu_domain_t wifi_manager_rcu;
+static rcu_ptr_t accessp_json = NULL;
+static rcu_ptr_t ip_info_json = NULL;
+static rcu_ptr_t wifi_manager_sta_ip = NULL;
+static uint32_t wifi_manager_snapshot_version = 0;
+
+static bool wifi_manager_snapshot_reclaim(void *ptr);
 wifi_config_t* wifi_manager_config_sta = NULL;
 
 /* @brief Array of callback function pointers */
@@ -113,6 +134,21 @@ struct wifi_settings_t wifi_settings = {
 
 const char wifi_manager_nvs_namespace[] = "espwifimgr";
 
+static esp_err_t wifi_manager_config_nvs_read(void *ctx, void *record, size_t *size);
+static esp_err_t wifi_manager_config_nvs_write(void *ctx, const void *record, size_t size);
+
+static const config_record_storage_t wifi_manager_config_storage = {
+	.read = wifi_manager_config_nvs_read,
+	.write = wifi_manager_config_nvs_write,
+};
+
+/* @brief the config record, a record without the settings is from a firmware that had separate blobs */
+static config_record_t wifi_manager_config = {
+	.version = WIFI_MANAGER_CONFIG_VERSION,
+	.min_size = offsetof(wifi_manager_config_record_t, settings),
+	.storage = &wifi_manager_config_storage,
+};
+
 static EventGroupHandle_t wifi_manager_event_group;
 
 /* @brief indicate that the ESP32 is currently connected. */
@@ -173,6 +209,69 @@ void wifi_manager_disconnect_async(){
 }
 
 
+static esp_err_t wifi_manager_fast_connect_set_config(void *ctx, wifi_config_t *config){
+	return esp_wifi_set_config(ESP_IF_WIFI_STA, config);
+}
+
+static esp_err_t wifi_manager_fast_connect_connect(void *ctx){
+	return esp_wifi_connect();
+}
+
+static esp_err_t wifi_manager_fast_connect_get_ap_info(void *ctx, wifi_ap_record_t *ap){
+	return esp_wifi_sta_get_ap_info(ap);
+}
+
+/* the last access point is kept next to the ssid, password and settings blobs */
+static esp_err_t wifi_manager_fast_connect_load(void *ctx, fast_connect_cache_t *cache){
+	nvs_handle handle;
+	esp_err_t esp_err;
+	size_t sz = sizeof(fast_connect_cache_t);
+
+	if(!nvs_sync_lock( portMAX_DELAY )){
+		return ESP_ERR_TIMEOUT;
+	}
+	esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READONLY, &handle);
+	if(esp_err == ESP_OK){
+		esp_err = nvs_get_blob(handle, "last_ap", cache, &sz);
+		if(esp_err == ESP_OK && sz != sizeof(fast_connect_cache_t)){
+			esp_err = ESP_ERR_NVS_INVALID_LENGTH;
+		}
+		nvs_close(handle);
+	}
+	nvs_sync_unlock();
+
+	return esp_err;
+}
+
+static esp_err_t wifi_manager_fast_connect_store(void *ctx, const fast_connect_cache_t *cache){
+	nvs_handle handle;
+	esp_err_t esp_err;
+
+	if(!nvs_sync_lock( portMAX_DELAY )){
+		return ESP_ERR_TIMEOUT;
+	}
+	esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READWRITE, &handle);
+	if(esp_err == ESP_OK){
+		esp_err = nvs_set_blob(handle, "last_ap", cache, sizeof(fast_connect_cache_t));
+		if(esp_err == ESP_OK){
+			esp_err = nvs_commit(handle);
+		}
+		nvs_close(handle);
+	}
+	nvs_sync_unlock();
+
+	return esp_err;
+}
+
+static const fast_connect_driver_t wifi_manager_fast_connect_driver = {
+	.ctx = NULL,
+	.set_config = wifi_manager_fast_connect_set_config,
+	.connect = wifi_manager_fast_connect_connect,
+	.get_ap_info = wifi_manager_fast_connect_get_ap_info,
+	.load = wifi_manager_fast_connect_load,
+	.store = wifi_manager_fast_connect_store,
+};
+
 void wifi_manager_start(){
 
 	/* disable the default wifi logging */
@@ -181,14 +280,15 @@ void wifi_manager_start(){
 	/* initialize flash memory */
 	// nvs_flash_init();	//I've already init it in init() function in main.c
 	ESP_ERROR_CHECK(nvs_sync_create()); /* semaphore for thread synchronization on NVS memory */
+	fast_connect_init(&wifi_manager_fast_connect_driver); /* last access point, for a targeted reconnection */
 
 	/* memory allocation */
 	wifi_manager_queue = xQueueCreate(3, sizeof(queue_message));
 	wifi_manager_json_mutex = xSemaphoreCreateMutex();
-	accessp_records = (wifi_ap_record_t*)malloc(sizeof(wifi_ap_record_t) * MAX_AP_NUM);
-	accessp_json = (char*)malloc(MAX_AP_NUM * JSON_ONE_APP_SIZE + 4); /* 4 bytes for json encapsulation of "[\n" and "]\0" */
+	rcu_init(&wifi_manager_rcu, wifi_manager_snapshot_reclaim);
+	accessp_records = (wifi_manager_ap_t*)malloc(sizeof(wifi_manager_ap_t) * MAX_AP_NUM);
+	ap_num = 0;
 	wifi_manager_clear_access_points_json();
-	ip_info_json = (char*)malloc(sizeof(char) * JSON_IP_INFO_SIZE);
 	wifi_manager_clear_ip_info_json();
 	wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
 	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
@@ -198,7 +298,6 @@ void wifi_manager_start(){
 		cb_ptr_arr[i] = NULL;
 	}
 	wifi_manager_sta_ip_mutex = xSemaphoreCreateMutex();
-	wifi_manager_sta_ip = (char*)malloc(sizeof(char) * IP4ADDR_STRLEN_MAX);
 	wifi_manager_safe_update_sta_ip_string((uint32_t)0);
 	wifi_manager_event_group = xEventGroupCreate();
 
@@ -212,186 +311,281 @@ void wifi_manager_start(){
 	xTaskCreate(&wifi_manager, "wifi_manager", 4096, NULL, WIFI_MANAGER_TASK_PRIORITY, &task_wifi_manager);
 }
 
-esp_err_t wifi_manager_save_sta_config(){
-
+static esp_err_t wifi_manager_config_nvs_read(void *ctx, void *record, size_t *size){
 	nvs_handle handle;
 	esp_err_t esp_err;
-	size_t sz;
 
-	/* variables used to check if write is really needed */
-	wifi_config_t tmp_conf;
-	struct wifi_settings_t tmp_settings;
-	memset(&tmp_conf, 0x00, sizeof(tmp_conf));
-	memset(&tmp_settings, 0x00, sizeof(tmp_settings));
-	bool change = false;
+	if(!nvs_sync_lock( portMAX_DELAY )){
+		return ESP_ERR_TIMEOUT;
+	}
+	esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READONLY, &handle);
+	if(esp_err == ESP_OK){
+		esp_err = nvs_get_blob(handle, "config", record, size);
+		nvs_close(handle);
+	}
+	nvs_sync_unlock();
 
-	ESP_LOGI(TAG, "About to save config to flash!!");
+	return esp_err;
+}
 
-	if(wifi_manager_config_sta && nvs_sync_lock( portMAX_DELAY )){
+static esp_err_t wifi_manager_config_nvs_write(void *ctx, const void *record, size_t size){
+	nvs_handle handle;
+	esp_err_t esp_err;
 
-		esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READWRITE, &handle);
-		if (esp_err != ESP_OK){
-			nvs_sync_unlock();
-			return esp_err;
+	if(!nvs_sync_lock( portMAX_DELAY )){
+		ESP_LOGE(TAG, "wifi_manager_save_sta_config failed to acquire nvs_sync mutex");
+		return ESP_ERR_TIMEOUT;
+	}
+	esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READWRITE, &handle);
+	if(esp_err == ESP_OK){
+		esp_err = nvs_set_blob(handle, "config", record, size);
+		if(esp_err == ESP_OK){
+			esp_err = nvs_commit(handle);
 		}
+		nvs_close(handle);
+	}
+	nvs_sync_unlock();
 
-		sz = sizeof(tmp_conf.sta.ssid);
-		esp_err = nvs_get_blob(handle, "ssid", tmp_conf.sta.ssid, &sz);
-		if( (esp_err == ESP_OK  || esp_err == ESP_ERR_NVS_NOT_FOUND) && strcmp( (char*)tmp_conf.sta.ssid, (char*)wifi_manager_config_sta->sta.ssid) != 0){
-			/* different ssid or ssid does not exist in flash: save new ssid */
-			esp_err = nvs_set_blob(handle, "ssid", wifi_manager_config_sta->sta.ssid, 32);
-			if (esp_err != ESP_OK){
-				nvs_sync_unlock();
-				return esp_err;
-			}
-			change = true;
-			ESP_LOGI(TAG, "wifi_manager_wrote wifi_sta_config: ssid:%s",wifi_manager_config_sta->sta.ssid);
+	return esp_err;
+}
 
-		}
+/**
+ * @brief the record of the current config.
+ */
+static void wifi_manager_config_build(wifi_manager_config_record_t *record){
+	memset(record, 0x00, sizeof(wifi_manager_config_record_t));
+	memcpy(record->sta_ssid, wifi_manager_config_sta->sta.ssid, sizeof(record->sta_ssid));
+	memcpy(record->sta_password, wifi_manager_config_sta->sta.password, sizeof(record->sta_password));
+	memcpy(&record->settings, &wifi_settings, sizeof(record->settings));
+}
 
-		sz = sizeof(tmp_conf.sta.password);
-		esp_err = nvs_get_blob(handle, "password", tmp_conf.sta.password, &sz);
-		if( (esp_err == ESP_OK  || esp_err == ESP_ERR_NVS_NOT_FOUND) && strcmp( (char*)tmp_conf.sta.password, (char*)wifi_manager_config_sta->sta.password) != 0){
-			/* different password or password does not exist in flash: save new password */
-			esp_err = nvs_set_blob(handle, "password", wifi_manager_config_sta->sta.password, 64);
-			if (esp_err != ESP_OK){
-				nvs_sync_unlock();
-				return esp_err;
-			}
-			change = true;
-			ESP_LOGI(TAG, "wifi_manager_wrote wifi_sta_config: password:%s",wifi_manager_config_sta->sta.password);
-		}
+/**
+ * @brief reads the config record, a missing, corrupted or incompatible one leaves the config untouched.
+ */
+static bool wifi_manager_config_read(){
+	wifi_manager_config_record_t current;
 
-		sz = sizeof(tmp_settings);
-		esp_err = nvs_get_blob(handle, "settings", &tmp_settings, &sz);
-		if( (esp_err == ESP_OK  || esp_err == ESP_ERR_NVS_NOT_FOUND) &&
-				(
-				strcmp( (char*)tmp_settings.ap_ssid, (char*)wifi_settings.ap_ssid) != 0 ||
-				strcmp( (char*)tmp_settings.ap_pwd, (char*)wifi_settings.ap_pwd) != 0 ||
-				tmp_settings.ap_ssid_hidden != wifi_settings.ap_ssid_hidden ||
-				tmp_settings.ap_bandwidth != wifi_settings.ap_bandwidth ||
-				tmp_settings.sta_only != wifi_settings.sta_only ||
-				tmp_settings.sta_power_save != wifi_settings.sta_power_save ||
-				tmp_settings.ap_channel != wifi_settings.ap_channel
-				)
-		){
-			esp_err = nvs_set_blob(handle, "settings", &wifi_settings, sizeof(wifi_settings));
-			if (esp_err != ESP_OK){
-				nvs_sync_unlock();
-				return esp_err;
-			}
-			change = true;
-
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_ssid: %s",wifi_settings.ap_ssid);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_pwd: %s",wifi_settings.ap_pwd);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_channel: %i",wifi_settings.ap_channel);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_hidden (1 = yes): %i",wifi_settings.ap_ssid_hidden);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_bandwidth (1 = 20MHz, 2 = 40MHz): %i",wifi_settings.ap_bandwidth);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: sta_only (0 = APSTA, 1 = STA when connected): %i",wifi_settings.sta_only);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: sta_power_save (1 = yes): %i",wifi_settings.sta_power_save);
-		}
+	/* an earlier firmware wrote less: what it did not know keeps its default */
+	wifi_manager_config_build(&current);
+	if(!config_record_load(&wifi_manager_config, &current, sizeof(current))){
+		return false;
+	}
+	memcpy(wifi_manager_config_sta->sta.ssid, current.sta_ssid, sizeof(current.sta_ssid));
+	memcpy(wifi_manager_config_sta->sta.password, current.sta_password, sizeof(current.sta_password));
+	memcpy(&wifi_settings, &current.settings, sizeof(wifi_settings));
 
-		if(change){
-			esp_err = nvs_commit(handle);
-		}
-		else{
-			ESP_LOGI(TAG, "Wifi config was not saved to flash because no change has been detected.");
-		}
+	return true;
+}
 
-		if (esp_err != ESP_OK) return esp_err;
+/**
+ * @brief reads the separate ssid, password and settings blobs of earlier versions.
+ */
+static bool wifi_manager_config_read_legacy(nvs_handle handle, uint8_t *buff){
+	size_t sz;
 
-		nvs_close(handle);
-		nvs_sync_unlock();
+	/* ssid */
+	sz = sizeof(wifi_manager_config_sta->sta.ssid);
+	if(nvs_get_blob(handle, "ssid", buff, &sz) != ESP_OK){
+		return false;
+	}
+	memcpy(wifi_manager_config_sta->sta.ssid, buff, sz);
 
+	/* password */
+	sz = sizeof(wifi_manager_config_sta->sta.password);
+	if(nvs_get_blob(handle, "password", buff, &sz) != ESP_OK){
+		return false;
+	}
+	memcpy(wifi_manager_config_sta->sta.password, buff, sz);
+
+	/* settings */
+	sz = sizeof(wifi_settings);
+	if(nvs_get_blob(handle, "settings", buff, &sz) != ESP_OK){
+		return false;
+	}
+	memcpy(&wifi_settings, buff, sz);
+
+	return true;
+}
+
+esp_err_t wifi_manager_save_sta_config(){
+
+	wifi_manager_config_record_t record;
+	esp_err_t esp_err;
+
+	ESP_LOGI(TAG, "About to save config to flash!!");
+
+	if(wifi_manager_config_sta == NULL){
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	/* unchanged records are not written */
+	wifi_manager_config_build(&record);
+	esp_err = config_record_save(&wifi_manager_config, &record, sizeof(record));
+
+	if(esp_err == ESP_OK){
+		ESP_LOGI(TAG, "wifi_manager_wrote wifi_sta_config: ssid:%s", wifi_manager_config_sta->sta.ssid);
+		ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_ssid: %s",wifi_settings.ap_ssid);
+		ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_channel: %i",wifi_settings.ap_channel);
+		ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_hidden (1 = yes): %i",wifi_settings.ap_ssid_hidden);
+		ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_bandwidth (1 = 20MHz, 2 = 40MHz): %i",wifi_settings.ap_bandwidth);
+		ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: sta_only (0 = APSTA, 1 = STA when connected): %i",wifi_settings.sta_only);
+		ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: sta_power_save (1 = yes): %i",wifi_settings.sta_power_save);
 	}
 	else{
-		ESP_LOGE(TAG, "wifi_manager_save_sta_config failed to acquire nvs_sync mutex");
+		ESP_LOGE(TAG, "wifi_manager_save_sta_config failed (%s)", esp_err_to_name(esp_err));
 	}
 
-	return ESP_OK;
+	return esp_err;
 }
 
 bool wifi_manager_fetch_wifi_sta_config(){
 
 	nvs_handle handle;
 	esp_err_t esp_err;
-	if(nvs_sync_lock( portMAX_DELAY )){
+	bool found = false;
+	bool legacy = false;
 
-		esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READONLY, &handle);
+	if(wifi_manager_config_sta == NULL){
+		wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
+	}
+	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
 
-		if(esp_err != ESP_OK){
-			nvs_sync_unlock();
+	found = wifi_manager_config_read();
+	if(!found){
+		/* large enough for each of the legacy blobs */
+		uint8_t *buff = (uint8_t*)malloc(sizeof(struct wifi_settings_t));
+		if(buff == NULL){
 			return false;
 		}
 
-		if(wifi_manager_config_sta == NULL){
-			wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
-		}
-		memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
-
-		/* allocate buffer */
-		size_t sz = sizeof(wifi_settings);
-		uint8_t *buff = (uint8_t*)malloc(sizeof(uint8_t) * sz);
-		memset(buff, 0x00, sizeof(sz));
-
-		/* ssid */
-		sz = sizeof(wifi_manager_config_sta->sta.ssid);
-		esp_err = nvs_get_blob(handle, "ssid", buff, &sz);
-		if(esp_err != ESP_OK){
-			free(buff);
+		if(nvs_sync_lock( portMAX_DELAY )){
+			esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READONLY, &handle);
+			if(esp_err == ESP_OK){
+				memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+				found = legacy = wifi_manager_config_read_legacy(handle, buff);
+				nvs_close(handle);
+			}
 			nvs_sync_unlock();
-			return false;
 		}
-		memcpy(wifi_manager_config_sta->sta.ssid, buff, sz);
+		free(buff);
+	}
 
-		/* password */
-		sz = sizeof(wifi_manager_config_sta->sta.password);
-		esp_err = nvs_get_blob(handle, "password", buff, &sz);
-		if(esp_err != ESP_OK){
-			free(buff);
-			nvs_sync_unlock();
-			return false;
-		}
-		memcpy(wifi_manager_config_sta->sta.password, buff, sz);
+	if(!found){
+		return false;
+	}
 
-		/* settings */
-		sz = sizeof(wifi_settings);
-		esp_err = nvs_get_blob(handle, "settings", buff, &sz);
-		if(esp_err != ESP_OK){
-			free(buff);
-			nvs_sync_unlock();
-			return false;
-		}
-		memcpy(&wifi_settings, buff, sz);
+	/* the legacy blobs are left in place, an earlier firmware can still read them */
+	if(legacy){
+		ESP_LOGI(TAG, "wifi_manager_fetch_wifi_sta_config: moving the legacy blobs to a config record");
+		wifi_manager_save_sta_config();
+	}
 
-		free(buff);
-		nvs_close(handle);
-		nvs_sync_unlock();
+	ESP_LOGI(TAG, "wifi_manager_fetch_wifi_sta_config: ssid:%s password:%s",wifi_manager_config_sta->sta.ssid,wifi_manager_config_sta->sta.password);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_ssid:%s",wifi_settings.ap_ssid);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_pwd:%s",wifi_settings.ap_pwd);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_channel:%i",wifi_settings.ap_channel);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_hidden (1 = yes):%i",wifi_settings.ap_ssid_hidden);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_bandwidth (1 = 20MHz, 2 = 40MHz)%i",wifi_settings.ap_bandwidth);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_only (0 = APSTA, 1 = STA when connected):%i",wifi_settings.sta_only);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_power_save (1 = yes):%i",wifi_settings.sta_power_save);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_static_ip (0 = dhcp client, 1 = static ip):%i",wifi_settings.sta_static_ip);
+
+	return wifi_manager_config_sta->sta.ssid[0] != '\0';
+}
 
 
-		ESP_LOGI(TAG, "wifi_manager_fetch_wifi_sta_config: ssid:%s password:%s",wifi_manager_config_sta->sta.ssid,wifi_manager_config_sta->sta.password);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_ssid:%s",wifi_settings.ap_ssid);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_pwd:%s",wifi_settings.ap_pwd);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_channel:%i",wifi_settings.ap_channel);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_hidden (1 = yes):%i",wifi_settings.ap_ssid_hidden);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_bandwidth (1 = 20MHz, 2 = 40MHz)%i",wifi_settings.ap_bandwidth);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_only (0 = APSTA, 1 = STA when connected):%i",wifi_settings.sta_only);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_power_save (1 = yes):%i",wifi_settings.sta_power_save);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_static_ip (0 = dhcp client, 1 = static ip):%i",wifi_settings.sta_static_ip);
+/**
+ * @brief allocates a new snapshot and points writer at its data, NULL when out of memory.
+ */
+static wifi_manager_snapshot_t* wifi_manager_snapshot_create(size_t size, json_writer_t *writer){
+	wifi_manager_snapshot_t *snapshot = (wifi_manager_snapshot_t*)malloc(sizeof(wifi_manager_snapshot_t) + size);
 
-		return wifi_manager_config_sta->sta.ssid[0] != '\0';
+	if(snapshot == NULL){
+		ESP_LOGE(TAG, "no memory for a new snapshot, readers keep the previous one");
+		return NULL;
+	}
+	atomic_init(&snapshot->refs, 0);
+	json_writer_init(writer, snapshot->data, size);
 
+	return snapshot;
+}
 
+/**
+ * @brief publishes a snapshot in place of the one in slot, which is freed once no reader uses it anymore.
+ * It was created at the worst case size and is first shrunk to what was written, readers may keep it a while.
+ * @note Takes wifi_manager_json_mutex, must not be called while holding it.
+ */
+static void wifi_manager_snapshot_publish(rcu_ptr_t *slot, wifi_manager_snapshot_t *snapshot, json_writer_t *writer){
+	if(snapshot){
+		wifi_manager_snapshot_t *fitted = (wifi_manager_snapshot_t*)realloc(snapshot, sizeof(wifi_manager_snapshot_t) + writer->len + 1);
+		if(fitted){
+			snapshot = fitted;
+		}
 	}
-	else{
+	xSemaphoreTake( wifi_manager_json_mutex, portMAX_DELAY );
+	if(snapshot){
+		snapshot->len = writer->len;
+		snapshot->version = ++wifi_manager_snapshot_version;
+		ESP_LOGD(TAG, "publishing snapshot version %u", (unsigned)snapshot->version);
+	}
+	rcu_publish(&wifi_manager_rcu, slot, snapshot);
+	xSemaphoreGive( wifi_manager_json_mutex );
+}
+
+static bool wifi_manager_snapshot_reclaim(void *ptr){
+	wifi_manager_snapshot_t *snapshot = (wifi_manager_snapshot_t*)ptr;
+
+	if(atomic_load(&snapshot->refs) != 0){
 		return false;
 	}
+	free(snapshot);
+
+	return true;
+}
+
+static const char* wifi_manager_snapshot_acquire(rcu_ptr_t *slot, size_t *len){
+	uint32_t token = rcu_read_lock(&wifi_manager_rcu);
+	wifi_manager_snapshot_t *snapshot = (wifi_manager_snapshot_t*)rcu_dereference(slot);
+
+	if(snapshot){
+		atomic_fetch_add(&snapshot->refs, 1);
+		*len = snapshot->len;
+	}
+	rcu_read_unlock(&wifi_manager_rcu, token);
+
+	return snapshot ? snapshot->data : NULL;
+}
+
+/* @brief current version for the legacy lock/get API, only stable while the matching mutex is held */
+static char* wifi_manager_snapshot_current(rcu_ptr_t *slot){
+	wifi_manager_snapshot_t *snapshot = (wifi_manager_snapshot_t*)rcu_dereference(slot);
+
+	return snapshot ? snapshot->data : NULL;
+}
+
+const char* wifi_manager_acquire_ap_list_json(size_t *len){
+	return wifi_manager_snapshot_acquire(&accessp_json, len);
+}
+
+const char* wifi_manager_acquire_ip_info_json(size_t *len){
+	return wifi_manager_snapshot_acquire(&ip_info_json, len);
+}
+
+void wifi_manager_release_json(const char *json){
+	wifi_manager_snapshot_t *snapshot = (wifi_manager_snapshot_t*)(json - offsetof(wifi_manager_snapshot_t, data));
 
+	atomic_fetch_sub(&snapshot->refs, 1);
 }
 
 
 void wifi_manager_clear_ip_info_json(){
-	strcpy(ip_info_json, "{}\n");
+	json_writer_t writer;
+	wifi_manager_snapshot_t *snapshot = wifi_manager_snapshot_create(JSON_IP_INFO_SIZE, &writer);
+
+	if(snapshot){
+		json_write_str(&writer, "{}\n");
+		wifi_manager_snapshot_publish(&ip_info_json, snapshot, &writer);
+	}
 }
 
 
@@ -400,44 +594,42 @@ void wifi_manager_generate_ip_info_json(update_reason_code_t update_reason_code)
 	wifi_config_t *config = wifi_manager_get_wifi_sta_config();
 	if(config){
 
-		const char *ip_info_json_format = ",\"ip\":\"%s\",\"netmask\":\"%s\",\"gw\":\"%s\",\"urc\":%d}\n";
-
-		memset(ip_info_json, 0x00, JSON_IP_INFO_SIZE);
+		char ip[IP4ADDR_STRLEN_MAX] = "0"; /* note: IP4ADDR_STRLEN_MAX is defined in lwip */
+		char gw[IP4ADDR_STRLEN_MAX] = "0";
+		char netmask[IP4ADDR_STRLEN_MAX] = "0";
+		json_writer_t writer;
+		wifi_manager_snapshot_t *snapshot;
 
-		/* to avoid declaring a new buffer we copy the data directly into the buffer at its correct address */
-		strcpy(ip_info_json, "{\"ssid\":");
-		json_print_string(config->sta.ssid,  (unsigned char*)(ip_info_json+strlen(ip_info_json)) );
-
-		size_t ip_info_json_len = strlen(ip_info_json);
-		size_t remaining = JSON_IP_INFO_SIZE - ip_info_json_len;
 		if(update_reason_code == UPDATE_CONNECTION_OK){
-			/* rest of the information is copied after the ssid */
 			esp_netif_ip_info_t ip_info;
 			ESP_ERROR_CHECK(esp_netif_get_ip_info(esp_netif_sta, &ip_info));
 
-			char ip[IP4ADDR_STRLEN_MAX]; /* note: IP4ADDR_STRLEN_MAX is defined in lwip */
-			char gw[IP4ADDR_STRLEN_MAX];
-			char netmask[IP4ADDR_STRLEN_MAX];
-
 			esp_ip4addr_ntoa(&ip_info.ip, ip, IP4ADDR_STRLEN_MAX);
 			esp_ip4addr_ntoa(&ip_info.gw, gw, IP4ADDR_STRLEN_MAX);
 			esp_ip4addr_ntoa(&ip_info.netmask, netmask, IP4ADDR_STRLEN_MAX);
+		}
+		/* otherwise the json only tells the reason code why this was updated without a connection */
 
-
-			snprintf( (ip_info_json + ip_info_json_len), remaining, ip_info_json_format,
-					ip,
-					netmask,
-					gw,
-					(int)update_reason_code);
+		snapshot = wifi_manager_snapshot_create(JSON_IP_INFO_SIZE, &writer);
+		if(snapshot == NULL){
+			return;
 		}
-		else{
-			/* notify in the json output the reason code why this was updated without a connection */
-			snprintf( (ip_info_json + ip_info_json_len), remaining, ip_info_json_format,
-								"0",
-								"0",
-								"0",
-								(int)update_reason_code);
+		json_write_str(&writer, "{\"ssid\":");
+		json_write_string(&writer, config->sta.ssid, sizeof(config->sta.ssid));
+		json_write_str(&writer, ",\"ip\":\"");
+		json_write_str(&writer, ip);
+		json_write_str(&writer, "\",\"netmask\":\"");
+		json_write_str(&writer, netmask);
+		json_write_str(&writer, "\",\"gw\":\"");
+		json_write_str(&writer, gw);
+		json_write_str(&writer, "\",\"urc\":");
+		json_write_int(&writer, (int)update_reason_code);
+		json_write_str(&writer, "}\n");
+		if(writer.overflow){
+			json_writer_rewind(&writer, 0);
+			json_write_str(&writer, "{}\n");
 		}
+		wifi_manager_snapshot_publish(&ip_info_json, snapshot, &writer);
 	}
 	else{
 		wifi_manager_clear_ip_info_json();
@@ -448,35 +640,49 @@ void wifi_manager_generate_ip_info_json(update_reason_code_t update_reason_code)
 
 
 void wifi_manager_clear_access_points_json(){
-	strcpy(accessp_json, "[]\n");
+	json_writer_t writer;
+	wifi_manager_snapshot_t *snapshot = wifi_manager_snapshot_create(JSON_ACCESS_POINTS_SIZE, &writer);
+
+	if(snapshot){
+		json_write_str(&writer, "[]\n");
+		wifi_manager_snapshot_publish(&accessp_json, snapshot, &writer);
+	}
 }
 void wifi_manager_generate_acess_points_json(){
 
-	strcpy(accessp_json, "[");
-
-
-	const char oneap_str[] = ",\"chan\":%d,\"rssi\":%d,\"auth\":%d}%c\n";
+	json_writer_t writer;
+	wifi_manager_snapshot_t *snapshot = wifi_manager_snapshot_create(JSON_ACCESS_POINTS_SIZE, &writer);
 
-	/* stack buffer to hold on to one AP until it's copied over to accessp_json */
-	char one_ap[JSON_ONE_APP_SIZE];
+	if(snapshot == NULL){
+		return;
+	}
+	json_write_str(&writer, "[");
 	for(int i=0; i<ap_num;i++){
 
-		wifi_ap_record_t ap = accessp_records[i];
-
-		/* ssid needs to be json escaped. To save on heap memory it's directly printed at the correct address */
-		strcat(accessp_json, "{\"ssid\":");
-		json_print_string( (unsigned char*)ap.ssid,  (unsigned char*)(accessp_json+strlen(accessp_json)) );
-
-		/* print the rest of the json for this access point: no more string to escape */
-		snprintf(one_ap, (size_t)JSON_ONE_APP_SIZE, oneap_str,
-				ap.primary,
-				ap.rssi,
-				ap.authmode,
-				i==ap_num-1?']':',');
+		wifi_manager_ap_t *ap = &accessp_records[i];
+		size_t mark = writer.len;
 
-		/* add it to the list */
-		strcat(accessp_json, one_ap);
+		if(i > 0){
+			json_write_str(&writer, ",\n");
+		}
+		json_write_str(&writer, "{\"ssid\":");
+		json_write_string(&writer, ap->ssid, sizeof(ap->ssid));
+		json_write_str(&writer, ",\"chan\":");
+		json_write_int(&writer, ap->chan);
+		json_write_str(&writer, ",\"rssi\":");
+		json_write_int(&writer, ap->rssi);
+		json_write_str(&writer, ",\"auth\":");
+		json_write_int(&writer, ap->auth);
+		json_write_str(&writer, "}");
+
+		/* an access point that does not fit is left out rather than cut in half, a funny name can't break the list */
+		if(writer.overflow){
+			json_writer_rewind(&writer, mark);
+			break;
+		}
 	}
+	json_write_str(&writer, "]\n");
+	wifi_manager_snapshot_publish(&accessp_json, snapshot, &writer);
 
 }
 
@@ -502,24 +708,35 @@ void wifi_manager_unlock_sta_ip_string(){
 
 void wifi_manager_safe_update_sta_ip_string(uint32_t ip){
 
-	if(wifi_manager_lock_sta_ip_string(portMAX_DELAY)){
+	esp_ip4_addr_t ip4;
+	ip4.addr = ip;
+	json_writer_t writer;
+	wifi_manager_snapshot_t *snapshot = wifi_manager_snapshot_create(IP4ADDR_STRLEN_MAX, &writer);
 
-		esp_ip4_addr_t ip4;
-		ip4.addr = ip;
-
-		char str_ip[IP4ADDR_STRLEN_MAX];
-		esp_ip4addr_ntoa(&ip4, str_ip, IP4ADDR_STRLEN_MAX);
-
-		strcpy(wifi_manager_sta_ip, str_ip);
-
-		ESP_LOGI(TAG, "Set STA IP String to: %s", wifi_manager_sta_ip);
-
-		wifi_manager_unlock_sta_ip_string();
+	if(snapshot == NULL){
+		return;
 	}
+	esp_ip4addr_ntoa(&ip4, snapshot->data, IP4ADDR_STRLEN_MAX);
+	writer.len = strlen(snapshot->data);
+	ESP_LOGI(TAG, "Set STA IP String to: %s", snapshot->data);
+
+	/* the sta ip mutex keeps the legacy lock/get API stable */
+	wifi_manager_lock_sta_ip_string(portMAX_DELAY);
+	wifi_manager_snapshot_publish(&wifi_manager_sta_ip, snapshot, &writer);
+	wifi_manager_unlock_sta_ip_string();
 }
 
 char* wifi_manager_get_sta_ip_string(){
-	return wifi_manager_sta_ip;
+	return wifi_manager_snapshot_current(&wifi_manager_sta_ip);
+}
+
+bool wifi_manager_match_sta_ip(const char *str){
+	uint32_t token = rcu_read_lock(&wifi_manager_rcu);
+	wifi_manager_snapshot_t *snapshot = (wifi_manager_snapshot_t*)rcu_dereference(&wifi_manager_sta_ip);
+	bool match = (str != NULL && snapshot != NULL && strstr(str, snapshot->data) != NULL);
+	rcu_read_unlock(&wifi_manager_rcu, token);
+
+	return match;
 }
 
 
@@ -542,7 +759,7 @@ void wifi_manager_unlock_json_buffer(){
 }
 
 char* wifi_manager_get_ap_list_json(){
-	return accessp_json;
+	return wifi_manager_snapshot_current(&accessp_json);
 }
 
 
@@ -760,16 +977,13 @@ void wifi_manager_connect_async(){
 	 * There'se a risk the front end sees an IP or a password error when in fact
 	 * it's a remnant from a previous connection
 	 */
-	if(wifi_manager_lock_json_buffer( portMAX_DELAY )){
-		wifi_manager_clear_ip_info_json();
-		wifi_manager_unlock_json_buffer();
-	}
+	wifi_manager_clear_ip_info_json();
 	wifi_manager_send_message(WM_ORDER_CONNECT_STA, (void*)CONNECTION_REQUEST_USER);
 }
 
 
 char* wifi_manager_get_ip_info_json(){
-	return ip_info_json;
+	return wifi_manager_snapshot_current(&ip_info_json);
 }
 
 
@@ -781,12 +995,10 @@ void wifi_manager_destroy(){
 	/* heap buffers */
 	free(accessp_records);
 	accessp_records = NULL;
-	free(accessp_json);
-	accessp_json = NULL;
-	free(ip_info_json);
-	ip_info_json = NULL;
-	free(wifi_manager_sta_ip);
-	wifi_manager_sta_ip = NULL;
+	wifi_manager_snapshot_publish(&accessp_json, NULL, NULL);
+	wifi_manager_snapshot_publish(&ip_info_json, NULL, NULL);
+	wifi_manager_snapshot_publish(&wifi_manager_sta_ip, NULL, NULL);
+	rcu_synchronize(&wifi_manager_rcu);
 	if(wifi_manager_config_sta){
 		free(wifi_manager_config_sta);
 		wifi_manager_config_sta = NULL;
@@ -806,55 +1018,13 @@ void wifi_manager_destroy(){
 }
 
 
-void wifi_manager_filter_unique( wifi_ap_record_t * aplist, uint16_t * aps) {
-	int total_unique;
-	wifi_ap_record_t * first_free;
-	total_unique=*aps;
-
-	first_free=NULL;
-
-	for(int i=0; i<*aps-1;i++) {
-		wifi_ap_record_t * ap = &aplist[i];
+void wifi_manager_merge_scan( wifi_ap_record_t * records, uint16_t count ){
+	ap_list_t list = { .aps = accessp_records, .count = ap_num, .capacity = MAX_AP_NUM, .max_age = WIFI_MANAGER_AP_MAX_AGE };
 
-		/* skip the previously removed APs */
-		if (ap->ssid[0] == 0) continue;
-
-		/* remove the identical SSID+authmodes */
-		for(int j=i+1; j<*aps;j++) {
-			wifi_ap_record_t * ap1 = &aplist[j];
-			if ( (strcmp((const char *)ap->ssid, (const char *)ap1->ssid)==0) && 
-			     (ap->authmode == ap1->authmode) ) { /* same SSID, different auth mode is skipped */
-				/* save the rssi for the display */
-				if ((ap1->rssi) > (ap->rssi)) ap->rssi=ap1->rssi;
-				/* clearing the record */
-				memset(ap1,0, sizeof(wifi_ap_record_t));
-			}
-		}
+	if(!ap_merge_scan(&list, records, count)){
+		ESP_LOGE(TAG, "could not allocate the access point index, scan dropped");
 	}
-	/* reorder the list so APs follow each other in the list */
-	for(int i=0; i<*aps;i++) {
-		wifi_ap_record_t * ap = &aplist[i];
-		/* skipping all that has no name */
-		if (ap->ssid[0] == 0) {
-			/* mark the first free slot */
-			if (first_free==NULL) first_free=ap;
-			total_unique--;
-			continue;
-		}
-		if (first_free!=NULL) {
-			memcpy(first_free, ap, sizeof(wifi_ap_record_t));
-			memset(ap,0, sizeof(wifi_ap_record_t));
-			/* find the next free slot */
-			for(int j=0; j<*aps;j++) {
-				if (aplist[j].ssid[0]==0) {
-					first_free=&aplist[j];
-					break;
-				}
-			}
-		}
-	}
-	/* update the length of the list */
-	*aps = total_unique;
+	ap_num = list.count;
 }
 
 
@@ -988,20 +1158,26 @@ void wifi_manager( void * pvParameters ){
 				wifi_event_sta_scan_done_t *evt_scan_done = (wifi_event_sta_scan_done_t*)msg.param;
 				/* only check for AP if the scan is succesful */
 				if(evt_scan_done->status == 0){
-					/* As input param, it stores max AP number ap_records can hold. As output param, it receives the actual AP number this API returns.
-					* As a consequence, ap_num MUST be reset to MAX_AP_NUM at every scan */
-					ap_num = MAX_AP_NUM;
-					ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&ap_num, accessp_records));
-					/* make sure the http server isn't trying to access the list while it gets refreshed */
-					if(wifi_manager_lock_json_buffer( pdMS_TO_TICKS(1000) )){
-						/* Will remove the duplicate SSIDs from the list and update ap_num */
-						wifi_manager_filter_unique(accessp_records, &ap_num);
-						wifi_manager_generate_acess_points_json();
-						wifi_manager_unlock_json_buffer();
+					/* the raw records are only needed while merging, the list keeps what /ap.json shows */
+					uint16_t count = 0;
+					ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&count));
+					if(count > WIFI_MANAGER_SCAN_RECORDS_MAX){
+						count = WIFI_MANAGER_SCAN_RECORDS_MAX;
+					}
+					wifi_ap_record_t *records = (wifi_ap_record_t*)malloc(sizeof(wifi_ap_record_t) * (count ? count : 1));
+					if(records){
+						/* As input param, it stores max AP number records can hold. As output param, it receives the actual AP number this API returns. */
+						ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&count, records));
 					}
 					else{
-						ESP_LOGE(TAG, "could not get access to json mutex in wifi_scan");
+						ESP_LOGE(TAG, "no memory for %u scan records, the list only ages", count);
+						count = 0;
 					}
+					/* Will merge the scan in the list of unique SSIDs and update ap_num */
+					wifi_manager_merge_scan(records, count);
+					free(records);
+					/* the list goes to the back buffer, clients being served keep the previous one */
+					wifi_manager_generate_acess_points_json();
 				}
 
 				/* callback */
@@ -1058,15 +1234,15 @@ void wifi_manager( void * pvParameters ){
 
 				uxBits = xEventGroupGetBits(wifi_manager_event_group);
 				if( ! (uxBits & WIFI_MANAGER_WIFI_CONNECTED_BIT) ){
-					/* update config to latest and attempt connection */
-					ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, wifi_manager_get_wifi_sta_config()));
-
 					/* if there is a wifi scan in progress abort it first
 					   Calling esp_wifi_scan_stop will trigger a SCAN_DONE event which will reset this bit */
 					if(uxBits & WIFI_MANAGER_SCAN_BIT){
 						esp_wifi_scan_stop();
 					}
-					ESP_ERROR_CHECK(esp_wifi_connect());
+
+					/* update config to latest and attempt connection. Straight to the last access point
+					 * when the credentials did not change, a full scan otherwise */
+					ESP_ERROR_CHECK(fast_connect_start(wifi_manager_get_wifi_sta_config()));
 				}
 
 				/* callback */
@@ -1139,15 +1315,16 @@ void wifi_manager( void * pvParameters ){
 				}
 
 				uxBits = xEventGroupGetBits(wifi_manager_event_group);
-				if( uxBits & WIFI_MANAGER_REQUEST_STA_CONNECT_BIT ){
+				if( fast_connect_on_disconnected(wifi_event_sta_disconnected->reason) ){
+					/* the attempt pinned to the last access point failed and a full scan attempt is already on its way:
+					 * this is not a failure yet, no retry is counted and the request bits stay */
+				}
+				else if( uxBits & WIFI_MANAGER_REQUEST_STA_CONNECT_BIT ){
 					/* there are no retries when it's a user requested connection by design. This avoids a user hanging too much
 					 * in case they typed a wrong password for instance. Here we simply clear the request bit and move on */
 					xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_STA_CONNECT_BIT);
 
-					if(wifi_manager_lock_json_buffer( portMAX_DELAY )){
-						wifi_manager_generate_ip_info_json( UPDATE_FAILED_ATTEMPT );
-						wifi_manager_unlock_json_buffer();
-					}
+					wifi_manager_generate_ip_info_json( UPDATE_FAILED_ATTEMPT );
 
 				}
 				else if (uxBits & WIFI_MANAGER_REQUEST_DISCONNECT_BIT){
@@ -1160,23 +1337,18 @@ void wifi_manager( void * pvParameters ){
 					}
 
 					/* regenerate json status */
-					if(wifi_manager_lock_json_buffer( portMAX_DELAY )){
-						wifi_manager_generate_ip_info_json( UPDATE_USER_DISCONNECT );
-						wifi_manager_unlock_json_buffer();
-					}
+					wifi_manager_generate_ip_info_json( UPDATE_USER_DISCONNECT );
 
 					/* save NVS memory */
 					wifi_manager_save_sta_config();
+					fast_connect_forget();
 
 					/* start SoftAP */
 					wifi_manager_send_message(WM_ORDER_START_AP, NULL);
 				}
 				else{
 					/* lost connection ? */
-					if(wifi_manager_lock_json_buffer( portMAX_DELAY )){
-						wifi_manager_generate_ip_info_json( UPDATE_LOST_CONNECTION );
-						wifi_manager_unlock_json_buffer();
-					}
+					wifi_manager_generate_ip_info_json( UPDATE_LOST_CONNECTION );
 
 					/* Start the timer that will try to restore the saved config */
 					xTimerStart( wifi_manager_retry_timer, (TickType_t)0 );
@@ -1271,16 +1443,14 @@ void wifi_manager( void * pvParameters ){
 					wifi_manager_save_sta_config();
 				}
 
+				/* remember the access point for a quick reconnection */
+				fast_connect_on_connected(wifi_manager_get_wifi_sta_config());
+
 				/* reset number of retries */
 				retries = 0;
 
-				/* refresh JSON with the new IP */
-				if(wifi_manager_lock_json_buffer( portMAX_DELAY )){
-					/* generate the connection info with success */
-					wifi_manager_generate_ip_info_json( UPDATE_CONNECTION_OK );
-					wifi_manager_unlock_json_buffer();
-				}
-				else { abort(); }
+				/* refresh JSON with the new IP: generate the connection info with success */
+				wifi_manager_generate_ip_info_json( UPDATE_CONNECTION_OK );
 
 				/* bring down DNS hijack */
 				dns_server_stop();
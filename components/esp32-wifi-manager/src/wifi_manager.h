@@ -33,6 +33,8 @@ Contains the freeRTOS task and all necessary support
 #define WIFI_MANAGER_H_INCLUDED
 
 #include <stdbool.h>
+#include "ap_merge.h"
+#include "config_record.h"
 
 
 #ifdef __cplusplus
@@ -59,7 +61,18 @@ extern "C" {
  * To save memory and avoid nasty out of memory errors,
  * we can limit the number of APs detected in a wifi scan.
  */
-#define MAX_AP_NUM 							5
+#define MAX_AP_NUM 							CONFIG_WIFI_MANAGER_MAX_AP_NUM
+
+/**
+ * @brief Defines how many scans an access point stays in the list after it was last seen.
+ */
+#define WIFI_MANAGER_AP_MAX_AGE				CONFIG_WIFI_MANAGER_AP_MAX_AGE
+
+/**
+ * @brief Defines how many records of one scan are fetched from the driver. Mesh networks report the same SSID
+ * several times, so this is larger than the list itself. Only held while merging.
+ */
+#define WIFI_MANAGER_SCAN_RECORDS_MAX		(2 * MAX_AP_NUM)
 
 
 /**
@@ -185,6 +198,12 @@ extern "C" {
  */
 #define JSON_IP_INFO_SIZE 					159
 
+/**
+ * @brief Defines the maximum length in bytes of the JSON list of access points.
+ * 4 bytes for json encapsulation of "[\n" and "]\0".
+ */
+#define JSON_ACCESS_POINTS_SIZE				(MAX_AP_NUM * JSON_ONE_APP_SIZE + 4)
+
 
 /**
  * @brief defines the minimum length of an access point password running on WPA2
@@ -258,6 +277,24 @@ struct wifi_settings_t{
 extern struct wifi_settings_t wifi_settings;
 
 
+/**
+ * @brief Layout version of the config record. Only bumped for incompatible changes, never for appended fields.
+ */
+#define WIFI_MANAGER_CONFIG_VERSION			1
+
+/**
+ * @brief The whole configuration as stored in NVS, one blob written at once, see config_record.h.
+ *
+ * Fields are only ever appended, after settings: LTE and BLE settings will go there.
+ */
+typedef struct{
+	config_record_header_t header;
+	uint8_t sta_ssid[MAX_SSID_SIZE];
+	uint8_t sta_password[MAX_PASSWORD_SIZE];
+	struct wifi_settings_t settings;
+} wifi_manager_config_record_t;
+
+
 /**
  * @brief Structure used to store one message in the queue.
  */
@@ -289,9 +326,13 @@ void wifi_manager_start();
 void wifi_manager_destroy();
 
 /**
- * Filters the AP scan list to unique SSIDs
+ * @brief Merges the records of a scan into the access point list, see ap_merge_scan.
+ *
+ * The list is capped at MAX_AP_NUM, an access point missing from the scan stays listed for
+ * WIFI_MANAGER_AP_MAX_AGE scans.
+ * @param records the scan, reordered by RSSI in place.
  */
-void filter_unique( wifi_ap_record_t * aplist, uint16_t * ap_num);
+void wifi_manager_merge_scan( wifi_ap_record_t * records, uint16_t count );
 
 /**
  * Main task for the wifi_manager
@@ -299,20 +340,44 @@ void filter_unique( wifi_ap_record_t * aplist, uint16_t * ap_num);
 void wifi_manager( void * pvParameters );
 
 
+/**
+ * @brief Gets the JSON currently served. Only valid while wifi_manager_lock_json_buffer is held,
+ * prefer the acquire functions which never block.
+ */
 char* wifi_manager_get_ap_list_json();
 char* wifi_manager_get_ip_info_json();
 
+/**
+ * @brief Takes a reference on the current access point list JSON, never blocks.
+ * The wifi_manager keeps publishing new versions meanwhile, the acquired one stays intact until released.
+ * @param len receives the length of the JSON.
+ * @return the JSON, to be handed back with wifi_manager_release_json, or NULL when none is published.
+ */
+const char* wifi_manager_acquire_ap_list_json(size_t *len);
+
+/**
+ * @brief Pins the current connection status JSON, see wifi_manager_acquire_ap_list_json.
+ */
+const char* wifi_manager_acquire_ip_info_json(size_t *len);
+
+/**
+ * @brief Releases a JSON acquired by one of the acquire functions, the version is freed once replaced and released by all.
+ */
+void wifi_manager_release_json(const char *json);
+
 
 void wifi_manager_scan_async();
 
 
 /**
  * @brief saves the current STA wifi config to flash ram storage.
+ * The config record is written with a single blob and commit, and not at all when it matches the last one read or written.
  */
 esp_err_t wifi_manager_save_sta_config();
 
 /**
  * @brief fetch a previously STA wifi config in the flash ram storage.
+ * Falls back to the separate ssid, password and settings blobs of earlier versions, which are then saved as a record.
  * @return true if a previously saved config was found, false otherwise.
  */
 bool wifi_manager_fetch_wifi_sta_config();
@@ -339,7 +404,9 @@ void wifi_manager_disconnect_async();
  * @brief Tries to get access to json buffer mutex.
  *
  * The HTTP server can try to access the json to serve clients while the wifi manager thread can try
- * to update it. These two tasks are synchronized through a mutex.
+ * to update it. Each document is an immutable snapshot: the wifi_manager builds a new version on the side and
+ * publishes it with an atomic pointer swap, readers never wait. The mutex only orders the writers, holding it
+ * keeps the current version from being replaced, which is what the get functions rely on.
  *
  * The mutex is used by both the access point list json and the connection status json.\n
  * These two resources should technically have their own mutex but we lose some flexibility to save
@@ -359,24 +426,24 @@ void wifi_manager_unlock_json_buffer();
 
 /**
  * @brief Generates the connection status json: ssid and IP addresses.
- * @note This is not thread-safe and should be called only if wifi_manager_lock_json_buffer call is successful.
+ * @note Takes the json mutex itself, must not be called while holding it.
  */
 void wifi_manager_generate_ip_info_json(update_reason_code_t update_reason_code);
 /**
  * @brief Clears the connection status json.
- * @note This is not thread-safe and should be called only if wifi_manager_lock_json_buffer call is successful.
+ * @note Takes the json mutex itself, must not be called while holding it.
  */
 void wifi_manager_clear_ip_info_json();
 
 /**
  * @brief Generates the list of access points after a wifi scan.
- * @note This is not thread-safe and should be called only if wifi_manager_lock_json_buffer call is successful.
+ * @note Takes the json mutex itself, must not be called while holding it.
  */
 void wifi_manager_generate_acess_points_json();
 
 /**
  * @brief Clear the list of access points.
- * @note This is not thread-safe and should be called only if wifi_manager_lock_json_buffer call is successful.
+ * @note Takes the json mutex itself, must not be called while holding it.
  */
 void wifi_manager_clear_access_points_json();
 
@@ -387,14 +454,23 @@ void wifi_manager_clear_access_points_json();
 void wifi_manager_initialise_mdns();
 
 
+/**
+ * @brief Keeps the STA IP string from being replaced, only needed around wifi_manager_get_sta_ip_string.
+ */
 bool wifi_manager_lock_sta_ip_string(TickType_t xTicksToWait);
 void wifi_manager_unlock_sta_ip_string();
 
 /**
  * @brief gets the string representation of the STA IP address, e.g.: "192.168.1.69"
+ * Only valid while wifi_manager_lock_sta_ip_string is held.
  */
 char* wifi_manager_get_sta_ip_string();
 
+/**
+ * @brief Checks whether str contains the current STA IP address, e.g. a Host header. Never blocks.
+ */
+bool wifi_manager_match_sta_ip(const char *str);
+
 /**
  * @brief thread safe char representation of the STA IP update
  */
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Gzip the web UI and write it as a C header for src/http_app.c.
+
+    python web_assets.py -o web_assets.h src/index.html src/code.js src/style.css
+
+For every input, e.g. code.js, the header defines
+    static const uint8_t code_js_gz[]    gzip -9 of the file
+    static const char    code_js_etag[]  strong ETag, quotes included
+
+The arrays are const so they stay in flash and are sent from there. The
+gzip stream carries no name and no time stamp, so the same sources always
+give the same bytes and the same ETags; the ETag only changes when the
+served content does. Sizes and ETags are printed so they can be checked
+without a board.
+"""
+
+import argparse
+import gzip
+import hashlib
+import io
+import os
+import re
+import sys
+
+
+def compress(data):
+    out = io.BytesIO()
+    with gzip.GzipFile(filename="", mode="wb", compresslevel=9, fileobj=out, mtime=0) as f:
+        f.write(data)
+    return out.getvalue()
+
+
+def etag(gz):
+    return '"' + hashlib.sha256(gz).hexdigest()[:16] + '"'
+
+
+def symbol(path):
+    return re.sub(r"[^0-9A-Za-z]", "_", os.path.basename(path))
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("\t" + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("inputs", nargs="+", help="web assets to embed")
+    parser.add_argument("-o", "--output", required=True, help="header to write")
+    args = parser.parse_args()
+
+    out = ["/* Generated by web_assets.py, do not edit */", "", "#include <stdint.h>", ""]
+    for path in args.inputs:
+        with open(path, "rb") as f:
+            data = f.read()
+        gz = compress(data)
+        name = symbol(path)
+        out.append("static const uint8_t %s_gz[] = {" % name)
+        out.append(c_array(gz))
+        out.append("};")
+        out.append("static const char %s_etag[] = \"%s\";" % (name, etag(gz).replace('"', '\\"')))
+        out.append("")
+        print("%s: %d -> %d bytes, ETag %s" % (os.path.basename(path), len(data), len(gz), etag(gz)))
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <string.h>
+#include <stdlib.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
 #include "esp_err.h"
@@ -27,10 +28,141 @@ void InitFontx(FontxFile *fxs, const char *f0, const char *f1)
 	AddFontx(&fxs[1], f1);
 }
 
+// 埋め込みフォントを構造体に保存
+// start/end are the _binary_*_start/_end symbols of an EMBED_FILES font.
+void AddFontxMem(FontxFile *fx, const char *name, const uint8_t *start, const uint8_t *end)
+{
+	memset(fx, 0, sizeof(FontxFile));
+	fx->path = name;
+	fx->data = start;
+	fx->size = end - start;
+	fx->opened = false;
+}
+
+// 埋め込みフォントで構造体を初期化
+void InitFontxMem(FontxFile *fxs, const char *name, const uint8_t *start, const uint8_t *end)
+{
+	AddFontxMem(&fxs[0], name, start, end);
+	AddFontx(&fxs[1], "");
+}
+
+// フォントヘッダを解析
+static bool ParseFontxHeader(FontxFile *fx, const uint8_t *buf)
+{
+	if(FontxDebug) {
+		for(int i=0;i<18;i++) {
+			printf("buf[%d]=0x%x\n",i,buf[i]);
+		}
+	}
+	memcpy(fx->fxname, &buf[6], 8);
+	fx->w = buf[14];
+	fx->h = buf[15];
+	fx->is_ank = (buf[16] == 0);
+	fx->bc = buf[17];
+	fx->fsz = (fx->w + 7)/8 * fx->h;
+	// a 0 width or height glyph is a corrupt header, the glyph count divides by fsz
+	if(fx->fsz == 0){
+		printf("Fontx:%s has no glyph size.\n",fx->path);
+		return false;
+	}
+	if(fx->fsz > FontxGlyphBufSize){
+		printf("Fontx:%s is too big font size.\n",fx->path);
+		return false;
+	}
+	return true;
+}
+
+// 埋め込みフォントをOPEN
+// The table stays in flash, glyphs are addressed in place.
+static bool OpenFontxMem(FontxFile *fx)
+{
+	fx->opened = true;
+	fx->valid = false;
+	if (fx->size < 18 || strncmp((const char *)fx->data, "FONTX2", 6) != 0) {
+		printf("Fontx:%s not FONTX format.\n",fx->path);
+		return fx->valid;
+	}
+	if (!ParseFontxHeader(fx, fx->data)) return fx->valid;
+	if (fx->is_ank) {
+		uint32_t nglyph = (fx->size - 17) / fx->fsz;
+		fx->nglyph = nglyph < FontxAnkGlyphs ? nglyph : FontxAnkGlyphs;
+		if (fx->nglyph == 0) return fx->valid;
+	}
+	if(FontxDebug)printf("[OpenFontxMem]%s nglyph=%d\n",fx->path,fx->nglyph);
+	fx->valid = true;
+	return fx->valid;
+}
+
+// グリフキャッシュを準備
+// Small ANK tables are read once and the file is closed,
+// larger ones get FontxCacheSlots slots filled on demand.
+static bool LoadFontxCache(FontxFile *fx)
+{
+	if (!fx->is_ank) return true;
+	size_t size = fx->fsz * FontxAnkGlyphs;
+	if (size <= FontxCacheMax) {
+		fx->glyphs = malloc(size);
+		if (fx->glyphs == NULL) return false;
+		fx->nglyph = 0;
+		if (fseek(fx->file, 17, SEEK_SET) == 0) {
+			fx->nglyph = fread(fx->glyphs, fx->fsz, FontxAnkGlyphs, fx->file);
+		}
+		if(FontxDebug)printf("[LoadFontxCache]%s nglyph=%d\n",fx->path,fx->nglyph);
+		if (fx->nglyph == 0) {
+			free(fx->glyphs);
+			fx->glyphs = NULL;
+			return false;
+		}
+		fclose(fx->file);
+		fx->file = NULL;
+		return true;
+	}
+	fx->glyphs = malloc(fx->fsz * FontxCacheSlots);
+	if (fx->glyphs == NULL) return false;
+	fx->nglyph = 0;
+	memset(fx->slot_of, 0, sizeof(fx->slot_of));
+	memset(fx->slot_used, 0, sizeof(fx->slot_used));
+	fx->tick = 0;
+	return true;
+}
+
+// LRUキャッシュからグリフを取り出す
+static const uint8_t *GetFontxSlot(FontxFile *fx, uint8_t ascii)
+{
+	int slot = fx->slot_of[ascii] - 1;
+	if (slot < 0) {
+		// evict the least recently used slot
+		slot = 0;
+		for(int i=1;i<FontxCacheSlots;i++) {
+			if (fx->slot_used[i] < fx->slot_used[slot]) slot = i;
+		}
+		if (fx->slot_used[slot]) fx->slot_of[fx->slot_code[slot]] = 0;
+		fx->slot_used[slot] = 0;
+
+		uint32_t offset = 17 + ascii * fx->fsz;
+		uint8_t *glyph = &fx->glyphs[slot * fx->fsz];
+		if(fseek(fx->file, offset, SEEK_SET)) {
+			printf("Fontx:seek(%"PRIu32") failed.\n",offset);
+			return NULL;
+		}
+		if(fread(glyph, 1, fx->fsz, fx->file) != fx->fsz) {
+			printf("Fontx:fread failed.\n");
+			return NULL;
+		}
+		fx->slot_of[ascii] = slot + 1;
+		fx->slot_code[slot] = ascii;
+	}
+	fx->slot_used[slot] = ++fx->tick;
+	return &fx->glyphs[slot * fx->fsz];
+}
+
 // フォントファイルをOPEN
 bool OpenFontx(FontxFile *fx)
 {
 	FILE *f;
+	if(!fx->opened && fx->data){
+		return OpenFontxMem(fx);
+	}
 	if(!fx->opened){
 		if(FontxDebug)printf("[openFont]fx->path=[%s]\n",fx->path);
 		f = fopen(fx->path, "r");
@@ -42,29 +174,25 @@ bool OpenFontx(FontxFile *fx)
 		}
 		fx->opened = true;
 		fx->file = f;
-		char buf[18];
+		uint8_t buf[18];
 		if (fread(buf, 1, sizeof(buf), fx->file) != sizeof(buf)) {
 			fx->valid = false;
 			printf("Fontx:%s not FONTX format.\n",fx->path);
 			fclose(fx->file);
+			fx->file = NULL;
 			return fx->valid ;
 		}
-
-		if(FontxDebug) {
-			for(int i=0;i<sizeof(buf);i++) {
-				printf("buf[%d]=0x%x\n",i,buf[i]);
-			}
+		if (!ParseFontxHeader(fx, buf)) {
+			fx->valid = false;
+			fclose(fx->file);
+			fx->file = NULL;
+			return fx->valid ;
 		}
-		memcpy(fx->fxname, &buf[6], 8);
-		fx->w = buf[14];
-		fx->h = buf[15];
-		fx->is_ank = (buf[16] == 0);
-		fx->bc = buf[17];
-		fx->fsz = (fx->w + 7)/8 * fx->h;
-		if(fx->fsz > FontxGlyphBufSize){
-			printf("Fontx:%s is too big font size.\n",fx->path);
+		if (!LoadFontxCache(fx)) {
+			printf("Fontx:%s glyph cache failed.\n",fx->path);
 			fx->valid = false;
 			fclose(fx->file);
+			fx->file = NULL;
 			return fx->valid ;
 		}
 		fx->valid = true;
@@ -76,7 +204,11 @@ bool OpenFontx(FontxFile *fx)
 void CloseFontx(FontxFile *fx)
 {
 	if(fx->opened){
-		fclose(fx->file);
+		if (fx->file) fclose(fx->file);
+		free(fx->glyphs);
+		fx->file = NULL;
+		fx->glyphs = NULL;
+		fx->nglyph = 0;
 		fx->opened = false;
 	}
 }
@@ -199,34 +331,53 @@ uint8_t getFortHeight(FontxFile *fx) {
 
 bool GetFontx(FontxFile *fxs, uint8_t ascii , uint8_t *pGlyph, uint8_t *pw, uint8_t *ph)
 {
-  
+	const uint8_t *glyph;
+	uint8_t w, h;
+
+	if (!GetFontxGlyph(fxs, ascii, &glyph, &w, &h)) return false;
+	memcpy(pGlyph, glyph, (w + 7)/8 * h);
+	if(pw) *pw = w;
+	if(ph) *ph = h;
+	return true;
+}
+
+// フォントパターンをコピーせずに取り出す
+// The pointer stays valid until the next lookup on the same font.
+bool GetFontxGlyph(FontxFile *fxs, uint8_t ascii, const uint8_t **pGlyph, uint8_t *pw, uint8_t *ph)
+{
 	int i;
-	uint32_t offset;
 
-	if(FontxDebug)printf("[GetFontx]ascii=0x%x\n",ascii);
+	if(FontxDebug)printf("[GetFontxGlyph]ascii=0x%x\n",ascii);
 	for(i=0; i<2; i++){
-	//for(i=0; i<1; i++){
 		if(!OpenFontx(&fxs[i])) continue;
-		if(FontxDebug)printf("[GetFontx]openFontxFile[%d] ok\n",i);
-	
-		//if(ascii < 0xFF){
-			if(fxs[i].is_ank){
-				if(FontxDebug)printf("[GetFontx]fxs.is_ank fxs.fsz=%d\n",fxs[i].fsz);
-				offset = 17 + ascii * fxs[i].fsz;
-				if(FontxDebug)printf("[GetFontx]offset=%"PRIu32"\n",offset);
-				if(fseek(fxs[i].file, offset, SEEK_SET)) {
-					printf("Fontx:seek(%"PRIu32") failed.\n",offset);
-					return false;
-				}
-				if(fread(pGlyph, 1, fxs[i].fsz, fxs[i].file) != fxs[i].fsz) {
-					printf("Fontx:fread failed.\n");
-					return false;
-				}
-				if(pw) *pw = fxs[i].w;
-				if(ph) *ph = fxs[i].h;
-				return true;
-			}
-		//}
+		if(!fxs[i].is_ank) continue;
+
+		if (fxs[i].data) {
+			if (ascii >= fxs[i].nglyph) return false;
+			*pGlyph = &fxs[i].data[17 + ascii * fxs[i].fsz];
+		} else if (fxs[i].nglyph) {
+			if (ascii >= fxs[i].nglyph) return false;
+			*pGlyph = &fxs[i].glyphs[ascii * fxs[i].fsz];
+		} else {
+			*pGlyph = GetFontxSlot(&fxs[i], ascii);
+			if (*pGlyph == NULL) return false;
+		}
+		if(pw) *pw = fxs[i].w;
+		if(ph) *ph = fxs[i].h;
+		return true;
+	}
+	return false;
+}
+
+// フォントサイズだけを取り出す
+bool GetFontxMetrics(FontxFile *fxs, uint8_t *pw, uint8_t *ph)
+{
+	for(int i=0; i<2; i++){
+		if(!OpenFontx(&fxs[i])) continue;
+		if(!fxs[i].is_ank) continue;
+		if(pw) *pw = fxs[i].w;
+		if(ph) *ph = fxs[i].h;
+		return true;
 	}
 	return false;
 }
@@ -1,6 +1,9 @@
 #ifndef MAIN_FONTX_H_
 #define MAIN_FONTX_H_
 #define FontxGlyphBufSize (32*32/8)
+#define FontxAnkGlyphs 256 // glyphs in an ANK table
+#define FontxCacheMax (12*1024) // ANK tables up to this size are loaded whole
+#define FontxCacheSlots 32 // LRU slots for larger fonts
 
 typedef struct {
 	const char *path;
@@ -12,17 +15,29 @@ typedef struct {
 	uint8_t h;
 	uint16_t fsz;
 	uint8_t bc;
+	const uint8_t *data; // embedded font image in flash, NULL for files
+	uint32_t size;
 	FILE *file;
+	uint8_t *glyphs; // whole ANK table, or FontxCacheSlots LRU slots
+	uint16_t nglyph; // glyphs held by a whole table, 0 for LRU
+	uint8_t slot_of[FontxAnkGlyphs]; // LRU: slot number + 1, 0 when not cached
+	uint8_t slot_code[FontxCacheSlots];
+	uint32_t slot_used[FontxCacheSlots];
+	uint32_t tick;
 } FontxFile;
 
 void AaddFontx(FontxFile *fx, const char *path);
 void InitFontx(FontxFile *fxs, const char *f0, const char *f1);
+void AddFontxMem(FontxFile *fx, const char *name, const uint8_t *start, const uint8_t *end);
+void InitFontxMem(FontxFile *fxs, const char *name, const uint8_t *start, const uint8_t *end);
 bool OpenFontx(FontxFile *fx);
 void CloseFontx(FontxFile *fx);
 void DumpFontx(FontxFile *fxs);
 uint8_t getFortWidth(FontxFile *fx);
 uint8_t getFortHeight(FontxFile *fx);
 bool GetFontx(FontxFile *fxs, uint8_t ascii , uint8_t *pGlyph, uint8_t *pw, uint8_t *ph);
+bool GetFontxGlyph(FontxFile *fxs, uint8_t ascii, const uint8_t **pGlyph, uint8_t *pw, uint8_t *ph);
+bool GetFontxMetrics(FontxFile *fxs, uint8_t *pw, uint8_t *ph);
 void Font2Bitmap(uint8_t *fonts, uint8_t *line, uint8_t w, uint8_t h, uint8_t inverse);
 void UnderlineBitmap(uint8_t *line, uint8_t w, uint8_t h);
 void ReversBitmap(uint8_t *line, uint8_t w, uint8_t h);
@@ -9,6 +9,7 @@
 #include <driver/spi_master.h>
 #include <driver/gpio.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 
 #include "ili9340.h"
 
@@ -28,8 +29,19 @@
 //static const int TFT_MOSI = 23;
 //static const int TFT_SCLK = 18;
 
+static void lcdSetWindow(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+static void lcdAddDirtyRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+
+// Frame buffer pixels are kept in wire (big endian) byte order
+static inline uint16_t lcdSwapColor(uint16_t color) {
+	return (color >> 8) | (color << 8);
+}
+
 static const int SPI_Command_Mode = 0;
 static const int SPI_Data_Mode = 1;
+
+// Transaction user field: D/C gpio and level, never NULL for display transfers
+#define TFT_DC_TAG(dc, mode)	((void *)(intptr_t)((((dc) + 1) << 1) | (mode)))
 //static const int TFT_Frequency = SPI_MASTER_FREQ_20M;
 ////static const int TFT_Frequency = SPI_MASTER_FREQ_26M;
 static const int TFT_Frequency = SPI_MASTER_FREQ_40M;
@@ -45,6 +57,31 @@ static const int XPT_Frequency = 1*1000*1000;
 //#define XPT_IRQ 5
 #endif
 
+// Drive D/C right before each display transaction goes on the bus
+static void IRAM_ATTR spi_master_pre_transfer_callback(spi_transaction_t *t)
+{
+	intptr_t tag = (intptr_t)t->user;
+	if (tag) gpio_set_level( (tag >> 1) - 1, tag & 1 );
+}
+
+// Descriptor ring and staging buffers are allocated once and reused by every transfer
+static void spi_master_alloc(TFT_t * dev)
+{
+	dev->_frame_buffer = NULL;
+	dev->_dirty_count = 0;
+	dev->_pipeline = false;
+	dev->_trans_head = 0;
+	dev->_trans_done = 0;
+	dev->_trans = heap_caps_malloc(sizeof(spi_transaction_t) * TFT_QUEUE_SIZE, MALLOC_CAP_DMA);
+	assert(dev->_trans != NULL);
+	dev->_tx_index = 0;
+	for(int i=0;i<TFT_TX_BUFFERS;i++) {
+		dev->_tx_buffer[i] = heap_caps_malloc(TFT_MAX_TRANSFER, MALLOC_CAP_DMA);
+		assert(dev->_tx_buffer[i] != NULL);
+		dev->_tx_seq[i] = 0;
+	}
+}
+
 void spi_master_init(TFT_t * dev, int16_t TFT_MOSI, int16_t TFT_SCLK, int16_t TFT_CS, int16_t GPIO_DC, int16_t GPIO_RESET, int16_t GPIO_BL,
 	int16_t XPT_MISO, int16_t XPT_CS, int16_t XPT_IRQ, int16_t XPT_SCLK, int16_t XPT_MOSI)
 {
@@ -104,8 +141,9 @@ void spi_master_init(TFT_t * dev, int16_t TFT_MOSI, int16_t TFT_SCLK, int16_t TF
 	spi_device_interface_config_t tft_devcfg={
 		.clock_speed_hz = TFT_Frequency,
 		.spics_io_num = TFT_CS,
-		.queue_size = 7,
+		.queue_size = TFT_QUEUE_SIZE,
 		.flags = SPI_DEVICE_NO_DUMMY,
+		.pre_cb = spi_master_pre_transfer_callback,
 	};
 
 	spi_device_handle_t tft_handle;
@@ -115,6 +153,8 @@ void spi_master_init(TFT_t * dev, int16_t TFT_MOSI, int16_t TFT_SCLK, int16_t TF
 	dev->_dc = GPIO_DC;
 	dev->_bl = GPIO_BL;
 	dev->_TFT_Handle = tft_handle;
+	dev->_transport = NULL;
+	spi_master_alloc(dev);
 
 #if CONFIG_XPT2046_ENABLE_DIFF_BUS
 	ESP_LOGI(TAG, "XPT_SCLK=%d",XPT_SCLK);
@@ -172,6 +212,18 @@ void spi_master_init(TFT_t * dev, int16_t TFT_MOSI, int16_t TFT_SCLK, int16_t TF
 }
 
 
+// Use a custom transport instead of spi_master_init (e.g. the host simulator in sim/)
+// No GPIO is touched: D/C travels as the mode argument, reset and backlight are not driven.
+void lcdAttachTransport(TFT_t * dev, const TFT_Transport * transport)
+{
+	memset(dev, 0, sizeof(TFT_t));
+	dev->_dc = -1;
+	dev->_bl = -1;
+	dev->_irq = -1;
+	dev->_transport = transport;
+	spi_master_alloc(dev);
+}
+
 bool spi_master_write_byte(spi_device_handle_t SPIHandle, const uint8_t* Data, size_t DataLength)
 {
 	spi_transaction_t SPITransaction;
@@ -193,76 +245,216 @@ bool spi_master_write_byte(spi_device_handle_t SPIHandle, const uint8_t* Data, s
 	return true;
 }
 
+// Wait until the transaction with sequence number seq has left the bus
+static void spi_master_wait(TFT_t * dev, uint32_t seq)
+{
+	spi_transaction_t *rtrans;
+	esp_err_t ret;
+
+	while ((int32_t)(seq - dev->_trans_done) > 0) {
+		ret = spi_device_get_trans_result( dev->_TFT_Handle, &rtrans, portMAX_DELAY );
+		assert(ret==ESP_OK);
+		dev->_trans_done++;
+	}
+}
+
+// Send one transfer with the D/C line driven by the pre-transaction callback
+// Up to 4 bytes are copied into the descriptor, larger data must stay untouched
+// until the transfer completes (see spi_master_wait/lcdSync).
+// Returns the sequence number of the transfer.
+static uint32_t spi_master_submit(TFT_t * dev, int mode, const uint8_t * data, size_t size)
+{
+	spi_transaction_t *trans;
+	spi_transaction_t SPITransaction;
+	esp_err_t ret;
+
+	if (dev->_transport) {
+		// Custom transports complete synchronously
+		dev->_transport->write(dev->_transport->ctx, mode, data, size);
+		dev->_trans_done = ++dev->_trans_head;
+		return dev->_trans_head;
+	}
+
+	if (dev->_pipeline) {
+		// Recycle the oldest descriptor once the ring is full
+		if (dev->_trans_head - dev->_trans_done >= TFT_QUEUE_SIZE) {
+			spi_master_wait(dev, dev->_trans_done + 1);
+		}
+		trans = &dev->_trans[dev->_trans_head % TFT_QUEUE_SIZE];
+	} else {
+		trans = &SPITransaction;
+	}
+
+	memset( trans, 0, sizeof( spi_transaction_t ) );
+	trans->length = size * 8;
+	trans->user = TFT_DC_TAG(dev->_dc, mode);
+	if (size <= 4) {
+		trans->flags = SPI_TRANS_USE_TXDATA;
+		memcpy(trans->tx_data, data, size);
+	} else {
+		trans->tx_buffer = data;
+	}
+
+	dev->_trans_head++;
+	if (dev->_pipeline) {
+		ret = spi_device_queue_trans( dev->_TFT_Handle, trans, portMAX_DELAY );
+	} else {
+		ret = spi_device_transmit( dev->_TFT_Handle, trans );
+		dev->_trans_done = dev->_trans_head;
+	}
+	assert(ret==ESP_OK);
+	return dev->_trans_head;
+}
+
+// Get the next DMA staging buffer (TFT_MAX_TRANSFER bytes)
+// Waits only for the transfer that last used this buffer, so the other one can still be on the bus.
+static uint8_t * spi_master_get_buffer(TFT_t * dev)
+{
+	dev->_tx_index = (dev->_tx_index + 1) % TFT_TX_BUFFERS;
+	spi_master_wait(dev, dev->_tx_seq[dev->_tx_index]);
+	return dev->_tx_buffer[dev->_tx_index];
+}
+
+// Send the buffer returned by the last spi_master_get_buffer as data
+static void spi_master_write_buffer(TFT_t * dev, size_t size)
+{
+	dev->_tx_seq[dev->_tx_index] = spi_master_submit(dev, SPI_Data_Mode, dev->_tx_buffer[dev->_tx_index], size);
+}
+
 bool spi_master_write_comm_byte(TFT_t * dev, uint8_t cmd)
 {
-	static uint8_t Byte = 0;
-	Byte = cmd;
-	gpio_set_level( dev->_dc, SPI_Command_Mode );
-	return spi_master_write_byte( dev->_TFT_Handle, &Byte, 1 );
+	spi_master_submit(dev, SPI_Command_Mode, &cmd, 1);
+	return true;
 }
 
 bool spi_master_write_comm_word(TFT_t * dev, uint16_t cmd)
 {
-	static uint8_t Byte[2];
+	uint8_t Byte[2];
 	Byte[0] = (cmd >> 8) & 0xFF;
 	Byte[1] = cmd & 0xFF;
-	gpio_set_level( dev->_dc, SPI_Command_Mode );
-	return spi_master_write_byte( dev->_TFT_Handle, Byte, 2 );
+	spi_master_submit(dev, SPI_Command_Mode, Byte, 2);
+	return true;
 }
 
 
 bool spi_master_write_data_byte(TFT_t * dev, uint8_t data)
 {
-	static uint8_t Byte = 0;
-	Byte = data;
-	gpio_set_level( dev->_dc, SPI_Data_Mode );
-	return spi_master_write_byte( dev->_TFT_Handle, &Byte, 1 );
+	spi_master_submit(dev, SPI_Data_Mode, &data, 1);
+	return true;
 }
 
 
 bool spi_master_write_data_word(TFT_t * dev, uint16_t data)
 {
-	static uint8_t Byte[2];
+	uint8_t Byte[2];
 	Byte[0] = (data >> 8) & 0xFF;
 	Byte[1] = data & 0xFF;
-	gpio_set_level( dev->_dc, SPI_Data_Mode );
-	return spi_master_write_byte( dev->_TFT_Handle, Byte, 2);
+	spi_master_submit(dev, SPI_Data_Mode, Byte, 2);
+	return true;
 }
 
 bool spi_master_write_addr(TFT_t * dev, uint16_t addr1, uint16_t addr2)
 {
-	static uint8_t Byte[4];
+	uint8_t Byte[4];
 	Byte[0] = (addr1 >> 8) & 0xFF;
 	Byte[1] = addr1 & 0xFF;
 	Byte[2] = (addr2 >> 8) & 0xFF;
 	Byte[3] = addr2 & 0xFF;
-	gpio_set_level( dev->_dc, SPI_Data_Mode );
-	return spi_master_write_byte( dev->_TFT_Handle, Byte, 4);
+	spi_master_submit(dev, SPI_Data_Mode, Byte, 4);
+	return true;
+}
+
+// Fill the next staging buffer with one colour, up to count pixels
+// Returns the number of pixels prepared for spi_master_write_run.
+static uint32_t spi_master_fill_buffer(TFT_t * dev, uint16_t color, uint32_t count)
+{
+	uint32_t len = (count > TFT_MAX_TRANSFER/2) ? TFT_MAX_TRANSFER/2 : count;
+	uint8_t *Byte = spi_master_get_buffer(dev);
+	uint16_t _color = lcdSwapColor(color);
+	uint32_t pattern = ((uint32_t)_color << 16) | _color;
+	uint32_t *word = (uint32_t *)Byte;
+	for(uint32_t i=0;i<len/2;i++) word[i] = pattern;
+	if (len & 1) ((uint16_t *)Byte)[len-1] = _color;
+	return len;
+}
+
+// Stream count pixels of the buffer prepared by spi_master_fill_buffer
+// The same buffer is queued again for every burst, so a long run costs only a few transfers.
+static void spi_master_write_run(TFT_t * dev, uint32_t prepared, uint32_t count)
+{
+	uint8_t *Byte = dev->_tx_buffer[dev->_tx_index];
+	while (count > 0) {
+		uint32_t len = (count > prepared) ? prepared : count;
+		dev->_tx_seq[dev->_tx_index] = spi_master_submit(dev, SPI_Data_Mode, Byte, len*2);
+		count -= len;
+	}
 }
 
 bool spi_master_write_color(TFT_t * dev, uint16_t color, uint16_t size)
 {
-	static uint8_t Byte[1024];
-	int index = 0;
-	for(int i=0;i<size;i++) {
-		Byte[index++] = (color >> 8) & 0xFF;
-		Byte[index++] = color & 0xFF;
+	if (size == 0) return true;
+	uint32_t prepared = spi_master_fill_buffer(dev, color, size);
+	spi_master_write_run(dev, prepared, size);
+	return true;
+}
+
+// Stream count pixels in wire order through the staging buffers
+static void spi_master_write_pixels(TFT_t * dev, const uint16_t * colors, uint32_t count)
+{
+	while (count > 0) {
+		uint32_t len = (count > TFT_MAX_TRANSFER/2) ? TFT_MAX_TRANSFER/2 : count;
+		uint8_t *Byte = spi_master_get_buffer(dev);
+		int index = 0;
+		for(int i=0;i<len;i++) {
+			Byte[index++] = (colors[i] >> 8) & 0xFF;
+			Byte[index++] = colors[i] & 0xFF;
+		}
+		spi_master_write_buffer(dev, len*2);
+		colors += len;
+		count -= len;
 	}
-	gpio_set_level( dev->_dc, SPI_Data_Mode );
-	return spi_master_write_byte( dev->_TFT_Handle, Byte, size*2);
 }
 
 // Add 202001
 bool spi_master_write_colors(TFT_t * dev, uint16_t * colors, uint16_t size)
 {
-	static uint8_t Byte[1024];
-	int index = 0;
-	for(int i=0;i<size;i++) {
-		Byte[index++] = (colors[i] >> 8) & 0xFF;
-		Byte[index++] = colors[i] & 0xFF;
+	spi_master_write_pixels(dev, colors, size);
+	return true;
+}
+
+// Write pre-encoded data bytes, split into DMA sized bursts
+// In pipeline mode the data is sent in place and must stay valid until lcdSync.
+bool spi_master_write_data_bytes(TFT_t * dev, const uint8_t * data, size_t size)
+{
+	while (size > 0) {
+		size_t len = (size > TFT_MAX_TRANSFER) ? TFT_MAX_TRANSFER : size;
+		spi_master_submit(dev, SPI_Data_Mode, data, len);
+		data += len;
+		size -= len;
 	}
-	gpio_set_level( dev->_dc, SPI_Data_Mode );
-	return spi_master_write_byte( dev->_TFT_Handle, Byte, size*2);
+	return true;
+}
+
+// Switch to queued transfers
+// Up to TFT_QUEUE_SIZE transactions stay in flight and drawing calls return
+// as soon as their data is queued. Call lcdSync before reusing memory passed
+// to spi_master_write_data_bytes or touching the bus from another driver.
+void lcdEnablePipeline(TFT_t * dev)
+{
+	dev->_pipeline = true;
+}
+
+// Switch back to blocking transfers
+void lcdDisablePipeline(TFT_t * dev)
+{
+	lcdSync(dev);
+	dev->_pipeline = false;
+}
+
+// Wait until every queued transaction has completed
+void lcdSync(TFT_t * dev)
+{
+	spi_master_wait(dev, dev->_trans_head);
 }
 
 
@@ -564,6 +756,12 @@ void lcdDrawPixel(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color){
 	if (x >= dev->_width) return;
 	if (y >= dev->_height) return;
 
+	if (dev->_frame_buffer) {
+		dev->_frame_buffer[y * dev->_width + x] = lcdSwapColor(color);
+		lcdAddDirtyRect(dev, x, y, x, y);
+		return;
+	}
+
 	uint16_t _x = x + dev->_offsetx;
 	uint16_t _y = y + dev->_offsety;
 
@@ -616,6 +814,13 @@ void lcdDrawMultiPixels(TFT_t * dev, uint16_t x, uint16_t y, uint16_t size, uint
 	if (x+size > dev->_width) return;
 	if (y >= dev->_height) return;
 
+	if (dev->_frame_buffer) {
+		uint16_t *fb = &dev->_frame_buffer[y * dev->_width + x];
+		for(int i=0;i<size;i++) fb[i] = lcdSwapColor(colors[i]);
+		lcdAddDirtyRect(dev, x, y, x+size-1, y);
+		return;
+	}
+
 	ESP_LOGD(TAG,"offset(x)=%d offset(y)=%d",dev->_offsetx,dev->_offsety);
 	uint16_t _x1 = x + dev->_offsetx;
 	uint16_t _x2 = _x1 + (size-1);
@@ -669,6 +874,82 @@ void lcdDrawMultiPixels(TFT_t * dev, uint16_t x, uint16_t y, uint16_t size, uint
 
 
 
+// Draw a block of pixels
+// x:Start X coordinate
+// y:Start Y coordinate
+// w:Width of the block
+// h:Height of the block
+// colors:w*h colors, row by row
+void lcdDrawBitmap(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t * colors) {
+	if (w == 0 || h == 0) return;
+	if (x+w > dev->_width) return;
+	if (y+h > dev->_height) return;
+
+	if (dev->_frame_buffer) {
+		for(int j=0;j<h;j++) {
+			uint16_t *fb = &dev->_frame_buffer[(y+j) * dev->_width + x];
+			const uint16_t *src = &colors[j * w];
+			for(int i=0;i<w;i++) fb[i] = lcdSwapColor(src[i]);
+		}
+		lcdAddDirtyRect(dev, x, y, x+w-1, y+h-1);
+		return;
+	}
+
+	if (dev->_model == 0x9225) {
+		// ILI9225 keeps the full screen window, so every row gets its own start address
+		for(int j=0;j<h;j++){
+			lcdSetWindow(dev, x, y+j, x+w-1, y+j);
+			spi_master_write_pixels(dev, &colors[j * w], w);
+		}
+		return;
+	} // endif 0x9225
+
+	// 0x9340/0x9341/0x7796/0x7735/0x9226 take the whole block in one window
+	lcdSetWindow(dev, x, y, x+w-1, y+h-1);
+	spi_master_write_pixels(dev, colors, (uint32_t)w * h);
+}
+
+// Get the next DMA staging buffer for lcdDrawRawBitmap
+// Holds TFT_DRAW_BUFFER_PIXELS pixels in wire byte order (big-endian RGB565).
+// The buffers are used in turn, so one can be filled while the other is on the bus.
+uint16_t * lcdGetDrawBuffer(TFT_t * dev) {
+	return (uint16_t *)spi_master_get_buffer(dev);
+}
+
+// Draw the buffer returned by the last lcdGetDrawBuffer
+// x:Start X coordinate
+// y:Start Y coordinate
+// w:Width of the block
+// h:Height of the block, w*h must not exceed TFT_DRAW_BUFFER_PIXELS
+// In pipeline mode this returns as soon as the transfer is queued.
+void lcdDrawRawBitmap(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+	if (w == 0 || h == 0) return;
+	if ((uint32_t)w * h > TFT_DRAW_BUFFER_PIXELS) return;
+	if (x+w > dev->_width) return;
+	if (y+h > dev->_height) return;
+
+	uint8_t *Byte = dev->_tx_buffer[dev->_tx_index];
+	if (dev->_frame_buffer) {
+		for(int j=0;j<h;j++) {
+			memcpy(&dev->_frame_buffer[(y+j) * dev->_width + x], &Byte[j * w * 2], w * 2);
+		}
+		lcdAddDirtyRect(dev, x, y, x+w-1, y+h-1);
+		return;
+	}
+
+	if (dev->_model == 0x9225) {
+		// ILI9225 keeps the full screen window, so every row gets its own start address
+		for(int j=0;j<h;j++){
+			lcdSetWindow(dev, x, y+j, x+w-1, y+j);
+			dev->_tx_seq[dev->_tx_index] = spi_master_submit(dev, SPI_Data_Mode, &Byte[j * w * 2], w * 2);
+		}
+		return;
+	} // endif 0x9225
+
+	lcdSetWindow(dev, x, y, x+w-1, y+h-1);
+	spi_master_write_buffer(dev, (size_t)w * h * 2);
+}
+
 // Draw rectangle of filling
 // x1:Start X coordinate
 // y1:Start Y coordinate
@@ -681,67 +962,33 @@ void lcdDrawFillRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_
 	if (y1 >= dev->_height) return;
 	if (y2 >= dev->_height) y2=dev->_height-1;
 
-	ESP_LOGD(TAG,"offset(x)=%d offset(y)=%d",dev->_offsetx,dev->_offsety);
-	uint16_t _x1 = x1 + dev->_offsetx;
-	uint16_t _x2 = x2 + dev->_offsetx;
-	uint16_t _y1 = y1 + dev->_offsety;
-	uint16_t _y2 = y2 + dev->_offsety;
-
-	if (dev->_model == 0x9340 || dev->_model == 0x9341 || dev->_model == 0x7796) {
-		spi_master_write_comm_byte(dev, 0x2A);	// set column(x) address
-		spi_master_write_addr(dev, _x1, _x2);
-		spi_master_write_comm_byte(dev, 0x2B);	// set Page(y) address
-		spi_master_write_addr(dev, _y1, _y2);
-		spi_master_write_comm_byte(dev, 0x2C);	// Memory Write
-		for(int i=_x1;i<=_x2;i++) {
-			uint16_t size = _y2-_y1+1;
-			spi_master_write_color(dev, color, size);
+	if (dev->_frame_buffer) {
+		uint16_t _color = lcdSwapColor(color);
+		for(int j=y1;j<=y2;j++) {
+			uint16_t *fb = &dev->_frame_buffer[j * dev->_width];
+			for(int i=x1;i<=x2;i++) fb[i] = _color;
 		}
-	} // endif 0x9340/0x9341/0x7796
+		lcdAddDirtyRect(dev, x1, y1, x2, y2);
+		return;
+	}
 
-	if (dev->_model == 0x7735) {
-		spi_master_write_comm_byte(dev, 0x2A);	// set column(x) address
-		spi_master_write_data_word(dev, _x1);
-		spi_master_write_data_word(dev, _x2);
-		spi_master_write_comm_byte(dev, 0x2B);	// set Page(y) address
-		spi_master_write_data_word(dev, _y1);
-		spi_master_write_data_word(dev, _y2);
-		spi_master_write_comm_byte(dev, 0x2C);	// Memory Write
-		for(int i=_x1;i<=_x2;i++) {
-			uint16_t size = _y2-_y1+1;
-			spi_master_write_color(dev, color, size);
-		}
-	} // 0x7735
+	ESP_LOGD(TAG,"offset(x)=%d offset(y)=%d",dev->_offsetx,dev->_offsety);
+	uint32_t w = x2 - x1 + 1;
+	uint32_t h = y2 - y1 + 1;
+	uint32_t prepared = spi_master_fill_buffer(dev, color, w * h);
 
 	if (dev->_model == 0x9225) {
-		for(int j=_y1;j<=_y2;j++){
-			lcdWriteRegisterByte(dev, 0x20, _x1);
-			lcdWriteRegisterByte(dev, 0x21, j);
-			spi_master_write_comm_byte(dev, 0x22);	// Memory Write
-			uint16_t size = _x2-_x1+1;
-			spi_master_write_color(dev, color, size);
+		// ILI9225 keeps the full screen window, so every row gets its own start address
+		for(int j=y1;j<=y2;j++){
+			lcdSetWindow(dev, x1, j, x2, j);
+			spi_master_write_run(dev, prepared, w);
 		}
+		return;
 	} // endif 0x9225
 
-	if (dev->_model == 0x9226) {
-		for(int j=_x1;j<=_x2;j++) {
-			lcdWriteRegisterByte(dev, 0x36, j);
-			lcdWriteRegisterByte(dev, 0x37, j);
-			lcdWriteRegisterByte(dev, 0x38, _y2);
-			lcdWriteRegisterByte(dev, 0x39, _y1);
-			lcdWriteRegisterByte(dev, 0x20, j);
-			lcdWriteRegisterByte(dev, 0x21, _y1); 
-			spi_master_write_comm_byte(dev, 0x22);
-			uint16_t size = _y2-_y1+1;
-			spi_master_write_color(dev, color, size);
-#if 0
-			for(int i=_y1;i<=_y2;i++) {
-				spi_master_write_data_word(dev, color);
-			}
-#endif
-		}
-	} // endif 0x9226
-
+	// 0x9340/0x9341/0x7796/0x7735/0x9226 fill the whole window in one run
+	lcdSetWindow(dev, x1, y1, x2, y2);
+	spi_master_write_run(dev, prepared, w * h);
 }
 
 // x0:Center X coordinate
@@ -1150,137 +1397,150 @@ uint16_t rgb565_conv(uint16_t r,uint16_t g,uint16_t b) {
 	return (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
 }
 
+// Glyph placement for one font direction
+// A glyph bit at column c, row r lands on cell pixel
+// (xb + c*xc + r*xr, yb + c*yc + r*yr), the cell being the glyph's bounding box.
+typedef struct {
+	int16_t x0, y0;	// top left of the cell
+	int16_t w, h;	// cell size
+	int16_t xb, xc, xr;
+	int16_t yb, yc, yr;
+	int16_t next;
+} GlyphLayout;
+
+static void lcdGlyphLayout(TFT_t * dev, int x, int y, uint8_t pw, uint8_t ph, GlyphLayout *l) {
+	memset(l, 0, sizeof(GlyphLayout));
+	if (dev->_font_direction == 0) {
+		l->x0 = x;
+		l->y0 = y - (ph-1);
+		l->w = pw; l->h = ph;
+		l->xc = 1;
+		l->yr = 1;
+		l->next = x + pw;
+	} else if (dev->_font_direction == 2) {
+		l->x0 = x - (pw-1);
+		l->y0 = y;
+		l->w = pw; l->h = ph;
+		l->xb = pw-1; l->xc = -1;
+		l->yb = ph-1; l->yr = -1;
+		l->next = x - pw;
+	} else if (dev->_font_direction == 1) {
+		l->x0 = x + 1;
+		l->y0 = y;
+		l->w = ph; l->h = pw;
+		l->xb = ph-1; l->xr = -1;
+		l->yc = 1;
+		l->next = y + pw;
+	} else if (dev->_font_direction == 3) {
+		l->x0 = x - (ph-1);
+		l->y0 = y - (pw-1);
+		l->w = ph; l->h = pw;
+		l->xr = 1;
+		l->yb = pw-1; l->yc = -1;
+		l->next = y - pw;
+	}
+}
+
+// Expand a glyph bitmap into RGB565 pixels in wire byte order
+// block:top left of the cell in the destination, stride:destination row length in pixels
+// opaque:paint clear bits with the font fill color, otherwise leave them untouched
+static void lcdExpandGlyph(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, GlyphLayout *l,
+	uint16_t *block, int stride, bool opaque, uint16_t color) {
+	uint16_t fg = lcdSwapColor(color);
+	uint16_t bg = lcdSwapColor(dev->_font_fill_color);
+	uint16_t ul = lcdSwapColor(dev->_font_underline_color);
+	int dc = l->yc * stride + l->xc;
+	int dr = l->yr * stride + l->xr;
+	int bytes = (pw + 7) / 8;
+
+	block += l->yb * stride + l->xb;
+	for(int r=0;r<ph;r++) {
+		const uint8_t *row = &fonts[r * bytes];
+		bool underline = dev->_font_underline && r >= ph-2;
+		uint16_t *p = block + r * dr;
+		for(int c=0;c<pw;c++, p+=dc) {
+			if (underline) {
+				*p = ul;
+			} else if (row[c >> 3] & (0x80 >> (c & 7))) {
+				*p = fg;
+			} else if (opaque) {
+				*p = bg;
+			}
+		}
+	}
+}
+
+// Send the current staging buffer as a w x h block into the given window
+static void lcdWriteBlock(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+	size_t rowBytes = (x2 - x1 + 1) * 2;
+
+	if (dev->_model == 0x9225) {
+		// ILI9225 keeps the full screen window, so every row gets its own start address
+		uint8_t *buffer = dev->_tx_buffer[dev->_tx_index];
+		for(int j=y1;j<=y2;j++) {
+			lcdSetWindow(dev, x1, j, x2, j);
+			dev->_tx_seq[dev->_tx_index] = spi_master_submit(dev, SPI_Data_Mode, buffer, rowBytes);
+			buffer += rowBytes;
+		}
+		return;
+	} // endif 0x9225
+
+	lcdSetWindow(dev, x1, y1, x2, y2);
+	spi_master_write_buffer(dev, rowBytes * (y2 - y1 + 1));
+}
+
 // Draw ASCII character
 // x:X coordinate
 // y:Y coordinate
 // ascii:ascii code
 // color:color
+// The glyph is expanded into a block and sent with one window write. Glyphs
+// crossing the screen edge, and transparent glyphs without a frame buffer,
+// are drawn pixel by pixel.
 int lcdDrawChar(TFT_t * dev, FontxFile *fxs, uint16_t x, uint16_t y, uint8_t ascii, uint16_t color) {
-	uint16_t xx,yy,bit,ofs;
-	unsigned char fonts[128]; // font pattern
+	const uint8_t *fonts; // font pattern
 	unsigned char pw, ph;
-	int h,w;
-	uint16_t mask;
 	bool rc;
+	GlyphLayout l;
 
 	if(_DEBUG_)printf("_font_direction=%d\n",dev->_font_direction);
-	rc = GetFontx(fxs, ascii, fonts, &pw, &ph);
+	rc = GetFontxGlyph(fxs, ascii, &fonts, &pw, &ph);
 	if(_DEBUG_)printf("GetFontx rc=%d pw=%d ph=%d\n",rc,pw,ph);
 	if (!rc) return 0;
 
-	int16_t xd1 = 0;
-	int16_t yd1 = 0;
-	int16_t xd2 = 0;
-	int16_t yd2 = 0;
-	int16_t xss = 0;
-	int16_t yss = 0;
-	int16_t xsd = 0;
-	int16_t ysd = 0;
-	int16_t next = 0;
-	int16_t x0	= 0;
-	int16_t x1	= 0;
-	int16_t y0	= 0;
-	int16_t y1	= 0;
-	if (dev->_font_direction == 0) {
-		xd1 = +1;
-		yd1 = +1; //-1;
-		xd2 =  0;
-		yd2 =  0;
-		xss =  x;
-		yss =  y - (ph - 1);
-		xsd =  1;
-		ysd =  0;
-		next = x + pw;
-
-		x0	= x;
-		y0	= y - (ph-1);
-		x1	= x + (pw-1);
-		y1	= y;
-	} else if (dev->_font_direction == 2) {
-		xd1 = -1;
-		yd1 = -1; //+1;
-		xd2 =  0;
-		yd2 =  0;
-		xss =  x;
-		yss =  y + ph + 1;
-		xsd =  1;
-		ysd =  0;
-		next = x - pw;
-
-		x0	= x - (pw-1);
-		y0	= y;
-		x1	= x;
-		y1	= y + (ph-1);
-	} else if (dev->_font_direction == 1) {
-		xd1 =  0;
-		yd1 =  0;
-		xd2 = -1;
-		yd2 = +1; //-1;
-		xss =  x + ph;
-		yss =  y;
-		xsd =  0;
-		ysd =  1;
-		next = y + pw; //y - pw;
-
-		x0	= x;
-		y0	= y;
-		x1	= x + (ph-1);
-		y1	= y + (pw-1);
-	} else if (dev->_font_direction == 3) {
-		xd1 =  0;
-		yd1 =  0;
-		xd2 = +1;
-		yd2 = -1; //+1;
-		xss =  x - (ph - 1);
-		yss =  y;
-		xsd =  0;
-		ysd =  1;
-		next = y - pw; //y + pw;
+	lcdGlyphLayout(dev, x, y, pw, ph, &l);
+	int16_t next = l.next;
+	if (next < 0) next = 0;
 
-		x0	= x - (ph-1);
-		y0	= y - (pw-1);
-		x1	= x;
-		y1	= y;
+	bool inside = (l.x0 >= 0 && l.y0 >= 0 && l.x0 + l.w <= dev->_width && l.y0 + l.h <= dev->_height);
+	if (inside && dev->_frame_buffer) {
+		lcdExpandGlyph(dev, fonts, pw, ph, &l, &dev->_frame_buffer[l.y0 * dev->_width + l.x0], dev->_width, dev->_font_fill, color);
+		lcdAddDirtyRect(dev, l.x0, l.y0, l.x0 + l.w - 1, l.y0 + l.h - 1);
+		return next;
 	}
 
-	if (dev->_font_fill) lcdDrawFillRect(dev, x0, y0, x1, y1, dev->_font_fill_color);
+	if (inside && dev->_font_fill && l.w * l.h * 2 <= TFT_MAX_TRANSFER) {
+		uint16_t *block = (uint16_t *)spi_master_get_buffer(dev);
+		lcdExpandGlyph(dev, fonts, pw, ph, &l, block, l.w, true, color);
+		lcdWriteBlock(dev, l.x0, l.y0, l.x0 + l.w - 1, l.y0 + l.h - 1);
+		return next;
+	}
 
-	int bits;
-	if(_DEBUG_)printf("xss=%d yss=%d\n",xss,yss);
-	ofs = 0;
-	yy = yss;
-	xx = xss;
-	for(h=0;h<ph;h++) {
-		if(xsd) xx = xss;
-		if(ysd) yy = yss;
-		//for(w=0;w<(pw/8);w++) {
-		bits = pw;
-		for(w=0;w<((pw+4)/8);w++) {
-			mask = 0x80;
-			for(bit=0;bit<8;bit++) {
-				bits--;
-				if (bits < 0) continue;
-				//if(_DEBUG_)printf("xx=%d yy=%d mask=%02x fonts[%d]=%02x\n",xx,yy,mask,ofs,fonts[ofs]);
-				if (fonts[ofs] & mask) {
-					lcdDrawPixel(dev, xx, yy, color);
-				} else {
-					//if (dev->_font_fill) lcdDrawPixel(dev, xx, yy, dev->_font_fill_color);
-				}
-				if (h == (ph-2) && dev->_font_underline)
-					lcdDrawPixel(dev, xx, yy, dev->_font_underline_color);
-				if (h == (ph-1) && dev->_font_underline)
-					lcdDrawPixel(dev, xx, yy, dev->_font_underline_color);
-				xx = xx + xd1;
-				yy = yy + yd2;
-				mask = mask >> 1;
+	// Pixel by pixel, lcdDrawPixel clips against the screen
+	int bytes = (pw + 7) / 8;
+	for(int r=0;r<ph;r++) {
+		for(int c=0;c<pw;c++) {
+			int16_t xx = l.x0 + l.xb + c * l.xc + r * l.xr;
+			int16_t yy = l.y0 + l.yb + c * l.yc + r * l.yr;
+			if (dev->_font_underline && r >= ph-2) {
+				lcdDrawPixel(dev, xx, yy, dev->_font_underline_color);
+			} else if (fonts[r * bytes + (c >> 3)] & (0x80 >> (c & 7))) {
+				lcdDrawPixel(dev, xx, yy, color);
+			} else if (dev->_font_fill) {
+				lcdDrawPixel(dev, xx, yy, dev->_font_fill_color);
 			}
-			ofs++;
 		}
-		yy = yy + yd1;
-		xx = xx + xd2;
 	}
-
-	if (next < 0) next = 0;
 	return next;
 }
 
@@ -1583,6 +1843,166 @@ void lcdScroll(TFT_t * dev, uint16_t vsp){
 	} // endif 0x9225/0x9226
 }
 
+// Set the GRAM window and start Memory Write
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+static void lcdSetWindow(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+	uint16_t _x1 = x1 + dev->_offsetx;
+	uint16_t _x2 = x2 + dev->_offsetx;
+	uint16_t _y1 = y1 + dev->_offsety;
+	uint16_t _y2 = y2 + dev->_offsety;
+
+	if (dev->_model == 0x9340 || dev->_model == 0x9341 || dev->_model == 0x7796 || dev->_model == 0x7735) {
+		spi_master_write_comm_byte(dev, 0x2A);	// set column(x) address
+		spi_master_write_addr(dev, _x1, _x2);
+		spi_master_write_comm_byte(dev, 0x2B);	// set Page(y) address
+		spi_master_write_addr(dev, _y1, _y2);
+		spi_master_write_comm_byte(dev, 0x2C);	// Memory Write
+	} // endif 0x9340/0x9341/0x7796/0x7735
+
+	if (dev->_model == 0x9225) {
+		lcdWriteRegisterByte(dev, 0x20, _x1);
+		lcdWriteRegisterByte(dev, 0x21, _y1);
+		spi_master_write_comm_byte(dev, 0x22);	// Memory Write
+	} // endif 0x9225
+
+	if (dev->_model == 0x9226) {
+		lcdWriteRegisterByte(dev, 0x36, _x2);
+		lcdWriteRegisterByte(dev, 0x37, _x1);
+		lcdWriteRegisterByte(dev, 0x38, _y2);
+		lcdWriteRegisterByte(dev, 0x39, _y1);
+		lcdWriteRegisterByte(dev, 0x20, _x1);
+		lcdWriteRegisterByte(dev, 0x21, _y1);
+		spi_master_write_comm_byte(dev, 0x22);	// Memory Write
+	} // endif 0x9226
+}
+
+static uint32_t lcdRectArea(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+	return (uint32_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+}
+
+// Record a changed region of the frame buffer
+// Rectangles are merged while the union wastes no more than FRAME_BUFFER_DIRTY_SLACK pixels,
+// when the list is full the new one is merged into the rectangle that grows the least.
+static void lcdAddDirtyRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+	uint32_t area = lcdRectArea(x1, y1, x2, y2);
+	int best = -1;
+	uint32_t bestGrowth = UINT32_MAX;
+
+	for(int i=0;i<dev->_dirty_count;i++) {
+		DirtyRect *r = &dev->_dirty[i];
+		uint16_t ux1 = (x1 < r->x1) ? x1 : r->x1;
+		uint16_t uy1 = (y1 < r->y1) ? y1 : r->y1;
+		uint16_t ux2 = (x2 > r->x2) ? x2 : r->x2;
+		uint16_t uy2 = (y2 > r->y2) ? y2 : r->y2;
+		uint32_t rarea = lcdRectArea(r->x1, r->y1, r->x2, r->y2);
+		uint32_t uarea = lcdRectArea(ux1, uy1, ux2, uy2);
+		if (uarea <= rarea + area + FRAME_BUFFER_DIRTY_SLACK) {
+			r->x1 = ux1; r->y1 = uy1; r->x2 = ux2; r->y2 = uy2;
+			return;
+		}
+		if (uarea - rarea < bestGrowth) {
+			bestGrowth = uarea - rarea;
+			best = i;
+		}
+	}
+
+	if (dev->_dirty_count < FRAME_BUFFER_DIRTY_MAX) {
+		DirtyRect *r = &dev->_dirty[dev->_dirty_count++];
+		r->x1 = x1; r->y1 = y1; r->x2 = x2; r->y2 = y2;
+		return;
+	}
+
+	DirtyRect *r = &dev->_dirty[best];
+	if (x1 < r->x1) r->x1 = x1;
+	if (y1 < r->y1) r->y1 = y1;
+	if (x2 > r->x2) r->x2 = x2;
+	if (y2 > r->y2) r->y2 = y2;
+}
+
+// Push one dirty rectangle of the frame buffer to GRAM
+// Returns true when transfers were queued straight out of the frame buffer.
+static bool lcdFlushRect(TFT_t * dev, DirtyRect *r) {
+	uint16_t w = r->x2 - r->x1 + 1;
+	size_t rowBytes = w * 2;
+
+	if (dev->_model == 0x9225) {
+		// ILI9225 keeps the full screen window, so every row gets its own start address
+		for(int j=r->y1;j<=r->y2;j++) {
+			lcdSetWindow(dev, r->x1, j, r->x2, j);
+			spi_master_write_data_bytes(dev, (uint8_t *)&dev->_frame_buffer[j * dev->_width + r->x1], rowBytes);
+		}
+		return true;
+	} // endif 0x9225
+
+	lcdSetWindow(dev, r->x1, r->y1, r->x2, r->y2);
+	if (w == dev->_width) {
+		// Full width rows are contiguous, send them straight from the frame buffer
+		size_t size = rowBytes * (r->y2 - r->y1 + 1);
+		spi_master_write_data_bytes(dev, (uint8_t *)&dev->_frame_buffer[r->y1 * dev->_width], size);
+		return true;
+	}
+
+	// Gather partial rows into staging buffers so each burst is as large as possible
+	size_t index = 0;
+	uint8_t *buffer = spi_master_get_buffer(dev);
+	for(int j=r->y1;j<=r->y2;j++) {
+		if (index + rowBytes > TFT_MAX_TRANSFER) {
+			spi_master_write_buffer(dev, index);
+			buffer = spi_master_get_buffer(dev);
+			index = 0;
+		}
+		memcpy(&buffer[index], &dev->_frame_buffer[j * dev->_width + r->x1], rowBytes);
+		index += rowBytes;
+	}
+	if (index) spi_master_write_buffer(dev, index);
+	return false;
+}
+
+// Enable off-screen rendering
+// All drawing functions render into a shadow frame buffer until lcdFlush is called.
+// Must be called after lcdInit.
+bool lcdEnableFrameBuffer(TFT_t * dev) {
+	if (dev->_frame_buffer) return true;
+	size_t size = dev->_width * dev->_height * sizeof(uint16_t);
+	dev->_frame_buffer = heap_caps_malloc(size, MALLOC_CAP_DMA);
+	if (dev->_frame_buffer == NULL) {
+		ESP_LOGE(TAG, "Frame buffer allocation failed (%zu bytes)", size);
+		return false;
+	}
+	// Start from a black screen so the shadow matches what the next flush will show
+	memset(dev->_frame_buffer, 0, size);
+	dev->_dirty_count = 0;
+	lcdAddDirtyRect(dev, 0, 0, dev->_width-1, dev->_height-1);
+	return true;
+}
+
+// Disable off-screen rendering
+// Pending changes are flushed before the buffer is released.
+void lcdDisableFrameBuffer(TFT_t * dev) {
+	if (dev->_frame_buffer == NULL) return;
+	lcdFlush(dev);
+	lcdSync(dev);
+	heap_caps_free(dev->_frame_buffer);
+	dev->_frame_buffer = NULL;
+}
+
+// Push all dirty regions of the frame buffer to the panel
+// Drawing may resume as soon as this returns: transfers still queued only read the staging buffers.
+void lcdFlush(TFT_t * dev) {
+	if (dev->_frame_buffer == NULL) return;
+	bool inPlace = false;
+	for(int i=0;i<dev->_dirty_count;i++) {
+		ESP_LOGD(TAG, "flush x1=%d y1=%d x2=%d y2=%d", dev->_dirty[i].x1, dev->_dirty[i].y1, dev->_dirty[i].x2, dev->_dirty[i].y2);
+		if (lcdFlushRect(dev, &dev->_dirty[i])) inPlace = true;
+	}
+	dev->_dirty_count = 0;
+	// The DMA reads the frame buffer itself for these, the next draw would tear them
+	if (inPlace) lcdSync(dev);
+}
+
 #define MAX_LEN 3
 #define	XPT_START	0x80
 #define XPT_XPOS	0x50
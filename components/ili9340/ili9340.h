@@ -25,6 +25,28 @@
 
 typedef enum {DIRECTION0, DIRECTION90, DIRECTION180, DIRECTION270} DIRECTION;
 
+#define TFT_MAX_TRANSFER	4092	// Largest single DMA burst in bytes
+#define TFT_QUEUE_SIZE	7	// Transactions kept in flight in pipeline mode
+#define TFT_TX_BUFFERS	2	// DMA staging buffers used in turn
+#define TFT_DRAW_BUFFER_PIXELS	(TFT_MAX_TRANSFER/2)	// Pixels in a lcdGetDrawBuffer buffer
+#define FRAME_BUFFER_DIRTY_MAX	8	// Dirty rectangles tracked before merging
+#define FRAME_BUFFER_DIRTY_SLACK	64	// Extra pixels accepted when merging two rectangles
+
+typedef struct {
+	uint16_t x1;
+	uint16_t y1;
+	uint16_t x2;
+	uint16_t y2;
+} DirtyRect;
+
+// Display transport
+// write() gets every display transfer in order, mode is 0 for command bytes and 1 for data bytes.
+// Transfers are complete when write() returns. Used instead of the ESP SPI driver when attached.
+typedef struct {
+	void * ctx;
+	void (*write)(void * ctx, int mode, const uint8_t * data, size_t size);
+} TFT_Transport;
+
 typedef struct {
 	uint16_t _model;
 	uint16_t _width;
@@ -41,6 +63,7 @@ typedef struct {
 	int16_t _irq;
 	spi_device_handle_t _TFT_Handle;
 	spi_device_handle_t _XPT_Handle;
+	const TFT_Transport * _transport; // NULL for the ESP SPI driver
 	bool _calibration;
 	int16_t _min_xp; // Minimum xp calibration
 	int16_t _min_yp; // Minimum yp calibration
@@ -50,10 +73,21 @@ typedef struct {
 	int16_t _min_yc; // Minimum y coordinate
 	int16_t _max_xc; // Maximum x coordinate
 	int16_t _max_yc; // Maximum y coordinate
+	bool _pipeline; // Queue transactions instead of waiting for each one
+	uint32_t _trans_head; // Transactions submitted
+	uint32_t _trans_done; // Transactions completed
+	spi_transaction_t * _trans; // Descriptor ring, TFT_QUEUE_SIZE entries
+	uint8_t * _tx_buffer[TFT_TX_BUFFERS]; // DMA staging buffers, TFT_MAX_TRANSFER bytes each
+	uint32_t _tx_seq[TFT_TX_BUFFERS]; // Last transaction using each staging buffer
+	uint8_t _tx_index;
+	uint16_t * _frame_buffer; // Shadow GRAM in wire byte order, NULL when drawing directly
+	uint8_t _dirty_count;
+	DirtyRect _dirty[FRAME_BUFFER_DIRTY_MAX];
 } TFT_t;
 
 void spi_master_init(TFT_t * dev, int16_t TFT_MOSI, int16_t TFT_SCLK, int16_t TFT_CS, int16_t GPIO_DC, int16_t GPIO_RESET, int16_t GPIO_BL,
 	int16_t XPT_MISO, int16_t XPT_CS, int16_t XPT_IRQ, int16_t XPT_SCLK, int16_t XPT_MOSI);
+void lcdAttachTransport(TFT_t * dev, const TFT_Transport * transport);
 bool spi_master_write_byte(spi_device_handle_t SPIHandle, const uint8_t* Data, size_t DataLength);
 bool spi_master_write_comm_byte(TFT_t * dev, uint8_t cmd);
 bool spi_master_write_comm_word(TFT_t * dev, uint16_t cmd);
@@ -62,6 +96,7 @@ bool spi_master_write_data_word(TFT_t * dev, uint16_t data);
 bool spi_master_write_addr(TFT_t * dev, uint16_t addr1, uint16_t addr2);
 bool spi_master_write_color(TFT_t * dev, uint16_t color, uint16_t size);
 bool spi_master_write_colors(TFT_t * dev, uint16_t * colors, uint16_t size);
+bool spi_master_write_data_bytes(TFT_t * dev, const uint8_t * data, size_t size);
 
 void delayMS(int ms);
 void lcdWriteRegisterWord(TFT_t * dev, uint16_t addr, uint16_t data);
@@ -69,6 +104,9 @@ void lcdWriteRegisterByte(TFT_t * dev, uint8_t addr, uint16_t data);
 void lcdInit(TFT_t * dev, uint16_t model, int width, int height, int offsetx, int offsety);
 void lcdDrawPixel(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color);
 void lcdDrawMultiPixels(TFT_t * dev, uint16_t x, uint16_t y, uint16_t size, uint16_t * colors);
+void lcdDrawBitmap(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t * colors);
+uint16_t * lcdGetDrawBuffer(TFT_t * dev);
+void lcdDrawRawBitmap(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 void lcdDrawFillRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
 void lcdDrawFillRect2(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t size, uint16_t color);
 void lcdDisplayOff(TFT_t * dev);
@@ -104,6 +142,12 @@ void lcdBacklightOn(TFT_t * dev);
 void lcdSetScrollArea(TFT_t * dev, uint16_t tfa, uint16_t vsa, uint16_t bfa);
 void lcdResetScrollArea(TFT_t * dev, uint16_t vsa);
 void lcdScroll(TFT_t * dev, uint16_t vsp);
+void lcdEnablePipeline(TFT_t * dev);
+void lcdDisablePipeline(TFT_t * dev);
+void lcdSync(TFT_t * dev);
+bool lcdEnableFrameBuffer(TFT_t * dev);
+void lcdDisableFrameBuffer(TFT_t * dev);
+void lcdFlush(TFT_t * dev);
 int xptGetit(TFT_t * dev, int cmd);
 bool touch_getxy(TFT_t *dev, int *xp, int *yp);
 #endif /* MAIN_ILI9340_H_ */
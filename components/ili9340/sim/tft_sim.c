@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "tft_sim.h"
+
+bool tft_sim_init(TFTSim * sim, uint16_t width, uint16_t height, uint32_t frequency)
+{
+	memset(sim, 0, sizeof(TFTSim));
+	sim->gram = calloc((size_t)width * height, sizeof(uint16_t));
+	if (sim->gram == NULL) return false;
+	sim->width = width;
+	sim->height = height;
+	sim->frequency = frequency;
+	sim->xe = width - 1;
+	sim->ye = height - 1;
+	sim->hi = -1;
+	return true;
+}
+
+void tft_sim_free(TFTSim * sim)
+{
+	free(sim->gram);
+	sim->gram = NULL;
+}
+
+void tft_sim_reset_stats(TFTSim * sim)
+{
+	sim->transactions = 0;
+	sim->bytes = 0;
+	sim->wire_ns = 0;
+	sim->pixels = 0;
+	sim->clipped = 0;
+	memset(sim->commands, 0, sizeof(sim->commands));
+}
+
+uint16_t tft_sim_get_pixel(TFTSim * sim, uint16_t x, uint16_t y)
+{
+	if (x >= sim->width || y >= sim->height) return 0;
+	return sim->gram[y * sim->width + x];
+}
+
+// Store one pixel at the write position and advance inside the window
+static void tft_sim_pixel(TFTSim * sim, uint16_t color)
+{
+	if (sim->x < sim->width && sim->y < sim->height) {
+		sim->gram[sim->y * sim->width + sim->x] = color;
+		sim->pixels++;
+	} else {
+		sim->clipped++;
+	}
+	if (sim->x++ >= sim->xe) {
+		sim->x = sim->xs;
+		if (sim->y++ >= sim->ye) sim->y = sim->ys;
+	}
+}
+
+static void tft_sim_command(TFTSim * sim, uint8_t cmd)
+{
+	sim->has_cmd = true;
+	sim->cmd = cmd;
+	sim->param = 0;
+	sim->hi = -1;
+	sim->commands[cmd].count++;
+	if (cmd == 0x2C) {
+		// Memory Write starts at the window origin, 0x3C continues
+		sim->x = sim->xs;
+		sim->y = sim->ys;
+	}
+}
+
+static void tft_sim_data(TFTSim * sim, uint8_t data)
+{
+	switch (sim->cmd) {
+	case 0x2A: // column address
+	case 0x2B: // page address
+		if (sim->param < 4) sim->params[sim->param] = data;
+		if (sim->param == 3) {
+			uint16_t start = (sim->params[0] << 8) | sim->params[1];
+			uint16_t end = (sim->params[2] << 8) | sim->params[3];
+			if (sim->cmd == 0x2A) {
+				sim->xs = start;
+				sim->xe = end;
+			} else {
+				sim->ys = start;
+				sim->ye = end;
+			}
+		}
+		break;
+	case 0x2C: // memory write
+	case 0x3C: // memory write continue
+		if (sim->hi < 0) {
+			sim->hi = data;
+		} else {
+			tft_sim_pixel(sim, (sim->hi << 8) | data);
+			sim->hi = -1;
+		}
+		break;
+	default:
+		break;
+	}
+	sim->param++;
+}
+
+// TFT_Transport write callback, ctx is the TFTSim
+void tft_sim_write(void * ctx, int mode, const uint8_t * data, size_t size)
+{
+	TFTSim * sim = ctx;
+
+	sim->transactions++;
+	sim->bytes += size;
+	if (sim->frequency) sim->wire_ns += (uint64_t)size * 8 * 1000000000ULL / sim->frequency;
+	sim->wire_ns += sim->overhead_ns;
+
+	if (mode == 0) {
+		// Only the last byte of a command transfer is decoded as the command
+		if (size) tft_sim_command(sim, data[size-1]);
+		return;
+	}
+	if (!sim->has_cmd) return;
+	sim->commands[sim->cmd].transactions++;
+	sim->commands[sim->cmd].bytes += size;
+	for(size_t i=0;i<size;i++) tft_sim_data(sim, data[i]);
+}
+
+void tft_sim_dump_stats(TFTSim * sim, FILE * out)
+{
+	fprintf(out, "transactions=%"PRIu32" bytes=%"PRIu64" wire=%"PRIu64"us pixels=%"PRIu32" clipped=%"PRIu32"\n",
+		sim->transactions, sim->bytes, sim->wire_ns / 1000, sim->pixels, sim->clipped);
+	for(int i=0;i<256;i++) {
+		TFTSimCommandStat *stat = &sim->commands[i];
+		if (stat->count == 0) continue;
+		fprintf(out, "cmd 0x%02X count=%"PRIu32" data transactions=%"PRIu32" data bytes=%"PRIu32"\n",
+			i, stat->count, stat->transactions, stat->bytes);
+	}
+}
+
+/*
+ PNG output
+
+ 8 bit RGB, the image data goes into stored (uncompressed) deflate blocks,
+ so no zlib is needed on the host.
+*/
+typedef struct {
+	FILE * f;
+	uint32_t crc;
+	uint32_t adler_a;
+	uint32_t adler_b;
+	uint32_t raw_left; // image bytes still to come
+	uint32_t block_left; // image bytes left in the current stored block
+} PngWriter;
+
+#define PNG_STORED_MAX 65535
+
+static uint32_t png_crc(uint32_t crc, uint8_t data)
+{
+	crc ^= data;
+	for(int i=0;i<8;i++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	return crc;
+}
+
+static void png_put(PngWriter * w, uint8_t data)
+{
+	fputc(data, w->f);
+	w->crc = png_crc(w->crc, data);
+}
+
+static void png_put32(PngWriter * w, uint32_t data)
+{
+	png_put(w, data >> 24);
+	png_put(w, data >> 16);
+	png_put(w, data >> 8);
+	png_put(w, data);
+}
+
+// Chunk length goes outside the CRC
+static void png_chunk_begin(PngWriter * w, uint32_t length, const char * type)
+{
+	fputc(length >> 24, w->f);
+	fputc(length >> 16, w->f);
+	fputc(length >> 8, w->f);
+	fputc(length, w->f);
+	w->crc = 0xFFFFFFFF;
+	for(int i=0;i<4;i++) png_put(w, type[i]);
+}
+
+static void png_chunk_end(PngWriter * w)
+{
+	uint32_t crc = ~w->crc;
+	png_put32(w, crc);
+}
+
+// One byte of filtered image data, opening a new stored block when needed
+static void png_put_raw(PngWriter * w, uint8_t data)
+{
+	if (w->block_left == 0) {
+		uint32_t len = (w->raw_left > PNG_STORED_MAX) ? PNG_STORED_MAX : w->raw_left;
+		png_put(w, (len == w->raw_left) ? 1 : 0); // BFINAL, BTYPE=00
+		png_put(w, len & 0xFF);
+		png_put(w, len >> 8);
+		png_put(w, ~len & 0xFF);
+		png_put(w, (~len >> 8) & 0xFF);
+		w->block_left = len;
+	}
+	png_put(w, data);
+	w->adler_a = (w->adler_a + data) % 65521;
+	w->adler_b = (w->adler_b + w->adler_a) % 65521;
+	w->block_left--;
+	w->raw_left--;
+}
+
+bool tft_sim_write_png(TFTSim * sim, const char * path)
+{
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+	PngWriter w;
+
+	memset(&w, 0, sizeof(w));
+	w.f = fopen(path, "wb");
+	if (w.f == NULL) return false;
+	fwrite(signature, 1, sizeof(signature), w.f);
+
+	png_chunk_begin(&w, 13, "IHDR");
+	png_put32(&w, sim->width);
+	png_put32(&w, sim->height);
+	png_put(&w, 8); // bit depth
+	png_put(&w, 2); // color type RGB
+	png_put(&w, 0); // compression
+	png_put(&w, 0); // filter
+	png_put(&w, 0); // interlace
+	png_chunk_end(&w);
+
+	uint32_t raw = (uint32_t)sim->height * (1 + sim->width * 3);
+	uint32_t blocks = (raw + PNG_STORED_MAX - 1) / PNG_STORED_MAX;
+	png_chunk_begin(&w, 2 + blocks * 5 + raw + 4, "IDAT");
+	png_put(&w, 0x78); // zlib header, 32K window, no compression
+	png_put(&w, 0x01);
+	w.adler_a = 1;
+	w.adler_b = 0;
+	w.raw_left = raw;
+	for(int y=0;y<sim->height;y++) {
+		png_put_raw(&w, 0); // filter type None
+		for(int x=0;x<sim->width;x++) {
+			uint16_t color = sim->gram[y * sim->width + x];
+			uint8_t r = (color >> 11) & 0x1F;
+			uint8_t g = (color >> 5) & 0x3F;
+			uint8_t b = color & 0x1F;
+			png_put_raw(&w, (r << 3) | (r >> 2));
+			png_put_raw(&w, (g << 2) | (g >> 4));
+			png_put_raw(&w, (b << 3) | (b >> 2));
+		}
+	}
+	png_put32(&w, (w.adler_b << 16) | w.adler_a);
+	png_chunk_end(&w);
+
+	png_chunk_begin(&w, 0, "IEND");
+	png_chunk_end(&w);
+
+	bool ok = !ferror(w.f);
+	if (fclose(w.f) != 0) ok = false;
+	return ok;
+}
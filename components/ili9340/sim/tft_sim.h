@@ -0,0 +1,62 @@
+#ifndef MAIN_TFT_SIM_H_
+#define MAIN_TFT_SIM_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ Host side display simulator
+
+ Decodes the ILI9341/ST7735 command stream (0x2A/0x2B/0x2C/0x3C) into an in-memory GRAM
+ and counts what went over the wire. Plain C without ESP-IDF dependencies, attach it with
+
+	static TFTSim sim;
+	tft_sim_init(&sim, CONFIG_WIDTH, CONFIG_HEIGHT, 40*1000*1000);
+	TFT_Transport transport = { .ctx = &sim, .write = tft_sim_write };
+	lcdAttachTransport(&dev, &transport);
+	lcdInit(&dev, 0x9341, CONFIG_WIDTH, CONFIG_HEIGHT, 0, 0);
+
+ GRAM is addressed the way the driver addresses it (column, page), MADCTL rotation is not applied.
+*/
+
+typedef struct {
+	uint32_t count; // times the command was sent
+	uint32_t transactions; // data transactions that followed it
+	uint32_t bytes; // data bytes that followed it
+} TFTSimCommandStat;
+
+typedef struct {
+	uint16_t width;
+	uint16_t height;
+	uint16_t * gram; // RGB565 in host byte order
+	uint32_t frequency; // SPI clock in Hz, e.g. TFT_Frequency
+	uint32_t overhead_ns; // fixed cost added to every transaction, 0 by default
+
+	// command decoder
+	bool has_cmd;
+	uint8_t cmd;
+	uint32_t param; // data bytes received since the command
+	uint8_t params[4];
+	uint16_t xs, xe, ys, ye; // window
+	uint16_t x, y; // write position
+	int16_t hi; // first byte of a pixel split across transactions, -1 when none
+
+	// counters
+	uint32_t transactions;
+	uint64_t bytes;
+	uint64_t wire_ns;
+	uint32_t pixels; // pixels written into GRAM
+	uint32_t clipped; // pixels outside the GRAM
+	TFTSimCommandStat commands[256];
+} TFTSim;
+
+bool tft_sim_init(TFTSim * sim, uint16_t width, uint16_t height, uint32_t frequency);
+void tft_sim_free(TFTSim * sim);
+void tft_sim_write(void * ctx, int mode, const uint8_t * data, size_t size);
+void tft_sim_reset_stats(TFTSim * sim);
+uint16_t tft_sim_get_pixel(TFTSim * sim, uint16_t x, uint16_t y);
+void tft_sim_dump_stats(TFTSim * sim, FILE * out);
+bool tft_sim_write_png(TFTSim * sim, const char * path);
+#endif /* MAIN_TFT_SIM_H_ */
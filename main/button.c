@@ -7,6 +7,7 @@
 #include "esp_event.h"
 #include "freertos/event_groups.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "driver/gpio.h"
@@ -16,73 +17,119 @@ static const char *TAG = "Button";
 
 QueueHandle_t buttonMessageQueue;
 
-void initButton(void)
+/*
+ * Every edge interrupt and every debounce deadline feeds the pin level into
+ * the debounce state machine. A one-shot esp_timer per button is armed for
+ * the next deadline, so nothing runs while the buttons are idle.
+ */
+typedef struct
+{
+    gpio_num_t pin;
+    debounce_config_t config;
+    debounce_state_t state;
+    esp_timer_handle_t timer;
+}button_t;
+
+static button_t buttons[] = {
+    { .pin = BUTTON_UP,    .config = { DEBOUNCE * 1000, LONG_PRESS * 1000, REPEAT_PERIOD * 1000 } },
+    { .pin = BUTTON_DOWN,  .config = { DEBOUNCE * 1000, LONG_PRESS * 1000, REPEAT_PERIOD * 1000 } },
+    { .pin = BUTTON_ENTER, .config = { DEBOUNCE * 1000, LONG_PRESS * 1000, 0 } },
+};
+
+#define NUM_OF_BUTTONS  (sizeof(buttons) / sizeof(buttons[0]))
+
+static portMUX_TYPE buttonMux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Run the state machine, returns the number of events written to events */
+static int buttonStep(button_t *btn, int64_t now, button_event_t *events, int maxEvents)
 {
-    gpio_set_direction(BUTTON_UP, GPIO_MODE_INPUT);
-    gpio_set_direction(BUTTON_DOWN, GPIO_MODE_INPUT);
-    gpio_set_direction(BUTTON_ENTER, GPIO_MODE_INPUT);
+    bool pressed = (gpio_get_level(btn->pin) == 0);
+    button_event_type_t type;
+    int64_t timestamp;
+    int count = 0;
 
-    gpio_pullup_en(BUTTON_UP);
-    gpio_pullup_en(BUTTON_DOWN);
-    gpio_pullup_en(BUTTON_ENTER);
+    while(count < maxEvents && (type = debounceUpdate(&btn->state, &btn->config, pressed, now, &timestamp)) != BUTTON_EVENT_NONE){
+        events[count].button = btn->pin;
+        events[count].type = type;
+        events[count].timestamp = timestamp;
+        count++;
+    }
+    return count;
+}
 
-    gpio_pulldown_dis(BUTTON_UP);
-    gpio_pulldown_dis(BUTTON_DOWN);
-    gpio_pulldown_dis(BUTTON_ENTER);
+/*
+ * Called with buttonMux held: otherwise the ISR and the timer callback can
+ * interleave their stop/start and leave the timer armed for a stale deadline.
+ */
+static void buttonArmTimer(button_t *btn, int64_t deadline, int64_t now)
+{
+    esp_timer_stop(btn->timer);
+    if(deadline >= 0){
+        esp_timer_start_once(btn->timer, (deadline > now) ? (deadline - now) : 0);
+    }
 }
 
-gpio_num_t detectButton(void)
+static void buttonIsrHandler(void *arg)
 {
-    gpio_num_t buttons[] = {BUTTON_UP, BUTTON_DOWN, BUTTON_ENTER};
-    for(int i = 0; i < sizeof(buttons) / sizeof(gpio_num_t); i++){
-        if(gpio_get_level(buttons[i]) == 0){
-            vTaskDelay(DEBOUNCE/portTICK_PERIOD_MS);
-            if(gpio_get_level(buttons[i]) == 0){
-                return buttons[i];
-            }
-        }
+    button_t *btn = (button_t *)arg;
+    button_event_t events[2];
+    BaseType_t woken = pdFALSE;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&buttonMux);
+    int count = buttonStep(btn, now, events, 2);
+    buttonArmTimer(btn, debounceDeadline(&btn->state, &btn->config), now);
+    portEXIT_CRITICAL_ISR(&buttonMux);
+
+    for(int i = 0; i < count; i++){
+        xQueueSendFromISR(buttonMessageQueue, &events[i], &woken);
+    }
+    if(woken){
+        portYIELD_FROM_ISR();
     }
-    return GPIO_NUM_NC;
 }
 
-void buttonTask(void * pvParameters)
+static void buttonTimerCallback(void *arg)
 {
-	BaseType_t err_queue;
-    gpio_num_t buttonMessage = GPIO_NUM_NC;
-    buttonMessageQueue = xQueueCreate(10, sizeof(gpio_num_t));
-    while(1){
-        buttonMessage = detectButton();
-        if(buttonMessage == GPIO_NUM_NC){
-            continue;
-        }else{
-            err_queue = xQueueSend(buttonMessageQueue, (const void *)&buttonMessage, (TickType_t)(NO_WAIT_TIME));
-            if(err_queue != pdTRUE){
-                ESP_LOGE(TAG, "Button Message Queue Send Error");
-            }
+    button_t *btn = (button_t *)arg;
+    button_event_t events[4];
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&buttonMux);
+    int count = buttonStep(btn, now, events, 4);
+    buttonArmTimer(btn, debounceDeadline(&btn->state, &btn->config), now);
+    portEXIT_CRITICAL(&buttonMux);
+
+    for(int i = 0; i < count; i++){
+        if(xQueueSend(buttonMessageQueue, &events[i], (TickType_t)(NO_WAIT_TIME)) != pdTRUE){
+            ESP_LOGE(TAG, "Button Message Queue Send Error");
         }
-        // switch (button)
-        // {
-        //     case BUTTON_UP:
-        //     {
-        //         ESP_LOGI(TAG, "Button Up");
-        //         buttonMessage = BUTTON_UP_SIGNAL;
-        //         break;
-        //     }
-        //     case BUTTON_DOWN:
-        //     {
-        //         ESP_LOGI(TAG, "Button Down");
-        //         buttonMessage = BUTTON_DOWN_SIGNAL;
-        //         break;
-        //     }
-        //     case BUTTON_ENTER:
-        //     {
-        //         ESP_LOGI(TAG, "Button Enter");
-        //         buttonMessage = BUTTON_ENTER_SIGNAL;
-        //         break;
-        //     }
-        //     default:
-        //         break;
-        // }
-        vTaskDelay(100/portTICK_PERIOD_MS);
     }
-}
\ No newline at end of file
+}
+
+void initButton(void)
+{
+    buttonMessageQueue = xQueueCreate(BUTTON_QUEUE_SIZE, sizeof(button_event_t));
+
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_ANYEDGE,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << BUTTON_UP) | (1ULL << BUTTON_DOWN) | (1ULL << BUTTON_ENTER),
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+
+    for(int i = 0; i < NUM_OF_BUTTONS; i++){
+        button_t *btn = &buttons[i];
+        debounceInit(&btn->state);
+        const esp_timer_create_args_t timer_args = {
+            .callback = buttonTimerCallback,
+            .arg = btn,
+            .name = "button",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &btn->timer));
+        ESP_ERROR_CHECK(gpio_isr_handler_add(btn->pin, buttonIsrHandler, btn));
+    }
+}
@@ -1,16 +1,27 @@
 #ifndef _BUTTON_H_
 #define _BUTTON_H_
 
+#include "debounce.h"
 
 #define BUTTON_DOWN     34
 #define BUTTON_UP       35
 #define BUTTON_ENTER    39
-#define DEBOUNCE        50
+#define DEBOUNCE        50      /* ms the contacts must be stable */
+#define LONG_PRESS      800     /* ms until BUTTON_EVENT_LONG_PRESS */
+#define REPEAT_PERIOD   150     /* ms between BUTTON_EVENT_REPEAT while held */
 #define NO_WAIT_TIME    0
+#define BUTTON_QUEUE_SIZE   10
+
+typedef struct
+{
+    gpio_num_t button;
+    button_event_type_t type;
+    int64_t timestamp;          /* esp_timer_get_time() of the debounced edge or deadline */
+}button_event_t;
+
 extern QueueHandle_t buttonMessageQueue;
 
 void initButton(void);
-void buttonTask(void * pvParameters);
 
 
-#endif // _BUTTON_H_
\ No newline at end of file
+#endif // _BUTTON_H_
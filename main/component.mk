@@ -2,3 +2,6 @@
 # "main" pseudo-component makefile.
 #
 # (Uses default behaviour of compiling all source files in directory, adding 'include' to include path.)
+
+# Fonts used by gui.c
+COMPONENT_EMBED_FILES := ../font/ILGH16XB.FNT ../font/ILGH24XB.FNT
@@ -175,6 +175,13 @@ void cb_connection_ok(void *pvParameter){
 }
 
 
+void cb_connection_lost(void *pvParameter){
+	ESP_LOGI(TAG, "The IoT Gateway Board lost its connection");
+    connectStatus.isWifiConnected = false;
+    dispUpdateWifiStatus(fx16G);
+}
+
+
 void monitoring_task(void *pvParameter)
 {
 	for(;;){
@@ -190,7 +197,8 @@ void wifiTask(void *pvParameters)
         if(uxBits & WIFI_TURN_ON_BIT) {
             ESP_LOGI(TAG, "Start Wi-Fi");
             wifi_manager_start();
-            wifi_manager_set_callback(WM_EVENT_STA_GOT_IP, &cb_connection_ok);            
+            wifi_manager_set_callback(WM_EVENT_STA_GOT_IP, &cb_connection_ok);
+            wifi_manager_set_callback(WM_EVENT_STA_DISCONNECTED, &cb_connection_lost);            
         }
 		vTaskDelay(pdMS_TO_TICKS(10));
     }
@@ -0,0 +1,107 @@
+/**
+********************************************************************************
+* @file         debounce.c
+* @brief        Button debounce state machine
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "debounce.h"
+
+/*
+ * No hardware access in here: the caller feeds the raw level of the button
+ * on every edge and whenever debounceDeadline() expires, so edge traces
+ * can be replayed on the host.
+ */
+
+void debounceInit(debounce_state_t *state)
+{
+    state->phase = DEBOUNCE_IDLE;
+    state->heldPhase = DEBOUNCE_IDLE;
+    state->edgeAt = 0;
+    state->pressedAt = 0;
+    state->nextRepeat = 0;
+}
+
+/**
+ * Advance the state machine with the raw level seen at time now.
+ * Returns at most one event, call again with the same input until
+ * BUTTON_EVENT_NONE when several deadlines may have passed.
+ * timestamp receives the time the event actually happened.
+ */
+button_event_type_t debounceUpdate(debounce_state_t *state, const debounce_config_t *config, bool pressed, int64_t now, int64_t *timestamp)
+{
+    switch(state->phase)
+    {
+        case DEBOUNCE_IDLE:
+            if(pressed){
+                state->phase = DEBOUNCE_PRESS_WAIT;
+                state->edgeAt = now;
+            }
+            break;
+        case DEBOUNCE_PRESS_WAIT:
+            if(!pressed){
+                state->phase = DEBOUNCE_IDLE;
+            }else if(now - state->edgeAt >= config->debounceUs){
+                state->phase = DEBOUNCE_PRESSED;
+                state->pressedAt = state->edgeAt;
+                *timestamp = state->pressedAt;
+                return BUTTON_EVENT_PRESS;
+            }
+            break;
+        case DEBOUNCE_PRESSED:
+            if(!pressed){
+                state->heldPhase = DEBOUNCE_PRESSED;
+                state->phase = DEBOUNCE_RELEASE_WAIT;
+                state->edgeAt = now;
+            }else if(config->longPressUs > 0 && now - state->pressedAt >= config->longPressUs){
+                state->phase = DEBOUNCE_HELD;
+                state->nextRepeat = state->pressedAt + config->longPressUs + config->repeatUs;
+                *timestamp = state->pressedAt + config->longPressUs;
+                return BUTTON_EVENT_LONG_PRESS;
+            }
+            break;
+        case DEBOUNCE_HELD:
+            if(!pressed){
+                state->heldPhase = DEBOUNCE_HELD;
+                state->phase = DEBOUNCE_RELEASE_WAIT;
+                state->edgeAt = now;
+            }else if(config->repeatUs > 0 && now >= state->nextRepeat){
+                *timestamp = state->nextRepeat;
+                state->nextRepeat += config->repeatUs;
+                return BUTTON_EVENT_REPEAT;
+            }
+            break;
+        case DEBOUNCE_RELEASE_WAIT:
+            if(pressed){
+                state->phase = state->heldPhase;
+            }else if(now - state->edgeAt >= config->debounceUs){
+                state->phase = DEBOUNCE_IDLE;
+                *timestamp = state->edgeAt;
+                return BUTTON_EVENT_RELEASE;
+            }
+            break;
+        default:
+            debounceInit(state);
+            break;
+    }
+    return BUTTON_EVENT_NONE;
+}
+
+/* Time the caller has to sample the button again, -1 when only an edge can change anything */
+int64_t debounceDeadline(const debounce_state_t *state, const debounce_config_t *config)
+{
+    switch(state->phase)
+    {
+        case DEBOUNCE_PRESS_WAIT:
+        case DEBOUNCE_RELEASE_WAIT:
+            return state->edgeAt + config->debounceUs;
+        case DEBOUNCE_PRESSED:
+            return (config->longPressUs > 0) ? state->pressedAt + config->longPressUs : -1;
+        case DEBOUNCE_HELD:
+            return (config->repeatUs > 0) ? state->nextRepeat : -1;
+        default:
+            return -1;
+    }
+}
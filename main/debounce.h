@@ -0,0 +1,55 @@
+/**
+********************************************************************************
+* @file         debounce.h
+* @brief        Header file for debounce.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _DEBOUNCE_H_
+#define _DEBOUNCE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    BUTTON_EVENT_NONE = 0,
+    BUTTON_EVENT_PRESS,
+    BUTTON_EVENT_RELEASE,
+    BUTTON_EVENT_LONG_PRESS,
+    BUTTON_EVENT_REPEAT,
+}button_event_type_t;
+
+typedef enum
+{
+    DEBOUNCE_IDLE = 0,          /* Stable released */
+    DEBOUNCE_PRESS_WAIT,        /* Pressed, waiting for the contacts to settle */
+    DEBOUNCE_PRESSED,           /* Stable pressed, waiting for the long press */
+    DEBOUNCE_HELD,              /* Long pressed, auto repeating */
+    DEBOUNCE_RELEASE_WAIT,      /* Released, waiting for the contacts to settle */
+}debounce_phase_t;
+
+/* Times in microseconds, 0 disables long press / auto repeat */
+typedef struct
+{
+    int64_t debounceUs;
+    int64_t longPressUs;
+    int64_t repeatUs;
+}debounce_config_t;
+
+typedef struct
+{
+    debounce_phase_t phase;
+    debounce_phase_t heldPhase;     /* Phase to go back to when a release bounces */
+    int64_t edgeAt;                 /* Last raw edge */
+    int64_t pressedAt;              /* Start of the current press */
+    int64_t nextRepeat;
+}debounce_state_t;
+
+void debounceInit(debounce_state_t *state);
+button_event_type_t debounceUpdate(debounce_state_t *state, const debounce_config_t *config, bool pressed, int64_t now, int64_t *timestamp);
+int64_t debounceDeadline(const debounce_state_t *state, const debounce_config_t *config);
+
+#endif // _DEBOUNCE_H_
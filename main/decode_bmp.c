@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "decode_bmp.h"
+#include "resample.h"
+#include "esp_log.h"
+
+#define BI_RGB			0
+#define BI_BITFIELDS	3
+
+typedef enum {
+	BMP_FORMAT_555,
+	BMP_FORMAT_565,
+	BMP_FORMAT_888,
+	BMP_FORMAT_8888,
+} bmp_format_t;
+
+//Rows going out to the panel, filled in a DMA staging buffer and sent as one window.
+//Bottom-up files deliver the rows from the bottom, so such bands fill from the end.
+typedef struct {
+	TFT_t * dev;
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+	uint16_t capacity;	// Rows per staging buffer
+	bool bottomUp;
+	uint8_t *buf;
+	uint16_t lines;		// Rows in the current band
+	uint16_t count;		// Rows filled so far
+} bmp_band_t;
+
+static uint32_t read_le32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_le16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static esp_err_t bmp_parse_header(FILE *fp, bmpfile_t *bmp, bmp_format_t *format, bool *bottomUp) {
+	uint8_t buf[14 + 56];	// file header, DIB v3 header and the bit fields after it
+	size_t len = fread(buf, 1, sizeof(buf), fp);
+	if (len < 14 + 40) return ESP_ERR_INVALID_SIZE;
+	if (buf[0] != 'B' || buf[1] != 'M') return ESP_ERR_NOT_SUPPORTED;
+
+	bmp->header.magic[0] = buf[0];
+	bmp->header.magic[1] = buf[1];
+	bmp->header.filesz = read_le32(&buf[2]);
+	bmp->header.creator1 = read_le16(&buf[6]);
+	bmp->header.creator2 = read_le16(&buf[8]);
+	bmp->header.offset = read_le32(&buf[10]);
+	bmp->dib.header_sz = read_le32(&buf[14]);
+	bmp->dib.width = read_le32(&buf[18]);
+	bmp->dib.height = read_le32(&buf[22]);
+	bmp->dib.nplanes = read_le16(&buf[26]);
+	bmp->dib.depth = read_le16(&buf[28]);
+	bmp->dib.compress_type = read_le32(&buf[30]);
+	bmp->dib.bmp_bytesz = read_le32(&buf[34]);
+	bmp->dib.hres = read_le32(&buf[38]);
+	bmp->dib.vres = read_le32(&buf[42]);
+	bmp->dib.ncolors = read_le32(&buf[46]);
+	bmp->dib.nimpcolors = read_le32(&buf[50]);
+	if (bmp->dib.header_sz < 40) return ESP_ERR_NOT_SUPPORTED;
+
+	// Top-down images have a negative height
+	*bottomUp = true;
+	if ((int32_t)bmp->dib.height < 0) {
+		*bottomUp = false;
+		bmp->dib.height = -(int32_t)bmp->dib.height;
+	}
+	if ((int32_t)bmp->dib.width <= 0 || bmp->dib.width > 0xFFFF || bmp->dib.height == 0 || bmp->dib.height > 0xFFFF) return ESP_ERR_NOT_SUPPORTED;
+
+	// Masks follow a v3 header, or sit at the same place inside v4/v5 headers
+	uint32_t red = 0, green = 0, blue = 0;
+	if (bmp->dib.compress_type == BI_BITFIELDS) {
+		if (len < 14 + 40 + 12) return ESP_ERR_INVALID_SIZE;
+		red = read_le32(&buf[54]);
+		green = read_le32(&buf[58]);
+		blue = read_le32(&buf[62]);
+	} else if (bmp->dib.compress_type != BI_RGB) {
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+
+	switch (bmp->dib.depth) {
+	case 16:
+		*format = BMP_FORMAT_555;
+		if (bmp->dib.compress_type == BI_BITFIELDS) {
+			if (red == 0xF800 && green == 0x07E0 && blue == 0x001F) *format = BMP_FORMAT_565;
+			else if (red != 0x7C00 || green != 0x03E0 || blue != 0x001F) return ESP_ERR_NOT_SUPPORTED;
+		}
+		return ESP_OK;
+	case 24:
+		if (bmp->dib.compress_type != BI_RGB) return ESP_ERR_NOT_SUPPORTED;
+		*format = BMP_FORMAT_888;
+		return ESP_OK;
+	case 32:
+		*format = BMP_FORMAT_8888;
+		if (bmp->dib.compress_type == BI_BITFIELDS && (red != 0xFF0000 || green != 0xFF00 || blue != 0xFF)) return ESP_ERR_NOT_SUPPORTED;
+		return ESP_OK;
+	}
+	return ESP_ERR_NOT_SUPPORTED;
+}
+
+//Convert a file row to big-endian RGB565. Rows start 4-byte aligned in the read buffer,
+//the 16 and 32 bpp kernels work on whole words, two 16-bit pixels per word.
+static void bmp_convert_row(bmp_format_t format, const uint8_t *src, uint16_t *dst, uint32_t width) {
+	const uint32_t *word = (const uint32_t *)src;
+	uint32_t i = 0;
+
+	switch (format) {
+	case BMP_FORMAT_565:
+		for (; i + 1 < width; i += 2) {
+			uint32_t w = *word++;
+			w = ((w & 0x00FF00FF) << 8) | ((w >> 8) & 0x00FF00FF);
+			dst[i] = w;
+			dst[i + 1] = w >> 16;
+		}
+		if (i < width) dst[i] = (src[i * 2] << 8) | src[i * 2 + 1];
+		break;
+	case BMP_FORMAT_555:
+		for (; i + 1 < width; i += 2) {
+			uint32_t w = *word++;
+			w = ((w & 0x7FE07FE0) << 1) | (w & 0x001F001F);
+			w |= (w >> 5) & 0x00200020;	// top green bit into the new low one
+			w = ((w & 0x00FF00FF) << 8) | ((w >> 8) & 0x00FF00FF);
+			dst[i] = w;
+			dst[i + 1] = w >> 16;
+		}
+		if (i < width) {
+			uint16_t v = read_le16(&src[i * 2]);
+			v = ((v & 0x7FE0) << 1) | (v & 0x001F);
+			v |= (v >> 5) & 0x0020;
+			dst[i] = (v << 8) | (v >> 8);
+		}
+		break;
+	case BMP_FORMAT_888:
+		for (; i < width; i++, src += 3) {
+			// B, G, R
+			dst[i] = ((src[2] & 0xF8) | (src[1] >> 5)) | ((((src[1] & 0x1C) << 3) | (src[0] >> 3)) << 8);
+		}
+		break;
+	case BMP_FORMAT_8888:
+		for (; i < width; i++) {
+			// B, G, R, A in a little-endian word
+			uint32_t w = *word++;
+			uint16_t v = ((w >> 8) & 0xF800) | ((w >> 5) & 0x07E0) | ((w >> 3) & 0x001F);
+			dst[i] = (v << 8) | (v >> 8);
+		}
+		break;
+	}
+}
+
+static void bmp_band_put(bmp_band_t *band, uint16_t row, const uint16_t *pixels) {
+	if (band->count == 0) {
+		uint16_t remain = band->bottomUp ? row + 1 : band->height - row;
+		band->lines = (remain < band->capacity) ? remain : band->capacity;
+		band->buf = (uint8_t *)lcdGetDrawBuffer(band->dev);
+	}
+	uint16_t index = band->bottomUp ? band->lines - 1 - band->count : band->count;
+	memcpy(&band->buf[index * band->width * 2], pixels, band->width * 2);
+	if (++band->count == band->lines) {
+		uint16_t top = band->bottomUp ? row : row - band->lines + 1;
+		lcdDrawRawBitmap(band->dev, band->x, band->y + top, band->width, band->lines);
+		band->count = 0;
+	}
+}
+
+//Draw a bmp file
+esp_err_t decode_bmp_draw(TFT_t * dev, char * file, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t * imageWidth, uint16_t * imageHeight) {
+	bmpfile_t bmp;
+	bmp_format_t format;
+	bool bottomUp;
+	resample_t rs;
+	uint8_t *rows = NULL;
+	uint16_t *line = NULL;
+	esp_err_t ret;
+
+	if (x >= dev->_width || y >= dev->_height) return ESP_ERR_INVALID_ARG;
+	if (x + width > dev->_width) width = dev->_width - x;
+	if (y + height > dev->_height) height = dev->_height - y;
+
+	FILE* fp = fopen(file, "rb");
+	if (fp == NULL) {
+		ESP_LOGW(__FUNCTION__, "Image file not found [%s]", file);
+		return ESP_ERR_NOT_FOUND;
+	}
+	ret = bmp_parse_header(fp, &bmp, &format, &bottomUp);
+	if (ret != ESP_OK) {
+		ESP_LOGW(__FUNCTION__, "Unsupported bmp file [%s]", file);
+		fclose(fp);
+		return ret;
+	}
+	uint32_t w = bmp.dib.width;
+	uint32_t h = bmp.dib.height;
+	uint32_t stride = ((w * bmp.dib.depth + 31) / 32) * 4;	// rows are padded to 4 bytes
+	ESP_LOGD(__FUNCTION__, "width=%"PRIu32" height=%"PRIu32" depth=%d bottomUp=%d", w, h, bmp.dib.depth, bottomUp);
+
+	if (!resampleInit(&rs, w, h, width, height, RESAMPLE_BOX)) {
+		fclose(fp);
+		return ESP_ERR_NO_MEM;
+	}
+	*imageWidth = rs.dstWidth;
+	*imageHeight = rs.dstHeight;
+
+	bmp_band_t band = {
+		.dev = dev,
+		.x = x,
+		.y = y,
+		.width = rs.dstWidth,
+		.height = rs.dstHeight,
+		.capacity = TFT_DRAW_BUFFER_PIXELS / rs.dstWidth,
+		.bottomUp = bottomUp,
+		.count = 0,
+	};
+	uint32_t chunkRows = (stride < BMP_READ_CHUNK) ? BMP_READ_CHUNK / stride : 1;
+	if (chunkRows > h) chunkRows = h;
+	rows = malloc(chunkRows * stride);
+	line = malloc(w * sizeof(uint16_t));
+	if (rows == NULL || line == NULL || fseek(fp, bmp.header.offset, SEEK_SET) != 0) {
+		ret = (rows == NULL || line == NULL) ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_SIZE;
+		goto err;
+	}
+
+	//Queue the bands so reading the next chunk overlaps the transfer
+	bool pipeline = dev->_pipeline;
+	if (!pipeline) lcdEnablePipeline(dev);
+	for (uint32_t done = 0; done < h; ) {
+		uint32_t n = (h - done < chunkRows) ? h - done : chunkRows;
+		if (fread(rows, stride, n, fp) != n) {
+			ESP_LOGE(__FUNCTION__, "Image data ends at row %"PRIu32, done);
+			ret = ESP_ERR_INVALID_SIZE;
+			break;
+		}
+		for (uint32_t i = 0; i < n; i++, done++) {
+			uint32_t row = bottomUp ? h - 1 - done : done;
+			bmp_convert_row(format, &rows[i * stride], line, w);
+			if (resampleIsIdentity(&rs)) {
+				bmp_band_put(&band, row, line);
+				continue;
+			}
+			// the box filter works on native RGB565
+			for (uint32_t j = 0; j < w; j++) line[j] = (line[j] << 8) | (line[j] >> 8);
+			if (resampleBoxRow(&rs, row, 0, 1, w, line)) {
+				for (uint32_t j = 0; j < rs.dstWidth; j++) rs.out[j] = (rs.out[j] << 8) | (rs.out[j] >> 8);
+				bmp_band_put(&band, rs.outY, rs.out);
+			}
+		}
+	}
+	if (ret == ESP_OK && !resampleIsIdentity(&rs) && resampleBoxFlush(&rs)) {
+		for (uint32_t j = 0; j < rs.dstWidth; j++) rs.out[j] = (rs.out[j] << 8) | (rs.out[j] >> 8);
+		bmp_band_put(&band, rs.outY, rs.out);
+	}
+	if (!pipeline) lcdDisablePipeline(dev);
+
+	err:
+	resampleFree(&rs);
+	free(rows);
+	free(line);
+	fclose(fp);
+	return ret;
+}
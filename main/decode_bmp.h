@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+#include "ili9340.h"
+#include "bmpfile.h"
+
+#define BMP_READ_CHUNK	4096	// Bytes of file rows read at once
+
+/**
+ * @brief Draw the BMP file ``file`` on the panel, streaming it row band by row band.
+ *
+ * Uncompressed 16 (RGB555, or RGB565 via BI_BITFIELDS), 24 and 32 bpp images,
+ * bottom-up or top-down. Images larger than width x height are box filtered to fit.
+ * @return - ESP_ERR_NOT_FOUND if the file can't be opened
+ *         - ESP_ERR_NOT_SUPPORTED for other depths, compression or bit fields
+ *         - ESP_ERR_INVALID_SIZE if the file is truncated
+ *         - ESP_ERR_NO_MEM if out of memory
+ *         - ESP_OK on succesful decode
+ */
+esp_err_t decode_bmp_draw(TFT_t * dev, char * file, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t * imageWidth, uint16_t * imageHeight);
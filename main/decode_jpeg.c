@@ -1,5 +1,8 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "decode_jpeg.h"
+#include "resample.h"
+#include "ili9340.h"
 #include "esp32/rom/tjpgd.h"
 #include "esp_log.h"
 
@@ -8,7 +11,11 @@ typedef struct {
 	pixel_jpeg **outData;		// Array of IMAGE_H pointers to arrays of 16-bit pixel values
 	int screenWidth;		// Width of the screen
 	int screenHeight;		// Height of the screen
+	resample_t resample;	// Fits what tjpgd's 1/8 scaling leaves too large
 	FILE* fp;				// File pointer of jpeg file
+	TFT_t * dev;			// Panel for panel_outfunc
+	uint16_t x;				// Panel position of the image
+	uint16_t y;
 } JpegDev;
 
 
@@ -42,13 +49,19 @@ static UINT outfunc(JDEC *decoder, void *bitmap, JRECT *rect) {
 	for (int y = rect->top; y <= rect->bottom; y++) {
 		for (int x = rect->left; x <= rect->right; x++) {
 
-			if (y < jd->screenHeight && x < jd->screenWidth) {
+			int _x = x;
+			int _y = y;
+			if (!resampleIsIdentity(&jd->resample)) {
+				_x = resampleMap(&jd->resample, x);
+				_y = resampleMap(&jd->resample, y);
+			}
+			if (_y < jd->resample.dstHeight && _x < jd->resample.dstWidth) {
 #if 0
-				jd->outData[y][x].red = in[0];
-				jd->outData[y][x].green = in[1];
-				jd->outData[y][x].blue = in[2];
+				jd->outData[_y][_x].red = in[0];
+				jd->outData[_y][_x].green = in[1];
+				jd->outData[_y][_x].blue = in[2];
 #endif
-				jd->outData[y][x] = rgb565(in[0], in[1], in[2]);
+				jd->outData[_y][_x] = rgb565(in[0], in[1], in[2]);
 			}
 
 			in += 3;
@@ -57,19 +70,51 @@ static UINT outfunc(JDEC *decoder, void *bitmap, JRECT *rect) {
 	return 1;
 }
 
+// First destination pixel of the source span first..last and the last one, false when the span maps to none
+static bool map_span(const resample_t *rs, uint32_t first, uint32_t last, uint32_t limit, uint32_t *d1, uint32_t *d2) {
+	*d1 = resampleMap(rs, first);
+	if (resampleUnmap(rs, *d1) < first) (*d1)++;
+	*d2 = resampleMap(rs, last);
+	if (*d2 >= limit) *d2 = limit - 1;
+	return *d1 <= *d2;
+}
+
+//Output function for decode_jpeg_draw. Converts the MCU block to big-endian RGB565 in a DMA
+//staging buffer and queues it to its window on the panel straight away. The staging buffers
+//are used in turn, so the next block is decoded while this one is on the bus.
+//The last source pixels may map past the rounded down image size, they are dropped.
+static UINT panel_outfunc(JDEC *decoder, void *bitmap, JRECT *rect) {
+	JpegDev *jd = (JpegDev *) decoder->device;
+	resample_t *rs = &jd->resample;
+	uint8_t *in = (uint8_t *) bitmap;
+	uint32_t w = rect->right - rect->left + 1;
+	uint32_t x1, x2, y1, y2;
+	ESP_LOGD(__FUNCTION__, "rect->top=%d rect->bottom=%d", rect->top, rect->bottom);
+	ESP_LOGD(__FUNCTION__, "rect->left=%d rect->right=%d", rect->left, rect->right);
+
+	if (!map_span(rs, rect->left, rect->right, rs->dstWidth, &x1, &x2)) return 1;
+	if (!map_span(rs, rect->top, rect->bottom, rs->dstHeight, &y1, &y2)) return 1;
+
+	uint8_t *out = (uint8_t *) lcdGetDrawBuffer(jd->dev);
+	for (uint32_t y = y1; y <= y2; y++) {
+		uint8_t *row = in + (resampleUnmap(rs, y) - rect->top) * w * 3;
+		for (uint32_t x = x1; x <= x2; x++) {
+			uint8_t *p = row + (resampleUnmap(rs, x) - rect->left) * 3;
+			*out++ = (p[0] & 0xF8) | (p[1] >> 5);
+			*out++ = ((p[1] & 0x1C) << 3) | (p[2] >> 3);
+		}
+	}
+	lcdDrawRawBitmap(jd->dev, jd->x + x1, jd->y + y1, x2 - x1 + 1, y2 - y1 + 1);
+	return 1;
+}
+
 // Specifies scaling factor N for output. The output image is descaled to 1 / 2 ^ N (N = 0 to 3).
 // When scaling feature is disabled (JD_USE_SCALE == 0), it must be 0.
 uint8_t getScale(uint16_t screenWidth, uint16_t screenHeight, uint16_t imageWidth, uint16_t imageHeight) {
-	if (screenWidth >= imageWidth && screenHeight >= imageHeight)  return 0;
-
-	double scaleWidth = (double)imageWidth / (double)screenWidth;
-	double scaleHeight = (double)imageHeight / (double)screenHeight;
-	ESP_LOGD(__FUNCTION__, "scaleWidth=%f scaleHeight=%f", scaleWidth, scaleHeight);
-	double scale = scaleWidth;
-	if (scaleWidth < scaleHeight) scale = scaleHeight;
-	ESP_LOGD(__FUNCTION__, "scale=%f", scale);
-	if (scale <= 2.0) return 1;
-	if (scale <= 4.0) return 2;
+	// Smallest N with image / 2^N <= screen
+	for (uint8_t scale = 0; scale < 3; scale++) {
+		if (imageWidth <= ((uint32_t)screenWidth << scale) && imageHeight <= ((uint32_t)screenHeight << scale)) return scale;
+	}
 	return 3;
 
 }
@@ -84,6 +129,7 @@ esp_err_t decode_jpeg(pixel_jpeg ***pixels, char * file, uint16_t width, uint16_
 	JDEC decoder;
 	JpegDev jd;
 	*pixels = NULL;
+	jd.fp = NULL;
 	esp_err_t ret = ESP_OK;
 
 
@@ -138,13 +184,10 @@ esp_err_t decode_jpeg(pixel_jpeg ***pixels, char * file, uint16_t width, uint16_
 	ESP_LOGD(__FUNCTION__, "scale=%d", scale);
 
 	//Calculate image size
-	double factor = 1.0;
-	if (scale == 1) factor = 0.5;
-	if (scale == 2) factor = 0.25;
-	if (scale == 3) factor = 0.125;
-	ESP_LOGD(__FUNCTION__, "factor=%f",factor);
-	*imageWidth = (double)decoder.width * factor;
-	*imageHeight = (double)decoder.height * factor;
+	//Blocks arrive in MCU order, so anything tjpgd can't reduce enough is sampled
+	resampleInit(&jd.resample, decoder.width >> scale, decoder.height >> scale, width, height, RESAMPLE_NEAREST);
+	*imageWidth = jd.resample.dstWidth;
+	*imageHeight = jd.resample.dstHeight;
 	ESP_LOGD(__FUNCTION__, "imageWidth=%d imageHeight=%d", *imageWidth, *imageHeight);
 
 
@@ -162,18 +205,82 @@ esp_err_t decode_jpeg(pixel_jpeg ***pixels, char * file, uint16_t width, uint16_
 
 	//Something went wrong! Exit cleanly, de-allocating everything we allocated.
 	err:
-	fclose(jd.fp);
+	if (jd.fp != NULL) fclose(jd.fp);
 	if (*pixels != NULL) {
 		for (int i = 0; i < height; i++) {
 			free((*pixels)[i]);
 		}
 		free(*pixels);
+		*pixels = NULL;
 	}
 	free(work);
 	return ret;
 }
 
 
+//Decode a jpeg file straight to the panel, one MCU block at a time.
+esp_err_t decode_jpeg_draw(TFT_t * dev, char * file, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t * imageWidth, uint16_t * imageHeight) {
+	char *work = NULL;
+	int r;
+	JDEC decoder;
+	JpegDev jd;
+	esp_err_t ret = ESP_OK;
+
+	//The clipped screen area below would wrap around
+	if (x >= dev->_width || y >= dev->_height) return ESP_ERR_INVALID_ARG;
+
+	//Allocate the work space for the jpeg decoder.
+	work = calloc(WORKSZ, 1);
+	if (work == NULL) {
+		ESP_LOGE(__FUNCTION__, "Cannot allocate workspace");
+		return ESP_ERR_NO_MEM;
+	}
+
+	//Populate fields of the JpegDev struct.
+	jd.outData = NULL;
+	jd.dev = dev;
+	jd.x = x;
+	jd.y = y;
+	jd.screenWidth = (x + width > dev->_width) ? dev->_width - x : width;
+	jd.screenHeight = (y + height > dev->_height) ? dev->_height - y : height;
+	jd.fp = fopen(file, "rb");
+	if (jd.fp == NULL) {
+		ESP_LOGW(__FUNCTION__, "Image file not found [%s]", file);
+		free(work);
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	//Prepare and decode the jpeg.
+	r = jd_prepare(&decoder, infunc, work, WORKSZ, (void *) &jd);
+	if (r != JDR_OK) {
+		ESP_LOGE(__FUNCTION__, "Image decoder: jd_prepare failed (%d)", r);
+		ret = ESP_ERR_NOT_SUPPORTED;
+		goto err;
+	}
+	ESP_LOGD(__FUNCTION__, "decoder.width=%d decoder.height=%d", decoder.width, decoder.height);
+
+	uint8_t scale = getScale(jd.screenWidth, jd.screenHeight, decoder.width, decoder.height);
+	resampleInit(&jd.resample, decoder.width >> scale, decoder.height >> scale, jd.screenWidth, jd.screenHeight, RESAMPLE_NEAREST);
+	*imageWidth = jd.resample.dstWidth;
+	*imageHeight = jd.resample.dstHeight;
+	ESP_LOGD(__FUNCTION__, "scale=%d imageWidth=%d imageHeight=%d", scale, *imageWidth, *imageHeight);
+
+	//Queue the blocks so decoding overlaps the transfers
+	bool pipeline = dev->_pipeline;
+	if (!pipeline) lcdEnablePipeline(dev);
+	r = jd_decomp(&decoder, panel_outfunc, scale);
+	if (!pipeline) lcdDisablePipeline(dev);
+	if (r != JDR_OK) {
+		ESP_LOGE(__FUNCTION__, "Image decoder: jd_decode failed (%d)", r);
+		ret = ESP_ERR_NOT_SUPPORTED;
+	}
+
+	err:
+	fclose(jd.fp);
+	free(work);
+	return ret;
+}
+
 esp_err_t release_image(pixel_jpeg ***pixels, uint16_t width, uint16_t height) {
 	if (*pixels != NULL) {
 		for (int i = 0; i < height; i++) {
@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include "esp_err.h"
+#include "ili9340.h"
 
 #if 0
 typedef struct __attribute__((__packed__)) {
@@ -25,6 +26,21 @@ typedef uint16_t pixel_jpeg;
 
 esp_err_t decode_jpeg(pixel_jpeg ***pixels, char * file, uint16_t width, uint16_t height, uint16_t * imageWidth, uint16_t * imageHeight);
 
+/**
+ * @brief Decode the jpeg file ``file`` straight to the panel.
+ *
+ * Each MCU block is converted into a DMA staging buffer and queued to its window on the panel,
+ * so no frame is held in memory and the first blocks show while the rest is decoded.
+ * The image is fitted into width x height at x, y.
+ * @return - ESP_ERR_INVALID_ARG if x, y is off the panel
+ *         - ESP_ERR_NOT_SUPPORTED if image is malformed or a progressive jpeg file
+ *         - ESP_ERR_NOT_FOUND if the file can't be opened
+ *         - ESP_ERR_NO_MEM if out of memory
+ *         - ESP_OK on succesful decode
+ */
+
+esp_err_t decode_jpeg_draw(TFT_t * dev, char * file, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t * imageWidth, uint16_t * imageHeight);
+
 /**
  * @brief Release image memory.
  *
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include "decode_png.h"
 #include "pngle.h"
@@ -8,24 +10,61 @@ void png_init(pngle_t *pngle, uint32_t w, uint32_t h)
 {
 	ESP_LOGD(__FUNCTION__, "png_init w=%"PRIu32" h=%"PRIu32, w, h);
 	ESP_LOGD(__FUNCTION__, "screenWidth=%d screenHeight=%d", pngle->screenWidth, pngle->screenHeight);
-	pngle->imageWidth = w;
-	pngle->imageHeight = h;
-	pngle->reduction = false;
-	pngle->scale_factor = 1.0;
 
 	// Calculate Reduction
-	if (pngle->screenWidth < pngle->imageWidth || pngle->screenHeight < pngle->imageHeight) {
-		pngle->reduction = true;
-		double factorWidth = (double)pngle->screenWidth / (double)pngle->imageWidth;
-		double factorHeight = (double)pngle->screenHeight / (double)pngle->imageHeight;
-		pngle->scale_factor = factorWidth;
-		if (factorHeight < factorWidth) pngle->scale_factor = factorHeight;
-		pngle->imageWidth = pngle->imageWidth * pngle->scale_factor;
-		pngle->imageHeight = pngle->imageHeight * pngle->scale_factor;
-	}
-	ESP_LOGD(__FUNCTION__, "reduction=%d scale_factor=%f", pngle->reduction, pngle->scale_factor);
+	// Whole rows in order can be box filtered, single pixels and interlaced passes are sampled
+	resample_mode_t mode = RESAMPLE_NEAREST;
+	if (pngle->draw_row_callback && !pngle->hdr.interlace) mode = RESAMPLE_BOX;
+	resampleFree(&pngle->resample);
+	if (!resampleInit(&pngle->resample, w, h, pngle->screenWidth, pngle->screenHeight, mode)) {
+		ESP_LOGW(__FUNCTION__, "No memory for the box filter, sampling instead");
+		resampleInit(&pngle->resample, w, h, pngle->screenWidth, pngle->screenHeight, RESAMPLE_NEAREST);
+	}
+	pngle->imageWidth = pngle->resample.dstWidth;
+	pngle->imageHeight = pngle->resample.dstHeight;
+	ESP_LOGD(__FUNCTION__, "scale=0x%"PRIx32" mode=%d", pngle->resample.scale, pngle->resample.mode);
 	ESP_LOGD(__FUNCTION__, "imageWidth=%d imageHeight=%d", pngle->imageWidth, pngle->imageHeight);
-		
+
+	// One block for the band, interlaced rows arrive out of order and need the whole image
+	pngle->band_height = pngle->imageHeight;
+	if (pngle->band_callback && pngle->band_lines && !pngle->hdr.interlace && pngle->band_lines < pngle->imageHeight) {
+		pngle->band_height = pngle->band_lines;
+	}
+	pngle->band_y = 0;
+	if (pngle->pixels) free(pngle->pixels);
+	pngle->pixels = calloc((size_t)pngle->imageWidth * pngle->band_height, sizeof(pixel_png));
+	if (pngle->pixels == NULL) {
+		ESP_LOGE(__FUNCTION__, "Error allocating memory for %d lines", pngle->band_height);
+	}
+	ESP_LOGD(__FUNCTION__, "band_height=%d", pngle->band_height);
+}
+
+// Hand the completed rows of the band to the band callback
+static void png_flush_band(pngle_t *pngle, uint32_t lines)
+{
+	if (pngle->band_callback && lines) {
+		pngle->band_callback(pngle, pngle->band_y, lines, pngle->pixels);
+	}
+}
+
+// Band row for image row _y, NULL when out of range
+// Rows arrive in order, so reaching the next band completes the current one.
+static pixel_png *png_band_row(pngle_t *pngle, uint32_t _y)
+{
+	if (pngle->pixels == NULL) return NULL;
+	if (_y >= pngle->imageHeight) return NULL;
+	if (_y >= pngle->band_y + pngle->band_height) {
+		png_flush_band(pngle, pngle->band_height);
+		pngle->band_y = _y;
+	}
+	return &pngle->pixels[(_y - pngle->band_y) * pngle->imageWidth];
+}
+
+// Copy a finished row of the box filter
+static void png_put_row(pngle_t *pngle, uint32_t _y, const pixel_png *pixels)
+{
+	pixel_png *row = png_band_row(pngle, _y);
+	if (row) memcpy(row, pixels, pngle->imageWidth * sizeof(pixel_png));
 }
 
 #define rgb565(r, g, b) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
@@ -40,23 +79,56 @@ void png_draw(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, ui
 #endif
 
 	// image reduction
-	uint32_t _x = x;
-	uint32_t _y = y;
-	if (pngle->reduction) {
-		_x = x * pngle->scale_factor;
-		_y = y * pngle->scale_factor;
-	}
-	if (_y < pngle->screenHeight && _x < pngle->screenWidth) {
+	uint32_t _x = resampleMap(&pngle->resample, x);
+	uint32_t _y = resampleMap(&pngle->resample, y);
+	pixel_png *row = png_band_row(pngle, _y);
+	if (row && _x < pngle->imageWidth) {
 #if 0
 		pngle->pixels[_y][_x].red = rgba[0];
 		pngle->pixels[_y][_x].green = rgba[1];
 		pngle->pixels[_y][_x].blue = rgba[2];
 #endif
-		pngle->pixels[_y][_x] = rgb565(rgba[0], rgba[1], rgba[2]);
+		row[_x] = rgb565(rgba[0], rgba[1], rgba[2]);
 	}
 
 }
 
+void png_draw_row(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t step, uint32_t n, const pixel_png *pixels)
+{
+	ESP_LOGD(__FUNCTION__, "png_draw_row x=%"PRIu32" y=%"PRIu32" step=%"PRIu32" n=%"PRIu32, x, y, step, n);
+
+	resample_t *rs = &pngle->resample;
+	if (resampleIsIdentity(rs)) {
+		pixel_png *row = png_band_row(pngle, y);
+		if (row == NULL) return;
+		if (step == 1) {
+			memcpy(&row[x], pixels, n * sizeof(pixel_png));
+		} else {
+			for (uint32_t i = 0; i < n; i++) row[x + i * step] = pixels[i];
+		}
+		return;
+	}
+
+	// image reduction
+	if (rs->mode == RESAMPLE_BOX) {
+		if (resampleBoxRow(rs, y, x, step, n, pixels)) png_put_row(pngle, rs->outY, rs->out);
+		return;
+	}
+	pixel_png *row = png_band_row(pngle, resampleMap(rs, y));
+	if (row == NULL) return;
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t _x = resampleMap(rs, x + i * step);
+		if (_x < pngle->imageWidth) row[_x] = pixels[i];
+	}
+}
+
 void png_finish(pngle_t *pngle) {
 	ESP_LOGD(__FUNCTION__, "png_finish");
+	if (pngle->resample.mode == RESAMPLE_BOX && resampleBoxFlush(&pngle->resample)) {
+		png_put_row(pngle, pngle->resample.outY, pngle->resample.out);
+	}
+	if (pngle->pixels == NULL) return;
+	uint32_t lines = pngle->imageHeight - pngle->band_y;
+	if (lines > pngle->band_height) lines = pngle->band_height;
+	png_flush_band(pngle, lines);
 }
@@ -3,7 +3,26 @@
 #include <stdbool.h>
 #include "pngle.h"
 
+#define PNG_BAND_LINES	8	// rows handed to the band callback at once
+
+/*
+ Streaming use, peak memory is PNG_BAND_LINES rows of the (reduced) image:
+
+	pngle_t *pngle = pngle_new(width, height);
+	pngle_set_init_callback(pngle, png_init);
+	pngle_set_draw_row_callback(pngle, png_draw_row);
+	pngle_set_done_callback(pngle, png_finish);
+	pngle_set_band_callback(pngle, band_callback, PNG_BAND_LINES);
+
+ band_callback(pngle, y, lines, pixels) gets rows y..y+lines-1 as RGB565,
+ pngle->imageWidth pixels per row, e.g. for lcdDrawBitmap.
+ png_draw_row takes whole RGB565 scanlines from the row decoder; png_draw is
+ the per pixel equivalent for pngle_set_draw_callback.
+ Without a band callback (and for interlaced images, whose rows arrive
+ out of order) pixels holds the whole image once pngle_feed is done.
+*/
+
 void png_init(pngle_t *pngle, uint32_t w, uint32_t h);
 void png_draw(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t rgba[4]);
+void png_draw_row(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t step, uint32_t n, const pixel_png *pixels);
 void png_finish(pngle_t *pngle);
-
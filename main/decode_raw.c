@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "decode_raw.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
+#include "esp_partition.h"
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "esp_spi_flash.h"
+#endif
+
+//Where the image bytes come from: a file, or memory (flash mapped or RAM).
+typedef struct {
+	FILE* fp;
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+} raw_source_t;
+
+//Unpacker state, packets run across the chunks handed to the panel.
+typedef struct {
+	raw_header_t header;
+	raw_source_t src;
+	uint8_t palette[256 * 2];	// big-endian RGB565
+	uint8_t element[2];			// element of the current repeat packet
+	uint16_t repeat;			// elements left in the current repeat packet
+	uint16_t literal;			// elements left in the current literal packet
+} raw_decoder_t;
+
+static size_t raw_read(raw_source_t *src, uint8_t *dst, size_t len) {
+	if (src->fp) return fread(dst, 1, len, src->fp);
+	if (len > src->size - src->pos) len = src->size - src->pos;
+	memcpy(dst, src->data + src->pos, len);
+	src->pos += len;
+	return len;
+}
+
+esp_err_t raw_parse_header(const uint8_t *data, raw_header_t *header) {
+	if (memcmp(data, "R565", 4) != 0) return ESP_ERR_INVALID_VERSION;
+	header->width = data[4] | (data[5] << 8);
+	header->height = data[6] | (data[7] << 8);
+	header->encoding = data[8];
+	header->colors = data[10] | (data[11] << 8);
+	header->size = data[12] | (data[13] << 8) | (data[14] << 16) | ((uint32_t)data[15] << 24);
+	if (header->encoding > RAW_ENCODING_PALETTE) return ESP_ERR_INVALID_VERSION;
+	if (header->encoding == RAW_ENCODING_PALETTE && (header->colors == 0 || header->colors > 256)) return ESP_ERR_INVALID_VERSION;
+	return ESP_OK;
+}
+
+//Expand count pixels into out (big-endian RGB565), false when the data runs out.
+static bool raw_unpack(raw_decoder_t *rd, uint8_t *out, uint32_t count) {
+	if (rd->header.encoding == RAW_ENCODING_RAW) {
+		return raw_read(&rd->src, out, count * 2) == count * 2;
+	}
+
+	bool indexed = (rd->header.encoding == RAW_ENCODING_PALETTE);
+	size_t esize = indexed ? 1 : 2;
+	while (count > 0) {
+		if (rd->repeat) {
+			uint32_t n = (rd->repeat < count) ? rd->repeat : count;
+			const uint8_t *pixel = indexed ? &rd->palette[rd->element[0] * 2] : rd->element;
+			for (uint32_t i = 0; i < n; i++) {
+				*out++ = pixel[0];
+				*out++ = pixel[1];
+			}
+			rd->repeat -= n;
+			count -= n;
+		} else if (rd->literal) {
+			uint32_t n = (rd->literal < count) ? rd->literal : count;
+			if (indexed) {
+				// indices land in the upper half of the output span and are expanded upwards
+				uint8_t *index = out + n;
+				if (raw_read(&rd->src, index, n) != n) return false;
+				for (uint32_t i = 0; i < n; i++) {
+					const uint8_t *pixel = &rd->palette[index[i] * 2];
+					out[i * 2] = pixel[0];
+					out[i * 2 + 1] = pixel[1];
+				}
+			} else {
+				if (raw_read(&rd->src, out, n * 2) != n * 2) return false;
+			}
+			out += n * 2;
+			rd->literal -= n;
+			count -= n;
+		} else {
+			uint8_t control;
+			if (raw_read(&rd->src, &control, 1) != 1) return false;
+			if (control < 0x80) {
+				rd->literal = control + 1;
+			} else {
+				rd->repeat = control - 0x7F;
+				if (raw_read(&rd->src, rd->element, esize) != esize) return false;
+			}
+		}
+	}
+	return true;
+}
+
+//Stream the image into the panel window, as many whole rows per transfer as fit a staging buffer.
+static esp_err_t raw_draw(TFT_t * dev, raw_decoder_t *rd, uint16_t x, uint16_t y, uint16_t * imageWidth, uint16_t * imageHeight) {
+	raw_header_t *hdr = &rd->header;
+	if (x >= dev->_width || y >= dev->_height) return ESP_ERR_INVALID_ARG;
+	*imageWidth = hdr->width;
+	*imageHeight = hdr->height;
+	if (hdr->width == 0 || hdr->height == 0) return ESP_OK;
+	if (hdr->width > TFT_DRAW_BUFFER_PIXELS) return ESP_ERR_INVALID_SIZE;
+
+	if (hdr->encoding == RAW_ENCODING_PALETTE) {
+		if (raw_read(&rd->src, rd->palette, hdr->colors * 2) != hdr->colors * 2) return ESP_ERR_INVALID_SIZE;
+	}
+
+	uint16_t width = (x + hdr->width > dev->_width) ? dev->_width - x : hdr->width;
+	uint16_t height = (y + hdr->height > dev->_height) ? dev->_height - y : hdr->height;
+	uint16_t rows = TFT_DRAW_BUFFER_PIXELS / hdr->width;
+	int64_t start = esp_timer_get_time();
+	esp_err_t ret = ESP_OK;
+
+	//Queue the chunks so reading the next one overlaps the transfer
+	bool pipeline = dev->_pipeline;
+	if (!pipeline) lcdEnablePipeline(dev);
+	for (uint16_t row = 0; row < height; row += rows) {
+		uint16_t lines = (height - row < rows) ? height - row : rows;
+		uint8_t *buf = (uint8_t *)lcdGetDrawBuffer(dev);
+		if (!raw_unpack(rd, buf, (uint32_t)lines * hdr->width)) {
+			ESP_LOGE(__FUNCTION__, "Image data ends at row %d", row);
+			ret = ESP_ERR_INVALID_SIZE;
+			break;
+		}
+		if (width < hdr->width) {
+			for (uint16_t j = 1; j < lines; j++) memmove(&buf[j * width * 2], &buf[j * hdr->width * 2], width * 2);
+		}
+		lcdDrawRawBitmap(dev, x, y + row, width, lines);
+	}
+	if (!pipeline) lcdDisablePipeline(dev);
+	ESP_LOGD(__FUNCTION__, "%dx%d encoding=%d in %"PRId64"us", width, height, hdr->encoding, esp_timer_get_time() - start);
+	return ret;
+}
+
+esp_err_t raw_draw_file(TFT_t * dev, const char * file, uint16_t x, uint16_t y, uint16_t * imageWidth, uint16_t * imageHeight) {
+	raw_decoder_t *rd = calloc(1, sizeof(raw_decoder_t));
+	if (rd == NULL) return ESP_ERR_NO_MEM;
+
+	esp_err_t ret;
+	uint8_t header[RAW_HEADER_SIZE];
+	rd->src.fp = fopen(file, "rb");
+	if (rd->src.fp == NULL) {
+		ESP_LOGW(__FUNCTION__, "Image file not found [%s]", file);
+		ret = ESP_ERR_NOT_FOUND;
+	} else if (fread(header, 1, RAW_HEADER_SIZE, rd->src.fp) != RAW_HEADER_SIZE) {
+		ret = ESP_ERR_INVALID_SIZE;
+	} else if ((ret = raw_parse_header(header, &rd->header)) == ESP_OK) {
+		ret = raw_draw(dev, rd, x, y, imageWidth, imageHeight);
+	}
+
+	if (rd->src.fp) fclose(rd->src.fp);
+	free(rd);
+	return ret;
+}
+
+esp_err_t raw_draw_mem(TFT_t * dev, const uint8_t * data, size_t size, uint16_t x, uint16_t y, uint16_t * imageWidth, uint16_t * imageHeight) {
+	if (size < RAW_HEADER_SIZE) return ESP_ERR_INVALID_SIZE;
+
+	raw_decoder_t *rd = calloc(1, sizeof(raw_decoder_t));
+	if (rd == NULL) return ESP_ERR_NO_MEM;
+
+	esp_err_t ret = raw_parse_header(data, &rd->header);
+	if (ret == ESP_OK && rd->header.size > size - RAW_HEADER_SIZE) ret = ESP_ERR_INVALID_SIZE;
+	if (ret == ESP_OK) {
+		rd->src.data = data + RAW_HEADER_SIZE;
+		rd->src.size = rd->header.size;
+		ret = raw_draw(dev, rd, x, y, imageWidth, imageHeight);
+	}
+	free(rd);
+	return ret;
+}
+
+esp_err_t raw_draw_partition(TFT_t * dev, const char * label, size_t offset, uint16_t x, uint16_t y, uint16_t * imageWidth, uint16_t * imageHeight) {
+	const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+	if (part == NULL) {
+		ESP_LOGW(__FUNCTION__, "Partition not found [%s]", label);
+		return ESP_ERR_NOT_FOUND;
+	}
+	if (offset + RAW_HEADER_SIZE > part->size) return ESP_ERR_INVALID_SIZE;
+
+	//Map only the header first, then the whole image
+	uint8_t header[RAW_HEADER_SIZE];
+	raw_header_t hdr;
+	esp_err_t ret = esp_partition_read(part, offset, header, RAW_HEADER_SIZE);
+	if (ret != ESP_OK) return ret;
+	ret = raw_parse_header(header, &hdr);
+	if (ret != ESP_OK) return ret;
+	size_t size = RAW_HEADER_SIZE + hdr.size;
+	if (offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+
+	const void *data;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+	esp_partition_mmap_handle_t handle;
+#else
+	spi_flash_mmap_handle_t handle;
+#endif
+	ret = esp_partition_mmap(part, offset, size, ESP_PARTITION_MMAP_DATA, &data, &handle);
+	if (ret != ESP_OK) {
+		ESP_LOGE(__FUNCTION__, "esp_partition_mmap failed (%s)", esp_err_to_name(ret));
+		return ret;
+	}
+	ret = raw_draw_mem(dev, data, size, x, y, imageWidth, imageHeight);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+	esp_partition_munmap(handle);
+#else
+	spi_flash_munmap(handle);
+#endif
+	return ret;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "ili9340.h"
+
+/*
+ Panel native images written by tools/imgpack.py (R565 container).
+ The pixels are already big-endian RGB565, so drawing is a copy into the
+ DMA staging buffers (raw) or a run length expansion (rle, palette).
+*/
+
+#define RAW_HEADER_SIZE		16
+
+typedef enum {
+	RAW_ENCODING_RAW = 0,		// width*height pixels
+	RAW_ENCODING_RLE = 1,		// packets of pixels
+	RAW_ENCODING_PALETTE = 2,	// up to 256 colors, then packets of indices
+} raw_encoding_t;
+
+typedef struct {
+	uint16_t width;
+	uint16_t height;
+	uint8_t encoding;
+	uint16_t colors;
+	uint32_t size;		// bytes after the header
+} raw_header_t;
+
+/**
+ * @brief Parse the 16 byte header of an R565 image.
+ *
+ * @return - ESP_ERR_INVALID_VERSION if it is no R565 image or the encoding is unknown
+ *         - ESP_OK
+ */
+esp_err_t raw_parse_header(const uint8_t *data, raw_header_t *header);
+
+/**
+ * @brief Draw an R565 file at x, y, clipped to the panel.
+ *
+ * @return - ESP_ERR_NOT_FOUND if the file can't be opened
+ *         - ESP_ERR_INVALID_ARG if x, y is off the panel
+ *         - ESP_ERR_INVALID_VERSION if it is no R565 image
+ *         - ESP_ERR_INVALID_SIZE if the file is truncated or wider than TFT_DRAW_BUFFER_PIXELS
+ *         - ESP_OK
+ */
+esp_err_t raw_draw_file(TFT_t * dev, const char * file, uint16_t x, uint16_t y, uint16_t * imageWidth, uint16_t * imageHeight);
+
+/**
+ * @brief Draw an R565 image held in memory, e.g. embedded or memory-mapped flash.
+ */
+esp_err_t raw_draw_mem(TFT_t * dev, const uint8_t * data, size_t size, uint16_t x, uint16_t y, uint16_t * imageWidth, uint16_t * imageHeight);
+
+/**
+ * @brief Draw the R565 image at offset of the data partition label, memory-mapped in place.
+ *
+ * @return - ESP_ERR_NOT_FOUND if there is no such partition
+ *         - see raw_draw_mem
+ */
+esp_err_t raw_draw_partition(TFT_t * dev, const char * label, size_t offset, uint16_t x, uint16_t y, uint16_t * imageWidth, uint16_t * imageHeight);
@@ -30,20 +30,15 @@
 #include "decode_png.h"
 #include "pngle.h"
 #include "driver/gpio.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 #include "button.h"
+#include "widget.h"
+#include "menu.h"
+#include "sensor.h"
+#include "uplink.h"
 
 
-/* Define a data structure to represent a menu item */
-typedef struct menuScreen
-{
-	const char *label;
-	TickType_t (*dispFunc)(FontxFile *, int8_t, struct menuScreen);
-	void (*handleFunc)(void);
-	struct menuScreen *subMenus;
-	int8_t numOfSubMenus;
-	int8_t curSubMenusDisp;
-}menuScreen;
-
 menuScreen menuScreenStack[STACK_SIZE] = {0};
 
 int8_t top = 0;
@@ -52,136 +47,42 @@ FontxFile fx16G[2];
 FontxFile fx24G[2];
 // FontxFile fx32G[2];
 
+// Fonts embedded by main (EMBED_FILES in CMakeLists.txt), add one there before using it here
+extern const uint8_t ILGH16XB_start[] asm("_binary_ILGH16XB_FNT_start");
+extern const uint8_t ILGH16XB_end[]   asm("_binary_ILGH16XB_FNT_end");
+extern const uint8_t ILGH24XB_start[] asm("_binary_ILGH24XB_FNT_start");
+extern const uint8_t ILGH24XB_end[]   asm("_binary_ILGH24XB_FNT_end");
+// extern const uint8_t ILGH32XB_start[] asm("_binary_ILGH32XB_FNT_start");
+// extern const uint8_t ILGH32XB_end[]   asm("_binary_ILGH32XB_FNT_end");
+
 static TFT_t dev;
 static int width  = SCREEN_WIDTH;
 static int height = SCREEN_HEIGHT;
 static const char *TAG = "GUI";
 
+#define GUI_STATUS_PERIOD	1000	/* ms between status bar refreshes while no button is pressed */
+
+static menu_view_t menuView;
+static SemaphoreHandle_t guiMutex = NULL;	/* Serializes drawing between GUITask and the WiFi callbacks */
+static bool guiReady = false;
+
 
 static void guiTextAlign(size_t stringLen, uint8_t fontWidth, uint8_t fontHeight, e_align_t alignment, uint16_t * xPos, uint16_t * yPos);
 static TickType_t guiBoot(FontxFile *fx);
 static void initGUI(void);
-static TickType_t dispMainScreen(FontxFile *fx, int8_t mainScreenOption, struct menuScreen curScreen);
-static TickType_t dispConnScreen(FontxFile *fx, int8_t connScreenOption, struct menuScreen curScreen);
-static TickType_t dispWifiScreen(FontxFile *fx, int8_t wifiScreenOption, struct menuScreen curScreen);
-static void handleOnOffWiFiFunc(void);
+static void guiBuildTree(FontxFile *fx);
+static void guiBindStatus(void);
 static void pushStack(menuScreen screen);
 static int8_t popStack(menuScreen *screen);
 
 
-menuScreen wifiScreenSubMenus[] = {
-	{
-		.label = "Turn on/off",
-		.dispFunc = NULL,
-		.handleFunc = handleOnOffWiFiFunc,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	}, 
-	{
-		.label = "Add New WiFi",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	}, 
-	{
-		.label = "Back",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	}
-};
-
-menuScreen connScreenSubMenus[] = {
-	{
-		.label = "WiFi",
-		.dispFunc = dispWifiScreen,
-		.handleFunc = NULL,
-		.subMenus = wifiScreenSubMenus,
-		.numOfSubMenus = 3,
-		.curSubMenusDisp = 0,
-	},
-	{
-		.label = "4G/TLE",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	},
-	{
-		.label = "Bluetooth",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	},
-	{
-		.label = "Back",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	}
-};
-
-menuScreen mainScreenSubMenus[] = {
-	{
-		.label = "Connection Config",
-		.dispFunc = dispConnScreen,
-		.handleFunc = NULL,
-		.subMenus = connScreenSubMenus,
-		.numOfSubMenus = 4,
-		.curSubMenusDisp = 0,
-	}, 
-	{
-		.label = "Cloud Config",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	}, 
-	{
-		.label = "Sensor Config",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	}, 
-	{
-		.label = "Option 4",
-		.dispFunc = NULL,
-		.handleFunc = NULL,
-		.subMenus = NULL,
-		.numOfSubMenus = 0,
-		.curSubMenusDisp = 0,
-	}
-};
-
-menuScreen mainScreen = {
-	.label = "Main Screen", 
-	.dispFunc = dispMainScreen, 
-	.handleFunc = NULL,
-	.subMenus = mainScreenSubMenus,
-	.numOfSubMenus = 4,
-	.curSubMenusDisp = 0,
-};
-
-
 void GUITask(void *pvParameters)
 {	
     initGUI();
     guiBoot(fx16G);
+	guiBuildTree(fx16G);
 	BaseType_t err_queue;
-	gpio_num_t btnSignal;
+	button_event_t btnEvent = {0};
 	menuScreen curScreen = mainScreen;
 	pushStack(curScreen);
 	// curScreen.dispFunc(fx16G, curScreen.curSubMenusDisp, curScreen);		
@@ -189,9 +90,15 @@ void GUITask(void *pvParameters)
 		if(curScreen.subMenus != NULL && curScreen.dispFunc != NULL){
 			curScreen.dispFunc(fx16G, curScreen.curSubMenusDisp, curScreen);
 		}
-		err_queue = xQueueReceive(buttonMessageQueue, (void* const )&btnSignal, (TickType_t) portMAX_DELAY);
-		if(err_queue == pdTRUE){
-			switch (btnSignal)
+		if(btnEvent.type == BUTTON_EVENT_PRESS || btnEvent.type == BUTTON_EVENT_REPEAT){
+			ESP_LOGD(TAG, "Button to pixel latency: %"PRId64" us", esp_timer_get_time() - btnEvent.timestamp);
+		}
+		err_queue = xQueueReceive(buttonMessageQueue, (void* const )&btnEvent, pdMS_TO_TICKS(GUI_STATUS_PERIOD));
+		if(err_queue != pdTRUE){
+			btnEvent.type = BUTTON_EVENT_NONE;	/* Timed out, the loop only refreshes the status bar */
+		}
+		if(err_queue == pdTRUE && (btnEvent.type == BUTTON_EVENT_PRESS || btnEvent.type == BUTTON_EVENT_REPEAT)){
+			switch (btnEvent.button)
 			{
 				case BUTTON_UP:
 				{
@@ -223,7 +130,6 @@ void GUITask(void *pvParameters)
 						}						
 					}
 					ESP_LOGI(TAG, "|Button Enter | Screen: %s | Index: %d|", curScreen.label, curScreen.curSubMenusDisp);
-					lcdFillScreen(&dev, BG_COLOR);	
 					break;				
 				}
 				default:
@@ -285,10 +191,9 @@ static TickType_t guiBoot(FontxFile *fx)
 	uint16_t yPos;
 	uint8_t ascii[30];
 	uint16_t color;
-	uint8_t buffer[FontxGlyphBufSize];
 	uint8_t fontWidth;
 	uint8_t fontHeight;
-	GetFontx(fx, 0, buffer, &fontWidth, &fontHeight);
+	GetFontxMetrics(fx, &fontWidth, &fontHeight);
 	ESP_LOGI(TAG, "fontWidth = %d; fontHeight = %d", fontWidth, fontHeight);
 
 	lcdFillScreen(&dev, BG_COLOR);
@@ -300,6 +205,7 @@ static TickType_t guiBoot(FontxFile *fx)
 		strcpy((char *)ascii, textLoading[i]);
 		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
 		lcdDrawString(&dev, fx, xPos, yPos, ascii, color);
+		lcdFlush(&dev);
 		vTaskDelay(800/portTICK_PERIOD_MS);
 		lcdFillScreen(&dev, BG_COLOR);
 	}
@@ -312,9 +218,9 @@ static TickType_t guiBoot(FontxFile *fx)
 
 static void initGUI(void)
 {
-    InitFontx(fx16G,"/spiffs/ILGH16XB.FNT",""); // 8x16Dot  Gothic
-	InitFontx(fx24G,"/spiffs/ILGH24XB.FNT",""); // 12x24Dot Gothic
-	// InitFontx(fx32G,"/spiffs/ILGH32XB.FNT",""); // 16x32Dot Gothic
+    InitFontxMem(fx16G,"ILGH16XB.FNT",ILGH16XB_start,ILGH16XB_end); // 8x16Dot  Gothic
+	InitFontxMem(fx24G,"ILGH24XB.FNT",ILGH24XB_start,ILGH24XB_end); // 12x24Dot Gothic
+	// InitFontxMem(fx32G,"ILGH32XB.FNT",ILGH32XB_start,ILGH32XB_end); // 16x32Dot Gothic
 
     spi_master_init(&dev, MOSI_GPIO, SCLK_GPIO, CS_GPIO, DC_GPIO, RESET_GPIO, BACKLIGHT_GPIO, 
                     XPT_MISO_GPIO, XPT_CS_GPIO, XPT_IRQ_GPIO, XPT_SCLK_GPIO, XPT_MOSI_GPIO);
@@ -326,501 +232,93 @@ static void initGUI(void)
     lcdBGRFilter(&dev);
 #endif 
 	lcdSetFontDirection(&dev, DIRECTION90);
+	guiMutex = xSemaphoreCreateMutex();
+	lcdEnablePipeline(&dev);
+	if(!lcdEnableFrameBuffer(&dev)){
+		ESP_LOGW(TAG, "No memory for frame buffer, drawing directly");
+	}
 }
 
 
-static TickType_t dispWifiScreen(FontxFile *fx, int8_t wifiScreenOption, menuScreen curScreen)
+/* Build the widget tree once the font is known, the first render paints everything */
+static void guiBuildTree(FontxFile *fx)
 {
-	wifi_screen_option_t _wifiScreenOption = (wifi_screen_option_t)wifiScreenOption;
-	TickType_t startTick, endTick, diffTick;
-	startTick = xTaskGetTickCount();
-	uint16_t xPos;
-	uint16_t yPos;
-	uint8_t ascii[30] = {0};
-	uint8_t buffer[FontxGlyphBufSize];
-	uint8_t fontWidth;
-	uint8_t fontHeight;
-	GetFontx(fx, 0, buffer, &fontWidth, &fontHeight);
+	menuBuildTree(&menuView, fx, width, height);
 
-	if(connectStatus.isWifiConnected){
-		strcpy((char*)ascii, "Connected");
-		lcdDrawFillRect(&dev, X_START + 1, 0, X_START + fontHeight + 1, Y_END, GREEN);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, BLACK);		
-	}else{
-		strcpy((char*)ascii, "Disconnected");
-		lcdDrawFillRect(&dev, X_START + 1 , 0, X_START + fontHeight + 1, Y_END, RED);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, WHITE);
-	}
-
-	lcdDrawLine(&dev, X_START, Y_START, X_START, Y_END, BLACK);	
+	xSemaphoreTake(guiMutex, portMAX_DELAY);
+	guiBindStatus();
+	guiReady = true;
+	xSemaphoreGive(guiMutex);
+}
 
-	switch (_wifiScreenOption)
-	{
-		case WIFI_ON_OFF:
-		{
-			if(!connectStatus.isWifiOn){
-				strcpy((char*)ascii, "Turn on");
-			}else{
-				strcpy((char*)ascii, "Turn off");
-			}
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20, 10, X_START - 20 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, BLACK);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 20 - (i + 1), 15, X_START - 20 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 20 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 20, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[WIFI_ADD_NEW].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, BLACK);
-			strcpy((char*)ascii, curScreen.subMenus[WIFI_EXIT].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, BLACK);
-			// strcpy((char*)ascii, curScreen.subMenus[WIFI_EXIT].label);
-			// guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			// lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			// lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, BLACK);
-			break;
-		}
-		case WIFI_ADD_NEW:
-			{
-			strcpy((char*)ascii, curScreen.subMenus[WIFI_ADD_NEW].label);		
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45, 10, X_START - 45 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, BLACK);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 45 - (i + 1), 15, X_START - 45 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 45 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 45, Y_END - 10 + (i + 1), GRAY);
-			// }
-			if(!connectStatus.isWifiOn){
-				strcpy((char*)ascii, "Turn on");
-			}else{
-				strcpy((char*)ascii, "Turn off");
-			}			
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, BLACK);
-			strcpy((char*)ascii, curScreen.subMenus[WIFI_EXIT].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, BLACK);
-			// strcpy((char*)ascii, curScreen.subMenus[WIFI_EXIT].label);
-			// guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			// lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			// lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, BLACK);
-			
-			break;
-		}
-		case WIFI_EXIT:
-		{
-
-			strcpy((char*)ascii, curScreen.subMenus[WIFI_EXIT].label);		
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70, 10, X_START - 70 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, BLACK);
-			// 	for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 70 - (i + 1), 15, X_START - 70 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 70 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 70, Y_END - 10 + (i + 1), GRAY);
-			// }
-			// strcpy((char*)ascii, curScreen.subMenus[WIFI_EXIT].label);
-			// guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			// lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			// lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, BLACK);
-			strcpy((char*)ascii, curScreen.subMenus[WIFI_ADD_NEW].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, BLACK);
-			if(!connectStatus.isWifiOn){
-				strcpy((char*)ascii, "Turn on");
-			}else{
-				strcpy((char*)ascii, "Turn off");
-			}			
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, BLACK);
-			break;
+/*
+ * The color tells the WiFi state, the text shows sensor throughput once sources are running:
+ * rate, fullest ring, samples dropped by the sensor and uplink rings, worst latency, and
+ * the batches waiting in the uplink backlog while there are any.
+ */
+static void guiBindStatus(void)
+{
+	char text[WIDGET_TEXT_SIZE];
+	sensor_stats_t stats;
+	uplink_stats_t uplink;
+	int len;
+
+	if(sensorSourceCount() > 0){
+		sensorGetStats(&stats);
+		uplinkGetStats(&uplink);
+		len = snprintf(text, sizeof(text), "%"PRIu32"/s q%"PRIu32" d%"PRIu32" %"PRIu32"ms", stats.rate, stats.depth,
+		               stats.dropped + uplink.dropped, stats.latencyMaxUs / 1000);
+		if(uplink.backlog > 0 && len < sizeof(text)){
+			snprintf(text + len, sizeof(text) - len, " b%"PRIu32, uplink.backlog);
 		}
-		// case WIFI_EXIT:
-		// {
-		// 	strcpy((char*)ascii, curScreen.subMenus[WIFI_EXIT].label);		
-		// 	guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		// 	lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, WHITE_SMOKE);
-		// 	lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, BLACK);
-		// 	// for(int i = 0; i < 4; i++){
-		// 	// 	lcdDrawLine(&dev, X_START - 95 - (i + 1), 15, X_START - 95 - (i + 1), Y_END - 10 + 4, GRAY);
-		// 	// 	lcdDrawLine(&dev, X_START - 95 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 95, Y_END - 10 + (i + 1), GRAY);
-		// 	// }
-		// 	strcpy((char*)ascii, curScreen.subMenus[WIFI_ADD_NEW].label);
-		// 	guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		// 	lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-		// 	lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, BLACK);
-		// 	if(!connectStatus.isWifiOn){
-		// 		strcpy((char*)ascii, "Turn on");
-		// 	}else{
-		// 		strcpy((char*)ascii, "Turn off");
-		// 	}
-		// 	guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		// 	lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-		// 	lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, BLACK);
-		// 	// strcpy((char*)ascii, curScreen.subMenus[WIFI_SCAN].label);
-		// 	// guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		// 	// lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-		// 	// lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, BLACK);
-			
-		// 	break;
-		// }
-		default:
-			break;
+		menuBindStatus(&menuView, connectStatus.isWifiConnected, text);
+	}else{
+		menuBindStatus(&menuView, connectStatus.isWifiConnected, connectStatus.isWifiConnected ? "Connected" : "Disconnected");
 	}
-	
-	
-
-	endTick = xTaskGetTickCount();
-	diffTick = endTick - startTick;
-	// ESP_LOGI(__FUNCTION__, "elapsed time[ms]:%"PRIu32,diffTick*portTICK_PERIOD_MS);
-	return diffTick;	
 }
 
-
-
-
-
-static TickType_t dispConnScreen(FontxFile *fx, int8_t connScreenOption, menuScreen curScreen)
+/**
+ * Generic list renderer for every menu screen.
+ * Rows are bound to curScreen.subMenus, only the widgets whose text,
+ * highlight or visibility changed are repainted and flushed.
+ */
+TickType_t dispListScreen(FontxFile *fx, int8_t option, menuScreen curScreen)
 {
-	connect_screen_option_t _connScreenOption = (connect_screen_option_t)connScreenOption;
-
 	TickType_t startTick, endTick, diffTick;
 	startTick = xTaskGetTickCount();
-	uint16_t xPos;
-	uint16_t yPos;
-	uint8_t ascii[30] = {0};
-	uint8_t buffer[FontxGlyphBufSize];
-	uint8_t fontWidth;
-	uint8_t fontHeight;
-	GetFontx(fx, 0, buffer, &fontWidth, &fontHeight);
-
-	// strcpy((char*)ascii, "Connect Screen");  
-	// guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-	// lcdDrawString(&dev, fx, X_START, yPos, ascii, BLACK);
-	// lcdDrawLine(&dev, X_START, Y_START, X_START, Y_END, TEXT_COLOR);
-
-	if(connectStatus.isWifiConnected){
-		strcpy((char*)ascii, "Connected");
-		lcdDrawFillRect(&dev, X_START + 1, 0, X_START + fontHeight + 1, Y_END, GREEN);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, BLACK);		
-	}else{
-		strcpy((char*)ascii, "Disconnected");
-		lcdDrawFillRect(&dev, X_START + 1 , 0, X_START + fontHeight + 1, Y_END, RED);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, WHITE);
-	}
-
-	lcdDrawLine(&dev, X_START, Y_START, X_START, Y_END, BLACK);	
-
-	switch (_connScreenOption)
-	{
-		case CONNECT_WIFI:
-		{
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_WIFI].label);
-			if(connectStatus.isWifiOn){
-				strcat((char*)ascii, " <ON>");
-			}else{
-				strcat((char*)ascii, " <OFF>");
-			}
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20, 10, X_START - 20 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 20 - (i + 1), 15, X_START - 20 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 20 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 20, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_TLE].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_BLE].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_EXIT].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-			break;
-		}
-		case CONNECT_TLE:
-		{
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_TLE].label);
-			if(connectStatus.isLTEConnected){
-				strcat((char*)ascii, " <ON>");
-			}else{
-				strcat((char*)ascii, " <OFF>");
-			}			
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45, 10, X_START - 45 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 45 - (i + 1), 15, X_START - 45 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 45 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 45, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_WIFI].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_BLE].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_EXIT].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-			
-			break;
-		}
-		case CONNECT_BLE:
-		{
+	int painted;
 
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_BLE].label);
-			if(connectStatus.isBLEConnected){
-				strcat((char*)ascii, " <ON>");
-			}else{
-				strcat((char*)ascii, " <OFF>");
-			}			
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70, 10, X_START - 70 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-			// 	for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 70 - (i + 1), 15, X_START - 70 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 70 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 70, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_EXIT].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_TLE].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_WIFI].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
-
-			break;
-		}
-		case CONNECT_EXIT:
-		{
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_EXIT].label);		
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 95 - (i + 1), 15, X_START - 95 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 95 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 95, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_BLE].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_WIFI].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_TLE].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-			
-			break;
-		}
-		default:
-			break;
-	}
+	xSemaphoreTake(guiMutex, portMAX_DELAY);
+	guiBindStatus();
+	menuBindList(&menuView, &curScreen, option);
+	painted = widgetRender(&dev, &menuView.root);
+	lcdFlush(&dev);
+	xSemaphoreGive(guiMutex);
 
 	endTick = xTaskGetTickCount();
 	diffTick = endTick - startTick;
-	// ESP_LOGI(__FUNCTION__, "elapsed time[ms]:%"PRIu32,diffTick*portTICK_PERIOD_MS);
+	ESP_LOGD(TAG, "%s: %d widgets repainted in %"PRIu32" ms", curScreen.label, painted, diffTick*portTICK_PERIOD_MS);
 	return diffTick;
 }
 
-
-
-static TickType_t dispMainScreen(FontxFile *fx, int8_t mainScreenOption, menuScreen curScreen)
+const char *labelOnOffWiFiFunc(void)
 {
-	main_screen_option_t _mainScreenOption = (main_screen_option_t)mainScreenOption;
-	TickType_t startTick, endTick, diffTick;
-	startTick = xTaskGetTickCount();
-	uint16_t xPos;
-	uint16_t yPos;
-	uint8_t ascii[30] = {0};
-	uint8_t buffer[FontxGlyphBufSize];
-	uint8_t fontWidth;
-	uint8_t fontHeight;
-	GetFontx(fx, 0, buffer, &fontWidth, &fontHeight);
-	
-    // strcpy((char*)ascii, mainScreen.label);
-	// guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-	// lcdDrawString(&dev, fx, X_START, yPos, ascii, TEXT_COLOR);
-	// lcdDrawLine(&dev, X_START, Y_START, X_START, Y_END, TEXT_COLOR);
-
-	if(connectStatus.isWifiConnected){
-		strcpy((char*)ascii, "Connected");
-		lcdDrawFillRect(&dev, X_START + 1, 0, X_START + fontHeight + 1, Y_END, GREEN);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, BLACK);		
-	}else{
-		strcpy((char*)ascii, "Disconnected");
-		lcdDrawFillRect(&dev, X_START + 1 , 0, X_START + fontHeight + 1, Y_END, RED);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, WHITE);
-	}
-
-	lcdDrawLine(&dev, X_START, Y_START, X_START, Y_END, BLACK);	
-
+	return connectStatus.isWifiOn ? "Turn off" : "Turn on";
+}
 
-	switch (_mainScreenOption)
-	{
-		case CONNECT_CONFIG:
-		{
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20, 10, X_START - 20 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 20 - (i + 1), 15, X_START - 20 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 20 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 20, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[CLOUD_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[SENSOR_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-
-
-			strcpy((char*)ascii, curScreen.subMenus[OPTION4].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-			break;
-		}
-		case CLOUD_CONFIG:
-		{
-			strcpy((char*)ascii, curScreen.subMenus[CLOUD_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45, 10, X_START - 45 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 45 - (i + 1), 15, X_START - 45 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 45 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 45, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[SENSOR_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[OPTION4].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-			
-			break;
-		}
-		case SENSOR_CONFIG:
-		{
-
-			strcpy((char*)ascii, curScreen.subMenus[SENSOR_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70, 10, X_START - 70 + fontHeight, Y_END - 10, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 70 - (i + 1), 15, X_START - 70 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 70 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 70, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[OPTION4].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CLOUD_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
+bool statusWiFiFunc(void)
+{
+	return connectStatus.isWifiOn;
+}
 
-			break;
-		}
-		case OPTION4:
-		{
-			strcpy((char*)ascii, curScreen.subMenus[OPTION4].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 95 - 4, 10, X_START - 95 + fontHeight, Y_END - 10 + 4, WHITE_SMOKE);
-			lcdDrawString(&dev, fx, X_START - 95, yPos, ascii, TEXT_COLOR);
-			// for(int i = 0; i < 4; i++){
-			// 	lcdDrawLine(&dev, X_START - 95 - (i + 1), 15, X_START - 95 - (i + 1), Y_END - 10 + 4, GRAY);
-			// 	lcdDrawLine(&dev, X_START - 95 + fontHeight - 4, Y_END - 10 + (i + 1), X_START - 95, Y_END - 10 + (i + 1), GRAY);
-			// }
-
-			strcpy((char*)ascii, curScreen.subMenus[SENSOR_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 70 - 4, 10, X_START - 70 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 70, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CONNECT_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 20 - 4, 10, X_START - 20 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 20, yPos, ascii, TEXT_COLOR);
-
-			strcpy((char*)ascii, curScreen.subMenus[CLOUD_CONFIG].label);
-			guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-			lcdDrawFillRect(&dev, X_START - 45 - 4, 10, X_START - 45 + fontHeight, Y_END - 10 + 4, BG_COLOR);
-			lcdDrawString(&dev, fx, X_START - 45, yPos, ascii, TEXT_COLOR);
-			
-			break;
-		}
-		default:
-			break;
-	}
+bool statusLTEFunc(void)
+{
+	return connectStatus.isLTEConnected;
+}
 
-	endTick = xTaskGetTickCount();
-	diffTick = endTick - startTick;
-	// ESP_LOGI(__FUNCTION__, "elapsed time[ms]:%"PRIu32,diffTick*portTICK_PERIOD_MS);
-	return diffTick;	
+bool statusBLEFunc(void)
+{
+	return connectStatus.isBLEConnected;
 }
 
 static void pushStack(menuScreen screen)
@@ -843,7 +341,7 @@ static int8_t popStack(menuScreen *screen){
 	}
 }
 
-static void handleOnOffWiFiFunc(void)
+void handleOnOffWiFiFunc(void)
 {
 	if(!connectStatus.isWifiOn){
         xEventGroupSetBits(s_wifi_event_group, WIFI_TURN_ON_BIT);
@@ -854,34 +352,25 @@ static void handleOnOffWiFiFunc(void)
 	}
 }
 
+/* Called from the WiFi callbacks, repaints only the status bar */
 TickType_t dispUpdateWifiStatus(FontxFile *fx)
 {
 	TickType_t startTick, endTick, diffTick;
 	startTick = xTaskGetTickCount();
-	uint16_t xPos;
-	uint16_t yPos;
-	uint8_t ascii[30] = {0};
-	uint8_t buffer[FontxGlyphBufSize];
-	uint8_t fontWidth;
-	uint8_t fontHeight;
-	GetFontx(fx, 0, buffer, &fontWidth, &fontHeight);
 
-	if(connectStatus.isWifiConnected){
-		strcpy((char*)ascii, "Connected");
-		lcdDrawFillRect(&dev, X_START + 1, 0, X_START + fontHeight + 1, Y_END, GREEN);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, BLACK);		
-	}else{
-		strcpy((char*)ascii, "Disconnected");
-		lcdDrawFillRect(&dev, X_START + 1 , 0, X_START + fontHeight + 1, Y_END, RED);
-		guiTextAlign(strlen((char *)ascii), fontWidth, fontHeight, ALIGN_CENTER, &xPos, &yPos);
-		lcdDrawString(&dev, fx, X_START, yPos, ascii, WHITE);
+	if(guiMutex == NULL){
+		return 0;
 	}
-
-	lcdDrawLine(&dev, X_START, Y_START, X_START, Y_END, BLACK);		
+	xSemaphoreTake(guiMutex, portMAX_DELAY);
+	if(guiReady){
+		guiBindStatus();
+		widgetRender(&dev, &menuView.root);
+		lcdFlush(&dev);
+	}
+	xSemaphoreGive(guiMutex);
 
 	endTick = xTaskGetTickCount();
 	diffTick = endTick - startTick;
 	// ESP_LOGI(__FUNCTION__, "elapsed time[ms]:%"PRIu32,diffTick*portTICK_PERIOD_MS);
 	return diffTick;	
-}
\ No newline at end of file
+}
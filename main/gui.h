@@ -13,18 +13,13 @@
 #include "esp_vfs.h"
 #include "ili9340.h"
 #include "connect.h"
+#include "menu.h"
 
 #define SCREEN_WIDTH    128
 #define SCREEN_HEIGHT   160
 #define GRAM_X_OFFSET   0
 #define GRAM_Y_OFFSET   0
 
-#define X_START         110
-#define Y_START         0
-
-#define X_END           0
-#define Y_END           160
-
 #define MOSI_GPIO       23
 #define SCLK_GPIO       18
 #define CS_GPIO         14
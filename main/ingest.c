@@ -0,0 +1,175 @@
+/**
+********************************************************************************
+* @file         ingest.c
+* @brief        Sensor sample rings and the batching aggregator behind sensor.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "ingest.h"
+#include <string.h>
+#include <math.h>
+
+/*
+ * No RTOS or timer in here: the time is an argument, sensor.c runs the
+ * producer and aggregator tasks around these calls and publishes the
+ * window under its lock, so the ingestion path runs on the host with
+ * synthetic sources.
+ */
+
+void ingestInit(ingest_t *ingest, sensor_batch_handler_t handler, void *ctx)
+{
+    memset(ingest, 0, sizeof(*ingest));
+    ingest->handler = handler;
+    ingest->ctx = ctx;
+}
+
+/* Returns the source id, or -1 when SENSOR_MAX_SOURCES are in use */
+int ingestAddSource(ingest_t *ingest, const char *name, uint32_t periodUs, sensor_read_t read, void *ctx)
+{
+    if(ingest->numOfSources >= SENSOR_MAX_SOURCES || read == NULL || periodUs == 0){
+        return -1;
+    }
+    sensor_source_t *src = &ingest->sources[ingest->numOfSources];
+    src->name = name;
+    src->id = ingest->numOfSources;
+    src->periodUs = periodUs;
+    src->read = read;
+    src->ctx = ctx;
+    src->nextRead = 0;
+    spscRingInit(&src->ring, src->storage, sizeof(sensor_sample_t), SENSOR_RING_SIZE);
+    atomic_init(&src->produced, 0);
+    atomic_init(&src->dropped, 0);
+    return ingest->numOfSources++;
+}
+
+/**
+ * Producer side. Takes every reading that fell due up to now, so periods
+ * shorter than a tick are served in bursts. Each sample carries the time
+ * it was due, not the time of the burst. Returns the samples queued.
+ */
+uint32_t ingestPoll(sensor_source_t *src, int64_t now)
+{
+    uint32_t queued = 0;
+    sensor_sample_t sample;
+
+    if(src->nextRead == 0){
+        src->nextRead = now;
+    }
+    // Too far behind to catch up: whatever the ring can't hold is lost anyway
+    if(now - src->nextRead > (int64_t)src->periodUs * SENSOR_RING_SIZE){
+        uint32_t missed = (now - src->nextRead) / src->periodUs - SENSOR_RING_SIZE;
+        atomic_fetch_add_explicit(&src->dropped, missed, memory_order_relaxed);
+        src->nextRead += (int64_t)missed * src->periodUs;
+    }
+    while(src->nextRead <= now){
+        sample.timestamp = src->nextRead;
+        sample.source = src->id;
+        sample.channel = 0;
+        src->nextRead += src->periodUs;
+        if(!src->read(src, &sample)){
+            continue;
+        }
+        if(spscRingPush(&src->ring, &sample)){
+            atomic_fetch_add_explicit(&src->produced, 1, memory_order_relaxed);
+            queued++;
+        }else{
+            atomic_fetch_add_explicit(&src->dropped, 1, memory_order_relaxed);
+        }
+    }
+    return queued;
+}
+
+/**
+ * Consumer side. Empties every ring in batches of SENSOR_BATCH and passes
+ * them to the batch handler. Returns the number of samples drained.
+ */
+uint32_t ingestDrain(ingest_t *ingest, int64_t now)
+{
+    sensor_sample_t batch[SENSOR_BATCH];
+    uint32_t total = 0;
+    uint32_t n;
+
+    if(ingest->windowStart == 0){
+        ingest->windowStart = now;
+    }
+    for(int i = 0; i < ingest->numOfSources; i++){
+        sensor_source_t *src = &ingest->sources[i];
+        uint32_t depth = spscRingCount(&src->ring);
+        if(depth > ingest->windowDepth){
+            ingest->windowDepth = depth;
+        }
+        while((n = spscRingPop(&src->ring, batch, SENSOR_BATCH)) > 0){
+            for(uint32_t j = 0; j < n; j++){
+                uint32_t latency = (now > batch[j].timestamp) ? (uint32_t)(now - batch[j].timestamp) : 0;
+                ingest->windowLatency += latency;
+                if(latency > ingest->windowLatencyMax){
+                    ingest->windowLatencyMax = latency;
+                }
+            }
+            if(ingest->handler != NULL){
+                ingest->handler(batch, n, ingest->ctx);
+            }
+            total += n;
+            if(n < SENSOR_BATCH){
+                break;
+            }
+        }
+    }
+    ingest->windowCount += total;
+    ingest->consumed += total;
+    return total;
+}
+
+/* True once SENSOR_STATS_WINDOW has passed since the window started */
+bool ingestWindowDone(const ingest_t *ingest, int64_t now)
+{
+    return ingest->windowStart != 0 && now - ingest->windowStart >= SENSOR_STATS_WINDOW * 1000LL;
+}
+
+/* Close the window into stats and start the next one at now */
+void ingestPublish(ingest_t *ingest, int64_t now, sensor_stats_t *stats)
+{
+    uint32_t elapsed = (uint32_t)(now - ingest->windowStart);
+
+    stats->produced = 0;
+    stats->dropped = 0;
+    for(int i = 0; i < ingest->numOfSources; i++){
+        stats->produced += atomic_load_explicit(&ingest->sources[i].produced, memory_order_relaxed);
+        stats->dropped += atomic_load_explicit(&ingest->sources[i].dropped, memory_order_relaxed);
+    }
+    stats->consumed = ingest->consumed;
+    stats->rate = elapsed ? (uint32_t)(((uint64_t)ingest->windowCount * 1000000 + elapsed / 2) / elapsed) : 0;
+    stats->depth = ingest->windowDepth;
+    stats->latencyAvgUs = ingest->windowCount ? (uint32_t)(ingest->windowLatency / ingest->windowCount) : 0;
+    stats->latencyMaxUs = ingest->windowLatencyMax;
+
+    ingest->windowStart = now;
+    ingest->windowCount = 0;
+    ingest->windowDepth = 0;
+    ingest->windowLatency = 0;
+    ingest->windowLatencyMax = 0;
+}
+
+/* Sine wave plus a little noise, one channel after the other */
+bool sensorSynthRead(sensor_source_t *src, sensor_sample_t *sample)
+{
+    sensor_synth_t *synth = (sensor_synth_t *)src->ctx;
+    uint32_t x = synth->noise;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    synth->noise = x;
+    sample->channel = synth->nextChannel;
+    sample->value = synth->offset + synth->amplitude * sinf(synth->phase + synth->nextChannel) + (float)(x & 0xFF) / 2560.0f;
+    if(++synth->nextChannel >= synth->channels){
+        synth->nextChannel = 0;
+        synth->phase += synth->step;
+        if(synth->phase > 2 * (float)M_PI){
+            synth->phase -= 2 * (float)M_PI;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+/**
+********************************************************************************
+* @file         ingest.h
+* @brief        Header file for ingest.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _INGEST_H_
+#define _INGEST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "spsc_ring.h"
+
+#define SENSOR_MAX_SOURCES      4
+#define SENSOR_RING_SIZE        128     /* Samples per source ring, power of two */
+#define SENSOR_BATCH            32      /* Samples handed to the batch handler at once */
+#define SENSOR_STATS_WINDOW     1000    /* ms over which rate, depth and latency are measured */
+
+/* One reading, fixed size so rings and batches need no allocation */
+typedef struct
+{
+    int64_t timestamp;          /* Time the reading was due, esp_timer_get_time() base */
+    uint16_t source;            /* Index returned by sensorAddSource */
+    uint16_t channel;
+    float value;
+}sensor_sample_t;
+
+struct sensor_source;
+
+/* Driver hook, fills channel and value. Returns false when nothing was read */
+typedef bool (*sensor_read_t)(struct sensor_source *src, sensor_sample_t *sample);
+
+/* Called from the aggregator task with samples of one source, oldest first */
+typedef void (*sensor_batch_handler_t)(const sensor_sample_t *samples, uint32_t count, void *ctx);
+
+typedef struct sensor_source
+{
+    const char *name;
+    uint16_t id;
+    uint32_t periodUs;          /* Time between readings */
+    sensor_read_t read;
+    void *ctx;                  /* Driver state */
+    int64_t nextRead;
+    spsc_ring_t ring;
+    sensor_sample_t storage[SENSOR_RING_SIZE];
+    _Atomic uint32_t produced;  /* Written by the producer only */
+    _Atomic uint32_t dropped;
+}sensor_source_t;
+
+typedef struct
+{
+    uint32_t produced;          /* Totals since sensorInit */
+    uint32_t dropped;           /* Readings lost to a full ring */
+    uint32_t consumed;
+    uint32_t rate;              /* Samples per second, last window */
+    uint32_t depth;             /* Fullest ring seen in the last window */
+    uint32_t latencyAvgUs;      /* Due time to batch handler, last window */
+    uint32_t latencyMaxUs;
+}sensor_stats_t;
+
+/* Sources and the aggregator side window, owned by the consumer */
+typedef struct
+{
+    sensor_source_t sources[SENSOR_MAX_SOURCES];
+    int numOfSources;
+    sensor_batch_handler_t handler;
+    void *ctx;
+    int64_t windowStart;
+    uint32_t windowCount;
+    uint32_t windowDepth;
+    uint64_t windowLatency;
+    uint32_t windowLatencyMax;
+    uint32_t consumed;
+}ingest_t;
+
+/* Synthetic generator standing in for the UART/I2C/BLE drivers */
+typedef struct
+{
+    uint16_t channels;
+    float offset;
+    float amplitude;
+    float phase;
+    float step;                 /* Phase advance per reading, radians */
+    uint32_t noise;             /* xorshift state, non zero */
+    uint16_t nextChannel;
+}sensor_synth_t;
+
+void ingestInit(ingest_t *ingest, sensor_batch_handler_t handler, void *ctx);
+int ingestAddSource(ingest_t *ingest, const char *name, uint32_t periodUs, sensor_read_t read, void *ctx);
+uint32_t ingestPoll(sensor_source_t *src, int64_t now);
+uint32_t ingestDrain(ingest_t *ingest, int64_t now);
+bool ingestWindowDone(const ingest_t *ingest, int64_t now);
+void ingestPublish(ingest_t *ingest, int64_t now, sensor_stats_t *stats);
+bool sensorSynthRead(sensor_source_t *src, sensor_sample_t *sample);
+
+#endif // _INGEST_H_
@@ -23,22 +23,51 @@
 #include "gui.h"
 #include "connect_wifi.h"
 #include "button.h"
+#include "sensor.h"
+#include "uplink.h"
+#include "ringlog.h"
 
 static const char *TAG = "IoT Gateway";
 
 
 TaskHandle_t GUITaskHandle;
 TaskHandle_t wifiTaskHandle;
-TaskHandle_t ButtonTaskHandle;
 
 static void init(void);
 
+static ringlog_t telemetryLog;		/* Uplink backlog while offline */
+
+#if CONFIG_SENSOR_SYNTHETIC
+/* Synthetic stand-ins for the UART, I2C and BLE sensors until their drivers land */
+static sensor_synth_t synthSensors[] = {
+	{ .channels = 4, .offset = 25.0f, .amplitude = 5.0f, .step = 0.01f, .noise = 0x1234 },
+	{ .channels = 2, .offset = 60.0f, .amplitude = 20.0f, .step = 0.002f, .noise = 0x5678 },
+	{ .channels = 1, .offset = -70.0f, .amplitude = 10.0f, .step = 0.05f, .noise = 0x9abc },
+};
+#endif
+
 void app_main(void)
 {
 	init();
 	xTaskCreate(GUITask, "GUI", 1024 * 5, NULL, 2, &GUITaskHandle);
 	xTaskCreate(wifiTask, "WiFi", 1024 * 5, NULL, 2, &wifiTaskHandle);
-	xTaskCreate(buttonTask, "Button", 1024 * 5, NULL, 2, &ButtonTaskHandle);
+
+	const ringlog_flash_t *flash = ringlogPartitionFlash(RINGLOG_PARTITION);
+	if(flash == NULL || ringlogOpen(&telemetryLog, flash) != ESP_OK){
+		ESP_LOGE(TAG, "No telemetry log, batches are lost while offline");
+		uplinkInit(uplinkMqttTransport(CONFIG_UPLINK_BROKER_URI, CONFIG_UPLINK_TOPIC), NULL);
+	}else{
+		uplinkInit(uplinkMqttTransport(CONFIG_UPLINK_BROKER_URI, CONFIG_UPLINK_TOPIC), &telemetryLog);
+	}
+	uplinkStart();
+	sensorInit(uplinkSensorHandler, NULL);
+#if CONFIG_SENSOR_SYNTHETIC
+	ESP_LOGW(TAG, "Synthetic sensor readings are uploaded");
+	sensorAddSource("uart", 1000, sensorSynthRead, &synthSensors[0]);
+	sensorAddSource("i2c", 500, sensorSynthRead, &synthSensors[1]);
+	sensorAddSource("ble", 5000, sensorSynthRead, &synthSensors[2]);
+#endif
+	sensorStart();
 }
 
 static void init(void)
@@ -0,0 +1,179 @@
+/**
+********************************************************************************
+* @file         menu.c
+* @brief        Menu screens and their widget tree, no drawing task or driver
+* @since        Created on 2023-09-26
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "menu.h"
+#include <stdio.h>
+#include <string.h>
+
+menuScreen wifiScreenSubMenus[] = {
+	{
+		.label = "Turn on/off",
+		.labelFunc = labelOnOffWiFiFunc,
+		.dispFunc = NULL,
+		.handleFunc = handleOnOffWiFiFunc,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	}, 
+	{
+		.label = "Add New WiFi",
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	}, 
+	{
+		.label = "Back",
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	}
+};
+
+menuScreen connScreenSubMenus[] = {
+	{
+		.label = "WiFi",
+		.statusFunc = statusWiFiFunc,
+		.dispFunc = dispListScreen,
+		.handleFunc = NULL,
+		.subMenus = wifiScreenSubMenus,
+		.numOfSubMenus = 3,
+		.curSubMenusDisp = 0,
+	},
+	{
+		.label = "4G/TLE",
+		.statusFunc = statusLTEFunc,
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	},
+	{
+		.label = "Bluetooth",
+		.statusFunc = statusBLEFunc,
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	},
+	{
+		.label = "Back",
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	}
+};
+
+menuScreen mainScreenSubMenus[] = {
+	{
+		.label = "Connection Config",
+		.dispFunc = dispListScreen,
+		.handleFunc = NULL,
+		.subMenus = connScreenSubMenus,
+		.numOfSubMenus = 4,
+		.curSubMenusDisp = 0,
+	}, 
+	{
+		.label = "Cloud Config",
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	}, 
+	{
+		.label = "Sensor Config",
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	}, 
+	{
+		.label = "Option 4",
+		.dispFunc = NULL,
+		.handleFunc = NULL,
+		.subMenus = NULL,
+		.numOfSubMenus = 0,
+		.curSubMenusDisp = 0,
+	}
+};
+
+menuScreen mainScreen = {
+	.label = "Main Screen", 
+	.dispFunc = dispListScreen, 
+	.handleFunc = NULL,
+	.subMenus = mainScreenSubMenus,
+	.numOfSubMenus = 4,
+	.curSubMenusDisp = 0,
+};
+
+/* Build the widget tree once the font is known, the first render paints everything */
+void menuBuildTree(menu_view_t *view, FontxFile *fx, uint16_t width, uint16_t height)
+{
+	uint8_t fontWidth;
+	uint8_t fontHeight;
+	GetFontxMetrics(fx, &fontWidth, &fontHeight);
+
+	widgetInit(&view->root, 0, 0, width - 1, height - 1, BG_COLOR);
+
+	widgetLabelInit(&view->statusBar, fx, X_START + 1, 0, X_START + fontHeight + 1, Y_END, X_START);
+	widgetAddChild(&view->root, &view->statusBar);
+
+	widgetSeparatorInit(&view->separator, X_START, Y_START, X_START, Y_END, BLACK);
+	widgetAddChild(&view->root, &view->separator);
+
+	for(int i = 0; i < MENU_LIST_ROWS; i++){
+		uint16_t xPos = X_START - 20 - MENU_ROW_PITCH * i;
+		widgetListRowInit(&view->rows[i], fx, xPos - 4, 10, xPos + fontHeight, Y_END - 10 + 4, xPos);
+		widgetAddChild(&view->root, &view->rows[i]);
+	}
+}
+
+/* Rows are bound to screen->subMenus, only what changed is marked for repainting */
+void menuBindList(menu_view_t *view, const menuScreen *screen, int8_t option)
+{
+	char text[WIDGET_TEXT_SIZE];
+
+	for(int i = 0; i < MENU_LIST_ROWS; i++){
+		widget_t *row = &view->rows[i];
+		if(i >= screen->numOfSubMenus){
+			widgetSetVisible(row, false);
+			continue;
+		}
+		menuScreen *item = &screen->subMenus[i];
+		const char *label = (item->labelFunc != NULL) ? item->labelFunc() : item->label;
+		if(i == option && item->statusFunc != NULL){
+			snprintf(text, sizeof(text), "%s %s", label, item->statusFunc() ? "<ON>" : "<OFF>");
+		}else{
+			snprintf(text, sizeof(text), "%s", label);
+		}
+		widgetSetText(row, text);
+		widgetSetSelected(row, i == option);
+		widgetSetVisible(row, true);
+	}
+}
+
+/* The color tells the WiFi state */
+void menuBindStatus(menu_view_t *view, bool connected, const char *text)
+{
+	if(connected){
+		widgetSetColor(&view->statusBar, BLACK, GREEN);
+	}else{
+		widgetSetColor(&view->statusBar, WHITE, RED);
+	}
+	widgetSetText(&view->statusBar, text);
+}
@@ -0,0 +1,65 @@
+/**
+********************************************************************************
+* @file         menu.h
+* @brief        Header file for menu.c
+* @since        Created on 2023-09-26
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef MENU_H_
+#define MENU_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "ili9340.h"
+#include "widget.h"
+
+/* Menu layout, text rotated by 90 degrees: status bar at X_START, list rows below it */
+#define X_START         110
+#define Y_START         0
+
+#define X_END           0
+#define Y_END           160
+
+#define MENU_LIST_ROWS  4
+#define MENU_ROW_PITCH  25
+
+/* Define a data structure to represent a menu item */
+typedef struct menuScreen
+{
+	const char *label;
+	const char *(*labelFunc)(void);		/* Dynamic label, replaces label when set */
+	bool (*statusFunc)(void);			/* " <ON>"/" <OFF>" suffix shown on the selected row */
+	TickType_t (*dispFunc)(FontxFile *, int8_t, struct menuScreen);
+	void (*handleFunc)(void);
+	struct menuScreen *subMenus;
+	int8_t numOfSubMenus;
+	int8_t curSubMenusDisp;
+}menuScreen;
+
+/* Retained widget tree: status bar, separator and the menu list rows */
+typedef struct
+{
+	widget_t root;
+	widget_t statusBar;
+	widget_t separator;
+	widget_t rows[MENU_LIST_ROWS];
+}menu_view_t;
+
+extern menuScreen mainScreen;
+
+void menuBuildTree(menu_view_t *view, FontxFile *fx, uint16_t width, uint16_t height);
+void menuBindList(menu_view_t *view, const menuScreen *screen, int8_t option);
+void menuBindStatus(menu_view_t *view, bool connected, const char *text);
+
+/* Implemented by gui.c: the list renderer and the actions behind the entries */
+TickType_t dispListScreen(FontxFile *fx, int8_t option, menuScreen curScreen);
+void handleOnOffWiFiFunc(void);
+const char *labelOnOffWiFiFunc(void);
+bool statusWiFiFunc(void);
+bool statusLTEFunc(void);
+bool statusBLEFunc(void);
+
+#endif /* MENU_H_ */
@@ -42,6 +42,9 @@
 
 #define PNGLE_UNUSED(x) (void)(x)
 
+// zero bytes in front of every row buffer line, covers the left neighbour of the widest pixel (8 bytes)
+#define PNGLE_ROW_PAD 8
+
 // magic
 static const uint8_t png_sig[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
 static uint32_t interlace_off_x[8] = { 0,  0, 4, 0, 2, 0, 1, 0 };
@@ -81,6 +84,9 @@ void pngle_reset(pngle_t *pngle)
 	pngle->error = "No error";
 
 	if (pngle->scanline_ringbuf) free(pngle->scanline_ringbuf);
+	if (pngle->row_buf) free(pngle->row_buf);
+	if (pngle->row_pixels) free(pngle->row_pixels);
+	if (pngle->palette565) free(pngle->palette565);
 	if (pngle->palette) free(pngle->palette);
 	if (pngle->trans_palette) free(pngle->trans_palette);
 #ifndef PNGLE_NO_GAMMA_CORRECTION
@@ -88,6 +94,9 @@ void pngle_reset(pngle_t *pngle)
 #endif
 
 	pngle->scanline_ringbuf = NULL;
+	pngle->row_buf = NULL;
+	pngle->row_pixels = NULL;
+	pngle->palette565 = NULL;
 	pngle->palette = NULL;
 	pngle->trans_palette = NULL;
 #ifndef PNGLE_NO_GAMMA_CORRECTION
@@ -112,50 +121,22 @@ pngle_t *pngle_new(uint16_t width, uint16_t height)
 
 	pngle_reset(pngle);
 
+	// Pixel rows are allocated by png_init once the image size is known
 	pngle->pixels = NULL;
-
-	//Alocate pixel memory. Each line is an array of IMAGE_W 16-bit pixels; the `*pixels` array itself contains pointers to these lines.
-	ESP_LOGD(__FUNCTION__, "height=%d sizeof(pixel_png *)=%d", height, sizeof(pixel_png *));
-	pngle->pixels = calloc(height, sizeof(pixel_png *));
-	if (pngle->pixels == NULL) {
-		ESP_LOGE(__FUNCTION__, "Error allocating memory for lines");
-		//ret = ESP_ERR_NO_MEM;
-		goto err;
-	}
-	ESP_LOGD(__FUNCTION__, "width=%d sizeof(pixel_png)=%d", width, sizeof(pixel_png));
-	for (int i = 0; i < height; i++) {
-		(pngle->pixels)[i] = malloc(width * sizeof(pixel_png));
-		if ((pngle->pixels)[i] == NULL) {
-			ESP_LOGE(__FUNCTION__, "Error allocating memory for line %d", i);
-			//ret = ESP_ERR_NO_MEM;
-			goto err;
-		}
-	}
+	pngle->band_lines = 0;
+	pngle->band_height = 0;
+	pngle->band_y = 0;
 
 	pngle->screenWidth = width;
 	pngle->screenHeight = height;
 	return pngle;
-
-	err:
-	//Something went wrong! Exit cleanly, de-allocating everything we allocated.
-	if (pngle->pixels != NULL) {
-		for (int i = 0; i < height; i++) {
-			if ((pngle->pixels)[i]) free((pngle->pixels)[i]);
-		}
-		free(pngle->pixels);
-	}
-	return NULL;
 }
 
 void pngle_destroy(pngle_t *pngle, uint16_t width, uint16_t height)
 {
 	if (pngle) {
-		if (pngle->pixels != NULL) {
-			for (int i = 0; i < height; i++) {
-				free((pngle->pixels)[i]);
-			}
-			free(pngle->pixels);
-		}
+		if (pngle->pixels != NULL) free(pngle->pixels);
+		resampleFree(&pngle->resample);
 		pngle_reset(pngle);
 		free(pngle);
 	}
@@ -237,6 +218,63 @@ static inline uint16_t get_value(pngle_t *pngle, size_t *ridx, int *bitcount, in
 	return 0;
 }
 
+// Expand the raw channel values in v into R, G, B, A
+static int pngle_resolve_pixel(pngle_t *pngle, uint16_t v[4], uint16_t maxval)
+{
+	// color type: 0000 0111
+	//                     ^-- indexed color (palette)
+	//                    ^--- Color
+	//                   ^---- Alpha channel
+
+	if (pngle->hdr.color_type & 2) {
+		// color
+		if (pngle->hdr.color_type & 1) {
+			// indexed color: type 3
+
+			// lookup palette info
+			uint16_t pidx = v[0];
+			if (pidx >= pngle->n_palettes) return PNGLE_ERROR("Color index is out of range");
+
+			v[0] = pngle->palette[pidx * 3 + 0];
+			v[1] = pngle->palette[pidx * 3 + 1];
+			v[2] = pngle->palette[pidx * 3 + 2];
+
+			// tRNS as an indexed alpha value table (for color type 3)
+			v[3] = pidx < pngle->n_trans_palettes ? pngle->trans_palette[pidx] : maxval;
+		} else {
+			// true color: 2, and 6
+			v[3] = (pngle->hdr.color_type & 4) ? v[3] : is_trans_color(pngle, v, 3) ? 0 : maxval;
+		}
+	} else {
+		// alpha, tRNS, or opaque
+		v[3] = (pngle->hdr.color_type & 4) ? v[1] : is_trans_color(pngle, v, 1) ? 0 : maxval;
+
+		// monochrome
+		v[1] = v[2] = v[0];
+	}
+
+	return 0;
+}
+
+// Scale the resolved values to 8 bits and apply the gamma table
+static inline void pngle_get_rgba(pngle_t *pngle, const uint16_t v[4], uint16_t maxval, uint8_t rgba[4])
+{
+	rgba[0] = (v[0] * 255 + maxval / 2) / maxval;
+	rgba[1] = (v[1] * 255 + maxval / 2) / maxval;
+	rgba[2] = (v[2] * 255 + maxval / 2) / maxval;
+	rgba[3] = (v[3] * 255 + maxval / 2) / maxval;
+
+#ifndef PNGLE_NO_GAMMA_CORRECTION
+	if (pngle->gamma_table) {
+		for (int i = 0; i < 3; i++) {
+			rgba[i] = pngle->gamma_table[rgba[i]];
+		}
+	}
+#else
+	PNGLE_UNUSED(pngle);
+#endif
+}
+
 static int pngle_draw_pixels(pngle_t *pngle, size_t scanline_ringbuf_xidx)
 {
 	uint16_t v[4]; // MAX_CHANNELS
@@ -251,53 +289,11 @@ static int pngle_draw_pixels(pngle_t *pngle, size_t scanline_ringbuf_xidx)
 			v[c] = get_value(pngle, &scanline_ringbuf_xidx, &bitcount, pngle->hdr.depth);
 		}
 
-		// color type: 0000 0111
-		//                     ^-- indexed color (palette)
-		//                    ^--- Color
-		//                   ^---- Alpha channel
-
-		if (pngle->hdr.color_type & 2) {
-			// color
-			if (pngle->hdr.color_type & 1) {
-				// indexed color: type 3
-
-				// lookup palette info
-				uint16_t pidx = v[0];
-				if (pidx >= pngle->n_palettes) return PNGLE_ERROR("Color index is out of range");
-
-				v[0] = pngle->palette[pidx * 3 + 0];
-				v[1] = pngle->palette[pidx * 3 + 1];
-				v[2] = pngle->palette[pidx * 3 + 2];
-
-				// tRNS as an indexed alpha value table (for color type 3)
-				v[3] = pidx < pngle->n_trans_palettes ? pngle->trans_palette[pidx] : maxval;
-			} else {
-				// true color: 2, and 6
-				v[3] = (pngle->hdr.color_type & 4) ? v[3] : is_trans_color(pngle, v, 3) ? 0 : maxval;
-			}
-		} else {
-			// alpha, tRNS, or opaque
-			v[3] = (pngle->hdr.color_type & 4) ? v[1] : is_trans_color(pngle, v, 1) ? 0 : maxval;
-
-			// monochrome
-			v[1] = v[2] = v[0];
-		}
+		if (pngle_resolve_pixel(pngle, v, maxval) < 0) return -1;
 
 		if (pngle->draw_callback) {
-			uint8_t rgba[4] = {
-				(v[0] * 255 + maxval / 2) / maxval,
-				(v[1] * 255 + maxval / 2) / maxval,
-				(v[2] * 255 + maxval / 2) / maxval,
-				(v[3] * 255 + maxval / 2) / maxval
-			};
-
-#ifndef PNGLE_NO_GAMMA_CORRECTION
-			if (pngle->gamma_table) {
-				for (int i = 0; i < 3; i++) {
-					rgba[i] = pngle->gamma_table[v[i]];
-				}
-			}
-#endif
+			uint8_t rgba[4];
+			pngle_get_rgba(pngle, v, maxval, rgba);
 
 			pngle->draw_callback(pngle, pngle->drawing_x, pngle->drawing_y
 				, MIN(interlace_div_x[pngle->interlace_pass] - interlace_off_x[pngle->interlace_pass], pngle->hdr.width  - pngle->drawing_x)
@@ -322,6 +318,203 @@ static inline int paeth(int a, int b, int c)
 	return c;
 }
 
+// ----------------
+// Row decoder
+// ----------------
+// Each line of row_buf starts 4-byte aligned, so the kernels below work on
+// 32-bit words holding four byte lanes (SWAR) wherever PNG's byte-wise
+// arithmetic has no dependency between neighbouring lanes.
+
+static inline uint32_t load32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, __builtin_assume_aligned(p, 4), 4);
+	return v;
+}
+
+static inline void store32(uint8_t *p, uint32_t v)
+{
+	memcpy(__builtin_assume_aligned(p, 4), &v, 4);
+}
+
+// Four independent byte additions modulo 256
+static inline uint32_t swar_add(uint32_t x, uint32_t y)
+{
+	return ((x & 0x7f7f7f7fUL) + (y & 0x7f7f7f7fUL)) ^ ((x ^ y) & 0x80808080UL);
+}
+
+// Four independent floor((x + y) / 2)
+static inline uint32_t swar_avg(uint32_t x, uint32_t y)
+{
+	return (x & y) + (((x ^ y) & 0xfefefefeUL) >> 1);
+}
+
+static void unfilter_sub(uint8_t *cur, size_t stride, uint_fast8_t bpp)
+{
+	if ((bpp & 3) == 0) {
+		// RGBA8, GA16 and RGBA16: whole pixels are whole words
+		for (size_t i = 0; i < stride; i += 4) store32(cur + i, swar_add(load32(cur + i), load32(cur + i - bpp)));
+		return;
+	}
+	for (size_t i = 0; i < stride; i++) cur[i] += cur[i - bpp];
+}
+
+static void unfilter_up(uint8_t *cur, const uint8_t *prev, size_t stride)
+{
+	for (size_t i = 0; i < stride; i += 4) store32(cur + i, swar_add(load32(cur + i), load32(prev + i)));
+}
+
+static void unfilter_avg(uint8_t *cur, const uint8_t *prev, size_t stride, uint_fast8_t bpp)
+{
+	if ((bpp & 3) == 0) {
+		for (size_t i = 0; i < stride; i += 4) store32(cur + i, swar_add(load32(cur + i), swar_avg(load32(cur + i - bpp), load32(prev + i))));
+		return;
+	}
+	for (size_t i = 0; i < stride; i++) cur[i] += (cur[i - bpp] + prev[i]) >> 1;
+}
+
+static void unfilter_paeth(uint8_t *cur, const uint8_t *prev, size_t stride, uint_fast8_t bpp)
+{
+	for (size_t i = 0; i < stride; i++) {
+		int a = cur[i - bpp];
+		int b = prev[i];
+		int c = prev[i - bpp];
+		int pa = abs(b - c); // |p - a|
+		int pb = abs(a - c); // |p - b|
+		int pc = abs(a + b - c - c); // |p - c|
+		int pred = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+		cur[i] += pred;
+	}
+}
+
+static void unfilter_row(pngle_t *pngle, uint_fast8_t bpp)
+{
+	uint8_t *cur = pngle->row_cur;
+	const uint8_t *prev = pngle->row_prev;
+	size_t stride = pngle->row_stride;
+	int_fast8_t filter = pngle->filter_type;
+
+	// Without a previous line Up is None, and Paeth always picks the left neighbour
+	if (pngle->row_first) {
+		if (filter == 2) filter = 0;
+		if (filter == 4) filter = 1;
+	}
+
+	switch (filter) {
+	case 0: break; // None
+	case 1: unfilter_sub(cur, stride, bpp); break;
+	case 2: unfilter_up(cur, prev, stride); break;
+	case 3: unfilter_avg(cur, prev, stride, bpp); break;
+	case 4: unfilter_paeth(cur, prev, stride, bpp); break;
+	}
+}
+
+static inline pixel_png pngle_rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+static inline pixel_png pngle_rgb565_gamma(const uint8_t *gamma, uint8_t r, uint8_t g, uint8_t b)
+{
+	if (gamma) return pngle_rgb565(gamma[r], gamma[g], gamma[b]);
+	return pngle_rgb565(r, g, b);
+}
+
+// Palette as RGB565, built on the first row once PLTE and gAMA are known
+static int setup_palette565(pngle_t *pngle)
+{
+	if ((pngle->palette565 = PNGLE_CALLOC(256, sizeof(pixel_png), "palette565")) == NULL) return PNGLE_ERROR("Insufficient memory");
+
+	for (size_t i = 0; i < pngle->n_palettes; i++) {
+		uint8_t rgb[3] = { pngle->palette[i * 3 + 0], pngle->palette[i * 3 + 1], pngle->palette[i * 3 + 2] };
+#ifndef PNGLE_NO_GAMMA_CORRECTION
+		if (pngle->gamma_table) {
+			for (int c = 0; c < 3; c++) rgb[c] = pngle->gamma_table[rgb[c]];
+		}
+#endif
+		pngle->palette565[i] = pngle_rgb565(rgb[0], rgb[1], rgb[2]);
+	}
+	return 0;
+}
+
+// Convert n pixels of the unfiltered row to RGB565 in row_pixels
+static int convert_row(pngle_t *pngle, size_t n)
+{
+	const uint8_t *src = pngle->row_cur;
+	pixel_png *dst = pngle->row_pixels;
+	const uint8_t *gamma = NULL;
+#ifndef PNGLE_NO_GAMMA_CORRECTION
+	gamma = pngle->gamma_table;
+#endif
+
+	if (pngle->hdr.color_type == 3) {
+		uint_fast8_t depth = pngle->hdr.depth;
+		uint_fast8_t mask = (1U << depth) - 1;
+		if (!pngle->palette565 && setup_palette565(pngle) < 0) return -1;
+		for (size_t i = 0, bit = 0; i < n; i++, bit += depth) {
+			uint_fast8_t pidx = (depth == 8) ? src[i] : (src[bit / 8] >> (8 - depth - bit % 8)) & mask;
+			if (pidx >= pngle->n_palettes) return PNGLE_ERROR("Color index is out of range");
+			dst[i] = pngle->palette565[pidx];
+		}
+		return 0;
+	}
+
+	if (pngle->hdr.depth == 8) {
+		switch (pngle->hdr.color_type) {
+		case 0: for (size_t i = 0; i < n; i++, src += 1) dst[i] = pngle_rgb565_gamma(gamma, src[0], src[0], src[0]); return 0;
+		case 2: for (size_t i = 0; i < n; i++, src += 3) dst[i] = pngle_rgb565_gamma(gamma, src[0], src[1], src[2]); return 0;
+		case 4: for (size_t i = 0; i < n; i++, src += 2) dst[i] = pngle_rgb565_gamma(gamma, src[0], src[0], src[0]); return 0;
+		case 6: for (size_t i = 0; i < n; i++, src += 4) dst[i] = pngle_rgb565_gamma(gamma, src[0], src[1], src[2]); return 0;
+		}
+	}
+
+	// Sub-byte and 16-bit samples
+	uint16_t v[4]; // MAX_CHANNELS
+	uint8_t pixel_depth = (pngle->hdr.color_type & 1) ? 8 : pngle->hdr.depth;
+	uint16_t maxval = (1UL << pixel_depth) - 1;
+	uint_fast8_t depth = pngle->hdr.depth;
+	size_t bit = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		for (uint_fast8_t c = 0; c < pngle->channels; c++) {
+			if (depth == 16) {
+				v[c] = src[bit / 8] * 0x100 + src[bit / 8 + 1];
+			} else if (depth == 8) {
+				v[c] = src[bit / 8];
+			} else {
+				v[c] = (src[bit / 8] >> (8 - depth - bit % 8)) & ((1U << depth) - 1);
+			}
+			bit += depth;
+		}
+
+		if (pngle_resolve_pixel(pngle, v, maxval) < 0) return -1;
+
+		uint8_t rgba[4];
+		pngle_get_rgba(pngle, v, maxval, rgba);
+		dst[i] = pngle_rgb565(rgba[0], rgba[1], rgba[2]);
+	}
+	return 0;
+}
+
+// Unfilter and convert the completed row, then hand it to draw_row_callback
+static int pngle_draw_row(pngle_t *pngle, uint_fast8_t bytes_per_pixel)
+{
+	uint32_t step = interlace_div_x[pngle->interlace_pass];
+	size_t n = (pngle->hdr.width - pngle->drawing_x + step - 1) / step;
+
+	unfilter_row(pngle, bytes_per_pixel);
+	if (convert_row(pngle, n) < 0) return -1;
+
+	pngle->draw_row_callback(pngle, pngle->drawing_x, pngle->drawing_y, step, n, pngle->row_pixels);
+
+	uint8_t *t = pngle->row_prev;
+	pngle->row_prev = pngle->row_cur;
+	pngle->row_cur = t;
+	pngle->row_first = false;
+	pngle->drawing_x = pngle->hdr.width; // row done
+	return 0;
+}
+
 static int set_interlace_pass(pngle_t *pngle, uint_fast8_t pass)
 {
 	pngle->interlace_pass = pass;
@@ -330,10 +523,25 @@ static int set_interlace_pass(pngle_t *pngle, uint_fast8_t pass)
 	size_t scanline_pixels = (pngle->hdr.width - interlace_off_x[pngle->interlace_pass] + interlace_div_x[pngle->interlace_pass] - 1) / interlace_div_x[pngle->interlace_pass];
 	size_t scanline_stride = (scanline_pixels * pngle->channels * pngle->hdr.depth + 7) / 8;
 
-	pngle->scanline_ringbuf_size = scanline_stride + bytes_per_pixel * 2; // 2 rooms for c/x and a
+	if (pngle->draw_row_callback) {
+		// two lines, each rounded up to whole words behind PNGLE_ROW_PAD zero bytes
+		size_t line = PNGLE_ROW_PAD + ((scanline_stride + 3) & ~(size_t)3);
 
-	if (pngle->scanline_ringbuf) free(pngle->scanline_ringbuf);
-	if ((pngle->scanline_ringbuf = PNGLE_CALLOC(pngle->scanline_ringbuf_size, 1, "scanline ringbuf")) == NULL) return PNGLE_ERROR("Insufficient memory");
+		if (pngle->row_buf) free(pngle->row_buf);
+		if ((pngle->row_buf = PNGLE_CALLOC(line, 2, "row buffer")) == NULL) return PNGLE_ERROR("Insufficient memory");
+		if (!pngle->row_pixels && (pngle->row_pixels = PNGLE_CALLOC(pngle->hdr.width, sizeof(pixel_png), "row pixels")) == NULL) return PNGLE_ERROR("Insufficient memory");
+
+		pngle->row_prev = pngle->row_buf + PNGLE_ROW_PAD;
+		pngle->row_cur = pngle->row_prev + line;
+		pngle->row_stride = scanline_stride;
+		pngle->row_fill = 0;
+		pngle->row_first = true;
+	} else {
+		pngle->scanline_ringbuf_size = scanline_stride + bytes_per_pixel * 2; // 2 rooms for c/x and a
+
+		if (pngle->scanline_ringbuf) free(pngle->scanline_ringbuf);
+		if ((pngle->scanline_ringbuf = PNGLE_CALLOC(pngle->scanline_ringbuf_size, 1, "scanline ringbuf")) == NULL) return PNGLE_ERROR("Insufficient memory");
+	}
 
 	pngle->drawing_x = interlace_off_x[pngle->interlace_pass];
 	pngle->drawing_y = interlace_off_y[pngle->interlace_pass];
@@ -345,24 +553,41 @@ static int set_interlace_pass(pngle_t *pngle, uint_fast8_t pass)
 	return 0;
 }
 
+#ifndef PNGLE_NO_GAMMA_CORRECTION
+// The table of the last gAMA / display gamma pair, most images share one
+static uint8_t gamma_cache[256];
+static uint32_t gamma_cache_png;
+static double gamma_cache_display;
+static bool gamma_cache_identity;
+#endif
+
 static int setup_gamma_table(pngle_t *pngle, uint32_t png_gamma)
 {
 #ifndef PNGLE_NO_GAMMA_CORRECTION
 	if (pngle->gamma_table) free(pngle->gamma_table);
+	pngle->gamma_table = NULL;
 
 	if (pngle->display_gamma <= 0) return 0; // disable gamma correction
 	if (png_gamma == 0) return 0;
 
-	uint8_t pixel_depth = (pngle->hdr.color_type & 1) ? 8 : pngle->hdr.depth;
-	uint16_t maxval = (1UL << pixel_depth) - 1;
-
-	pngle->gamma_table = PNGLE_CALLOC(1, maxval + 1, "gamma table");
-	if (!pngle->gamma_table) return PNGLE_ERROR("Insufficient memory");
-
-	for (int i = 0; i < maxval + 1; i++) {
-		pngle->gamma_table[i] = (uint8_t)floor(pow(i / (double)maxval, 100000.0 / png_gamma / pngle->display_gamma) * 255.0 + 0.5);
+	if (png_gamma != gamma_cache_png || pngle->display_gamma != gamma_cache_display) {
+		gamma_cache_identity = true;
+		for (int i = 0; i < 256; i++) {
+			gamma_cache[i] = (uint8_t)floor(pow(i / 255.0, 100000.0 / png_gamma / pngle->display_gamma) * 255.0 + 0.5);
+			if (gamma_cache[i] != i) gamma_cache_identity = false;
+		}
+		gamma_cache_png = png_gamma;
+		gamma_cache_display = pngle->display_gamma;
 	}
 	debug_printf("[pngle] gamma value = %d\n", png_gamma);
+
+	// e.g. sRGB files (gAMA 45455) on a 2.2 display need no correction at all
+	if (gamma_cache_identity) return 0;
+
+	// indexed by the sample scaled to 8 bits
+	pngle->gamma_table = PNGLE_CALLOC(1, 256, "gamma table");
+	if (!pngle->gamma_table) return PNGLE_ERROR("Insufficient memory");
+	memcpy(pngle->gamma_table, gamma_cache, 256);
 #else
 	PNGLE_UNUSED(pngle);
 	PNGLE_UNUSED(png_gamma);
@@ -403,6 +628,11 @@ static int pngle_on_data(pngle_t *pngle, const uint8_t *p, int len)
 
 			pngle->filter_type = (int_fast8_t)*p++; // 0 - 4
 
+			if (pngle->draw_row_callback) {
+				pngle->row_fill = 0;
+				continue;
+			}
+
 			// push sentinel bytes for new line
 			for (uint_fast8_t i = 0; i < bytes_per_pixel; i++) {
 				scanline_ringbuf_push(pngle, 0);
@@ -411,6 +641,19 @@ static int pngle_on_data(pngle_t *pngle, const uint8_t *p, int len)
 			continue;
 		}
 
+		if (pngle->draw_row_callback) {
+			// gather the whole line, then unfilter and convert it at once
+			size_t n = MIN((size_t)(ep - p), pngle->row_stride - pngle->row_fill);
+			memcpy(pngle->row_cur + pngle->row_fill, p, n);
+			pngle->row_fill += n;
+			p += n;
+
+			if (pngle->row_fill == pngle->row_stride) {
+				if (pngle_draw_row(pngle, bytes_per_pixel) < 0) return -1;
+			}
+			continue;
+		}
+
 		size_t cidx =  pngle->scanline_ringbuf_cidx;
 		size_t bidx = (pngle->scanline_ringbuf_cidx + bytes_per_pixel) % pngle->scanline_ringbuf_size;
 		size_t aidx = (pngle->scanline_ringbuf_cidx + pngle->scanline_ringbuf_size - bytes_per_pixel) % pngle->scanline_ringbuf_size;
@@ -819,6 +1062,19 @@ void pngle_set_done_callback(pngle_t *pngle, pngle_done_callback_t callback)
 	pngle->done_callback = callback;
 }
 
+void pngle_set_draw_row_callback(pngle_t *pngle, pngle_draw_row_callback_t callback)
+{
+	if (!pngle) return ;
+	pngle->draw_row_callback = callback;
+}
+
+void pngle_set_band_callback(pngle_t *pngle, pngle_band_callback_t callback, uint16_t lines)
+{
+	if (!pngle) return ;
+	pngle->band_callback = callback;
+	pngle->band_lines = lines;
+}
+
 void pngle_set_user_data(pngle_t *pngle, void *user_data)
 {
 	if (!pngle) return ;
@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "freertos/FreeRTOS.h"
+#include "resample.h"
 
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
 #include "miniz.h"
@@ -102,6 +103,8 @@ typedef struct pngle pngle_t;
 typedef void (*pngle_init_callback_t)(pngle_t *pngle, uint32_t w, uint32_t h);
 typedef void (*pngle_draw_callback_t)(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t rgba[4]);
 typedef void (*pngle_done_callback_t)(pngle_t *pngle);
+typedef void (*pngle_band_callback_t)(pngle_t *pngle, uint32_t y, uint32_t lines, pixel_png *pixels);
+typedef void (*pngle_draw_row_callback_t)(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t step, uint32_t n, const pixel_png *row);
 
 struct pngle {
     pngle_ihdr_t hdr;
@@ -137,6 +140,16 @@ struct pngle {
     uint32_t drawing_x;
     uint32_t drawing_y;
 
+    // row decoder, used instead of the ring buffer when draw_row_callback is set
+    uint8_t *row_buf; // previous and current line, each behind PNGLE_ROW_PAD zero bytes
+    uint8_t *row_cur;
+    uint8_t *row_prev;
+    size_t row_stride;
+    size_t row_fill;
+    bool row_first; // no previous line in this pass
+    pixel_png *row_pixels;
+    pixel_png *palette565;
+
     // interlace
     uint_fast8_t interlace_pass;
 
@@ -150,15 +163,19 @@ struct pngle {
     pngle_init_callback_t init_callback;
     pngle_draw_callback_t draw_callback;
     pngle_done_callback_t done_callback;
+    pngle_band_callback_t band_callback;
+    pngle_draw_row_callback_t draw_row_callback;
 
     void *user_data;
 	uint16_t screenWidth;
 	uint16_t screenHeight;
 	uint16_t imageWidth;
 	uint16_t imageHeight;
-	pixel_png **pixels;
-	bool reduction;
-	double scale_factor;
+	pixel_png *pixels; // band_height rows of imageWidth pixels
+	uint16_t band_lines; // rows per band_callback call
+	uint16_t band_height; // rows held by pixels, the whole image when interlaced or without band callback
+	uint16_t band_y; // first image row held by pixels
+	resample_t resample; // image to screen reduction, see decode_png.c
 };
 
 
@@ -177,6 +194,8 @@ uint32_t pngle_get_height(pngle_t *pngle);
 void pngle_set_init_callback(pngle_t *png, pngle_init_callback_t callback);
 void pngle_set_draw_callback(pngle_t *png, pngle_draw_callback_t callback);
 void pngle_set_done_callback(pngle_t *png, pngle_done_callback_t callback);
+void pngle_set_band_callback(pngle_t *png, pngle_band_callback_t callback, uint16_t lines); // receives completed RGB565 rows, see decode_png.h
+void pngle_set_draw_row_callback(pngle_t *png, pngle_draw_row_callback_t callback); // decodes a scanline at a time into RGB565 (alpha is dropped) instead of calling draw_callback per pixel
 
 void pngle_set_display_gamma(pngle_t *pngle, double display_gamma); // enables gamma correction by specifying display gamma, typically 2.2. No effect when gAMA chunk is missing
 
@@ -0,0 +1,128 @@
+/**
+********************************************************************************
+* @file         resample.c
+* @brief        Integer image downscaling shared by the PNG and JPEG decoders
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "resample.h"
+
+/*
+ * Coordinates are scaled with one Q16 factor, so the same source image
+ * always gives the same output on the target and on the host. Pixels are
+ * RGB565; the box filter averages the 5/6/5 bit channels separately.
+ */
+
+/**
+ * Fit srcWidth x srcHeight into maxWidth x maxHeight keeping the aspect
+ * ratio, images are never enlarged. The box mode allocates one row of
+ * sums, returns false when that fails.
+ */
+bool resampleInit(resample_t *rs, uint16_t srcWidth, uint16_t srcHeight, uint16_t maxWidth, uint16_t maxHeight, resample_mode_t mode)
+{
+    memset(rs, 0, sizeof(resample_t));
+    rs->srcWidth = srcWidth;
+    rs->srcHeight = srcHeight;
+    rs->scale = RESAMPLE_ONE;
+    rs->mode = mode;
+    rs->accY = -1;
+
+    if(srcWidth > maxWidth || srcHeight > maxHeight){
+        uint32_t scaleWidth = ((uint32_t)maxWidth << 16) / srcWidth;
+        uint32_t scaleHeight = ((uint32_t)maxHeight << 16) / srcHeight;
+        rs->scale = (scaleWidth < scaleHeight) ? scaleWidth : scaleHeight;
+        if(rs->scale == 0) rs->scale = 1;
+    }
+    rs->dstWidth = resampleMap(rs, srcWidth);
+    rs->dstHeight = resampleMap(rs, srcHeight);
+    if(rs->dstWidth == 0) rs->dstWidth = 1;
+    if(rs->dstHeight == 0) rs->dstHeight = 1;
+
+    if(rs->mode != RESAMPLE_BOX || resampleIsIdentity(rs)){
+        rs->mode = RESAMPLE_NEAREST;
+        return true;
+    }
+
+    rs->sum = calloc(rs->dstWidth * 3, sizeof(uint32_t));
+    rs->count = calloc(rs->dstWidth, sizeof(uint32_t));
+    rs->out = calloc(rs->dstWidth, sizeof(uint16_t));
+    if(rs->sum == NULL || rs->count == NULL || rs->out == NULL){
+        resampleFree(rs);
+        return false;
+    }
+    return true;
+}
+
+void resampleFree(resample_t *rs)
+{
+    free(rs->sum);
+    free(rs->count);
+    free(rs->out);
+    rs->sum = NULL;
+    rs->count = NULL;
+    rs->out = NULL;
+    rs->accY = -1;
+}
+
+/* Move the averages of the accumulated row to out and clear the sums */
+static void resampleBoxEmit(resample_t *rs)
+{
+    for(int i = 0; i < rs->dstWidth; i++){
+        uint32_t n = rs->count[i];
+        uint32_t *s = &rs->sum[i * 3];
+        if(n){
+            uint16_t r = (s[0] + n / 2) / n;
+            uint16_t g = (s[1] + n / 2) / n;
+            uint16_t b = (s[2] + n / 2) / n;
+            rs->out[i] = (r << 11) | (g << 5) | b;
+        }else{
+            rs->out[i] = 0;
+        }
+    }
+    rs->outY = rs->accY;
+    memset(rs->sum, 0, rs->dstWidth * 3 * sizeof(uint32_t));
+    memset(rs->count, 0, rs->dstWidth * sizeof(uint32_t));
+    rs->accY = -1;
+}
+
+/**
+ * Add source row y, pixel i at x + i * step. Rows must come in order, top-down or bottom-up.
+ * Returns true when the row completed the previous destination row,
+ * which is then in out / outY.
+ */
+bool resampleBoxRow(resample_t *rs, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const uint16_t *pixels)
+{
+    bool done = false;
+    int32_t dy = resampleMap(rs, y);
+    if(dy >= rs->dstHeight) return false;
+
+    if(rs->accY >= 0 && rs->accY != dy){
+        resampleBoxEmit(rs);
+        done = true;
+    }
+    rs->accY = dy;
+
+    for(uint32_t i = 0; i < n; i++, x += step){
+        uint32_t dx = resampleMap(rs, x);
+        if(dx >= rs->dstWidth) break;
+        uint16_t c = pixels[i];
+        uint32_t *s = &rs->sum[dx * 3];
+        s[0] += c >> 11;
+        s[1] += (c >> 5) & 0x3F;
+        s[2] += c & 0x1F;
+        rs->count[dx]++;
+    }
+    return done;
+}
+
+/* Complete the last destination row, returns false when nothing was pending */
+bool resampleBoxFlush(resample_t *rs)
+{
+    if(rs->accY < 0) return false;
+    resampleBoxEmit(rs);
+    return true;
+}
@@ -0,0 +1,63 @@
+/**
+********************************************************************************
+* @file         resample.h
+* @brief        Header file for resample.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _RESAMPLE_H_
+#define _RESAMPLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RESAMPLE_ONE    (1UL << 16)     /* Q16 1.0 */
+
+typedef enum
+{
+    RESAMPLE_NEAREST = 0,       /* Every source pixel lands on the pixel it maps to */
+    RESAMPLE_BOX,               /* Average of all source pixels mapping to a pixel, source rows in order */
+}resample_mode_t;
+
+typedef struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+    uint16_t dstWidth;
+    uint16_t dstHeight;
+    uint32_t scale;             /* Q16 destination pixels per source pixel, at most RESAMPLE_ONE */
+    resample_mode_t mode;
+
+    /* Box filter, sums of the destination row being accumulated */
+    uint32_t *sum;              /* R5, G6, B5 sums per destination column */
+    uint32_t *count;            /* Source pixels per destination column */
+    uint16_t *out;              /* Last completed destination row */
+    int32_t accY;               /* Destination row in sum, -1 when empty */
+    uint16_t outY;              /* Destination row in out */
+}resample_t;
+
+bool resampleInit(resample_t *rs, uint16_t srcWidth, uint16_t srcHeight, uint16_t maxWidth, uint16_t maxHeight, resample_mode_t mode);
+void resampleFree(resample_t *rs);
+bool resampleBoxRow(resample_t *rs, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const uint16_t *pixels);
+bool resampleBoxFlush(resample_t *rs);
+
+/* Destination coordinate of source coordinate v */
+static inline uint32_t resampleMap(const resample_t *rs, uint32_t v)
+{
+    return (uint32_t)(((uint64_t)v * rs->scale) >> 16);
+}
+
+/* First source coordinate that maps to destination coordinate d */
+static inline uint32_t resampleUnmap(const resample_t *rs, uint32_t d)
+{
+    return (uint32_t)((((uint64_t)d << 16) + rs->scale - 1) / rs->scale);
+}
+
+static inline bool resampleIsIdentity(const resample_t *rs)
+{
+    return rs->scale == RESAMPLE_ONE;
+}
+
+#endif // _RESAMPLE_H_
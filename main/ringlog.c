@@ -0,0 +1,429 @@
+/**
+********************************************************************************
+* @file         ringlog.c
+* @brief        Append-only ring log on a raw flash partition
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "ringlog.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_partition.h"
+
+static const char *TAG = "Ring Log";
+
+/*
+ * Sectors are written in order around the partition, so every sector gets
+ * erased equally often. Each one starts with a header carrying its own
+ * sequence number, the sequence of its first record and the consumer
+ * position when it was opened. Records follow back to back, 4-byte
+ * aligned: header first, then the payload, with one CRC over both. A
+ * record cut short by power loss fails its CRC and is skipped.
+ * Recovery reads the sector headers only, plus the records of the newest
+ * sector to find the write position and the ack records written since.
+ */
+#define SECTOR_MAGIC    0x474F4C52  /* "RLOG" */
+#define RECORD_DATA     0xA5
+#define RECORD_ACK      0x5A        /* seq holds the new ackSeq, no payload */
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sectorSeq;
+    uint32_t firstSeq;          /* Sequence of the first record in this sector */
+    uint32_t ackSeq;            /* Consumer position when the sector was opened */
+    uint32_t crc;
+}ringlog_sector_t;
+
+typedef struct
+{
+    uint16_t size;              /* Payload bytes */
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t seq;
+    uint32_t crc;               /* Over the fields above and the payload */
+}ringlog_record_t;
+
+_Static_assert(sizeof(ringlog_sector_t) == RINGLOG_SECTOR_HEADER, "sector header size");
+_Static_assert(sizeof(ringlog_record_t) == RINGLOG_RECORD_HEADER, "record header size");
+
+#define ALIGN4(n)   (((n) + 3) & ~3)
+
+static uint32_t sectorAddr(const ringlog_t *log, uint16_t sector)
+{
+    return (uint32_t)sector * RINGLOG_SECTOR_SIZE;
+}
+
+static uint16_t nextSector(const ringlog_t *log, uint16_t sector)
+{
+    return (sector + 1 == log->sectors) ? 0 : sector + 1;
+}
+
+static uint32_t sectorCrc(const ringlog_sector_t *header)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(ringlog_sector_t, crc));
+}
+
+static uint32_t recordCrc(const ringlog_record_t *record, const void *data)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)record, offsetof(ringlog_record_t, crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)data, record->size);
+}
+
+static bool isErased(const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for(size_t i = 0; i < size; i++){
+        if(p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+/* Header plausible enough to step over the record, the CRC is checked by the caller */
+static bool recordFits(const ringlog_record_t *record, uint32_t offset)
+{
+    return record->size <= RINGLOG_MAX_RECORD && offset + ALIGN4(RINGLOG_RECORD_HEADER + record->size) <= RINGLOG_SECTOR_SIZE;
+}
+
+static esp_err_t writeRecord(ringlog_t *log, uint8_t type, uint32_t seq, const void *data, uint16_t size);
+
+/* Erase the sector after the head and start writing there, drops the oldest sector when full */
+static esp_err_t openNextSector(ringlog_t *log)
+{
+    uint16_t next = nextSector(log, log->headSector);
+    esp_err_t ret;
+
+    if(log->usedSectors == log->sectors){
+        uint16_t newTail = nextSector(log, log->tailSector);
+        uint32_t newFirst = log->firstSeq[newTail];
+        if((int32_t)(log->ackSeq - newFirst) < 0){
+            uint32_t from = log->firstSeq[log->tailSector];
+            if((int32_t)(log->ackSeq - from) > 0) from = log->ackSeq;
+            log->lost += newFirst - from;
+            log->ackSeq = newFirst;
+        }
+        log->tailSector = newTail;
+        log->usedSectors--;
+    }
+    if(log->cursorValid && log->cursorSector == next){
+        log->cursorValid = false;
+    }
+
+    ret = log->flash->erase(log->flash->ctx, sectorAddr(log, next), RINGLOG_SECTOR_SIZE);
+    if(ret != ESP_OK) return ret;
+    ringlog_sector_t header = {
+        .magic = SECTOR_MAGIC,
+        .sectorSeq = log->sectorSeq + 1,
+        .firstSeq = log->nextSeq,
+        .ackSeq = log->ackSeq,
+    };
+    header.crc = sectorCrc(&header);
+    ret = log->flash->write(log->flash->ctx, sectorAddr(log, next), &header, sizeof(header));
+    if(ret != ESP_OK) return ret;
+
+    log->headSector = next;
+    log->headOffset = RINGLOG_SECTOR_HEADER;
+    log->sectorSeq++;
+    log->firstSeq[next] = log->nextSeq;
+    log->usedSectors++;
+    return ESP_OK;
+}
+
+static esp_err_t writeRecord(ringlog_t *log, uint8_t type, uint32_t seq, const void *data, uint16_t size)
+{
+    uint32_t need = ALIGN4(RINGLOG_RECORD_HEADER + size);
+    esp_err_t ret;
+
+    if(log->headOffset + need > RINGLOG_SECTOR_SIZE){
+        ret = openNextSector(log);
+        if(ret != ESP_OK) return ret;
+    }
+    ringlog_record_t record = {
+        .size = size,
+        .type = type,
+        .reserved = 0xFF,
+        .seq = seq,
+    };
+    record.crc = recordCrc(&record, data);
+
+    uint32_t addr = sectorAddr(log, log->headSector) + log->headOffset;
+    // Space is taken even if a write fails, the bytes may already be programmed
+    log->headOffset += need;
+    ret = log->flash->write(log->flash->ctx, addr, &record, sizeof(record));
+    if(ret == ESP_OK && size > 0){
+        ret = log->flash->write(log->flash->ctx, addr + RINGLOG_RECORD_HEADER, data, size);
+    }
+    return ret;
+}
+
+/* Erase everything and start an empty log */
+esp_err_t ringlogFormat(ringlog_t *log)
+{
+    esp_err_t ret = log->flash->erase(log->flash->ctx, 0, (uint32_t)log->sectors * RINGLOG_SECTOR_SIZE);
+    if(ret != ESP_OK) return ret;
+
+    log->headSector = log->sectors - 1;     // openNextSector() moves on to sector 0
+    log->tailSector = 0;
+    log->usedSectors = 0;
+    log->sectorSeq = 0;
+    log->nextSeq = 0;
+    log->ackSeq = 0;
+    log->lost = 0;
+    log->cursorValid = false;
+    return openNextSector(log);
+}
+
+/* CRC check straight from flash, a chunk at a time */
+static bool recordValid(ringlog_t *log, uint32_t addr, const ringlog_record_t *record)
+{
+    uint8_t chunk[64];
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)record, offsetof(ringlog_record_t, crc));
+
+    for(uint32_t done = 0; done < record->size; ){
+        uint32_t n = record->size - done;
+        if(n > sizeof(chunk)) n = sizeof(chunk);
+        if(log->flash->read(log->flash->ctx, addr + RINGLOG_RECORD_HEADER + done, chunk, n) != ESP_OK) return false;
+        crc = esp_rom_crc32_le(crc, chunk, n);
+        done += n;
+    }
+    return crc == record->crc;
+}
+
+/* Replay the newest sector: write position, next sequence and acks since it was opened */
+static void scanHeadSector(ringlog_t *log)
+{
+    ringlog_record_t record;
+    uint32_t offset = RINGLOG_SECTOR_HEADER;
+    uint32_t base = sectorAddr(log, log->headSector);
+
+    while(offset + RINGLOG_RECORD_HEADER <= RINGLOG_SECTOR_SIZE){
+        if(log->flash->read(log->flash->ctx, base + offset, &record, sizeof(record)) != ESP_OK){
+            offset = RINGLOG_SECTOR_SIZE;
+            break;
+        }
+        if(isErased(&record, sizeof(record))){
+            break;
+        }
+        if(!recordFits(&record, offset)){
+            // Torn header, nothing after it can be trusted
+            offset = RINGLOG_SECTOR_SIZE;
+            break;
+        }
+        // A torn record is stepped over, its sequence number is simply reused
+        if(recordValid(log, base + offset, &record)){
+            if(record.type == RECORD_ACK && (int32_t)(record.seq - log->ackSeq) > 0){
+                log->ackSeq = record.seq;
+            }else if(record.type == RECORD_DATA && (int32_t)(record.seq + 1 - log->nextSeq) > 0){
+                log->nextSeq = record.seq + 1;
+            }
+        }
+        offset += ALIGN4(RINGLOG_RECORD_HEADER + record.size);
+    }
+    log->headOffset = offset;
+}
+
+/* Sector headers seen by ringlogOpen, too big for app_main's stack */
+typedef struct
+{
+    uint32_t seq[RINGLOG_MAX_SECTORS];
+    bool valid[RINGLOG_MAX_SECTORS];
+}ringlog_scan_t;
+
+/**
+ * Mount the log kept in flash, formatting it when no valid sector is found.
+ * Reads every sector header once and the records of the newest sector.
+ */
+esp_err_t ringlogOpen(ringlog_t *log, const ringlog_flash_t *flash)
+{
+    ringlog_sector_t header;
+    ringlog_scan_t *scan;
+    bool found = false;
+
+    memset(log, 0, sizeof(*log));
+    log->flash = flash;
+    log->sectors = flash->size / RINGLOG_SECTOR_SIZE;
+    if(log->sectors < 2 || log->sectors > RINGLOG_MAX_SECTORS){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    scan = malloc(sizeof(ringlog_scan_t));
+    if(scan == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+
+    for(uint16_t i = 0; i < log->sectors; i++){
+        scan->valid[i] = false;
+        if(flash->read(flash->ctx, sectorAddr(log, i), &header, sizeof(header)) != ESP_OK) continue;
+        if(header.magic != SECTOR_MAGIC || header.crc != sectorCrc(&header)) continue;
+        scan->valid[i] = true;
+        scan->seq[i] = header.sectorSeq;
+        log->firstSeq[i] = header.firstSeq;
+        if(!found || (int32_t)(header.sectorSeq - log->sectorSeq) > 0){
+            log->sectorSeq = header.sectorSeq;
+            log->headSector = i;
+            log->nextSeq = header.firstSeq;
+            log->ackSeq = header.ackSeq;
+        }
+        found = true;
+    }
+    if(!found){
+        free(scan);
+        ESP_LOGI(TAG, "No log found, formatting %d sectors", log->sectors);
+        return ringlogFormat(log);
+    }
+
+    // The log is the run of sectors with consecutive sequence numbers ending at the head
+    uint16_t sector = log->headSector;
+    log->tailSector = sector;
+    log->usedSectors = 1;
+    while(log->usedSectors < log->sectors){
+        sector = (sector == 0) ? log->sectors - 1 : sector - 1;
+        if(!scan->valid[sector] || scan->seq[sector] != log->sectorSeq - log->usedSectors) break;
+        log->tailSector = sector;
+        log->usedSectors++;
+    }
+    free(scan);
+
+    scanHeadSector(log);
+    uint32_t tailSeq = log->firstSeq[log->tailSector];
+    if((int32_t)(log->ackSeq - tailSeq) < 0){
+        log->ackSeq = tailSeq;
+    }
+    ESP_LOGI(TAG, "%d sectors in use, records %"PRIu32"..%"PRIu32", %"PRIu32" pending",
+             log->usedSectors, tailSeq, log->nextSeq, ringlogPending(log));
+    return ESP_OK;
+}
+
+/* O(1): one or two flash writes, plus a sector erase every RINGLOG_SECTOR_SIZE bytes */
+esp_err_t ringlogAppend(ringlog_t *log, const void *data, uint16_t size, uint32_t *seq)
+{
+    if(size > RINGLOG_MAX_RECORD){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint32_t recordSeq = log->nextSeq;
+    if(seq != NULL){
+        *seq = recordSeq;
+    }
+    // A new sector must record this sequence as its first, so count the record afterwards
+    esp_err_t ret = writeRecord(log, RECORD_DATA, recordSeq, data, size);
+    log->nextSeq = recordSeq + 1;
+    return ret;
+}
+
+/* Put the cursor at the start of the sector holding ackSeq */
+static void locateCursor(ringlog_t *log)
+{
+    uint16_t sector = log->tailSector;
+
+    log->cursorSector = sector;
+    for(uint16_t i = 1; i < log->usedSectors; i++){
+        sector = nextSector(log, sector);
+        if((int32_t)(log->firstSeq[sector] - log->ackSeq) > 0) break;
+        log->cursorSector = sector;
+    }
+    log->cursorOffset = RINGLOG_SECTOR_HEADER;
+    log->cursorValid = true;
+}
+
+/**
+ * Copy out the oldest record not acknowledged yet, the cursor stays on it
+ * until ringlogAck(). ESP_ERR_NOT_FOUND when everything has been consumed.
+ */
+esp_err_t ringlogPeek(ringlog_t *log, void *data, uint16_t maxSize, uint16_t *size, uint32_t *seq)
+{
+    ringlog_record_t record;
+
+    if(log->ackSeq == log->nextSeq){
+        return ESP_ERR_NOT_FOUND;
+    }
+    if(!log->cursorValid){
+        locateCursor(log);
+    }
+    while(1){
+        bool end = (log->cursorSector == log->headSector && log->cursorOffset >= log->headOffset);
+        uint32_t addr = sectorAddr(log, log->cursorSector) + log->cursorOffset;
+        if(!end && log->cursorOffset + RINGLOG_RECORD_HEADER <= RINGLOG_SECTOR_SIZE &&
+           log->flash->read(log->flash->ctx, addr, &record, sizeof(record)) == ESP_OK &&
+           !isErased(&record, sizeof(record)) && recordFits(&record, log->cursorOffset)){
+            if(record.type == RECORD_DATA && (int32_t)(record.seq - log->ackSeq) >= 0){
+                if(record.size > maxSize){
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                if(log->flash->read(log->flash->ctx, addr + RINGLOG_RECORD_HEADER, data, record.size) == ESP_OK &&
+                   record.crc == recordCrc(&record, data)){
+                    *size = record.size;
+                    *seq = record.seq;
+                    return ESP_OK;
+                }
+            }
+            log->cursorOffset += ALIGN4(RINGLOG_RECORD_HEADER + record.size);
+            continue;
+        }
+        // End of this sector's records
+        if(log->cursorSector == log->headSector){
+            return ESP_ERR_NOT_FOUND;
+        }
+        log->cursorSector = nextSector(log, log->cursorSector);
+        log->cursorOffset = RINGLOG_SECTOR_HEADER;
+    }
+}
+
+/* Everything up to and including seq is consumed, persisted with a small ack record */
+esp_err_t ringlogAck(ringlog_t *log, uint32_t seq)
+{
+    uint32_t ack = seq + 1;
+
+    if((int32_t)(ack - log->ackSeq) <= 0){
+        return ESP_OK;
+    }
+    if((int32_t)(ack - log->nextSeq) > 0){
+        return ESP_ERR_INVALID_ARG;
+    }
+    log->ackSeq = ack;
+    return writeRecord(log, RECORD_ACK, ack, NULL, 0);
+}
+
+uint32_t ringlogPending(const ringlog_t *log)
+{
+    return log->nextSeq - log->ackSeq;
+}
+
+static esp_err_t partitionRead(void *ctx, uint32_t offset, void *data, size_t size)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, data, size);
+}
+
+static esp_err_t partitionWrite(void *ctx, uint32_t offset, const void *data, size_t size)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, offset, data, size);
+}
+
+static esp_err_t partitionErase(void *ctx, uint32_t offset, size_t size)
+{
+    return esp_partition_erase_range((const esp_partition_t *)ctx, offset, size);
+}
+
+/* Flash access through the data partition called label, NULL when it is missing */
+const ringlog_flash_t *ringlogPartitionFlash(const char *label)
+{
+    static ringlog_flash_t flash;
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+
+    if(part == NULL){
+        ESP_LOGE(TAG, "Partition [%s] not found", label);
+        return NULL;
+    }
+    flash.ctx = (void *)part;
+    flash.size = part->size - part->size % RINGLOG_SECTOR_SIZE;
+    if(flash.size > RINGLOG_MAX_SECTORS * RINGLOG_SECTOR_SIZE){
+        flash.size = RINGLOG_MAX_SECTORS * RINGLOG_SECTOR_SIZE;
+    }
+    flash.read = partitionRead;
+    flash.write = partitionWrite;
+    flash.erase = partitionErase;
+    return &flash;
+}
@@ -0,0 +1,64 @@
+/**
+********************************************************************************
+* @file         ringlog.h
+* @brief        Header file for ringlog.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _RINGLOG_H_
+#define _RINGLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define RINGLOG_SECTOR_SIZE     4096
+#define RINGLOG_MAX_SECTORS     256     /* Partition size / RINGLOG_SECTOR_SIZE at most */
+#define RINGLOG_PARTITION       "telemetry"
+#define RINGLOG_SECTOR_HEADER   20      /* sizeof(ringlog_sector_t) */
+#define RINGLOG_RECORD_HEADER   12      /* sizeof(ringlog_record_t) */
+#define RINGLOG_MAX_RECORD      (RINGLOG_SECTOR_SIZE - RINGLOG_SECTOR_HEADER - RINGLOG_RECORD_HEADER)
+
+// Raw flash under the log
+// NOR semantics: write() can only clear bits, erase() sets whole sectors back to 0xFF.
+typedef struct
+{
+    void *ctx;
+    uint32_t size;              /* Bytes, a multiple of RINGLOG_SECTOR_SIZE */
+    esp_err_t (*read)(void *ctx, uint32_t offset, void *data, size_t size);
+    esp_err_t (*write)(void *ctx, uint32_t offset, const void *data, size_t size);
+    esp_err_t (*erase)(void *ctx, uint32_t offset, size_t size);
+}ringlog_flash_t;
+
+typedef struct
+{
+    const ringlog_flash_t *flash;
+    uint16_t sectors;
+    uint16_t headSector;        /* Sector being appended to */
+    uint16_t tailSector;        /* Oldest sector with data */
+    uint16_t usedSectors;       /* Sectors from tail to head */
+    uint32_t headOffset;        /* Next write offset inside the head sector */
+    uint32_t sectorSeq;         /* Sequence number of the head sector */
+    uint32_t nextSeq;           /* Sequence number of the next record */
+    uint32_t ackSeq;            /* Records before this one are consumed */
+    uint32_t lost;              /* Unconsumed records overwritten by a full log */
+    uint32_t firstSeq[RINGLOG_MAX_SECTORS];    /* First record sequence of each sector */
+
+    /* Read cursor, the record at ackSeq or a position before it */
+    bool cursorValid;
+    uint16_t cursorSector;
+    uint32_t cursorOffset;
+}ringlog_t;
+
+esp_err_t ringlogOpen(ringlog_t *log, const ringlog_flash_t *flash);
+esp_err_t ringlogFormat(ringlog_t *log);
+esp_err_t ringlogAppend(ringlog_t *log, const void *data, uint16_t size, uint32_t *seq);
+esp_err_t ringlogPeek(ringlog_t *log, void *data, uint16_t maxSize, uint16_t *size, uint32_t *seq);
+esp_err_t ringlogAck(ringlog_t *log, uint32_t seq);
+uint32_t ringlogPending(const ringlog_t *log);
+const ringlog_flash_t *ringlogPartitionFlash(const char *label);
+
+#endif // _RINGLOG_H_
@@ -0,0 +1,99 @@
+/**
+********************************************************************************
+* @file         sensor.c
+* @brief        Sensor ingestion: per source producer tasks and a batching aggregator
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "sensor.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "Sensor";
+
+/*
+ * Every source has its own producer task and its own SPSC ring, so producers
+ * never contend with each other. The aggregator is the single consumer of
+ * all rings: it wakes every SENSOR_DRAIN_PERIOD, or earlier when a producer
+ * sees its ring half full, and hands the samples on in batches.
+ * The rings and the batching live in ingest.c, this file only adds the
+ * tasks, the clock and the lock around the published stats.
+ */
+static ingest_t ingest;
+static TaskHandle_t aggregatorHandle = NULL;
+
+static sensor_stats_t stats;
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+void sensorInit(sensor_batch_handler_t handler, void *ctx)
+{
+    ingestInit(&ingest, handler, ctx);
+    memset(&stats, 0, sizeof(stats));
+}
+
+/* Returns the source id, or -1 when SENSOR_MAX_SOURCES are in use */
+int sensorAddSource(const char *name, uint32_t periodUs, sensor_read_t read, void *ctx)
+{
+    return ingestAddSource(&ingest, name, periodUs, read, ctx);
+}
+
+int sensorSourceCount(void)
+{
+    return ingest.numOfSources;
+}
+
+void sensorGetStats(sensor_stats_t *out)
+{
+    portENTER_CRITICAL(&statsMux);
+    *out = stats;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+static void sensorProducerTask(void *pvParameters)
+{
+    sensor_source_t *src = (sensor_source_t *)pvParameters;
+    TickType_t period = pdMS_TO_TICKS(src->periodUs / 1000);
+
+    if(period == 0){
+        period = 1;
+    }
+    while(1){
+        ingestPoll(src, esp_timer_get_time());
+        // Wake the aggregator early instead of dropping samples
+        if(spscRingCount(&src->ring) >= SENSOR_RING_SIZE / 2){
+            xTaskNotifyGive(aggregatorHandle);
+        }
+        vTaskDelay(period);
+    }
+}
+
+static void sensorAggregatorTask(void *pvParameters)
+{
+    sensor_stats_t window;
+
+    while(1){
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SENSOR_DRAIN_PERIOD));
+        int64_t now = esp_timer_get_time();
+        ingestDrain(&ingest, now);
+        if(ingestWindowDone(&ingest, now)){
+            ingestPublish(&ingest, now, &window);
+            portENTER_CRITICAL(&statsMux);
+            stats = window;
+            portEXIT_CRITICAL(&statsMux);
+        }
+    }
+}
+
+void sensorStart(void)
+{
+    xTaskCreate(sensorAggregatorTask, "SensorAgg", SENSOR_AGGREGATOR_STACK, NULL, SENSOR_AGGREGATOR_PRIO, &aggregatorHandle);
+    for(int i = 0; i < ingest.numOfSources; i++){
+        xTaskCreate(sensorProducerTask, ingest.sources[i].name, SENSOR_PRODUCER_STACK, &ingest.sources[i], SENSOR_PRODUCER_PRIO, NULL);
+    }
+    ESP_LOGI(TAG, "%d sources started", ingest.numOfSources);
+}
@@ -0,0 +1,29 @@
+/**
+********************************************************************************
+* @file         sensor.h
+* @brief        Header file for sensor.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _SENSOR_H_
+#define _SENSOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ingest.h"
+
+#define SENSOR_DRAIN_PERIOD     20      /* ms between drains when no ring fills up */
+#define SENSOR_PRODUCER_STACK   2048
+#define SENSOR_PRODUCER_PRIO    4
+#define SENSOR_AGGREGATOR_STACK 4096
+#define SENSOR_AGGREGATOR_PRIO  3
+
+void sensorInit(sensor_batch_handler_t handler, void *ctx);
+int sensorAddSource(const char *name, uint32_t periodUs, sensor_read_t read, void *ctx);
+void sensorStart(void);
+int sensorSourceCount(void);
+void sensorGetStats(sensor_stats_t *stats);
+
+#endif // _SENSOR_H_
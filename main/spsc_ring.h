@@ -0,0 +1,85 @@
+/**
+********************************************************************************
+* @file         spsc_ring.h
+* @brief        Lock-free single producer / single consumer ring of fixed size items
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _SPSC_RING_H_
+#define _SPSC_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/*
+ * head is only written by the producer and tail only by the consumer, both
+ * count items forever and wrap at 2^32. The release store of one side and
+ * the acquire load on the other order the item copies, no lock is taken and
+ * either side can run on the other core or in an ISR.
+ */
+typedef struct
+{
+    uint8_t *items;
+    uint32_t itemSize;
+    uint32_t mask;              /* Capacity - 1, capacity is a power of two */
+    _Atomic uint32_t head;      /* Next item to write */
+    _Atomic uint32_t tail;      /* Next item to read */
+}spsc_ring_t;
+
+/* storage holds capacity items of itemSize bytes, capacity must be a power of two */
+static inline bool spscRingInit(spsc_ring_t *ring, void *storage, uint32_t itemSize, uint32_t capacity)
+{
+    if(capacity == 0 || (capacity & (capacity - 1)) != 0) return false;
+    ring->items = (uint8_t *)storage;
+    ring->itemSize = itemSize;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return true;
+}
+
+static inline uint32_t spscRingCapacity(const spsc_ring_t *ring)
+{
+    return ring->mask + 1;
+}
+
+/* Items waiting, exact for either side, a snapshot for anybody else */
+static inline uint32_t spscRingCount(spsc_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire) - atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+/* Producer only. Returns false when the ring is full */
+static inline bool spscRingPush(spsc_ring_t *ring, const void *item)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if(head - tail > ring->mask) return false;
+    memcpy(&ring->items[(head & ring->mask) * ring->itemSize], item, ring->itemSize);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+/* Consumer only. Copies out up to max items in at most two blocks, returns the number copied */
+static inline uint32_t spscRingPop(spsc_ring_t *ring, void *items, uint32_t max)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t n = head - tail;
+    if(n > max) n = max;
+    if(n == 0) return 0;
+
+    uint32_t first = tail & ring->mask;
+    uint32_t part = spscRingCapacity(ring) - first;
+    if(part > n) part = n;
+    memcpy(items, &ring->items[first * ring->itemSize], part * ring->itemSize);
+    memcpy((uint8_t *)items + part * ring->itemSize, ring->items, (n - part) * ring->itemSize);
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    return n;
+}
+
+#endif // _SPSC_RING_H_
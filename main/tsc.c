@@ -0,0 +1,311 @@
+/**
+********************************************************************************
+* @file         tsc.c
+* @brief        Time-series codec: delta-of-delta timestamps and XOR floats
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "tsc.h"
+#include <string.h>
+
+/*
+ * Gorilla style bit packing, MSB first, every sample is:
+ *
+ * series   '0'                     same series that followed the last one before
+ *          '1' + 4 bits index      index 15: new series, + 16 bits source + 16 bits channel
+ * time     new series: 32 bits, signed offset from the block base time
+ *          '0'                     delta of delta 0
+ *          '10'   + 7 bits         -64 .. 63
+ *          '110'  + 9 bits         -256 .. 255
+ *          '1110' + 12 bits        -2048 .. 2047
+ *          '1111' + 32 bits        anything else
+ * value    new series: 32 bits float
+ *          '0'                     same value as the last one of the series
+ *          '10' + meaningful bits  XOR fits in the last leading/trailing zero window
+ *          '11' + 5 bits leading + 5 bits length - 1 + meaningful bits
+ *
+ * Blocks are fixed size, a sample is only accepted while TSC_MAX_SAMPLE_BITS
+ * are left, so a block never ends in the middle of a sample.
+ */
+#define SERIES_NEW      15
+#define NO_WINDOW       32
+
+static void putBits(tsc_encoder_t *enc, uint32_t value, uint8_t bits)
+{
+    while(bits > 0){
+        uint8_t *p = &enc->buf[enc->bitPos >> 3];
+        uint8_t used = enc->bitPos & 7;
+        uint8_t room = 8 - used;
+        uint8_t n = (bits < room) ? bits : room;
+        uint8_t chunk = (value >> (bits - n)) & ((1u << n) - 1);
+        if(used == 0){
+            *p = 0;
+        }
+        *p |= chunk << (room - n);
+        enc->bitPos += n;
+        bits -= n;
+    }
+}
+
+static bool getBits(tsc_decoder_t *dec, uint8_t bits, uint32_t *value)
+{
+    uint32_t v = 0;
+
+    if(dec->bitPos + bits > dec->size * 8){
+        return false;
+    }
+    while(bits > 0){
+        uint8_t byte = dec->buf[dec->bitPos >> 3];
+        uint8_t used = dec->bitPos & 7;
+        uint8_t room = 8 - used;
+        uint8_t n = (bits < room) ? bits : room;
+        v = (v << n) | ((byte >> (room - n)) & ((1u << n) - 1));
+        dec->bitPos += n;
+        bits -= n;
+    }
+    *value = v;
+    return true;
+}
+
+static int32_t signExtend(uint32_t v, uint8_t bits)
+{
+    uint32_t m = 1u << (bits - 1);
+    return (int32_t)((v ^ m) - m);
+}
+
+static uint32_t floatBits(float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static float bitsFloat(uint32_t v)
+{
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+void tscEncoderInit(tsc_encoder_t *enc, uint8_t *buf, uint32_t capacity, int64_t baseTime)
+{
+    enc->buf = buf;
+    enc->capacity = capacity;
+    enc->bitPos = 0;
+    enc->count = 0;
+    enc->baseTime = baseTime;
+    enc->numSeries = 0;
+    enc->prev = 0;
+}
+
+/* Bytes of the block in use */
+uint32_t tscEncodedSize(const tsc_encoder_t *enc)
+{
+    return (enc->bitPos + 7) >> 3;
+}
+
+static void encodeTime(tsc_encoder_t *enc, tsc_series_t *s, int64_t timestamp)
+{
+    int64_t delta = timestamp - s->timestamp;
+    int64_t dod = delta - s->delta;
+
+    if(dod == 0){
+        putBits(enc, 0, 1);
+    }else if(dod >= -64 && dod <= 63){
+        putBits(enc, 0x2, 2);
+        putBits(enc, (uint32_t)dod & 0x7F, 7);
+    }else if(dod >= -256 && dod <= 255){
+        putBits(enc, 0x6, 3);
+        putBits(enc, (uint32_t)dod & 0x1FF, 9);
+    }else if(dod >= -2048 && dod <= 2047){
+        putBits(enc, 0xE, 4);
+        putBits(enc, (uint32_t)dod & 0xFFF, 12);
+    }else{
+        putBits(enc, 0xF, 4);
+        putBits(enc, (uint32_t)dod, 32);
+    }
+    s->timestamp = timestamp;
+    s->delta = delta;
+}
+
+static void encodeValue(tsc_encoder_t *enc, tsc_series_t *s, uint32_t value)
+{
+    uint32_t x = value ^ s->value;
+
+    if(x == 0){
+        putBits(enc, 0, 1);
+        return;
+    }
+    uint8_t leading = __builtin_clz(x);
+    uint8_t trailing = __builtin_ctz(x);
+    if(s->leading != NO_WINDOW && leading >= s->leading && trailing >= s->trailing){
+        putBits(enc, 0x2, 2);
+        putBits(enc, x >> s->trailing, 32 - s->leading - s->trailing);
+    }else{
+        uint8_t length = 32 - leading - trailing;
+        putBits(enc, 0x3, 2);
+        putBits(enc, leading, 5);
+        putBits(enc, length - 1, 5);
+        putBits(enc, x >> trailing, length);
+        s->leading = leading;
+        s->trailing = trailing;
+    }
+    s->value = value;
+}
+
+/**
+ * Append one sample. Returns false, leaving the block untouched, when the
+ * block is full or already holds TSC_MAX_SERIES other series.
+ * Timestamps within a block must stay within +-35 minutes of each other.
+ */
+bool tscEncode(tsc_encoder_t *enc, const sensor_sample_t *sample)
+{
+    uint8_t index;
+
+    if(enc->bitPos + TSC_MAX_SAMPLE_BITS > enc->capacity * 8 || enc->count == UINT16_MAX){
+        return false;
+    }
+    for(index = 0; index < enc->numSeries; index++){
+        if(enc->series[index].source == sample->source && enc->series[index].channel == sample->channel) break;
+    }
+    if(index == enc->numSeries && index == TSC_MAX_SERIES){
+        return false;
+    }
+
+    if(enc->count > 0 && index == enc->series[enc->prev].next){
+        putBits(enc, 0, 1);
+    }else{
+        putBits(enc, 1, 1);
+        putBits(enc, (index == enc->numSeries) ? SERIES_NEW : index, 4);
+    }
+
+    tsc_series_t *s = &enc->series[index];
+    if(index == enc->numSeries){
+        putBits(enc, sample->source, 16);
+        putBits(enc, sample->channel, 16);
+        putBits(enc, (uint32_t)(sample->timestamp - enc->baseTime), 32);
+        putBits(enc, floatBits(sample->value), 32);
+        s->source = sample->source;
+        s->channel = sample->channel;
+        s->timestamp = sample->timestamp;
+        s->delta = 0;
+        s->value = floatBits(sample->value);
+        s->leading = NO_WINDOW;
+        s->trailing = 0;
+        s->next = SERIES_NEW;
+        enc->numSeries++;
+    }else{
+        encodeTime(enc, s, sample->timestamp);
+        encodeValue(enc, s, floatBits(sample->value));
+    }
+
+    enc->series[enc->prev].next = index;
+    enc->prev = index;
+    enc->count++;
+    return true;
+}
+
+void tscDecoderInit(tsc_decoder_t *dec, const uint8_t *buf, uint32_t size, uint16_t count, int64_t baseTime)
+{
+    dec->buf = buf;
+    dec->size = size;
+    dec->bitPos = 0;
+    dec->remaining = count;
+    dec->baseTime = baseTime;
+    dec->numSeries = 0;
+    dec->prev = 0;
+}
+
+static bool decodeTime(tsc_decoder_t *dec, tsc_series_t *s)
+{
+    static const uint8_t widths[] = { 7, 9, 12, 32 };
+    uint32_t bit;
+    uint32_t v;
+    int64_t dod = 0;
+    int ones = 0;
+
+    // Up to four 1 bits before the 0 pick the bucket
+    while(ones < 4){
+        if(!getBits(dec, 1, &bit)) return false;
+        if(bit == 0) break;
+        ones++;
+    }
+    if(ones > 0){
+        if(!getBits(dec, widths[ones - 1], &v)) return false;
+        dod = signExtend(v, widths[ones - 1]);
+    }
+    s->delta += dod;
+    s->timestamp += s->delta;
+    return true;
+}
+
+static bool decodeValue(tsc_decoder_t *dec, tsc_series_t *s)
+{
+    uint32_t bit;
+    uint32_t v;
+
+    if(!getBits(dec, 1, &bit)) return false;
+    if(bit == 0) return true;
+    if(!getBits(dec, 1, &bit)) return false;
+    if(bit == 0){
+        if(s->leading == NO_WINDOW || !getBits(dec, 32 - s->leading - s->trailing, &v)) return false;
+        s->value ^= v << s->trailing;
+        return true;
+    }
+    uint32_t leading;
+    uint32_t length;
+    if(!getBits(dec, 5, &leading) || !getBits(dec, 5, &length)) return false;
+    length++;
+    if(leading + length > 32 || !getBits(dec, length, &v)) return false;
+    s->leading = leading;
+    s->trailing = 32 - leading - length;
+    s->value ^= v << s->trailing;
+    return true;
+}
+
+/* Next sample of the block, false at the end or on a damaged block */
+bool tscDecode(tsc_decoder_t *dec, sensor_sample_t *sample)
+{
+    uint32_t bit;
+    uint32_t v;
+    uint8_t index;
+
+    if(dec->remaining == 0 || !getBits(dec, 1, &bit)) return false;
+    if(bit == 0){
+        if(dec->numSeries == 0) return false;
+        index = dec->series[dec->prev].next;
+    }else{
+        if(!getBits(dec, 4, &v)) return false;
+        index = (v == SERIES_NEW) ? dec->numSeries : v;
+    }
+    if(index > dec->numSeries || index >= TSC_MAX_SERIES) return false;
+
+    tsc_series_t *s = &dec->series[index];
+    if(index == dec->numSeries){
+        uint32_t source, channel, offset, value;
+        if(!getBits(dec, 16, &source) || !getBits(dec, 16, &channel) ||
+           !getBits(dec, 32, &offset) || !getBits(dec, 32, &value)) return false;
+        s->source = source;
+        s->channel = channel;
+        s->timestamp = dec->baseTime + (int32_t)offset;
+        s->delta = 0;
+        s->value = value;
+        s->leading = NO_WINDOW;
+        s->trailing = 0;
+        s->next = SERIES_NEW;
+        dec->numSeries++;
+    }else{
+        if(!decodeTime(dec, s) || !decodeValue(dec, s)) return false;
+    }
+
+    sample->timestamp = s->timestamp;
+    sample->source = s->source;
+    sample->channel = s->channel;
+    sample->value = bitsFloat(s->value);
+    dec->series[dec->prev].next = index;
+    dec->prev = index;
+    dec->remaining--;
+    return true;
+}
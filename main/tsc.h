@@ -0,0 +1,63 @@
+/**
+********************************************************************************
+* @file         tsc.h
+* @brief        Header file for tsc.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _TSC_H_
+#define _TSC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor.h"
+
+#define TSC_MAX_SERIES          15      /* (source, channel) pairs per block, index 15 announces a new one */
+#define TSC_MAX_SAMPLE_BITS     104     /* Worst case for one sample: new series, full 32-bit fields */
+
+/* Per series state, identical on both sides */
+typedef struct
+{
+    uint16_t source;
+    uint16_t channel;
+    int64_t timestamp;          /* Last timestamp */
+    int64_t delta;              /* Last timestamp delta */
+    uint32_t value;             /* Last value, IEEE 754 bits */
+    uint8_t leading;            /* Window of the last XOR, 32 = none yet */
+    uint8_t trailing;
+    uint8_t next;               /* Series that followed this one last time */
+}tsc_series_t;
+
+typedef struct
+{
+    uint8_t *buf;
+    uint32_t capacity;          /* Bytes */
+    uint32_t bitPos;
+    uint16_t count;             /* Samples in the block */
+    int64_t baseTime;           /* Timestamp of the first sample */
+    uint8_t numSeries;
+    uint8_t prev;               /* Series of the last sample */
+    tsc_series_t series[TSC_MAX_SERIES];
+}tsc_encoder_t;
+
+typedef struct
+{
+    const uint8_t *buf;
+    uint32_t size;              /* Bytes */
+    uint32_t bitPos;
+    uint16_t remaining;         /* Samples left to decode */
+    int64_t baseTime;
+    uint8_t numSeries;
+    uint8_t prev;
+    tsc_series_t series[TSC_MAX_SERIES];
+}tsc_decoder_t;
+
+void tscEncoderInit(tsc_encoder_t *enc, uint8_t *buf, uint32_t capacity, int64_t baseTime);
+bool tscEncode(tsc_encoder_t *enc, const sensor_sample_t *sample);
+uint32_t tscEncodedSize(const tsc_encoder_t *enc);
+void tscDecoderInit(tsc_decoder_t *dec, const uint8_t *buf, uint32_t size, uint16_t count, int64_t baseTime);
+bool tscDecode(tsc_decoder_t *dec, sensor_sample_t *sample);
+
+#endif // _TSC_H_
@@ -0,0 +1,191 @@
+/**
+********************************************************************************
+* @file         uplink.c
+* @brief        Batched cloud uplink with store-and-forward while offline
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "uplink.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "Uplink";
+
+/*
+ * The sensor aggregator pushes samples into an SPSC ring, the uplink task
+ * packs them into batches closed on size or age. The batch payload is a
+ * tsc.c block: delta-of-delta timestamps and XOR values, a few bits per
+ * sample for slow moving sensors instead of 12 bytes. A closed batch is
+ * published while the transport is connected and appended to the backlog
+ * otherwise. The backlog is a ring log on a raw partition, one record per
+ * batch; once the link is back it is drained oldest first, at most
+ * UPLINK_DRAIN_RATE batches per second so live data keeps flowing.
+ * uplinkProcess() takes the time as an argument, so the engine runs on the
+ * host against a stand-in transport.
+ */
+static const uplink_transport_t *uplinkTransport = NULL;
+static spsc_ring_t ring;
+static sensor_sample_t ringStorage[UPLINK_RING_SIZE];
+static _Atomic uint32_t dropped;
+
+static uint8_t batch[UPLINK_BATCH_BYTES];
+static uplink_batch_header_t *batchHeader = (uplink_batch_header_t *)batch;
+static tsc_encoder_t batchEncoder;
+static int64_t batchOpened = 0;
+static uint32_t nextSeq = 0;
+
+static ringlog_t *backlog = NULL;
+static uint8_t backlogBuf[UPLINK_BATCH_BYTES];
+static int64_t nextDrain = 0;
+
+static uplink_stats_t stats;
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool backlogAppend(const uint8_t *data, uint32_t size)
+{
+    if(backlog == NULL){
+        return false;
+    }
+    esp_err_t ret = ringlogAppend(backlog, data, size, NULL);
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Backlog write failed (%s)", esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+static void uplinkOpenBatch(int64_t baseTime, int64_t now)
+{
+    batchHeader->baseTime = baseTime;
+    batchOpened = now;
+    tscEncoderInit(&batchEncoder, batch + sizeof(uplink_batch_header_t),
+                   UPLINK_BATCH_BYTES - sizeof(uplink_batch_header_t), baseTime);
+}
+
+static void uplinkCloseBatch(bool *online)
+{
+    uint32_t size = sizeof(uplink_batch_header_t) + tscEncodedSize(&batchEncoder);
+    bool sent = false;
+    bool stored = false;
+
+    batchHeader->version = UPLINK_BATCH_VERSION;
+    batchHeader->encoding = UPLINK_ENCODING_TSC;
+    batchHeader->count = batchEncoder.count;
+    batchHeader->seq = nextSeq++;
+    if(*online){
+        sent = uplinkTransport->publish(uplinkTransport->ctx, batch, size);
+        *online = sent;
+    }
+    if(!sent){
+        stored = backlogAppend(batch, size);
+    }
+
+    portENTER_CRITICAL(&statsMux);
+    stats.batches++;
+    if(sent){
+        stats.published++;
+    }else if(stored){
+        stats.stored++;
+    }
+    portEXIT_CRITICAL(&statsMux);
+    batchEncoder.count = 0;
+}
+
+/* Called by the sensor aggregator, never blocks */
+void uplinkSensorHandler(const sensor_sample_t *samples, uint32_t count, void *ctx)
+{
+    for(uint32_t i = 0; i < count; i++){
+        if(!spscRingPush(&ring, &samples[i])){
+            atomic_fetch_add_explicit(&dropped, count - i, memory_order_relaxed);
+            break;
+        }
+    }
+}
+
+/**
+ * One run of the uplink: batch the queued samples, close the batch when it
+ * is full or old enough, then forward one backlog batch if the rate allows.
+ */
+void uplinkProcess(int64_t now)
+{
+    sensor_sample_t samples[SENSOR_BATCH];
+    bool online = (uplinkTransport != NULL) && uplinkTransport->connected(uplinkTransport->ctx);
+    uint32_t n;
+
+    while((n = spscRingPop(&ring, samples, SENSOR_BATCH)) > 0){
+        for(uint32_t i = 0; i < n; i++){
+            if(batchEncoder.count == 0){
+                uplinkOpenBatch(samples[i].timestamp, now);
+            }
+            // A full block is closed and the sample starts the next one
+            if(!tscEncode(&batchEncoder, &samples[i])){
+                uplinkCloseBatch(&online);
+                uplinkOpenBatch(samples[i].timestamp, now);
+                tscEncode(&batchEncoder, &samples[i]);
+            }
+        }
+    }
+    if(batchEncoder.count > 0 && now - batchOpened >= UPLINK_BATCH_TIME * 1000LL){
+        uplinkCloseBatch(&online);
+    }
+
+    if(online && backlog != NULL && ringlogPending(backlog) > 0 && now >= nextDrain){
+        uint16_t size;
+        uint32_t seq;
+        if(ringlogPeek(backlog, backlogBuf, sizeof(backlogBuf), &size, &seq) == ESP_OK &&
+           uplinkTransport->publish(uplinkTransport->ctx, backlogBuf, size)){
+            ringlogAck(backlog, seq);
+            portENTER_CRITICAL(&statsMux);
+            stats.forwarded++;
+            portEXIT_CRITICAL(&statsMux);
+        }
+        nextDrain = now + 1000000 / UPLINK_DRAIN_RATE;
+    }
+}
+
+/* backlog may be NULL, batches are then lost while offline */
+void uplinkInit(const uplink_transport_t *transport, ringlog_t *log)
+{
+    uplinkTransport = transport;
+    backlog = log;
+    spscRingInit(&ring, ringStorage, sizeof(sensor_sample_t), UPLINK_RING_SIZE);
+    atomic_init(&dropped, 0);
+    memset(&stats, 0, sizeof(stats));
+    batchEncoder.count = 0;
+    nextSeq = 0;
+    nextDrain = 0;
+    if(backlog != NULL){
+        ESP_LOGI(TAG, "Backlog holds %"PRIu32" batches", ringlogPending(backlog));
+    }
+}
+
+void uplinkGetStats(uplink_stats_t *out)
+{
+    portENTER_CRITICAL(&statsMux);
+    *out = stats;
+    portEXIT_CRITICAL(&statsMux);
+    out->backlog = (backlog != NULL) ? ringlogPending(backlog) : 0;
+    out->overwritten = (backlog != NULL) ? backlog->lost : 0;
+    out->dropped = atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+static void uplinkTask(void *pvParameters)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    while(1){
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(UPLINK_POLL_PERIOD));
+        uplinkProcess(esp_timer_get_time());
+    }
+}
+
+void uplinkStart(void)
+{
+    xTaskCreate(uplinkTask, "Uplink", UPLINK_TASK_STACK, NULL, UPLINK_TASK_PRIO, NULL);
+}
@@ -0,0 +1,77 @@
+/**
+********************************************************************************
+* @file         uplink.h
+* @brief        Header file for uplink.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef _UPLINK_H_
+#define _UPLINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sensor.h"
+#include "ringlog.h"
+#include "tsc.h"
+
+#define UPLINK_RING_SIZE        512     /* Samples between the aggregator and the uplink task, power of two */
+#define UPLINK_BATCH_BYTES      2024    /* Largest batch, header included, two fit a ring log sector */
+#define UPLINK_BATCH_TIME       1000    /* ms before a partly filled batch goes out */
+#define UPLINK_POLL_PERIOD      50      /* ms between uplink task runs */
+#define UPLINK_DRAIN_RATE       5       /* Backlog batches sent per second once the link is back */
+#define UPLINK_TASK_STACK       4096
+#define UPLINK_TASK_PRIO        2
+
+#define UPLINK_BATCH_VERSION    1
+#define UPLINK_ENCODING_RAW     0       /* uplink_record_t array, older firmware, may still sit in a backlog */
+#define UPLINK_ENCODING_TSC     1       /* One tsc.c block */
+
+/* Every batch starts with this header, all fields little-endian */
+typedef struct
+{
+    uint8_t version;
+    uint8_t encoding;
+    uint16_t count;             /* Samples in the batch */
+    uint32_t seq;               /* Batch number, gaps mean lost batches */
+    int64_t baseTime;           /* Timestamp of the first sample, us */
+}uplink_batch_header_t;
+
+typedef struct
+{
+    int32_t offset;             /* us from baseTime */
+    uint16_t source;
+    uint16_t channel;
+    float value;
+}uplink_record_t;
+
+// Link to the cloud
+// publish() sends one whole batch, returns false when it could not be handed over.
+typedef struct
+{
+    void *ctx;
+    bool (*connected)(void *ctx);
+    bool (*publish)(void *ctx, const uint8_t *data, size_t size);
+}uplink_transport_t;
+
+typedef struct
+{
+    uint32_t batches;           /* Batches closed */
+    uint32_t published;         /* Batches sent live */
+    uint32_t stored;            /* Batches written to the backlog */
+    uint32_t forwarded;         /* Backlog batches sent later */
+    uint32_t overwritten;       /* Backlog batches lost to a full log since boot */
+    uint32_t backlog;           /* Batches waiting in the log */
+    uint32_t dropped;           /* Samples lost to a full ring */
+}uplink_stats_t;
+
+void uplinkInit(const uplink_transport_t *transport, ringlog_t *backlog);
+void uplinkStart(void);
+void uplinkSensorHandler(const sensor_sample_t *samples, uint32_t count, void *ctx);
+void uplinkProcess(int64_t now);
+void uplinkGetStats(uplink_stats_t *stats);
+const uplink_transport_t *uplinkMqttTransport(const char *uri, const char *topic);
+
+#endif // _UPLINK_H_
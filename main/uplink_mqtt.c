@@ -0,0 +1,80 @@
+/**
+********************************************************************************
+* @file         uplink_mqtt.c
+* @brief        MQTT transport for the uplink
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "uplink.h"
+#include "mqtt_client.h"
+#include "esp_idf_version.h"
+#include "esp_log.h"
+#include "connect.h"
+
+static const char *TAG = "Uplink MQTT";
+
+static esp_mqtt_client_handle_t mqttClient = NULL;
+static const char *mqttTopic = NULL;
+static volatile bool mqttConnected = false;
+static bool mqttStarted = false;
+
+static void mqttEventHandler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    switch((esp_mqtt_event_id_t)event_id)
+    {
+        case MQTT_EVENT_CONNECTED:
+            ESP_LOGI(TAG, "Connected");
+            mqttConnected = true;
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            ESP_LOGI(TAG, "Disconnected");
+            mqttConnected = false;
+            break;
+        default:
+            break;
+    }
+}
+
+/* The client is started with the first IP, the network stack is not up before that */
+static bool mqttIsConnected(void *ctx)
+{
+    if(!mqttStarted && connectStatus.isWifiConnected){
+        mqttStarted = (esp_mqtt_client_start(mqttClient) == ESP_OK);
+    }
+    return connectStatus.isWifiConnected && mqttConnected;
+}
+
+/* QoS 1: the client keeps the batch in its outbox until the broker acknowledges it */
+static bool mqttPublish(void *ctx, const uint8_t *data, size_t size)
+{
+    return esp_mqtt_client_publish(mqttClient, mqttTopic, (const char *)data, size, 1, 0) >= 0;
+}
+
+static const uplink_transport_t mqttTransport = {
+    .ctx = NULL,
+    .connected = mqttIsConnected,
+    .publish = mqttPublish,
+};
+
+/* Once started the client keeps reconnecting in the background */
+const uplink_transport_t *uplinkMqttTransport(const char *uri, const char *topic)
+{
+    esp_mqtt_client_config_t config = {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        .broker.address.uri = uri,
+#else
+        .uri = uri,
+#endif
+    };
+
+    mqttTopic = topic;
+    mqttClient = esp_mqtt_client_init(&config);
+    if(mqttClient == NULL){
+        ESP_LOGE(TAG, "Client init failed");
+        return NULL;
+    }
+    esp_mqtt_client_register_event(mqttClient, ESP_EVENT_ANY_ID, mqttEventHandler, NULL);
+    return &mqttTransport;
+}
@@ -0,0 +1,173 @@
+/**
+********************************************************************************
+* @file         widget.c
+* @brief        Retained widget tree with dirty tracking
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#include "widget.h"
+#include <string.h>
+
+/* Screen background behind every widget */
+static void widgetDrawBackground(TFT_t *dev, widget_t *w)
+{
+	lcdDrawFillRect(dev, w->x1, w->y1, w->x2, w->y2, w->bgColor);
+}
+
+/* Center the text along y over the whole screen, like the menu rows always did */
+static void widgetDrawText(TFT_t *dev, widget_t *w, uint16_t color)
+{
+	uint8_t fontWidth;
+	uint8_t fontHeight;
+	uint16_t yPos = 0;
+	size_t textLen = strlen(w->text);
+
+	if(textLen == 0 || !GetFontxMetrics(w->fx, &fontWidth, &fontHeight)){
+		return;
+	}
+	if(dev->_height > textLen * fontWidth){
+		yPos = (dev->_height - textLen * fontWidth) / 2;
+	}
+	lcdDrawString(dev, w->fx, w->textX, yPos, (uint8_t *)w->text, color);
+}
+
+static void widgetDrawLabel(TFT_t *dev, widget_t *w)
+{
+	lcdDrawFillRect(dev, w->x1, w->y1, w->x2, w->y2, w->bgColor);
+	widgetDrawText(dev, w, w->fgColor);
+}
+
+static void widgetDrawSeparator(TFT_t *dev, widget_t *w)
+{
+	lcdDrawLine(dev, w->x1, w->y1, w->x2, w->y2, w->fgColor);
+}
+
+/* Clear the row, then highlight the selected one from textX */
+static void widgetDrawListRow(TFT_t *dev, widget_t *w)
+{
+	lcdDrawFillRect(dev, w->x1, w->y1, w->x2, w->y2, w->bgColor);
+	if(w->selected){
+		lcdDrawFillRect(dev, w->textX, w->y1, w->x2, w->y2 - 4, w->hlColor);
+	}
+	widgetDrawText(dev, w, w->fgColor);
+}
+
+void widgetInit(widget_t *w, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t bgColor)
+{
+	memset(w, 0, sizeof(widget_t));
+	w->x1 = x1;
+	w->y1 = y1;
+	w->x2 = x2;
+	w->y2 = y2;
+	w->bgColor = bgColor;
+	w->visible = true;
+	w->dirty = true;
+	w->draw = widgetDrawBackground;
+}
+
+void widgetLabelInit(widget_t *w, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t textX)
+{
+	widgetInit(w, x1, y1, x2, y2, BG_COLOR);
+	w->fx = fx;
+	w->textX = textX;
+	w->fgColor = TEXT_COLOR;
+	w->draw = widgetDrawLabel;
+}
+
+void widgetSeparatorInit(widget_t *w, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+{
+	widgetInit(w, x1, y1, x2, y2, BG_COLOR);
+	w->fgColor = color;
+	w->draw = widgetDrawSeparator;
+}
+
+void widgetListRowInit(widget_t *w, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t textX)
+{
+	widgetLabelInit(w, fx, x1, y1, x2, y2, textX);
+	w->hlColor = WHITE_SMOKE;
+	w->draw = widgetDrawListRow;
+}
+
+/* Children are painted after their parent, in the order they were added */
+void widgetAddChild(widget_t *parent, widget_t *child)
+{
+	widget_t **link = &parent->child;
+	while(*link != NULL){
+		link = &(*link)->next;
+	}
+	child->next = NULL;
+	*link = child;
+}
+
+void widgetInvalidate(widget_t *w)
+{
+	w->dirty = true;
+}
+
+void widgetSetText(widget_t *w, const char *text)
+{
+	if(strncmp(w->text, text, WIDGET_TEXT_SIZE - 1) != 0){
+		strncpy(w->text, text, WIDGET_TEXT_SIZE - 1);
+		w->text[WIDGET_TEXT_SIZE - 1] = '\0';
+		w->dirty = true;
+	}
+}
+
+void widgetSetColor(widget_t *w, uint16_t fgColor, uint16_t bgColor)
+{
+	if(w->fgColor != fgColor || w->bgColor != bgColor){
+		w->fgColor = fgColor;
+		w->bgColor = bgColor;
+		w->dirty = true;
+	}
+}
+
+void widgetSetSelected(widget_t *w, bool selected)
+{
+	if(w->selected != selected){
+		w->selected = selected;
+		w->dirty = true;
+	}
+}
+
+/* A hidden widget keeps its area cleared to the background color */
+void widgetSetVisible(widget_t *w, bool visible)
+{
+	if(w->visible != visible){
+		w->visible = visible;
+		w->dirty = true;
+	}
+}
+
+static int widgetRenderNode(TFT_t *dev, widget_t *w, bool force)
+{
+	int painted = 0;
+	bool paint = force || w->dirty;
+
+	if(paint){
+		if(w->visible){
+			w->draw(dev, w);
+		}else{
+			widgetDrawBackground(dev, w);
+		}
+		w->dirty = false;
+		painted++;
+	}
+	if(w->visible){
+		for(widget_t *child = w->child; child != NULL; child = child->next){
+			painted += widgetRenderNode(dev, child, paint);
+		}
+	}
+	return painted;
+}
+
+/**
+ * Paint every dirty widget of the tree. A repainted parent repaints its children.
+ * Returns the number of widgets painted.
+ */
+int widgetRender(TFT_t *dev, widget_t *root)
+{
+	return widgetRenderNode(dev, root, false);
+}
@@ -0,0 +1,53 @@
+/**
+********************************************************************************
+* @file         widget.h
+* @brief        Header file for widget.c
+* @since        Created on 2023-10-18
+* @author       Tran Minh Nhat - 2014008
+********************************************************************************
+*/
+
+#ifndef WIDGET_H_
+#define WIDGET_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ili9340.h"
+
+#define WIDGET_TEXT_SIZE    30
+
+/* A node of the retained widget tree */
+typedef struct widget
+{
+	uint16_t x1;                        /* Bounds in screen coordinates, inclusive */
+	uint16_t y1;
+	uint16_t x2;
+	uint16_t y2;
+	bool dirty;                         /* Needs to be painted on the next widgetRender */
+	bool visible;
+	bool selected;                      /* List rows: draw with the highlight color */
+	char text[WIDGET_TEXT_SIZE];
+	uint16_t textX;                     /* Text origin, text is centered along y */
+	uint16_t fgColor;
+	uint16_t bgColor;
+	uint16_t hlColor;
+	FontxFile *fx;
+	void (*draw)(TFT_t *dev, struct widget *w);
+	struct widget *child;
+	struct widget *next;
+}widget_t;
+
+void widgetInit(widget_t *w, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t bgColor);
+void widgetLabelInit(widget_t *w, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t textX);
+void widgetSeparatorInit(widget_t *w, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+void widgetListRowInit(widget_t *w, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t textX);
+void widgetAddChild(widget_t *parent, widget_t *child);
+void widgetInvalidate(widget_t *w);
+void widgetSetText(widget_t *w, const char *text);
+void widgetSetColor(widget_t *w, uint16_t fgColor, uint16_t bgColor);
+void widgetSetSelected(widget_t *w, bool selected);
+void widgetSetVisible(widget_t *w, bool visible);
+int widgetRender(TFT_t *dev, widget_t *root);
+
+#endif /* WIDGET_H_ */
@@ -0,0 +1,244 @@
+/*
+ BMP display: the corpus against its reference pixels, then BMP against PNG display time
+
+ corpus/gen_bmp.py writes the corpus at build time (first argument), with
+ the expected RGB565 pixels of every image. Each is drawn into a 240x320
+ ILI9341 at the origin, into a 100x60 box at 13,7 and into the bottom right
+ corner. Larger images must come out box filtered, the rest of the panel
+ untouched. Broken files must fail with the documented error.
+
+ The timing uses the benchmark pictures of corpus/gen_images.py (second
+ argument) as a 24 bpp BMP and as PNG, against a transport that drops the
+ bytes. Both must leave the same pixels in the simulator.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ili9340.h"
+#include "tft_sim.h"
+#include "decode_bmp.h"
+#include "decode_png.h"
+#include "resample.h"
+#include "check.h"
+
+#define WIDTH	240
+#define HEIGHT	320
+#define ROUNDS	20
+#define BACKGROUND	0x1234
+#define READ_SIZE	1024	// bytes per fread, like reading from SPIFFS
+
+typedef struct {
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+} Box;
+
+static const Box boxes[] = {
+	{ 0, 0, WIDTH, HEIGHT },
+	{ 13, 7, 100, 60 },
+	{ 200, 300, WIDTH, HEIGHT },
+};
+
+static double seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void drop(void *ctx, int mode, const uint8_t *data, size_t size)
+{
+}
+
+// Rounded average of the reference pixels mapping to each panel pixel, per RGB565 field
+static uint16_t *boxFilter(const uint16_t *ref, int w, int h, int width, int height, int *outWidth, int *outHeight)
+{
+	resample_t rs;
+	resampleInit(&rs, w, h, width, height, RESAMPLE_BOX);
+	int dw = rs.dstWidth, dh = rs.dstHeight;
+	uint32_t *sums = calloc(dw * dh * 4, sizeof(uint32_t));
+	uint16_t *out = calloc(dw * dh, sizeof(uint16_t));
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			uint32_t dx = resampleMap(&rs, x), dy = resampleMap(&rs, y);
+			if (dx >= dw || dy >= dh) continue;
+			uint32_t *s = &sums[(dy * dw + dx) * 4];
+			uint16_t p = ref[y * w + x];
+			s[0] += p >> 11;
+			s[1] += (p >> 5) & 0x3F;
+			s[2] += p & 0x1F;
+			s[3]++;
+		}
+	}
+	for (int i = 0; i < dw * dh; i++) {
+		uint32_t *s = &sums[i * 4];
+		uint32_t n = s[3];
+		if (n) out[i] = (((s[0] + n / 2) / n) << 11) | (((s[1] + n / 2) / n) << 5) | ((s[2] + n / 2) / n);
+	}
+	free(sums);
+	resampleFree(&rs);
+	*outWidth = dw;
+	*outHeight = dh;
+	return out;
+}
+
+static void checkCase(TFT_t *dev, TFTSim *sim, const char *dir, const char *name, int w, int h)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s.ref", dir, name);
+	FILE *f = fopen(path, "rb");
+	CHECK(f != NULL);
+	if (f == NULL) return;
+	uint16_t *ref = malloc(w * h * sizeof(uint16_t));
+	CHECK_EQ(fread(ref, sizeof(uint16_t), w * h, f), (size_t)(w * h));
+	fclose(f);
+
+	snprintf(path, sizeof(path), "%s/%s.bmp", dir, name);
+	for (int b = 0; b < sizeof(boxes) / sizeof(boxes[0]); b++) {
+		const Box *box = &boxes[b];
+		int width = (box->x + box->width > WIDTH) ? WIDTH - box->x : box->width;
+		int height = (box->y + box->height > HEIGHT) ? HEIGHT - box->y : box->height;
+		int dw, dh;
+		uint16_t *want = boxFilter(ref, w, h, width, height, &dw, &dh);
+
+		lcdFillScreen(dev, BACKGROUND);
+		uint16_t imageWidth = 0, imageHeight = 0;
+		CHECK_EQ(decode_bmp_draw(dev, path, box->x, box->y, box->width, box->height, &imageWidth, &imageHeight), ESP_OK);
+		CHECK_EQ(imageWidth, dw);
+		CHECK_EQ(imageHeight, dh);
+		int wrong = 0;
+		for (int y = 0; y < HEIGHT; y++) {
+			for (int x = 0; x < WIDTH; x++) {
+				int sx = x - box->x, sy = y - box->y;
+				uint16_t pixel = (sx >= 0 && sy >= 0 && sx < dw && sy < dh) ? want[sy * dw + sx] : BACKGROUND;
+				if (tft_sim_get_pixel(sim, x, y) != pixel) wrong++;
+			}
+		}
+		if (wrong) {
+			printf("%s (%dx%d) at %d,%d: %d pixels differ\n", name, w, h, box->x, box->y, wrong);
+			CHECK(false);
+		}
+		free(want);
+	}
+	free(ref);
+}
+
+static void checkError(TFT_t *dev, const char *dir, const char *name, esp_err_t error)
+{
+	char path[512];
+	uint16_t w, h;
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	CHECK_EQ(decode_bmp_draw(dev, path, 0, 0, WIDTH, HEIGHT, &w, &h), error);
+}
+
+static void pngBand(pngle_t *pngle, uint32_t y, uint32_t lines, pixel_png *pixels)
+{
+	lcdDrawBitmap(pngle_get_user_data(pngle), 0, y, pngle->imageWidth, lines, pixels);
+}
+
+static bool drawPng(TFT_t *dev, const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return false;
+	pngle_t *pngle = pngle_new(dev->_width, dev->_height);
+	pngle_set_init_callback(pngle, png_init);
+	pngle_set_draw_row_callback(pngle, png_draw_row);
+	pngle_set_done_callback(pngle, png_finish);
+	pngle_set_band_callback(pngle, pngBand, PNG_BAND_LINES);
+	pngle_set_user_data(pngle, dev);
+
+	uint8_t buf[READ_SIZE];
+	size_t remain = 0, len;
+	bool ok = true;
+	while (ok && (len = fread(buf + remain, 1, sizeof(buf) - remain, f)) > 0) {
+		int fed = pngle_feed(pngle, buf, remain + len);
+		if (fed < 0) {
+			ok = false;
+			break;
+		}
+		remain = remain + len - fed;
+		if (remain > 0) memmove(buf, buf + fed, remain);
+	}
+	pngle_destroy(pngle, dev->_width, dev->_height);
+	fclose(f);
+	return ok;
+}
+
+static bool draw(TFT_t *dev, bool bmp, const char *dir, const char *image)
+{
+	char path[512];
+	uint16_t w, h;
+	snprintf(path, sizeof(path), "%s/%s.%s", dir, image, bmp ? "bmp" : "png");
+	if (bmp) return decode_bmp_draw(dev, path, 0, 0, dev->_width, dev->_height, &w, &h) == ESP_OK;
+	return drawPng(dev, path);
+}
+
+int main(int argc, char **argv)
+{
+	static const char *images[] = {"photo", "screen", "icon"};
+	static TFTSim sim;
+	static uint16_t reference[WIDTH * HEIGHT];
+	TFT_t simDev, nullDev;
+
+	CHECK(argc == 3);
+	if (argc != 3) return checkResult();
+	const char *corpus = argv[1];
+	const char *dir = argv[2];
+
+	CHECK(tft_sim_init(&sim, WIDTH, HEIGHT, SPI_MASTER_FREQ_40M));
+	TFT_Transport simTransport = { .ctx = &sim, .write = tft_sim_write };
+	lcdAttachTransport(&simDev, &simTransport);
+	lcdInit(&simDev, 0x9341, WIDTH, HEIGHT, 0, 0);
+	TFT_Transport nullTransport = { .ctx = NULL, .write = drop };
+	lcdAttachTransport(&nullDev, &nullTransport);
+	lcdInit(&nullDev, 0x9341, WIDTH, HEIGHT, 0, 0);
+
+	char path[512];
+	snprintf(path, sizeof(path), "%s/cases.txt", corpus);
+	FILE *cases = fopen(path, "r");
+	CHECK(cases != NULL);
+	if (cases == NULL) return checkResult();
+	char name[64];
+	int w, h, count = 0;
+	while (fscanf(cases, "%63s %d %d", name, &w, &h) == 3) {
+		checkCase(&simDev, &sim, corpus, name, w, h);
+		count++;
+	}
+	fclose(cases);
+	CHECK(count >= 16);
+	printf("%d files, %d placements\n", count, count * (int)(sizeof(boxes) / sizeof(boxes[0])));
+
+	checkError(&simDev, corpus, "trunc.bmp", ESP_ERR_INVALID_SIZE);
+	checkError(&simDev, corpus, "bpp8.bmp", ESP_ERR_NOT_SUPPORTED);
+	checkError(&simDev, corpus, "masks.bmp", ESP_ERR_NOT_SUPPORTED);
+	checkError(&simDev, corpus, "missing.bmp", ESP_ERR_NOT_FOUND);
+	uint16_t iw, ih;
+	snprintf(path, sizeof(path), "%s/c0.bmp", corpus);
+	CHECK_EQ(decode_bmp_draw(&simDev, path, WIDTH, 0, WIDTH, HEIGHT, &iw, &ih), ESP_ERR_INVALID_ARG);
+	CHECK_EQ(decode_bmp_draw(&simDev, path, 0, HEIGHT, WIDTH, HEIGHT, &iw, &ih), ESP_ERR_INVALID_ARG);
+
+	printf("%-8s %9s %9s %6s\n", "image", "png ms", "bmp ms", "x");
+	for (int i = 0; i < sizeof(images) / sizeof(images[0]); i++) {
+		double cpu[2];
+		for (int bmp = 0; bmp < 2; bmp++) {
+			lcdFillScreen(&simDev, BLACK);
+			CHECK(draw(&simDev, bmp, dir, images[i]));
+			if (!bmp) {
+				memcpy(reference, sim.gram, sizeof(reference));
+			} else if (memcmp(reference, sim.gram, sizeof(reference)) != 0) {
+				printf("%s: BMP differs from the PNG\n", images[i]);
+				CHECK(false);
+			}
+			double start = seconds();
+			for (int r = 0; r < ROUNDS; r++) draw(&nullDev, bmp, dir, images[i]);
+			cpu[bmp] = (seconds() - start) * 1e3 / ROUNDS;
+		}
+		printf("%-8s %9.3f %9.3f %6.1f\n", images[i], cpu[0], cpu[1], cpu[0] / cpu[1]);
+		CHECK(cpu[1] < cpu[0]);
+	}
+	tft_sim_free(&sim);
+	return checkResult();
+}
@@ -0,0 +1,202 @@
+/*
+ Glyph rendering: bytes and transactions per string, before and after block rendering
+
+ "before" is the per-pixel lcdDrawChar of the original driver, kept here
+ verbatim on top of the public API. "after" is lcdDrawString. Both draw the
+ same 16 character fx16G label into the simulator, for every direction,
+ transparent, filled and underlined, without and with the frame buffer.
+
+ The block path made the fill cover exactly the glyph cell and moved
+ DIRECTION180 glyphs, which sat two rows below their box, into it. So the
+ ink must land on the same pixels except at 180 degrees, where only the
+ amount of ink is compared.
+*/
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "ili9340.h"
+#include "tft_sim.h"
+#include "check.h"
+
+#define WIDTH	240
+#define HEIGHT	320
+
+static const char text[] = "Hello, gateway!!";
+
+// The original lcdDrawChar: one lcdDrawPixel per lit bit
+static int legacyDrawChar(TFT_t * dev, FontxFile *fxs, uint16_t x, uint16_t y, uint8_t ascii, uint16_t color) {
+	uint16_t xx,yy,bit,ofs;
+	unsigned char fonts[128]; // font pattern
+	unsigned char pw, ph;
+	int h,w;
+	uint16_t mask;
+
+	if (!GetFontx(fxs, ascii, fonts, &pw, &ph)) return 0;
+
+	int16_t xd1 = 0, yd1 = 0, xd2 = 0, yd2 = 0;
+	int16_t xss = 0, yss = 0, xsd = 0, ysd = 0;
+	int16_t next = 0;
+	int16_t x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+	if (dev->_font_direction == 0) {
+		xd1 = +1; yd1 = +1;
+		xss = x; yss = y - (ph - 1);
+		xsd = 1;
+		next = x + pw;
+		x0 = x; y0 = y - (ph-1); x1 = x + (pw-1); y1 = y;
+	} else if (dev->_font_direction == 2) {
+		xd1 = -1; yd1 = -1;
+		xss = x; yss = y + ph + 1;
+		xsd = 1;
+		next = x - pw;
+		x0 = x - (pw-1); y0 = y; x1 = x; y1 = y + (ph-1);
+	} else if (dev->_font_direction == 1) {
+		xd2 = -1; yd2 = +1;
+		xss = x + ph; yss = y;
+		ysd = 1;
+		next = y + pw;
+		x0 = x; y0 = y; x1 = x + (ph-1); y1 = y + (pw-1);
+	} else if (dev->_font_direction == 3) {
+		xd2 = +1; yd2 = -1;
+		xss = x - (ph - 1); yss = y;
+		ysd = 1;
+		next = y - pw;
+		x0 = x - (ph-1); y0 = y - (pw-1); x1 = x; y1 = y;
+	}
+
+	if (dev->_font_fill) lcdDrawFillRect(dev, x0, y0, x1, y1, dev->_font_fill_color);
+
+	int bits;
+	ofs = 0;
+	yy = yss;
+	xx = xss;
+	for(h=0;h<ph;h++) {
+		if(xsd) xx = xss;
+		if(ysd) yy = yss;
+		bits = pw;
+		for(w=0;w<((pw+4)/8);w++) {
+			mask = 0x80;
+			for(bit=0;bit<8;bit++) {
+				bits--;
+				if (bits < 0) continue;
+				if (fonts[ofs] & mask) lcdDrawPixel(dev, xx, yy, color);
+				if (h == (ph-2) && dev->_font_underline) lcdDrawPixel(dev, xx, yy, dev->_font_underline_color);
+				if (h == (ph-1) && dev->_font_underline) lcdDrawPixel(dev, xx, yy, dev->_font_underline_color);
+				xx = xx + xd1;
+				yy = yy + yd2;
+				mask = mask >> 1;
+			}
+			ofs++;
+		}
+		yy = yy + yd1;
+		xx = xx + xd2;
+	}
+
+	if (next < 0) next = 0;
+	return next;
+}
+
+// lcdDrawString with the legacy glyph path
+static void legacyDrawString(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, const char * s, uint16_t color) {
+	for(;*s;s++) {
+		int next = legacyDrawChar(dev, fx, x, y, *s, color);
+		if (dev->_font_direction == 0 || dev->_font_direction == 2) x = next;
+		else y = next;
+	}
+}
+
+typedef struct {
+	uint32_t transactions;
+	uint64_t bytes;
+	uint64_t wire_us;
+} Cost;
+
+static FontxFile fx16[2];
+static TFTSim sim;
+static TFT_t dev;
+
+// Origin of the label so that it fits the screen in every direction
+static void origin(uint16_t direction, uint16_t * x, uint16_t * y)
+{
+	static const uint16_t xs[4] = {20, 100, 220, 100};
+	static const uint16_t ys[4] = {100, 20, 100, 300};
+	*x = xs[direction];
+	*y = ys[direction];
+}
+
+// Text and underline pixels: at the same places, or just as many of them
+static bool sameInk(const uint16_t * before, const uint16_t * after, bool samePlaces)
+{
+	int inkBefore = 0, inkAfter = 0;
+	for(int i=0;i<WIDTH*HEIGHT;i++) {
+		bool a = (before[i] == WHITE || before[i] == RED);
+		bool b = (after[i] == WHITE || after[i] == RED);
+		if (samePlaces && a != b) return false;
+		inkBefore += a;
+		inkAfter += b;
+	}
+	return inkBefore > 0 && inkBefore == inkAfter;
+}
+
+static Cost render(bool legacy, uint16_t direction, int style, bool frameBuffer, uint16_t * gram)
+{
+	Cost cost;
+	uint16_t x, y;
+
+	lcdSetFontDirection(&dev, direction);
+	if (style >= 1) lcdSetFontFill(&dev, YELLOW); else lcdUnsetFontFill(&dev);
+	if (style >= 2) lcdSetFontUnderLine(&dev, RED); else lcdUnsetFontUnderLine(&dev);
+	if (frameBuffer) CHECK(lcdEnableFrameBuffer(&dev));
+	lcdFillScreen(&dev, BLACK);
+	lcdFlush(&dev);
+
+	tft_sim_reset_stats(&sim);
+	origin(direction, &x, &y);
+	if (legacy) {
+		legacyDrawString(&dev, fx16, x, y, text, WHITE);
+	} else {
+		lcdDrawString(&dev, fx16, x, y, (uint8_t *)text, WHITE);
+	}
+	lcdFlush(&dev);
+	cost.transactions = sim.transactions;
+	cost.bytes = sim.bytes;
+	cost.wire_us = sim.wire_ns / 1000;
+	memcpy(gram, sim.gram, WIDTH * HEIGHT * 2);
+	if (frameBuffer) lcdDisableFrameBuffer(&dev);
+	return cost;
+}
+
+int main(void)
+{
+	static const char * styles[] = {"transparent", "filled", "underlined"};
+	static uint16_t before[WIDTH * HEIGHT];
+	static uint16_t after[WIDTH * HEIGHT];
+
+	InitFontx(fx16, REPO_ROOT "/font/ILGH16XB.FNT", "");
+	CHECK(tft_sim_init(&sim, WIDTH, HEIGHT, SPI_MASTER_FREQ_40M));
+	sim.overhead_ns = 2000; // queueing a transaction on the ESP32
+	TFT_Transport transport = { .ctx = &sim, .write = tft_sim_write };
+	lcdAttachTransport(&dev, &transport);
+	lcdInit(&dev, 0x9341, WIDTH, HEIGHT, 0, 0);
+
+	printf("\"%s\", fx16G, per string\n", text);
+	printf("%-4s %-12s %-5s %22s %22s\n", "dir", "style", "fb", "before: trans / bytes", "after: trans / bytes");
+	for(int fb=0;fb<2;fb++) {
+		for(uint16_t direction=0;direction<4;direction++) {
+			for(int style=0;style<3;style++) {
+				Cost old = render(true, direction, style, fb, before);
+				Cost now = render(false, direction, style, fb, after);
+				printf("%-4d %-12s %-5s %7" PRIu32 " / %6" PRIu64 " %6" PRIu64 "us %7" PRIu32 " / %6" PRIu64 " %6" PRIu64 "us\n",
+					direction * 90, styles[style], fb ? "yes" : "no",
+					old.transactions, old.bytes, old.wire_us, now.transactions, now.bytes, now.wire_us);
+				CHECK(sameInk(before, after, direction != DIRECTION180));
+				CHECK(now.transactions <= old.transactions);
+				// Opaque text without a frame buffer is where the per-pixel path hurt the most
+				if (style > 0 && !fb) CHECK(now.transactions * 10 < old.transactions);
+			}
+		}
+	}
+	tft_sim_free(&sim);
+	CloseFontx(&fx16[0]);
+	return checkResult();
+}
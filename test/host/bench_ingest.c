@@ -0,0 +1,192 @@
+/*
+ Sensor ingestion: the firmware schedule on a virtual clock, then throughput with threads
+
+ The schedule replays main.c's three synthetic sources (1 ms, 500 us and
+ 5 ms) with producers polled once per 10 ms tick and a drain every 20 ms.
+ Every sample must carry its own due time, one period after the previous
+ one, nothing may be dropped and the published rate must be the sum of the
+ source rates.
+
+ The throughput run gives each source a producer thread polling a 1 us
+ period against the real clock, the main thread drains like the aggregator
+ task. Samples must come out in order with the reads, drops and consumption
+ adding up; the sustained rate must be far above the firmware's 3200/s.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "ingest.h"
+#include "check.h"
+
+#define MS	1000
+#define TICK	(10 * MS)	// CONFIG_FREERTOS_HZ=100
+#define DRAIN	(20 * MS)	// SENSOR_DRAIN_PERIOD
+#define SOURCES	3
+#define RUN_US	(1000 * MS)
+#define MIN_RATE	100000	// samples per second
+
+typedef struct {
+	int64_t last[SENSOR_MAX_SOURCES];
+	uint32_t periodUs[SENSOR_MAX_SOURCES];
+	uint64_t count;
+	int wrongStep;
+	int outOfOrder;
+} Seen;
+
+static int64_t nowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// Every sample one period after the previous one of its source
+static void checkSteps(const sensor_sample_t *samples, uint32_t count, void *ctx)
+{
+	Seen *seen = ctx;
+	for (uint32_t i = 0; i < count; i++) {
+		const sensor_sample_t *s = &samples[i];
+		if (seen->last[s->source] != 0 && s->timestamp - seen->last[s->source] != seen->periodUs[s->source]) seen->wrongStep++;
+		seen->last[s->source] = s->timestamp;
+	}
+	seen->count += count;
+}
+
+// Drops leave gaps, the order must still hold
+static void checkOrder(const sensor_sample_t *samples, uint32_t count, void *ctx)
+{
+	Seen *seen = ctx;
+	for (uint32_t i = 0; i < count; i++) {
+		const sensor_sample_t *s = &samples[i];
+		if (s->timestamp <= seen->last[s->source]) seen->outOfOrder++;
+		seen->last[s->source] = s->timestamp;
+	}
+	seen->count += count;
+}
+
+static void testSchedule(void)
+{
+	static const uint32_t periods[SOURCES] = { 1000, 500, 5000 };
+	static sensor_synth_t synth[SOURCES] = {
+		{ .channels = 4, .offset = 25.0f, .amplitude = 5.0f, .step = 0.01f, .noise = 0x1234 },
+		{ .channels = 2, .offset = 60.0f, .amplitude = 20.0f, .step = 0.002f, .noise = 0x5678 },
+		{ .channels = 1, .offset = -70.0f, .amplitude = 10.0f, .step = 0.05f, .noise = 0x9abc },
+	};
+	static ingest_t ingest;
+	Seen seen = { 0 };
+	sensor_stats_t stats = { 0 };
+	int windows = 0;
+
+	ingestInit(&ingest, checkSteps, &seen);
+	for (int i = 0; i < SOURCES; i++) {
+		CHECK_EQ(ingestAddSource(&ingest, "synth", periods[i], sensorSynthRead, &synth[i]), i);
+		seen.periodUs[i] = periods[i];
+	}
+	// The producer tasks wake at different points of the tick
+	int64_t start = 1000000;
+	for (int64_t now = start; now <= start + 5 * RUN_US; now += MS) {
+		for (int i = 0; i < SOURCES; i++) {
+			if ((now - start) % TICK == i * 3 * MS) ingestPoll(&ingest.sources[i], now);
+		}
+		if ((now - start) % DRAIN == 0) {
+			ingestDrain(&ingest, now);
+			if (ingestWindowDone(&ingest, now)) {
+				ingestPublish(&ingest, now, &stats);
+				windows++;
+			}
+		}
+	}
+	CHECK_EQ(windows, 5);
+	CHECK_EQ(seen.wrongStep, 0);
+	CHECK_EQ(stats.dropped, 0);
+	CHECK_EQ(stats.consumed, seen.count);
+	CHECK(stats.produced - stats.consumed <= SOURCES * SENSOR_RING_SIZE);
+	CHECK_EQ(stats.rate, 1000 + 2000 + 200);
+	// Due times are at most a tick before the poll and a drain before the handler
+	CHECK(stats.latencyMaxUs <= TICK + DRAIN);
+	CHECK(stats.latencyAvgUs < stats.latencyMaxUs);
+	printf("schedule: %llu samples, %u/s, depth %u, latency avg %u us max %u us\n", (unsigned long long)seen.count,
+		stats.rate, stats.depth, stats.latencyAvgUs, stats.latencyMaxUs);
+}
+
+typedef struct {
+	sensor_source_t *src;
+	uint64_t reads;		// Only touched by the producer thread
+	_Atomic int *stop;
+	_Atomic int *wake;
+} Producer;
+
+static bool countRead(sensor_source_t *src, sensor_sample_t *sample)
+{
+	Producer *producer = src->ctx;
+	producer->reads++;
+	sample->value = (float)producer->reads;
+	return true;
+}
+
+static void *producerThread(void *arg)
+{
+	Producer *producer = arg;
+	while (!atomic_load(producer->stop)) {
+		ingestPoll(producer->src, nowUs());
+		// Wake the aggregator early instead of dropping samples
+		if (spscRingCount(&producer->src->ring) >= SENSOR_RING_SIZE / 2) atomic_store(producer->wake, 1);
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void testThroughput(void)
+{
+	static ingest_t ingest;
+	static Producer producers[SOURCES];
+	pthread_t threads[SOURCES];
+	_Atomic int stop = 0, wake = 0;
+	Seen seen = { 0 };
+	sensor_stats_t stats;
+
+	ingestInit(&ingest, checkOrder, &seen);
+	for (int i = 0; i < SOURCES; i++) {
+		ingestAddSource(&ingest, "count", 1, countRead, &producers[i]);
+		producers[i] = (Producer){ &ingest.sources[i], 0, &stop, &wake };
+	}
+	for (int i = 0; i < SOURCES; i++) pthread_create(&threads[i], NULL, producerThread, &producers[i]);
+
+	int64_t start = nowUs(), lastDrain = start, now;
+	while ((now = nowUs()) - start < RUN_US) {
+		if (atomic_exchange(&wake, 0) || now - lastDrain >= MS) {
+			ingestDrain(&ingest, now);
+			lastDrain = now;
+		} else {
+			sched_yield();
+		}
+	}
+	atomic_store(&stop, 1);
+	for (int i = 0; i < SOURCES; i++) pthread_join(threads[i], NULL);
+	now = nowUs();
+	ingestDrain(&ingest, now);
+	ingestPublish(&ingest, now, &stats);
+
+	uint64_t reads = 0;
+	for (int i = 0; i < SOURCES; i++) reads += producers[i].reads;
+	double seconds = (now - start) / 1e6;
+	CHECK_EQ(seen.outOfOrder, 0);
+	CHECK_EQ(stats.consumed, seen.count);
+	CHECK_EQ(stats.produced, stats.consumed);
+	// Readings skipped while too far behind are counted as dropped without a read
+	CHECK(stats.produced + stats.dropped >= reads);
+	CHECK(seen.count / seconds > MIN_RATE);
+	printf("threads: %.0f samples/s consumed, %.1f%% dropped, %llu reads\n", seen.count / seconds,
+		100.0 * stats.dropped / (stats.produced + stats.dropped), (unsigned long long)reads);
+}
+
+int main(void)
+{
+	testSchedule();
+	testThroughput();
+	return checkResult();
+}
@@ -0,0 +1,259 @@
+/*
+ PNG decoding: the row decoder against the per-pixel callback, over test/host/corpus/png
+
+ Every file is decoded with pngle_set_draw_callback (png_draw) and with
+ pngle_set_draw_row_callback (png_draw_row), whole and in row bands, fed in
+ odd chunk sizes. At full size both must give the same RGB565 image. Reduced
+ to a 17x11 screen, plain images must match a box filter over the full size
+ decode, interlaced ones are sampled by both paths alike.
+ Times include inflate, which zlib does here in place of the ROM miniz.
+
+ corpus/gen_png.py regenerates the corpus.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <time.h>
+
+#include "decode_png.h"
+#include "check.h"
+
+#define CORPUS	REPO_ROOT "/test/host/corpus/png"
+#define SCREEN_WIDTH	320
+#define SCREEN_HEIGHT	240
+#define SMALL_WIDTH	17
+#define SMALL_HEIGHT	11
+#define ROUNDS	20
+
+typedef enum {
+	PATH_PIXEL,
+	PATH_ROW,
+	PATH_ROW_BANDS,
+} decode_path_t;
+
+typedef struct {
+	pixel_png *pixels;
+	int width;
+	int height;
+} Image;
+
+static uint8_t *loadFile(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return NULL;
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *data = malloc(*size);
+	if (data != NULL && fread(data, 1, *size, f) != *size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	return data;
+}
+
+static double seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Bands land in the image like lcdDrawBitmap would put them on the panel
+static void bandToImage(pngle_t *pngle, uint32_t y, uint32_t lines, pixel_png *pixels)
+{
+	Image *image = pngle_get_user_data(pngle);
+	memcpy(&image->pixels[y * pngle->imageWidth], pixels, lines * pngle->imageWidth * sizeof(pixel_png));
+}
+
+static void bandDiscard(pngle_t *pngle, uint32_t y, uint32_t lines, pixel_png *pixels)
+{
+}
+
+// Feed in chunk byte pieces, doubling the piece whenever pngle needs more to make progress
+static bool feed(pngle_t *pngle, const uint8_t *data, size_t size, size_t chunk)
+{
+	size_t offset = 0, want = chunk;
+	while (offset < size) {
+		size_t n = (size - offset < want) ? size - offset : want;
+		int eaten = pngle_feed(pngle, data + offset, n);
+		if (eaten < 0) {
+			printf("pngle_feed: %s\n", pngle_error(pngle));
+			return false;
+		}
+		if (eaten == 0) {
+			if (n == size - offset) return false;
+			want *= 2;
+			continue;
+		}
+		offset += eaten;
+		want = chunk;
+	}
+	return true;
+}
+
+static bool decode(const uint8_t *data, size_t size, decode_path_t path, int screenWidth, int screenHeight, size_t chunk, Image *image)
+{
+	pngle_t *pngle = pngle_new(screenWidth, screenHeight);
+	pngle_set_init_callback(pngle, png_init);
+	pngle_set_done_callback(pngle, png_finish);
+	pngle_set_display_gamma(pngle, 2.2);
+	if (path == PATH_PIXEL) {
+		pngle_set_draw_callback(pngle, png_draw);
+	} else {
+		pngle_set_draw_row_callback(pngle, png_draw_row);
+	}
+	// Bands are only known to fit once the header is read, collect them into a screen sized image
+	image->pixels = calloc(screenWidth * screenHeight, sizeof(pixel_png));
+	if (path == PATH_ROW_BANDS) {
+		pngle_set_user_data(pngle, image);
+		pngle_set_band_callback(pngle, bandToImage, 3);
+	}
+	bool ok = feed(pngle, data, size, chunk);
+	image->width = pngle->imageWidth;
+	image->height = pngle->imageHeight;
+	if (ok && path != PATH_ROW_BANDS) {
+		memcpy(image->pixels, pngle->pixels, image->width * image->height * sizeof(pixel_png));
+	}
+	pngle_destroy(pngle, screenWidth, screenHeight);
+	return ok;
+}
+
+static bool sameImage(const Image *a, const Image *b)
+{
+	return a->width == b->width && a->height == b->height &&
+		memcmp(a->pixels, b->pixels, a->width * a->height * sizeof(pixel_png)) == 0;
+}
+
+// Rounded average of the source pixels mapping to each destination pixel, per RGB565 field
+static Image boxFilter(const Image *full, int screenWidth, int screenHeight)
+{
+	resample_t rs;
+	resampleInit(&rs, full->width, full->height, screenWidth, screenHeight, RESAMPLE_NEAREST);
+	Image out = { calloc(rs.dstWidth * rs.dstHeight, sizeof(pixel_png)), rs.dstWidth, rs.dstHeight };
+	uint32_t *sums = calloc(out.width * out.height * 4, sizeof(uint32_t));
+	for (int y = 0; y < full->height; y++) {
+		for (int x = 0; x < full->width; x++) {
+			uint32_t dx = resampleMap(&rs, x), dy = resampleMap(&rs, y);
+			if (dx >= out.width || dy >= out.height) continue;
+			uint32_t *s = &sums[(dy * out.width + dx) * 4];
+			pixel_png p = full->pixels[y * full->width + x];
+			s[0] += p >> 11;
+			s[1] += (p >> 5) & 0x3F;
+			s[2] += p & 0x1F;
+			s[3]++;
+		}
+	}
+	for (int i = 0; i < out.width * out.height; i++) {
+		uint32_t *s = &sums[i * 4];
+		uint32_t n = s[3];
+		if (n) out.pixels[i] = (((s[0] + n / 2) / n) << 11) | (((s[1] + n / 2) / n) << 5) | ((s[2] + n / 2) / n);
+	}
+	free(sums);
+	resampleFree(&rs);
+	return out;
+}
+
+static void checkFile(const char *name, const uint8_t *data, size_t size)
+{
+	Image pixel, row, bands;
+	bool interlaced = strstr(name, "_i1_") != NULL;
+
+	CHECK(decode(data, size, PATH_PIXEL, SCREEN_WIDTH, SCREEN_HEIGHT, 1000, &pixel));
+	CHECK(decode(data, size, PATH_ROW, SCREEN_WIDTH, SCREEN_HEIGHT, 7, &row));
+	CHECK(decode(data, size, PATH_ROW_BANDS, SCREEN_WIDTH, SCREEN_HEIGHT, 333, &bands));
+	if (!sameImage(&pixel, &row) || !sameImage(&pixel, &bands)) {
+		printf("%s: row decoder differs at full size\n", name);
+		CHECK(false);
+	}
+
+	Image smallPixel, smallRow, smallBands;
+	CHECK(decode(data, size, PATH_PIXEL, SMALL_WIDTH, SMALL_HEIGHT, 1000, &smallPixel));
+	CHECK(decode(data, size, PATH_ROW, SMALL_WIDTH, SMALL_HEIGHT, 7, &smallRow));
+	CHECK(decode(data, size, PATH_ROW_BANDS, SMALL_WIDTH, SMALL_HEIGHT, 333, &smallBands));
+	if (interlaced) {
+		// passes arrive out of order, both paths sample
+		if (!sameImage(&smallPixel, &smallRow) || !sameImage(&smallPixel, &smallBands)) {
+			printf("%s: reduced interlaced image differs\n", name);
+			CHECK(false);
+		}
+	} else {
+		Image box = boxFilter(&pixel, SMALL_WIDTH, SMALL_HEIGHT);
+		if (!sameImage(&box, &smallRow) || !sameImage(&box, &smallBands)) {
+			printf("%s: reduced image is not the box filtered one\n", name);
+			CHECK(false);
+		}
+		free(box.pixels);
+	}
+	free(pixel.pixels);
+	free(row.pixels);
+	free(bands.pixels);
+	free(smallPixel.pixels);
+	free(smallRow.pixels);
+	free(smallBands.pixels);
+}
+
+// Mean decode time of a file in ms, streamed into bands as decode_png is used on the panel
+static double timeFile(const uint8_t *data, size_t size, decode_path_t path)
+{
+	double start = seconds();
+	for (int i = 0; i < ROUNDS; i++) {
+		pngle_t *pngle = pngle_new(SCREEN_WIDTH, SCREEN_HEIGHT);
+		pngle_set_init_callback(pngle, png_init);
+		pngle_set_done_callback(pngle, png_finish);
+		if (path == PATH_PIXEL) {
+			pngle_set_draw_callback(pngle, png_draw);
+		} else {
+			pngle_set_draw_row_callback(pngle, png_draw_row);
+		}
+		pngle_set_band_callback(pngle, bandDiscard, PNG_BAND_LINES);
+		pngle_feed(pngle, data, size);
+		pngle_destroy(pngle, SCREEN_WIDTH, SCREEN_HEIGHT);
+	}
+	return (seconds() - start) * 1e3 / ROUNDS;
+}
+
+static int byName(const void *a, const void *b)
+{
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+int main(void)
+{
+	static char *names[512];
+	int count = 0;
+	DIR *dir = opendir(CORPUS);
+	CHECK(dir != NULL);
+	if (dir == NULL) return checkResult();
+	for (struct dirent *entry; (entry = readdir(dir)) != NULL && count < 512;) {
+		if (strstr(entry->d_name, ".png")) names[count++] = strdup(entry->d_name);
+	}
+	closedir(dir);
+	qsort(names, count, sizeof(names[0]), byName);
+	CHECK(count >= 100);
+
+	double totalPixel = 0, totalRow = 0;
+	printf("%-28s %8s %10s %10s\n", "file", "bytes", "pixel ms", "row ms");
+	for (int i = 0; i < count; i++) {
+		char path[512];
+		size_t size;
+		snprintf(path, sizeof(path), "%s/%s", CORPUS, names[i]);
+		uint8_t *data = loadFile(path, &size);
+		CHECK(data != NULL);
+		if (data == NULL) continue;
+
+		checkFile(names[i], data, size);
+		double pixel = timeFile(data, size, PATH_PIXEL);
+		double row = timeFile(data, size, PATH_ROW);
+		totalPixel += pixel;
+		totalRow += row;
+		printf("%-28s %8zu %10.3f %10.3f\n", names[i], size, pixel, row);
+		free(data);
+		free(names[i]);
+	}
+	printf("%d files: pixel %.2f ms, row %.2f ms, x%.1f\n", count, totalPixel, totalRow, totalPixel / totalRow);
+	CHECK(totalRow < totalPixel);
+	return checkResult();
+}
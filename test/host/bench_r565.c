@@ -0,0 +1,184 @@
+/*
+ Display time of R565 images against the same pictures as PNG
+
+ The images are generated at build time by corpus/gen_images.py, the R565
+ files by tools/imgpack.py: a noisy photo, a flat UI screen and an icon.
+ Each is drawn at the origin of a 240x320 ILI9341:
+
+	png	pngle row decoder, bands of PNG_BAND_LINES rows through lcdDrawBitmap
+	r565 raw	raw_draw_file, pixels copied into the staging buffers
+	r565	raw_draw_file with the smallest encoding
+	r565 mem	raw_draw_mem, as from a memory-mapped partition
+
+ Every path must leave the same pixels in the simulator's GRAM. The host CPU
+ time is measured against a transport that drops the bytes, the wire time is
+ the simulator's at 40 MHz. JPEG is not covered: tjpgd is in the ESP32 ROM
+ and not built for the host.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ili9340.h"
+#include "tft_sim.h"
+#include "decode_png.h"
+#include "decode_raw.h"
+#include "check.h"
+
+#define WIDTH	240
+#define HEIGHT	320
+#define ROUNDS	20
+#define READ_SIZE	1024	// bytes per fread, like reading from SPIFFS
+
+typedef enum {
+	DRAW_PNG,
+	DRAW_R565_RAW,
+	DRAW_R565,
+	DRAW_R565_MEM,
+	DRAW_COUNT,
+} draw_t;
+
+static const char *drawNames[DRAW_COUNT] = {"png", "r565 raw", "r565", "r565 mem"};
+
+static double seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint8_t *loadFile(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return NULL;
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *data = malloc(*size);
+	if (data != NULL && fread(data, 1, *size, f) != *size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	return data;
+}
+
+static void drop(void *ctx, int mode, const uint8_t *data, size_t size)
+{
+}
+
+static void pngBand(pngle_t *pngle, uint32_t y, uint32_t lines, pixel_png *pixels)
+{
+	lcdDrawBitmap(pngle_get_user_data(pngle), 0, y, pngle->imageWidth, lines, pixels);
+}
+
+static bool drawPng(TFT_t *dev, const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return false;
+	pngle_t *pngle = pngle_new(dev->_width, dev->_height);
+	pngle_set_init_callback(pngle, png_init);
+	pngle_set_draw_row_callback(pngle, png_draw_row);
+	pngle_set_done_callback(pngle, png_finish);
+	pngle_set_band_callback(pngle, pngBand, PNG_BAND_LINES);
+	pngle_set_user_data(pngle, dev);
+
+	uint8_t buf[READ_SIZE];
+	size_t remain = 0, len;
+	bool ok = true;
+	while (ok && (len = fread(buf + remain, 1, sizeof(buf) - remain, f)) > 0) {
+		int fed = pngle_feed(pngle, buf, remain + len);
+		if (fed < 0) {
+			ok = false;
+			break;
+		}
+		remain = remain + len - fed;
+		if (remain > 0) memmove(buf, buf + fed, remain);
+	}
+	pngle_destroy(pngle, dev->_width, dev->_height);
+	fclose(f);
+	return ok;
+}
+
+static bool draw(TFT_t *dev, draw_t how, const char *dir, const char *image, const uint8_t *mem, size_t memSize)
+{
+	char path[512];
+	uint16_t w, h;
+	switch (how) {
+	case DRAW_PNG:
+		snprintf(path, sizeof(path), "%s/%s.png", dir, image);
+		return drawPng(dev, path);
+	case DRAW_R565_RAW:
+		snprintf(path, sizeof(path), "%s/%s_raw.r565", dir, image);
+		return raw_draw_file(dev, path, 0, 0, &w, &h) == ESP_OK;
+	case DRAW_R565:
+		snprintf(path, sizeof(path), "%s/%s.r565", dir, image);
+		return raw_draw_file(dev, path, 0, 0, &w, &h) == ESP_OK;
+	default:
+		return raw_draw_mem(dev, mem, memSize, 0, 0, &w, &h) == ESP_OK;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const char *images[] = {"photo", "screen", "icon"};
+	static TFTSim sim;
+	static uint16_t reference[WIDTH * HEIGHT];
+	TFT_t simDev, nullDev;
+
+	CHECK(argc == 2);
+	if (argc != 2) return checkResult();
+	const char *dir = argv[1];
+
+	CHECK(tft_sim_init(&sim, WIDTH, HEIGHT, SPI_MASTER_FREQ_40M));
+	sim.overhead_ns = 2000; // queueing a transaction on the ESP32
+	TFT_Transport simTransport = { .ctx = &sim, .write = tft_sim_write };
+	lcdAttachTransport(&simDev, &simTransport);
+	lcdInit(&simDev, 0x9341, WIDTH, HEIGHT, 0, 0);
+	TFT_Transport nullTransport = { .ctx = NULL, .write = drop };
+	lcdAttachTransport(&nullDev, &nullTransport);
+	lcdInit(&nullDev, 0x9341, WIDTH, HEIGHT, 0, 0);
+
+	printf("%-8s %-9s %8s %12s %8s %9s\n", "image", "draw", "bytes", "transactions", "wire ms", "cpu ms");
+	for (int i = 0; i < sizeof(images) / sizeof(images[0]); i++) {
+		char path[512];
+		size_t memSize = 0;
+		snprintf(path, sizeof(path), "%s/%s.r565", dir, images[i]);
+		uint8_t *mem = loadFile(path, &memSize);
+		CHECK(mem != NULL);
+		if (mem == NULL) continue;
+
+		double cpu[DRAW_COUNT];
+		uint64_t pixelBytes[DRAW_COUNT];
+		for (draw_t how = 0; how < DRAW_COUNT; how++) {
+			lcdFillScreen(&simDev, BLACK);
+			tft_sim_reset_stats(&sim);
+			CHECK(draw(&simDev, how, dir, images[i], mem, memSize));
+			pixelBytes[how] = sim.commands[0x2C].bytes;
+			if (how == DRAW_PNG) {
+				memcpy(reference, sim.gram, sizeof(reference));
+			} else if (memcmp(reference, sim.gram, sizeof(reference)) != 0) {
+				printf("%s: %s differs from the PNG\n", images[i], drawNames[how]);
+				CHECK(false);
+			}
+
+			double start = seconds();
+			for (int r = 0; r < ROUNDS; r++) draw(&nullDev, how, dir, images[i], mem, memSize);
+			cpu[how] = (seconds() - start) * 1e3 / ROUNDS;
+			printf("%-8s %-9s %8llu %12u %8.2f %9.3f\n", images[i], drawNames[how],
+				(unsigned long long)sim.bytes, sim.transactions, sim.wire_ns / 1e6, cpu[how]);
+		}
+		// Off the panel is an error, like for the BMP and JPEG decoders
+		uint16_t w, h;
+		CHECK_EQ(raw_draw_mem(&simDev, mem, memSize, WIDTH, 0, &w, &h), ESP_ERR_INVALID_ARG);
+		CHECK_EQ(raw_draw_mem(&simDev, mem, memSize, 0, HEIGHT, &w, &h), ESP_ERR_INVALID_ARG);
+		for (draw_t how = DRAW_R565_RAW; how < DRAW_COUNT; how++) {
+			CHECK_EQ(pixelBytes[how], pixelBytes[DRAW_PNG]);
+			CHECK(cpu[how] < cpu[DRAW_PNG]);
+		}
+		free(mem);
+	}
+	tft_sim_free(&sim);
+	return checkResult();
+}
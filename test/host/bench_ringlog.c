@@ -0,0 +1,126 @@
+/*
+ Backlog flash time: the ring log against the SPIFFS slot file it replaced
+
+ The workload is the uplink's during outages: BACKLOG_SLOTS batches stored,
+ then forwarded and acknowledged one by one, over and over. The SPIFFS
+ side replays the old backlog file (128 slots of header and batch, written
+ in place and cleared on forward) through spiffs_model.c, the ring log
+ runs on the 512 KB telemetry partition. Both stores work on a FlashEmu,
+ the times are its modelled W25Q32JV busy times.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ringlog.h"
+#include "flash_emu.h"
+#include "spiffs_model.h"
+#include "check.h"
+
+#define SPIFFS_SIZE	0xF0000		// storage partition
+#define RINGLOG_SIZE	0x80000		// telemetry partition
+#define BACKLOG_SLOTS	128
+#define SLOT_HEADER	12
+#define SLOT_SIZE	(SLOT_HEADER + 2048)
+#define BATCH_MIN	1200
+#define BATCH_MAX	2024		// UPLINK_BATCH_BYTES
+#define LAPS	8
+
+typedef struct {
+	double storeUs;
+	double forwardUs;
+	uint64_t erases;
+	uint64_t programBytes;
+} Cost;
+
+static uint16_t batchSize(uint32_t n)
+{
+	return BATCH_MIN + (n * 2654435761u >> 16) % (BATCH_MAX - BATCH_MIN + 1);
+}
+
+static void account(FlashEmu *emu, Cost *cost, double *us)
+{
+	*us += emu->busyUs;
+	cost->erases += emu->erases;
+	cost->programBytes += emu->programBytes;
+	flashEmuResetStats(emu);
+}
+
+static Cost runSpiffs(FlashEmu *emu)
+{
+	SpiffsModel model;
+	Cost cost = { 0 };
+
+	CHECK(spiffsModelInit(&model, emu, BACKLOG_SLOTS * SLOT_SIZE));
+	flashEmuResetStats(emu);
+	for (uint32_t lap = 0, n = 0; lap < LAPS; lap++) {
+		for (uint32_t slot = 0; slot < BACKLOG_SLOTS; slot++, n++) {
+			spiffsModelWrite(&model, slot * SLOT_SIZE, SLOT_HEADER + batchSize(n));
+		}
+		account(emu, &cost, &cost.storeUs);
+		for (uint32_t slot = 0; slot < BACKLOG_SLOTS; slot++) {
+			spiffsModelWrite(&model, slot * SLOT_SIZE, 4);	// magic cleared
+		}
+		account(emu, &cost, &cost.forwardUs);
+	}
+	printf("spiffs: %llu garbage collections, %llu pages moved\n", (unsigned long long)model.gcs, (unsigned long long)model.moved);
+	spiffsModelFree(&model);
+	return cost;
+}
+
+static Cost runRinglog(FlashEmu *emu)
+{
+	static ringlog_t log;
+	static uint8_t batch[BATCH_MAX];
+	Cost cost = { 0 };
+	uint16_t size;
+	uint32_t seq;
+
+	CHECK_EQ(ringlogOpen(&log, &emu->ops), ESP_OK);
+	flashEmuResetStats(emu);
+	for (uint32_t lap = 0, n = 0; lap < LAPS; lap++) {
+		for (uint32_t i = 0; i < BACKLOG_SLOTS; i++, n++) {
+			memset(batch, (uint8_t)n, batchSize(n));
+			CHECK_EQ(ringlogAppend(&log, batch, batchSize(n), NULL), ESP_OK);
+		}
+		account(emu, &cost, &cost.storeUs);
+		for (uint32_t i = 0; i < BACKLOG_SLOTS; i++) {
+			CHECK_EQ(ringlogPeek(&log, batch, sizeof(batch), &size, &seq), ESP_OK);
+			CHECK_EQ(ringlogAck(&log, seq), ESP_OK);
+		}
+		account(emu, &cost, &cost.forwardUs);
+	}
+	CHECK_EQ(log.lost, 0);
+	CHECK_EQ(ringlogPending(&log), 0);
+	return cost;
+}
+
+static void report(const char *name, const Cost *cost)
+{
+	uint32_t batches = LAPS * BACKLOG_SLOTS;
+	printf("%-8s %10.2f %12.2f %8llu %12llu\n", name, cost->storeUs / batches / 1000, cost->forwardUs / batches / 1000,
+		(unsigned long long)cost->erases, (unsigned long long)cost->programBytes / 1024);
+}
+
+int main(void)
+{
+	FlashEmu spiffsFlash, ringlogFlash;
+	CHECK(flashEmuOpen(&spiffsFlash, "bench_ringlog_spiffs.flash", SPIFFS_SIZE));
+	CHECK(flashEmuOpen(&ringlogFlash, "bench_ringlog.flash", RINGLOG_SIZE));
+	if (spiffsFlash.file == NULL || ringlogFlash.file == NULL) return checkResult();
+
+	Cost spiffs = runSpiffs(&spiffsFlash);
+	Cost ringlog = runRinglog(&ringlogFlash);
+	printf("%-8s %10s %12s %8s %12s\n", "store", "ms/batch", "ms/forward", "erases", "programmed KB");
+	report("spiffs", &spiffs);
+	report("ringlog", &ringlog);
+	double total = (spiffs.storeUs + spiffs.forwardUs) / (ringlog.storeUs + ringlog.forwardUs);
+	printf("ring log x%.1f faster overall, x%.1f storing\n", total, spiffs.storeUs / ringlog.storeUs);
+	// Erase time dominates both and is about the same per byte stored, the gain is in forwarding
+	CHECK(total > 1.1);
+	CHECK(spiffs.forwardUs > 5 * ringlog.forwardUs);
+
+	flashEmuClose(&spiffsFlash);
+	flashEmuClose(&ringlogFlash);
+	return checkResult();
+}
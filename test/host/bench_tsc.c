@@ -0,0 +1,148 @@
+/*
+ Time-series codec: compression and encode time per sample
+
+ Traces are cut into uplink batches the way uplink.c does: one tsc block
+ per batch, closed when the next sample no longer fits. Every batch must
+ decode to the exact samples that went in. The ratio compares with the raw
+ batches of older firmware, 12 byte records behind the same header.
+
+	synthetic	main.c's three sources through ingest.c on a virtual clock,
+			in the order the aggregator hands them to the uplink
+	trace files	timestamp_us,source,channel,value per line, see
+			corpus/gen_trace.py for the one the build generates
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ingest.h"
+#include "uplink.h"
+#include "check.h"
+
+#define MS	1000
+#define TICK	(10 * MS)
+#define DRAIN	(20 * MS)
+#define SOURCES	3
+#define SYNTH_US	(60 * 1000 * MS)
+#define MAX_SAMPLES	(SYNTH_US / 1000 * 4)	// 3200/s with room
+#define BLOCK_BYTES	(UPLINK_BATCH_BYTES - sizeof(uplink_batch_header_t))
+#define RAW_PER_BATCH	((UPLINK_BATCH_BYTES - sizeof(uplink_batch_header_t)) / sizeof(uplink_record_t))
+#define PASSES	5
+
+typedef struct {
+	sensor_sample_t *samples;
+	uint32_t count;
+} Trace;
+
+static int64_t nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void collect(const sensor_sample_t *samples, uint32_t count, void *ctx)
+{
+	Trace *trace = ctx;
+	if (trace->count + count > MAX_SAMPLES) return;
+	memcpy(&trace->samples[trace->count], samples, count * sizeof(*samples));
+	trace->count += count;
+}
+
+// The firmware schedule of bench_ingest.c, samples stamped with their due time
+static void synthetic(Trace *trace)
+{
+	static const uint32_t periods[SOURCES] = { 1000, 500, 5000 };
+	static sensor_synth_t synth[SOURCES] = {
+		{ .channels = 4, .offset = 25.0f, .amplitude = 5.0f, .step = 0.01f, .noise = 0x1234 },
+		{ .channels = 2, .offset = 60.0f, .amplitude = 20.0f, .step = 0.002f, .noise = 0x5678 },
+		{ .channels = 1, .offset = -70.0f, .amplitude = 10.0f, .step = 0.05f, .noise = 0x9abc },
+	};
+	static ingest_t ingest;
+
+	ingestInit(&ingest, collect, trace);
+	for (int i = 0; i < SOURCES; i++) ingestAddSource(&ingest, "synth", periods[i], sensorSynthRead, &synth[i]);
+	int64_t start = 1000000;
+	for (int64_t now = start; now <= start + SYNTH_US; now += MS) {
+		for (int i = 0; i < SOURCES; i++) {
+			if ((now - start) % TICK == i * 3 * MS) ingestPoll(&ingest.sources[i], now);
+		}
+		if ((now - start) % DRAIN == 0) ingestDrain(&ingest, now);
+	}
+}
+
+static bool load(Trace *trace, const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) return false;
+	long long timestamp;
+	unsigned source, channel;
+	float value;
+	while (trace->count < MAX_SAMPLES && fscanf(f, "%lld,%u,%u,%f", &timestamp, &source, &channel, &value) == 4) {
+		trace->samples[trace->count++] = (sensor_sample_t){ timestamp, source, channel, value };
+	}
+	fclose(f);
+	return trace->count > 0;
+}
+
+// Returns the raw / tsc size ratio
+static double run(const char *name, const Trace *trace)
+{
+	static uint8_t block[BLOCK_BYTES];
+	static tsc_encoder_t enc;
+	static tsc_decoder_t dec;
+	uint64_t tscBytes = 0, batches = 0, mismatches = 0;
+	int64_t encodeNs = 0, decodeNs = 0;
+
+	for (int pass = 0; pass < PASSES; pass++) {
+		for (uint32_t i = 0; i < trace->count; ) {
+			uint32_t first = i;
+			int64_t t0 = nowNs();
+			tscEncoderInit(&enc, block, sizeof(block), trace->samples[i].timestamp);
+			while (i < trace->count && tscEncode(&enc, &trace->samples[i])) i++;
+			int64_t t1 = nowNs();
+			encodeNs += t1 - t0;
+
+			sensor_sample_t out;
+			tscDecoderInit(&dec, block, tscEncodedSize(&enc), enc.count, enc.baseTime);
+			for (uint32_t k = first; k < i; k++) {
+				if (!tscDecode(&dec, &out) || memcmp(&out, &trace->samples[k], sizeof(out)) != 0) mismatches++;
+			}
+			decodeNs += nowNs() - t1;
+			if (tscDecode(&dec, &out)) mismatches++;
+			if (pass == 0) {
+				tscBytes += sizeof(uplink_batch_header_t) + tscEncodedSize(&enc);
+				batches++;
+			}
+		}
+	}
+	CHECK_EQ(mismatches, 0);
+
+	uint64_t rawBatches = (trace->count + RAW_PER_BATCH - 1) / RAW_PER_BATCH;
+	uint64_t rawBytes = rawBatches * sizeof(uplink_batch_header_t) + (uint64_t)trace->count * sizeof(uplink_record_t);
+	double samples = (double)trace->count * PASSES;
+	printf("%-24s %8u %8llu %10.2f %7.1fx %8.1f %8.1f\n", name, trace->count, (unsigned long long)batches,
+		(double)tscBytes / trace->count, (double)rawBytes / tscBytes, encodeNs / samples, decodeNs / samples);
+	return (double)rawBytes / tscBytes;
+}
+
+int main(int argc, char **argv)
+{
+	static sensor_sample_t samples[MAX_SAMPLES];
+	Trace trace = { samples, 0 };
+
+	printf("%-24s %8s %8s %10s %8s %8s %8s\n", "trace", "samples", "batches", "B/sample", "ratio", "enc ns", "dec ns");
+	synthetic(&trace);
+	CHECK(trace.count > SYNTH_US / 1000 * 3);
+	// The synthetic noise reaches into every mantissa, only the timestamps shrink to a bit or two
+	CHECK(run("synthetic", &trace) > 3);
+
+	for (int i = 1; i < argc; i++) {
+		trace.count = 0;
+		CHECK(load(&trace, argv[i]));
+		const char *name = strrchr(argv[i], '/');
+		CHECK(run(name != NULL ? name + 1 : argv[i], &trace) > 4);
+	}
+	return checkResult();
+}
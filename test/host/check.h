@@ -0,0 +1,36 @@
+#ifndef HOST_CHECK_H_
+#define HOST_CHECK_H_
+
+#include <stdio.h>
+
+/*
+ Checks for the host tests
+
+ A failed check is reported with its location and the test goes on, so one
+ run lists every mismatch. main() ends with return checkResult();
+*/
+static int checkFailures;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		checkFailures++; \
+	} \
+} while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+	long long actual_ = (long long)(actual); \
+	long long expected_ = (long long)(expected); \
+	if (actual_ != expected_) { \
+		fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, actual_, expected_); \
+		checkFailures++; \
+	} \
+} while (0)
+
+static inline int checkResult(void)
+{
+	if (checkFailures) fprintf(stderr, "%d check(s) failed\n", checkFailures);
+	return checkFailures ? 1 : 0;
+}
+
+#endif /* HOST_CHECK_H_ */
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Generate the BMP corpus: 16 (RGB555, RGB565 bit fields), 24 and 32 bpp,
+bottom-up and top-down, from 1x1 to wider and taller than the panel.
+
+Rows are padded with 0xAA so a decoder reading the padding shows up, and
+the pixel data starts at an odd offset after a gap. Next to each image,
+<name>.ref holds the expected RGB565 pixels, native endian, top row first.
+cases.txt lists "<name> <width> <height>", the error cases are not in it:
+
+    trunc.bmp   pixel data cut short     ESP_ERR_INVALID_SIZE
+    bpp8.bmp    palette image            ESP_ERR_NOT_SUPPORTED
+    masks.bmp   16 bpp with BGR masks    ESP_ERR_NOT_SUPPORTED
+
+    python3 gen_bmp.py <output directory>
+"""
+import os
+import random
+import struct
+import sys
+
+random.seed(15)
+
+MASKS = {'565': (0xF800, 0x07E0, 0x001F), '555': (0x7C00, 0x03E0, 0x001F), '8888': (0xFF0000, 0xFF00, 0xFF)}
+DEPTH = {'555': 16, '565': 16, '888': 24, '8888': 32}
+
+# width, height, format, top-down, bit fields, DIB header size
+SPECS = [
+    (100, 80, '888', False, False, 40),
+    (101, 80, '888', True, False, 40),
+    (33, 17, '888', False, False, 40),
+    (240, 320, '565', False, True, 40),
+    (239, 311, '565', True, True, 40),
+    (31, 9, '555', False, False, 40),
+    (31, 9, '555', True, True, 40),
+    (64, 64, '8888', False, False, 124),
+    (77, 41, '8888', True, True, 40),
+    (1, 1, '888', False, False, 40),
+    (1, 3, '565', True, True, 40),
+    (480, 200, '888', False, False, 40),
+    (500, 700, '565', True, True, 40),
+    (321, 900, '8888', False, False, 40),
+    (2000, 3, '888', True, False, 40),
+    (250, 321, '555', False, False, 40),
+]
+
+
+def pixels(index, width, height):
+    """Every third image is a smooth gradient, the others noise"""
+    if index % 3 == 0:
+        return [((x * 7) & 255, (y * 5) & 255, ((x + y) * 3) & 255) for y in range(height) for x in range(width)]
+    return [(random.randrange(256), random.randrange(256), random.randrange(256)) for _ in range(width * height)]
+
+
+def rgb565(r, g, b):
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def encode(fmt, r, g, b):
+    """File bytes of a pixel and the RGB565 value the panel gets"""
+    if fmt == '565':
+        v = rgb565(r, g, b)
+        return struct.pack('<H', v), v
+    if fmt == '555':
+        # five green bits widen to six by repeating the top one
+        g5 = g >> 3
+        v = ((r >> 3) << 10) | (g5 << 5) | (b >> 3)
+        return struct.pack('<H', v), ((r >> 3) << 11) | (((g5 << 1) | (g5 >> 4)) << 5) | (b >> 3)
+    if fmt == '888':
+        return bytes((b, g, r)), rgb565(r, g, b)
+    return bytes((b, g, r, random.randrange(256))), rgb565(r, g, b)
+
+
+def bmp(width, height, depth, data, topdown=False, compression=0, masks=b'', header=40, gap=3):
+    dib = struct.pack('<IiiHHIIiiII', header, width, -height if topdown else height, 1, depth,
+                      compression, len(data), 2835, 2835, 0, 0)
+    if header > 40:
+        # v4/v5 headers carry the masks inside
+        dib += masks + bytes(header - 40 - len(masks))
+        masks = b''
+    offset = 14 + len(dib) + len(masks) + gap
+    return b'BM' + struct.pack('<IHHI', offset + len(data), 0, 0, offset) + dib + masks + bytes(gap) + data
+
+
+def write(path, data):
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+def main(out):
+    os.makedirs(out, exist_ok=True)
+    cases = []
+    for i, (width, height, fmt, topdown, bitfields, header) in enumerate(SPECS):
+        depth = DEPTH[fmt]
+        stride = (width * depth + 31) // 32 * 4
+        rows, ref = [], bytearray()
+        source = pixels(i, width, height)
+        for y in range(height):
+            row = bytearray()
+            for r, g, b in source[y * width:(y + 1) * width]:
+                data, value = encode(fmt, r, g, b)
+                row += data
+                ref += struct.pack('=H', value)
+            rows.append(bytes(row) + b'\xAA' * (stride - len(row)))
+        data = b''.join(rows if topdown else rows[::-1])
+        masks = struct.pack('<III', *MASKS[fmt]) if bitfields else b''
+        name = 'c%d' % i
+        write(os.path.join(out, name + '.bmp'), bmp(width, height, depth, data, topdown, 3 if bitfields else 0, masks, header))
+        write(os.path.join(out, name + '.ref'), ref)
+        cases.append('%s %d %d\n' % (name, width, height))
+    write(os.path.join(out, 'cases.txt'), ''.join(cases).encode())
+
+    data = bytes(random.randrange(256) for _ in range(100 * 80 * 3))
+    write(os.path.join(out, 'trunc.bmp'), bmp(100, 80, 24, data)[:5000])
+    write(os.path.join(out, 'bpp8.bmp'), bmp(100, 80, 8, data[:100 * 80]))
+    write(os.path.join(out, 'masks.bmp'), bmp(16, 16, 16, data[:512], compression=3,
+                                              masks=struct.pack('<III', 0x001F, 0x07E0, 0xF800)))
+
+
+if __name__ == '__main__':
+    main(sys.argv[1] if len(sys.argv) > 1 else 'bmp')
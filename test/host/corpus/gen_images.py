@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Generate the display benchmark images: each picture as a PNG, a 24 bpp BMP
+and as R565.
+
+The R565 files come from tools/imgpack.py: raw, and the smallest encoding
+(auto). PNG and BMP pixels are 8-bit, so all decode to the same RGB565 image.
+
+    python3 gen_images.py <output directory>
+"""
+import os
+import random
+import struct
+import sys
+import zlib
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', '..', 'tools'))
+import imgpack  # noqa: E402
+
+random.seed(14)
+
+
+def chunk(kind, data):
+    return struct.pack('>I', len(data)) + kind + data + struct.pack('>I', zlib.crc32(kind + data) & 0xffffffff)
+
+
+def sub_filter(row, bpp):
+    return bytes([1]) + bytes((row[i] - (row[i - bpp] if i >= bpp else 0)) & 255 for i in range(len(row)))
+
+
+def write_png(path, width, height, rows, colour, palette=None):
+    """rows: packed scanlines. RGB rows are Sub filtered, palette rows are not."""
+    bpp = 3 if colour == 2 else 1
+    raw = b''.join(sub_filter(r, bpp) if colour == 2 else b'\0' + r for r in rows)
+    png = b'\x89PNG\r\n\x1a\n' + chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, colour, 0, 0, 0))
+    if palette:
+        png += chunk(b'PLTE', b''.join(bytes(c) for c in palette))
+    png += chunk(b'IDAT', zlib.compress(raw, 9))
+    png += chunk(b'IEND', b'')
+    with open(path, 'wb') as f:
+        f.write(png)
+
+
+def photo(width, height):
+    """Smooth shading with sensor noise, compresses poorly"""
+    pixels = []
+    for y in range(height):
+        for x in range(width):
+            r = (x * 255 // width + random.randrange(24)) & 255
+            g = (y * 255 // height + random.randrange(24)) & 255
+            b = ((x + y) * 128 // (width + height) + 64 + random.randrange(24)) & 255
+            pixels.append((r, g, b))
+    return pixels
+
+
+def screen(width, height):
+    """Flat UI: background, bars and boxes in a handful of colours"""
+    colours = [(255, 255, 255), (0, 0, 0), (0, 128, 0), (245, 245, 245), (255, 0, 0), (0, 0, 255)]
+    boxes = [(0, 0, width, 24, 2), (8, 40, width - 8, 70, 3), (8, 80, width - 8, 110, 3),
+             (8, 120, width - 8, 150, 3), (width // 2 - 20, height - 60, width // 2 + 20, height - 20, 4)]
+    index = []
+    for y in range(height):
+        for x in range(width):
+            c = 0
+            for x0, y0, x1, y1, k in boxes:
+                if x0 <= x < x1 and y0 <= y < y1:
+                    c = k
+            # text like speckle inside the rows
+            if c == 3 and (x // 2 + y // 3) % 7 == 0 and 16 < x < width // 2:
+                c = 1
+            index.append(c)
+    return colours, index
+
+
+def write_bmp(path, width, height, pixels):
+    """Bottom-up BI_RGB, rows padded to 4 bytes"""
+    pad = bytes(-width * 3 % 4)
+    data = b''.join(bytes(v for p in pixels[y * width:(y + 1) * width] for v in p[::-1]) + pad
+                    for y in reversed(range(height)))
+    dib = struct.pack('<IiiHHIIiiII', 40, width, height, 1, 24, 0, len(data), 2835, 2835, 0, 0)
+    with open(path, 'wb') as f:
+        f.write(b'BM' + struct.pack('<IHHI', 54 + len(data), 0, 0, 54) + dib + data)
+
+
+def write_r565(base, width, height, pixels):
+    values = [imgpack.rgb565(*p) for p in pixels]
+    with open(base + '_raw.r565', 'wb') as f:
+        f.write(imgpack.encode(values, width, height, imgpack.ENC_RAW))
+    with open(base + '.r565', 'wb') as f:
+        f.write(imgpack.encode_smallest(values, width, height))
+
+
+def main(out):
+    os.makedirs(out, exist_ok=True)
+
+    width, height = 240, 320
+    pixels = photo(width, height)
+    rows = [bytes(v for p in pixels[y * width:(y + 1) * width] for v in p) for y in range(height)]
+    write_png(os.path.join(out, 'photo.png'), width, height, rows, 2)
+    write_bmp(os.path.join(out, 'photo.bmp'), width, height, pixels)
+    write_r565(os.path.join(out, 'photo'), width, height, pixels)
+
+    colours, index = screen(width, height)
+    rows = [bytes(index[y * width:(y + 1) * width]) for y in range(height)]
+    write_png(os.path.join(out, 'screen.png'), width, height, rows, 3, colours)
+    write_bmp(os.path.join(out, 'screen.bmp'), width, height, [colours[i] for i in index])
+    write_r565(os.path.join(out, 'screen'), width, height, [colours[i] for i in index])
+
+    width, height = 64, 64
+    colours, index = screen(width, height)
+    icon = [colours[i] if (x - 32) ** 2 + (y - 32) ** 2 < 900 else colours[2]
+            for y in range(height) for x, i in zip(range(width), index[y * width:(y + 1) * width])]
+    rows = [bytes(v for p in icon[y * width:(y + 1) * width] for v in p) for y in range(height)]
+    write_png(os.path.join(out, 'icon.png'), width, height, rows, 2)
+    write_bmp(os.path.join(out, 'icon.bmp'), width, height, icon)
+    write_r565(os.path.join(out, 'icon'), width, height, icon)
+
+
+if __name__ == '__main__':
+    main(sys.argv[1] if len(sys.argv) > 1 else 'images')
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Generate the PNG corpus: every colour type and bit depth, plain and
+interlaced, at sizes from 1x1 to 96x64.
+
+Rows use random filter types so every unfilter kernel is exercised. The
+content is a gradient with some noise, so IDAT compresses like a real
+picture. Every fifth file carries a gAMA chunk.
+
+    python3 gen_png.py png
+"""
+import os
+import random
+import struct
+import sys
+import zlib
+
+random.seed(1)
+
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+DEPTHS = {0: [1, 2, 4, 8, 16], 2: [8, 16], 3: [1, 2, 4, 8], 4: [8, 16], 6: [8, 16]}
+SIZES = ((1, 1), (5, 3), (37, 29), (96, 64))
+ADAM7 = [(0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4), (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2)]
+
+
+def chunk(kind, data):
+    return struct.pack('>I', len(data)) + kind + data + struct.pack('>I', zlib.crc32(kind + data) & 0xffffffff)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filter_rows(rows, bpp):
+    out = bytearray()
+    prev = bytes(len(rows[0])) if rows else b''
+    for row in rows:
+        kind = random.randrange(5)
+        out.append(kind)
+        for i, x in enumerate(row):
+            a = row[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i - bpp] if i >= bpp else 0
+            predicted = [0, a, b, (a + b) // 2, paeth(a, b, c)][kind]
+            out.append((x - predicted) & 255)
+        prev = row
+    return bytes(out)
+
+
+def pack(samples, depth):
+    if depth == 8:
+        return bytes(samples)
+    if depth == 16:
+        return b''.join(struct.pack('>H', v) for v in samples)
+    out = bytearray()
+    acc = bits = 0
+    for v in samples:
+        acc = (acc << depth) | v
+        bits += depth
+        if bits == 8:
+            out.append(acc)
+            acc = bits = 0
+    if bits:
+        out.append(acc << (8 - bits))
+    return bytes(out)
+
+
+def sample(x, y, c, w, h, levels):
+    ramp = ((x * 3 + c * 7) / max(w, 1) + (y * 2) / max(h, 1)) / 5.0
+    noise = random.randrange(min(max(levels // 32, 1), 16))
+    return int(ramp * (levels - 1) + noise) % levels
+
+
+def make(path, w, h, colour, depth, interlace, gamma):
+    channels = CHANNELS[colour]
+    levels = min(256, 1 << depth) if colour == 3 else 1 << depth
+    pixels = [[[sample(x, y, c, w, h, levels) for c in range(channels)] for x in range(w)] for y in range(h)]
+    bpp = max(1, channels * depth // 8)
+    raw = b''
+    for ox, oy, dx, dy in (ADAM7 if interlace else [(0, 0, 1, 1)]):
+        rows = []
+        for y in range(oy, h, dy):
+            xs = range(ox, w, dx)
+            if len(xs):
+                rows.append(pack([s for x in xs for s in pixels[y][x]], depth))
+        raw += filter_rows(rows, bpp)
+    png = b'\x89PNG\r\n\x1a\n' + chunk(b'IHDR', struct.pack('>IIBBBBB', w, h, depth, colour, 0, 0, interlace))
+    if gamma:
+        png += chunk(b'gAMA', struct.pack('>I', 45455))
+    if colour == 3:
+        png += chunk(b'PLTE', bytes(random.randrange(256) for _ in range(levels * 3)))
+    compressed = zlib.compress(raw, 9)
+    # several IDAT chunks, as encoders split them
+    for i in range(0, len(compressed), 4096):
+        png += chunk(b'IDAT', compressed[i:i + 4096])
+    png += chunk(b'IEND', b'')
+    with open(path, 'wb') as f:
+        f.write(png)
+
+
+def main(out):
+    os.makedirs(out, exist_ok=True)
+    n = 0
+    for colour, depths in DEPTHS.items():
+        for depth in depths:
+            for interlace in (0, 1):
+                for w, h in SIZES:
+                    name = 't%03d_c%d_d%d_i%d_%dx%d.png' % (n, colour, depth, interlace, w, h)
+                    make(os.path.join(out, name), w, h, colour, depth, interlace, n % 5 == 0)
+                    n += 1
+    print('%d files in %s' % (n, out))
+
+
+if __name__ == '__main__':
+    main(sys.argv[1] if len(sys.argv) > 1 else 'png')
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""Generate the codec benchmark trace: what a gateway logs from real sensors.
+
+No recording from the field is in the tree yet, so this writes one with the
+properties that matter to tsc.c: values at the resolution the drivers
+deliver them, slow drift, and readings now and then missed so the periods
+are not perfect.
+
+    source 0  BME280 every second: temperature 0.01 C, humidity 1/1024 %RH,
+              pressure 0.01 hPa
+    source 1  energy meter every 500 ms: voltage 0.1 V, current 1 mA
+
+One sample per line, time ordered: timestamp_us,source,channel,value
+
+    python3 gen_trace.py <output file>
+"""
+import random
+import struct
+import sys
+
+random.seed(19)
+
+DURATION_US = 3600 * 1000000
+MISSED = 1 / 200
+
+
+def f32(value):
+    return struct.unpack('<f', struct.pack('<f', value))[0]
+
+
+def main():
+    temp, hum, press = 2345, 45 * 1024, 101325
+    volts, amps = 2301, 1520
+    lines = []
+    for t in range(0, DURATION_US, 500000):
+        if t % 1000000 == 0 and random.random() >= MISSED:
+            temp += random.choice((-1, 0, 0, 0, 0, 0, 1))
+            hum += random.randint(-8, 8)
+            press += random.randint(-3, 3)
+            for channel, value in enumerate((temp / 100, hum / 1024, press / 100)):
+                lines.append('%d,0,%d,%.9g' % (t, channel, f32(value)))
+        if random.random() >= MISSED:
+            volts += random.randint(-2, 2)
+            amps = max(0, amps + random.randint(-15, 15) + (600 if random.random() < 0.01 else 0))
+            if amps > 4000:
+                amps -= 2000
+            for channel, value in enumerate((volts / 10, amps / 1000)):
+                lines.append('%d,1,%d,%.9g' % (t + 1000, channel, f32(value)))
+    with open(sys.argv[1], 'w') as out:
+        out.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
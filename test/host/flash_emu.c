@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_emu.h"
+
+// W25Q32JV typical timings, bus at 40 MHz with two data lines
+#define COMMAND_US	2.0		// opcode, address and driver overhead
+#define READ_US_PER_BYTE	0.1
+#define FIRST_BYTE_US	30.0		// tBP1
+#define NEXT_BYTE_US	2.5		// tBP2
+#define ERASE_US	45000.0		// tSE, 4 KB
+#define ERASE_BUDGET	64		// an erase counts as this many bytes of the cut budget
+
+static esp_err_t emuRead(void *ctx, uint32_t offset, void *data, size_t size)
+{
+	FlashEmu *emu = ctx;
+	if (emu->dead) return ESP_FAIL;
+	if (offset + size > emu->size) return ESP_ERR_INVALID_SIZE;
+	fseek(emu->file, offset, SEEK_SET);
+	if (fread(data, 1, size, emu->file) != size) return ESP_FAIL;
+	emu->reads++;
+	emu->readBytes += size;
+	emu->busyUs += COMMAND_US + size * READ_US_PER_BYTE;
+	return ESP_OK;
+}
+
+static esp_err_t emuWrite(void *ctx, uint32_t offset, const void *data, size_t size)
+{
+	FlashEmu *emu = ctx;
+	const uint8_t *in = data;
+	uint8_t page[FLASH_EMU_PAGE];
+
+	if (emu->dead) return ESP_FAIL;
+	if (offset + size > emu->size) return ESP_ERR_INVALID_SIZE;
+	// One page program per 256 byte page touched, like the ESP-IDF flash driver
+	for (size_t done = 0; done < size; ) {
+		uint32_t addr = offset + done;
+		size_t n = FLASH_EMU_PAGE - addr % FLASH_EMU_PAGE;
+		if (n > size - done) n = size - done;
+		size_t programmed = n;
+		bool cut = emu->budget >= 0 && (long)n > emu->budget;
+		if (cut) programmed = emu->budget;
+
+		fseek(emu->file, addr, SEEK_SET);
+		if (fread(page, 1, n, emu->file) != n) return ESP_FAIL;
+		for (size_t i = 0; i < programmed; i++) page[i] &= in[done + i];
+		if (cut) {
+			// The byte being programmed when the power went has some of its bits cleared
+			page[programmed] &= in[done + programmed] | (uint8_t)rand_r(&emu->seed);
+			programmed++;
+		}
+		fseek(emu->file, addr, SEEK_SET);
+		fwrite(page, 1, programmed, emu->file);
+
+		emu->programs++;
+		emu->programBytes += n;
+		emu->busyUs += COMMAND_US + FIRST_BYTE_US + (n - 1) * NEXT_BYTE_US;
+		if (emu->budget >= 0) emu->budget -= n;
+		if (cut) {
+			emu->dead = true;
+			return ESP_FAIL;
+		}
+		done += n;
+	}
+	return ESP_OK;
+}
+
+static esp_err_t emuErase(void *ctx, uint32_t offset, size_t size)
+{
+	FlashEmu *emu = ctx;
+	uint8_t erased[RINGLOG_SECTOR_SIZE];
+
+	if (emu->dead) return ESP_FAIL;
+	if (offset % RINGLOG_SECTOR_SIZE || size % RINGLOG_SECTOR_SIZE || offset + size > emu->size) return ESP_ERR_INVALID_ARG;
+	memset(erased, 0xFF, sizeof(erased));
+	for (size_t done = 0; done < size; done += RINGLOG_SECTOR_SIZE) {
+		fseek(emu->file, offset + done, SEEK_SET);
+		if (emu->budget >= 0 && emu->budget < ERASE_BUDGET) {
+			// Cut during the erase: the sector is partly erased
+			fwrite(erased, 1, rand_r(&emu->seed) % RINGLOG_SECTOR_SIZE, emu->file);
+			emu->dead = true;
+			return ESP_FAIL;
+		}
+		fwrite(erased, 1, RINGLOG_SECTOR_SIZE, emu->file);
+		emu->erases++;
+		emu->busyUs += COMMAND_US + ERASE_US;
+		if (emu->budget >= 0) emu->budget -= ERASE_BUDGET;
+	}
+	return ESP_OK;
+}
+
+bool flashEmuOpen(FlashEmu *emu, const char *path, uint32_t size)
+{
+	static const uint8_t zeros[RINGLOG_SECTOR_SIZE];
+
+	memset(emu, 0, sizeof(*emu));
+	emu->file = fopen(path, "w+b");
+	if (emu->file == NULL) return false;
+	for (uint32_t done = 0; done < size; done += sizeof(zeros)) {
+		fwrite(zeros, 1, sizeof(zeros), emu->file);
+	}
+	emu->size = size;
+	emu->budget = -1;
+	emu->seed = 1;
+	emu->ops = (ringlog_flash_t){ emu, size, emuRead, emuWrite, emuErase };
+	return true;
+}
+
+void flashEmuClose(FlashEmu *emu)
+{
+	if (emu->file != NULL) fclose(emu->file);
+	emu->file = NULL;
+}
+
+void flashEmuCutAfter(FlashEmu *emu, long bytes, unsigned seed)
+{
+	emu->budget = bytes;
+	emu->seed = seed;
+}
+
+void flashEmuPowerOn(FlashEmu *emu)
+{
+	emu->budget = -1;
+	emu->dead = false;
+}
+
+void flashEmuResetStats(FlashEmu *emu)
+{
+	emu->reads = emu->readBytes = 0;
+	emu->programs = emu->programBytes = 0;
+	emu->erases = 0;
+	emu->busyUs = 0;
+}
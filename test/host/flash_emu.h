@@ -0,0 +1,50 @@
+#ifndef HOST_FLASH_EMU_H_
+#define HOST_FLASH_EMU_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ringlog.h"
+
+/*
+ NOR flash in a file, behind the ringlog_flash_t ops
+
+ Writes can only clear bits, erases set 4 KB sectors back to 0xFF. A power
+ cut can be scheduled after a number of programmed bytes: the write in
+ progress stops part way, its last byte half programmed, an erase in
+ progress leaves part of the sector erased. Every access fails from then
+ on until flashEmuPowerOn().
+
+ The busy time of every operation is added up with the typical figures of
+ a W25Q32JV on the ESP32's 40 MHz DIO bus, so different stores can be
+ compared on the same workload.
+*/
+
+#define FLASH_EMU_PAGE	256
+
+typedef struct {
+	FILE *file;
+	uint32_t size;
+	long budget;		// Bytes programmed before the power cut, -1 for none
+	bool dead;
+	unsigned seed;		// rand_r state for the torn byte and erase
+
+	uint64_t reads;
+	uint64_t readBytes;
+	uint64_t programs;	// Page program commands
+	uint64_t programBytes;
+	uint64_t erases;
+	double busyUs;
+
+	ringlog_flash_t ops;
+} FlashEmu;
+
+// Creates or truncates path, filled with zeros like never erased flash
+bool flashEmuOpen(FlashEmu *emu, const char *path, uint32_t size);
+void flashEmuClose(FlashEmu *emu);
+void flashEmuCutAfter(FlashEmu *emu, long bytes, unsigned seed);
+void flashEmuPowerOn(FlashEmu *emu);
+void flashEmuResetStats(FlashEmu *emu);
+
+#endif /* HOST_FLASH_EMU_H_ */
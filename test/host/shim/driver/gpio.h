@@ -0,0 +1,27 @@
+#ifndef SHIM_GPIO_H_
+#define SHIM_GPIO_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define GPIO_FAKE_PINS	64
+
+typedef int gpio_num_t;
+typedef enum {GPIO_MODE_DISABLE, GPIO_MODE_INPUT, GPIO_MODE_OUTPUT} gpio_mode_t;
+typedef enum {GPIO_INTR_DISABLE, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE, GPIO_INTR_ANYEDGE} gpio_int_type_t;
+
+typedef struct {
+	uint64_t pin_bit_mask;
+	gpio_mode_t mode;
+	int pull_up_en;
+	int pull_down_en;
+	gpio_int_type_t intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio);
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+int gpio_get_level(gpio_num_t gpio);
+esp_err_t gpio_config(const gpio_config_t *config);
+
+#endif /* SHIM_GPIO_H_ */
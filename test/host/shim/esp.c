@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+	return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+	return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+	free(ptr);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+	static char name[16];
+	switch (code) {
+	case ESP_OK: return "ESP_OK";
+	case ESP_FAIL: return "ESP_FAIL";
+	case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+	case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+	case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+	case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+	case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+	case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+	case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+	case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+	case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+	default:
+		snprintf(name, sizeof(name), "0x%x", code);
+		return name;
+	}
+}
+
+static bool fakeClock;
+static int64_t fakeNow;
+
+int64_t esp_timer_get_time(void)
+{
+	if (fakeClock) return fakeNow;
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void esp_timer_fake_set(int64_t now)
+{
+	fakeClock = true;
+	fakeNow = now;
+}
+
+void esp_timer_fake_advance(int64_t us)
+{
+	fakeNow += us;
+}
+
+void esp_timer_fake_stop(void)
+{
+	fakeClock = false;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+	return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+	return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+	return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+	return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+	esp_partition_mmap_memory_t memory, const void **out_ptr, esp_partition_mmap_handle_t *out_handle)
+{
+	return ESP_ERR_NOT_FOUND;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+	return ~crc;
+}
@@ -0,0 +1,54 @@
+/*
+ The part of the ROM tjpgd used by decode_jpeg, without the JPEG
+
+ jd_prepare and jd_decomp follow the ROM decoder's contract: the input is
+ read through infunc, the work area holds the decoder state, and the image
+ is handed to outfunc as RGB888 rects in MCU order, 1/2^scale reduced.
+ The stream is not JPEG but the test image format below, so the pixels
+ that reach outfunc are known exactly:
+
+	"TJPG", width and height as little-endian uint16, MCU width and height
+	(8 or 16) as one byte each, then width*height RGB888 pixels row by row
+
+ A reduced pixel is the top left pixel of its 2^scale square.
+*/
+#ifndef SHIM_TJPGD_H_
+#define SHIM_TJPGD_H_
+
+#include <stdint.h>
+
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+
+typedef enum {
+	JDR_OK = 0,	// Succeeded
+	JDR_INTR,	// Interrupted by output function
+	JDR_INP,	// Device error or wrong termination of input stream
+	JDR_MEM1,	// Insufficient memory pool for the image
+	JDR_MEM2,	// Insufficient stream input buffer
+	JDR_PAR,	// Parameter error
+	JDR_FMT1,	// Data format error
+	JDR_FMT2,	// Right format but not supported
+	JDR_FMT3	// Not supported JPEG standard
+} JRESULT;
+
+typedef struct {
+	WORD left, right, top, bottom;
+} JRECT;
+
+typedef struct JDEC JDEC;
+struct JDEC {
+	WORD width, height;	// Size of the input image (pixel)
+	BYTE msx, msy;		// MCU size in unit of block (width, height)
+	BYTE *mcubuf;		// Working buffer for the MCU, in the pool
+	void *pool;		// Pointer to available memory pool
+	UINT sz_pool;		// Size of momory pool (bytes available)
+	UINT (*infunc)(JDEC *, BYTE *, UINT);	// Pointer to jpeg stream input function
+	void *device;		// Pointer to I/O device identifiler for the session
+};
+
+JRESULT jd_prepare(JDEC *jd, UINT (*infunc)(JDEC *, BYTE *, UINT), void *pool, UINT sz_pool, void *dev);
+JRESULT jd_decomp(JDEC *jd, UINT (*outfunc)(JDEC *, void *, JRECT *), BYTE scale);
+
+#endif /* SHIM_TJPGD_H_ */
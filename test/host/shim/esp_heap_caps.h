@@ -0,0 +1,15 @@
+#ifndef SHIM_ESP_HEAP_CAPS_H_
+#define SHIM_ESP_HEAP_CAPS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT	(1<<2)
+#define MALLOC_CAP_DMA	(1<<3)
+#define MALLOC_CAP_INTERNAL	(1<<11)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+
+#endif /* SHIM_ESP_HEAP_CAPS_H_ */
@@ -0,0 +1,8 @@
+#ifndef SHIM_ESP_IDF_VERSION_H_
+#define SHIM_ESP_IDF_VERSION_H_
+
+// The IDF release the firmware is built with
+#define ESP_IDF_VERSION_VAL(major, minor, patch)	(((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION	ESP_IDF_VERSION_VAL(5, 1, 0)
+
+#endif /* SHIM_ESP_IDF_VERSION_H_ */
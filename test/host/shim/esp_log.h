@@ -0,0 +1,13 @@
+#ifndef SHIM_ESP_LOG_H_
+#define SHIM_ESP_LOG_H_
+
+#include <stdio.h>
+
+// Errors and warnings go to stderr, the rest is compiled out but still format checked
+#define ESP_LOGE(tag, fmt, ...)	fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)	fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)	do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, fmt, ...)	do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, fmt, ...)	do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+
+#endif /* SHIM_ESP_LOG_H_ */
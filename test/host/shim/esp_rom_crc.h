@@ -0,0 +1,9 @@
+#ifndef SHIM_ESP_ROM_CRC_H_
+#define SHIM_ESP_ROM_CRC_H_
+
+#include <stdint.h>
+
+// The ROM's little-endian CRC32, the zlib one: esp_rom_crc32_le(0, ...) == crc32(0, ...)
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif /* SHIM_ESP_ROM_CRC_H_ */
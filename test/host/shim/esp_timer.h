@@ -0,0 +1,16 @@
+#ifndef SHIM_ESP_TIMER_H_
+#define SHIM_ESP_TIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Microseconds since start, from CLOCK_MONOTONIC unless a test drives the clock
+int64_t esp_timer_get_time(void);
+
+// Freeze the clock at now, later calls move it; esp_timer_fake_stop goes back to real time
+void esp_timer_fake_set(int64_t now);
+void esp_timer_fake_advance(int64_t us);
+void esp_timer_fake_stop(void);
+
+#endif /* SHIM_ESP_TIMER_H_ */
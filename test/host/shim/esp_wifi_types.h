@@ -0,0 +1,78 @@
+#ifndef SHIM_ESP_WIFI_TYPES_H_
+#define SHIM_ESP_WIFI_TYPES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The station side types, fields in the ESP-IDF order, without the ones nobody here reads
+
+typedef enum {
+	WIFI_AUTH_OPEN = 0,
+	WIFI_AUTH_WEP,
+	WIFI_AUTH_WPA_PSK,
+	WIFI_AUTH_WPA2_PSK,
+	WIFI_AUTH_WPA_WPA2_PSK,
+	WIFI_AUTH_WPA2_ENTERPRISE,
+	WIFI_AUTH_WPA3_PSK,
+	WIFI_AUTH_WPA2_WPA3_PSK,
+	WIFI_AUTH_MAX,
+} wifi_auth_mode_t;
+
+typedef enum {
+	WIFI_REASON_UNSPECIFIED = 1,
+	WIFI_REASON_AUTH_EXPIRE = 2,
+	WIFI_REASON_ASSOC_LEAVE = 8,
+	WIFI_REASON_MIC_FAILURE = 14,
+	WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+	WIFI_REASON_802_1X_AUTH_FAILED = 23,
+	WIFI_REASON_BEACON_TIMEOUT = 200,
+	WIFI_REASON_NO_AP_FOUND = 201,
+	WIFI_REASON_AUTH_FAIL = 202,
+	WIFI_REASON_ASSOC_FAIL = 203,
+	WIFI_REASON_HANDSHAKE_TIMEOUT = 204,
+	WIFI_REASON_CONNECTION_FAIL = 205,
+} wifi_err_reason_t;
+
+typedef enum {
+	WIFI_FAST_SCAN = 0,
+	WIFI_ALL_CHANNEL_SCAN,
+} wifi_scan_method_t;
+
+typedef enum {
+	WIFI_CONNECT_AP_BY_SIGNAL = 0,
+	WIFI_CONNECT_AP_BY_SECURITY,
+} wifi_sort_method_t;
+
+typedef struct {
+	uint8_t bssid[6];
+	uint8_t ssid[33];
+	uint8_t primary;
+	int8_t rssi;
+	wifi_auth_mode_t authmode;
+} wifi_ap_record_t;
+
+typedef struct {
+	uint8_t ssid[32];
+	uint8_t password[64];
+	wifi_scan_method_t scan_method;
+	bool bssid_set;
+	uint8_t bssid[6];
+	uint8_t channel;
+	uint16_t listen_interval;
+	wifi_sort_method_t sort_method;
+} wifi_sta_config_t;
+
+typedef struct {
+	uint8_t ssid[32];
+	uint8_t password[64];
+	uint8_t ssid_len;
+	uint8_t channel;
+	wifi_auth_mode_t authmode;
+} wifi_ap_config_t;
+
+typedef union {
+	wifi_ap_config_t ap;
+	wifi_sta_config_t sta;
+} wifi_config_t;
+
+#endif /* SHIM_ESP_WIFI_TYPES_H_ */
@@ -0,0 +1,59 @@
+#include <time.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+TickType_t xTaskGetTickCount(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (TickType_t)(ts.tv_sec * configTICK_RATE_HZ + ts.tv_nsec / (1000000000 / configTICK_RATE_HZ));
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec ts;
+	ts.tv_sec = ticks / configTICK_RATE_HZ;
+	ts.tv_nsec = (long)(ticks % configTICK_RATE_HZ) * (1000000000 / configTICK_RATE_HZ);
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+	}
+}
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment)
+{
+	TickType_t wake = *previous + increment;
+	TickType_t now = xTaskGetTickCount();
+	if ((int32_t)(wake - now) > 0) vTaskDelay(wake - now);
+	*previous = wake;
+}
+
+struct shim_task {
+	pthread_t thread;
+	TaskFunction_t task;
+	void *parameters;
+};
+
+static void *taskEntry(void *arg)
+{
+	struct shim_task *task = arg;
+	task->task(task->parameters);
+	return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth, void *parameters,
+	UBaseType_t priority, TaskHandle_t *handle)
+{
+	struct shim_task *t = malloc(sizeof(*t));
+	if (t == NULL) return pdFAIL;
+	t->task = task;
+	t->parameters = parameters;
+	if (pthread_create(&t->thread, NULL, taskEntry, t) != 0) {
+		free(t);
+		return pdFAIL;
+	}
+	pthread_detach(t->thread);
+	if (handle != NULL) *handle = t;
+	return pdPASS;
+}
@@ -0,0 +1,45 @@
+/*
+ Host stand-ins for the FreeRTOS and ESP-IDF APIs used by the sources under test
+
+ Only what the host tests link against is declared. Ticks follow the target
+ configuration (CONFIG_FREERTOS_HZ=100), critical sections are pthread mutexes
+ so code shared between threads keeps its locking on the host.
+*/
+#ifndef SHIM_FREERTOS_H_
+#define SHIM_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include "esp_err.h"
+#include "esp_idf_version.h"
+
+#define configTICK_RATE_HZ	100
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE	1
+#define pdFALSE	0
+#define pdPASS	pdTRUE
+#define pdFAIL	pdFALSE
+#define portMAX_DELAY	((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS	((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)	((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define IRAM_ATTR
+
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED	PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux)	pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)	pthread_mutex_unlock(mux)
+#define portENTER_CRITICAL_ISR(mux)	pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL_ISR(mux)	pthread_mutex_unlock(mux)
+#define portYIELD_FROM_ISR(...)
+
+typedef struct shim_task * TaskHandle_t;
+
+#endif /* SHIM_FREERTOS_H_ */
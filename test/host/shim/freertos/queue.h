@@ -0,0 +1,9 @@
+#ifndef SHIM_QUEUE_H_
+#define SHIM_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+// Declared for headers that carry a queue handle, no queue is implemented
+typedef struct shim_queue * QueueHandle_t;
+
+#endif /* SHIM_QUEUE_H_ */
@@ -0,0 +1,16 @@
+#ifndef SHIM_TASK_H_
+#define SHIM_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+// vTaskDelay really sleeps, the tick count is derived from CLOCK_MONOTONIC
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment);
+TickType_t xTaskGetTickCount(void);
+
+// Tasks are detached threads, stack size and priority are ignored
+typedef void (*TaskFunction_t)(void *);
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth, void *parameters,
+	UBaseType_t priority, TaskHandle_t *handle);
+
+#endif /* SHIM_TASK_H_ */
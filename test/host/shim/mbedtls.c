@@ -0,0 +1,19 @@
+#include <openssl/evp.h>
+#include "mbedtls/pkcs5.h"
+
+#define MBEDTLS_ERR_MD_BAD_INPUT_DATA	-0x5100
+
+unsigned mbedtlsPbkdf2Runs;
+
+// PBKDF2 through OpenSSL
+int mbedtls_pkcs5_pbkdf2_hmac_ext(mbedtls_md_type_t md_type, const unsigned char *password, size_t plen,
+	const unsigned char *salt, size_t slen, unsigned int iteration_count, uint32_t key_length, unsigned char *output)
+{
+	const EVP_MD *md = (md_type == MBEDTLS_MD_SHA1) ? EVP_sha1() : (md_type == MBEDTLS_MD_SHA256) ? EVP_sha256() : NULL;
+	if (md == NULL) return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+	mbedtlsPbkdf2Runs++;
+	if (PKCS5_PBKDF2_HMAC((const char *)password, plen, salt, slen, iteration_count, md, key_length, output) != 1) {
+		return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+	}
+	return 0;
+}
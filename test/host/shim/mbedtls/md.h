@@ -0,0 +1,10 @@
+#ifndef SHIM_MBEDTLS_MD_H_
+#define SHIM_MBEDTLS_MD_H_
+
+typedef enum {
+	MBEDTLS_MD_NONE = 0,
+	MBEDTLS_MD_SHA1 = 4,
+	MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+#endif /* SHIM_MBEDTLS_MD_H_ */
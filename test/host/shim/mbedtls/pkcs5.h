@@ -0,0 +1,14 @@
+#ifndef SHIM_MBEDTLS_PKCS5_H_
+#define SHIM_MBEDTLS_PKCS5_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbedtls/md.h"
+
+int mbedtls_pkcs5_pbkdf2_hmac_ext(mbedtls_md_type_t md_type, const unsigned char *password, size_t plen,
+	const unsigned char *salt, size_t slen, unsigned int iteration_count, uint32_t key_length, unsigned char *output);
+
+// Host only: derivations so far, 4096 rounds each on the target
+extern unsigned mbedtlsPbkdf2Runs;
+
+#endif /* SHIM_MBEDTLS_PKCS5_H_ */
@@ -0,0 +1,7 @@
+#ifndef SHIM_MBEDTLS_VERSION_H_
+#define SHIM_MBEDTLS_VERSION_H_
+
+// The mbedtls 3 API of ESP-IDF 5, the little used here runs on OpenSSL, see mbedtls.c
+#define MBEDTLS_VERSION_NUMBER	0x03000000
+
+#endif /* SHIM_MBEDTLS_VERSION_H_ */
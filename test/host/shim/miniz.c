@@ -0,0 +1,60 @@
+#include <string.h>
+#include "miniz.h"
+
+static voidpf arenaAlloc(voidpf opaque, uInt items, uInt size)
+{
+	tinfl_decompressor *r = opaque;
+	size_t bytes = ((size_t)items * size + 15) & ~(size_t)15;
+	if (r->used + bytes > sizeof(r->arena)) return Z_NULL;
+	voidpf p = &r->arena[r->used];
+	r->used += bytes;
+	return p;
+}
+
+static void arenaFree(voidpf opaque, voidpf address)
+{
+	(void)opaque;
+	(void)address;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+	mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size, const mz_uint32 decomp_flags)
+{
+	(void)pOut_buf_start;
+	if (r->m_state == 0) {
+		memset(&r->stream, 0, sizeof(r->stream));
+		r->used = 0;
+		r->stream.zalloc = arenaAlloc;
+		r->stream.zfree = arenaFree;
+		r->stream.opaque = r;
+		int windowBits = (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? MAX_WBITS : -MAX_WBITS;
+		if (inflateInit2(&r->stream, windowBits) != Z_OK) return TINFL_STATUS_FAILED;
+		r->m_state = 1;
+	}
+	if (r->m_state == 2) {
+		// anything after the end of the stream is ignored
+		*pOut_buf_size = 0;
+		return TINFL_STATUS_DONE;
+	}
+
+	r->stream.next_in = (Bytef *)pIn_buf_next;
+	r->stream.avail_in = *pIn_buf_size;
+	r->stream.next_out = pOut_buf_next;
+	r->stream.avail_out = *pOut_buf_size;
+	int rc = inflate(&r->stream, Z_NO_FLUSH);
+	*pIn_buf_size -= r->stream.avail_in;
+	*pOut_buf_size -= r->stream.avail_out;
+
+	if (rc == Z_STREAM_END) {
+		r->m_state = 2;
+		return TINFL_STATUS_DONE;
+	}
+	if (rc != Z_OK && rc != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+	if (r->stream.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+	return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+mz_ulong mz_crc32(mz_ulong crc, const unsigned char *ptr, size_t buf_len)
+{
+	return crc32(crc, ptr, buf_len);
+}
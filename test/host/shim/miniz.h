@@ -0,0 +1,48 @@
+/*
+ The part of the ROM miniz used by pngle, on top of zlib
+
+ tinfl_decompress writes into the caller's 32 KB dictionary buffer like the
+ ROM inflater. zlib keeps its own window, allocated from the arena inside
+ the decompressor, so a pngle_t that is freed mid-stream leaks nothing.
+*/
+#ifndef SHIM_MINIZ_H_
+#define SHIM_MINIZ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+typedef unsigned long mz_ulong;
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+typedef unsigned int mz_uint;
+
+#define TINFL_LZ_DICT_SIZE	32768
+#define TINFL_ARENA_SIZE	(48 * 1024)	// inflate state and its 32 KB window
+
+typedef struct {
+	int m_state;
+	z_stream stream;
+	size_t used;
+	uint8_t arena[TINFL_ARENA_SIZE];
+} tinfl_decompressor;
+
+typedef enum {
+	TINFL_STATUS_FAILED = -1,
+	TINFL_STATUS_DONE = 0,
+	TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+	TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+#define TINFL_FLAG_PARSE_ZLIB_HEADER	1
+#define TINFL_FLAG_HAS_MORE_INPUT	2
+
+#define tinfl_init(r)	do { (r)->m_state = 0; } while (0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+	mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size, const mz_uint32 decomp_flags);
+
+#define MZ_CRC32_INIT	0
+mz_ulong mz_crc32(mz_ulong crc, const unsigned char *ptr, size_t buf_len);
+
+#endif /* SHIM_MINIZ_H_ */
@@ -0,0 +1,128 @@
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "spi_fake.h"
+
+#define SPI_FAKE_DEVICES	4
+#define SPI_FAKE_QUEUE	64
+
+struct spi_device_t {
+	spi_device_interface_config_t config;
+	spi_transaction_t *queue[SPI_FAKE_QUEUE]; // submitted, result not fetched
+	uint32_t head;
+	uint32_t tail;
+	uint32_t sent; // transfers of the queue already on the bus
+};
+
+spi_fake_t spi_fake = { .dc_gpio = -1 };
+
+static struct spi_device_t devices[SPI_FAKE_DEVICES];
+static int ndevices;
+static uint8_t levels[GPIO_FAKE_PINS];
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio) { return ESP_OK; }
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode) { return ESP_OK; }
+esp_err_t gpio_config(const gpio_config_t *config) { return ESP_OK; }
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+	if (gpio < 0 || gpio >= GPIO_FAKE_PINS) return ESP_ERR_INVALID_ARG;
+	levels[gpio] = level ? 1 : 0;
+	return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+	if (gpio < 0 || gpio >= GPIO_FAKE_PINS) return 0;
+	return levels[gpio];
+}
+
+void spi_fake_reset_stats(void)
+{
+	spi_fake.transactions = 0;
+	spi_fake.data_transactions = 0;
+	spi_fake.bytes = 0;
+	spi_fake.data_bytes = 0;
+	spi_fake.in_flight_max = spi_fake.in_flight;
+}
+
+void spi_fake_reset(void)
+{
+	uint32_t in_flight = spi_fake.in_flight;
+	memset(&spi_fake, 0, sizeof(spi_fake));
+	spi_fake.dc_gpio = -1;
+	spi_fake.in_flight = in_flight;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, spi_dma_chan_t dma)
+{
+	return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config, spi_device_handle_t *handle)
+{
+	if (ndevices == SPI_FAKE_DEVICES) return ESP_ERR_NO_MEM;
+	struct spi_device_t *dev = &devices[ndevices++];
+	memset(dev, 0, sizeof(*dev));
+	dev->config = *config;
+	*handle = dev;
+	return ESP_OK;
+}
+
+// Put one transfer on the bus
+static void spi_fake_send(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+	size_t size = trans->length / 8;
+	const uint8_t *data = (trans->flags & SPI_TRANS_USE_TXDATA) ? trans->tx_data : trans->tx_buffer;
+
+	if (handle->config.pre_cb) handle->config.pre_cb(trans);
+	int mode = (spi_fake.dc_gpio < 0) ? 1 : gpio_get_level(spi_fake.dc_gpio);
+	spi_fake.transactions++;
+	spi_fake.bytes += size;
+	if (mode) {
+		spi_fake.data_transactions++;
+		spi_fake.data_bytes += size;
+	}
+	if (spi_fake.sink) spi_fake.sink(spi_fake.ctx, mode, data, size);
+	if (handle->config.post_cb) handle->config.post_cb(trans);
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t wait)
+{
+	if (handle->head - handle->tail >= (uint32_t)handle->config.queue_size) return ESP_ERR_TIMEOUT;
+	handle->queue[handle->head++ % SPI_FAKE_QUEUE] = trans;
+	spi_fake.in_flight++;
+	if (spi_fake.in_flight > spi_fake.in_flight_max) spi_fake.in_flight_max = spi_fake.in_flight;
+	if (!spi_fake.defer) {
+		spi_fake_send(handle, trans);
+		handle->sent++;
+	}
+	return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t wait)
+{
+	if (handle->head == handle->tail) return ESP_ERR_TIMEOUT;
+	spi_transaction_t *t = handle->queue[handle->tail++ % SPI_FAKE_QUEUE];
+	if (handle->sent) {
+		handle->sent--;
+	} else {
+		spi_fake_send(handle, t);
+	}
+	spi_fake.in_flight--;
+	*trans = t;
+	return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+	if (handle->head != handle->tail) return ESP_ERR_INVALID_STATE;
+	spi_fake_send(handle, trans);
+	return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+	return spi_device_transmit(handle, trans);
+}
@@ -0,0 +1,39 @@
+#ifndef SHIM_SPI_FAKE_H_
+#define SHIM_SPI_FAKE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ Fake SPI bus behind driver/spi_master.h
+
+ Transfers go on the bus in submission order: the device pre_cb runs, D/C is
+ sampled from dc_gpio the way the panel samples it, then the bytes are counted
+ and handed to sink. Queued transfers normally go on the bus right away. With
+ defer set they only go when their result is fetched, so memory a queued
+ transfer points at is read as late as the real DMA could read it.
+ Only change defer while nothing is in flight. A transfer that exceeds the
+ device queue_size, or a blocking transmit while transfers are still queued,
+ fails the way the ESP driver would.
+*/
+typedef struct {
+	int dc_gpio; // -1 counts everything as data
+	bool defer;
+	void *ctx;
+	void (*sink)(void *ctx, int mode, const uint8_t *data, size_t size); // same signature as TFT_Transport write
+
+	uint32_t transactions;
+	uint32_t data_transactions;
+	uint64_t bytes;
+	uint64_t data_bytes;
+	uint32_t in_flight; // queued and not fetched yet
+	uint32_t in_flight_max;
+} spi_fake_t;
+
+extern spi_fake_t spi_fake;
+
+void spi_fake_reset(void); // clears counters and settings, keeps registered devices
+void spi_fake_reset_stats(void);
+
+#endif /* SHIM_SPI_FAKE_H_ */
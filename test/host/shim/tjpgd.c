@@ -0,0 +1,73 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp32/rom/tjpgd.h"
+
+#define HEADER_SIZE	10
+
+JRESULT jd_prepare(JDEC *jd, UINT (*infunc)(JDEC *, BYTE *, UINT), void *pool, UINT sz_pool, void *dev)
+{
+	BYTE header[HEADER_SIZE];
+
+	if (pool == NULL) return JDR_PAR;
+	jd->pool = pool;
+	jd->sz_pool = sz_pool;
+	jd->infunc = infunc;
+	jd->device = dev;
+
+	if (infunc(jd, header, HEADER_SIZE) != HEADER_SIZE) return JDR_INP;
+	if (memcmp(header, "TJPG", 4) != 0) return JDR_FMT1;
+	jd->width = header[4] | (header[5] << 8);
+	jd->height = header[6] | (header[7] << 8);
+	if (jd->width == 0 || jd->height == 0) return JDR_FMT1;
+	if ((header[8] != 8 && header[8] != 16) || (header[9] != 8 && header[9] != 16)) return JDR_FMT3;
+	jd->msx = header[8] / 8;
+	jd->msy = header[9] / 8;
+
+	// One MCU of RGB888 out of the pool, like the ROM decoder's workbuf
+	if ((UINT)jd->msx * 8 * jd->msy * 8 * 3 > sz_pool) return JDR_MEM1;
+	jd->mcubuf = pool;
+	return JDR_OK;
+}
+
+JRESULT jd_decomp(JDEC *jd, UINT (*outfunc)(JDEC *, void *, JRECT *), BYTE scale)
+{
+	if (scale > 3) return JDR_PAR;
+	UINT mx = jd->msx * 8, my = jd->msy * 8;
+	UINT stride = jd->width * 3;
+	JRESULT rc = JDR_OK;
+
+	// The rows are stored in order, so a whole row of MCUs is read at once.
+	// The ROM decoder needs no such band, the MCU order it emits is the same.
+	BYTE *band = malloc(my * stride);
+	if (band == NULL) return JDR_MEM1;
+
+	for (UINT y = 0; y < jd->height && rc == JDR_OK; y += my) {
+		UINT rows = (y + my <= jd->height) ? my : jd->height - y;
+		if (jd->infunc(jd, band, rows * stride) != rows * stride) {
+			rc = JDR_INP;
+			break;
+		}
+		for (UINT x = 0; x < jd->width; x += mx) {
+			// A partial MCU keeps only the whole reduced pixels, like the ROM decoder
+			UINT cols = ((x + mx <= jd->width) ? mx : jd->width - x) >> scale;
+			if (cols == 0 || (rows >> scale) == 0) continue;
+			JRECT rect = {
+				.left = x >> scale, .right = (x >> scale) + cols - 1,
+				.top = y >> scale, .bottom = (y >> scale) + (rows >> scale) - 1,
+			};
+			BYTE *out = jd->mcubuf;
+			for (UINT sy = rect.top; sy <= rect.bottom; sy++) {
+				for (UINT sx = rect.left; sx <= rect.right; sx++) {
+					memcpy(out, &band[((sy << scale) - y) * stride + (sx << scale) * 3], 3);
+					out += 3;
+				}
+			}
+			if (!outfunc(jd, jd->mcubuf, &rect)) {
+				rc = JDR_INTR;
+				break;
+			}
+		}
+	}
+	free(band);
+	return rc;
+}
@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "spiffs_model.h"
+
+#define BLOCK_SIZE	RINGLOG_SECTOR_SIZE
+#define PAGE_SIZE	FLASH_EMU_PAGE
+#define PAGES_PER_BLOCK	(BLOCK_SIZE / PAGE_SIZE)
+#define PAGE_HEADER	5		// object id, span index, flags
+#define PAGE_DATA	(PAGE_SIZE - PAGE_HEADER)
+#define HEADER_ENTRIES	106		// data pages listed by the index header, after size, type and name
+#define INDEX_ENTRIES	124		// data pages listed by every further index page
+#define GC_RESERVE	(2 * (PAGES_PER_BLOCK - 1))
+
+enum {
+	PAGE_FREE,
+	PAGE_USED,
+	PAGE_DELETED,
+};
+
+static uint32_t pageAddr(uint32_t page)
+{
+	return (page / PAGES_PER_BLOCK) * BLOCK_SIZE + (page % PAGES_PER_BLOCK) * PAGE_SIZE;
+}
+
+static uint32_t lookupAddr(uint32_t page)
+{
+	return (page / PAGES_PER_BLOCK) * BLOCK_SIZE + (page % PAGES_PER_BLOCK - 1) * 2;
+}
+
+// Index page listing a data page
+static uint32_t indexOf(const SpiffsModel *model, uint32_t span)
+{
+	uint32_t index = (span < HEADER_ENTRIES) ? 0 : 1 + (span - HEADER_ENTRIES) / INDEX_ENTRIES;
+	return model->dataPages + index;
+}
+
+static void program(SpiffsModel *model, uint32_t page, int32_t logical)
+{
+	static uint8_t data[PAGE_SIZE];
+	uint16_t id = (uint16_t)(logical + 1);
+	const ringlog_flash_t *ops = &model->flash->ops;
+
+	ops->write(ops->ctx, lookupAddr(page), &id, 2);
+	ops->write(ops->ctx, pageAddr(page), data, PAGE_HEADER);
+	ops->write(ops->ctx, pageAddr(page) + PAGE_HEADER, data, PAGE_DATA);
+	ops->write(ops->ctx, pageAddr(page) + PAGE_HEADER - 1, data, 1);	// finalized
+	model->state[page] = PAGE_USED;
+	model->owner[page] = logical;
+	model->where[logical] = page;
+	model->freePages--;
+}
+
+static void delete(SpiffsModel *model, uint32_t page)
+{
+	static const uint8_t zeros[2];
+	const ringlog_flash_t *ops = &model->flash->ops;
+
+	ops->write(ops->ctx, pageAddr(page) + PAGE_HEADER - 1, zeros, 1);
+	ops->write(ops->ctx, lookupAddr(page), zeros, 2);
+	model->state[page] = PAGE_DELETED;
+	model->owner[page] = -1;
+}
+
+// Next free page from the cursor, reading the lookup page of every block looked at
+static uint32_t findFree(SpiffsModel *model)
+{
+	uint8_t lookup[2 * (PAGES_PER_BLOCK - 1)];
+	const ringlog_flash_t *ops = &model->flash->ops;
+	uint32_t pages = model->blocks * PAGES_PER_BLOCK;
+	uint32_t page = model->freeCursor;
+
+	for (uint32_t i = 0; i < pages; i++, page = (page + 1) % pages) {
+		if (page % PAGES_PER_BLOCK == 0 || i == 0) {
+			ops->read(ops->ctx, lookupAddr(page - page % PAGES_PER_BLOCK + 1), lookup, sizeof(lookup));
+		}
+		if (page % PAGES_PER_BLOCK != 0 && model->state[page] == PAGE_FREE && (int32_t)(page / PAGES_PER_BLOCK) != model->gcBlock) {
+			model->freeCursor = page;
+			return page;
+		}
+	}
+	return 0;
+}
+
+static void collect(SpiffsModel *model);
+
+// Copy on write of a logical page: read it, write it elsewhere, delete the old copy
+static void rewrite(SpiffsModel *model, int32_t logical, bool collecting)
+{
+	uint8_t old[PAGE_SIZE];
+	const ringlog_flash_t *ops = &model->flash->ops;
+
+	if (!collecting && model->freePages <= GC_RESERVE) collect(model);
+	int32_t from = model->where[logical];
+	if (from >= 0) ops->read(ops->ctx, pageAddr(from), old, sizeof(old));
+	program(model, findFree(model), logical);
+	if (from >= 0) delete(model, from);
+}
+
+// Empty the block with most deleted pages, moving its live pages out
+static void collect(SpiffsModel *model)
+{
+	static const uint8_t magic[2];
+	const ringlog_flash_t *ops = &model->flash->ops;
+	uint32_t best = 0, bestDeleted = 0;
+
+	for (uint32_t b = 0; b < model->blocks; b++) {
+		uint32_t deleted = 0;
+		for (uint32_t k = 1; k < PAGES_PER_BLOCK; k++) {
+			if (model->state[b * PAGES_PER_BLOCK + k] == PAGE_DELETED) deleted++;
+		}
+		if (deleted > bestDeleted) {
+			best = b;
+			bestDeleted = deleted;
+		}
+	}
+	if (bestDeleted == 0) return;
+
+	// Keep the cursor out of the block being erased
+	if (model->freeCursor / PAGES_PER_BLOCK == best) {
+		model->freeCursor = ((best + 1) % model->blocks) * PAGES_PER_BLOCK;
+	}
+	model->gcBlock = best;
+	bool *dirty = calloc(model->indexPages, sizeof(bool));
+	for (uint32_t k = 1; k < PAGES_PER_BLOCK; k++) {
+		uint32_t page = best * PAGES_PER_BLOCK + k;
+		if (model->state[page] != PAGE_USED) continue;
+		int32_t logical = model->owner[page];
+		rewrite(model, logical, true);
+		if (logical < model->dataPages) dirty[indexOf(model, logical) - model->dataPages] = true;
+		model->moved++;
+	}
+	for (uint32_t i = 0; i < model->indexPages; i++) {
+		if (dirty[i]) rewrite(model, model->dataPages + i, true);
+	}
+	free(dirty);
+
+	ops->erase(ops->ctx, best * BLOCK_SIZE, BLOCK_SIZE);
+	ops->write(ops->ctx, best * BLOCK_SIZE + PAGE_SIZE - 2, magic, 2);
+	for (uint32_t k = 1; k < PAGES_PER_BLOCK; k++) {
+		uint32_t page = best * PAGES_PER_BLOCK + k;
+		if (model->state[page] != PAGE_FREE) model->freePages++;
+		model->state[page] = PAGE_FREE;
+		model->owner[page] = -1;
+	}
+	model->gcBlock = -1;
+	model->gcs++;
+}
+
+bool spiffsModelInit(SpiffsModel *model, FlashEmu *flash, uint32_t fileSize)
+{
+	static const uint8_t magic[2];
+	const ringlog_flash_t *ops = &flash->ops;
+
+	memset(model, 0, sizeof(*model));
+	model->flash = flash;
+	model->blocks = flash->size / BLOCK_SIZE;
+	model->dataPages = (fileSize + PAGE_DATA - 1) / PAGE_DATA;
+	model->indexPages = (model->dataPages <= HEADER_ENTRIES) ? 1 : 2 + (model->dataPages - HEADER_ENTRIES - 1) / INDEX_ENTRIES;
+	uint32_t pages = model->blocks * PAGES_PER_BLOCK;
+	uint32_t logical = model->dataPages + model->indexPages;
+	model->state = calloc(pages, 1);
+	model->owner = malloc(pages * sizeof(int32_t));
+	model->where = malloc(logical * sizeof(int32_t));
+	if (model->state == NULL || model->owner == NULL || model->where == NULL) return false;
+	for (uint32_t i = 0; i < pages; i++) model->owner[i] = -1;
+	for (uint32_t i = 0; i < logical; i++) model->where[i] = -1;
+	model->freeCursor = 1;
+	model->gcBlock = -1;
+	model->freePages = model->blocks * (PAGES_PER_BLOCK - 1);
+
+	for (uint32_t b = 0; b < model->blocks; b++) {
+		ops->erase(ops->ctx, b * BLOCK_SIZE, BLOCK_SIZE);
+		ops->write(ops->ctx, b * BLOCK_SIZE + PAGE_SIZE - 2, magic, 2);
+	}
+	for (uint32_t i = 0; i < logical; i++) rewrite(model, i, false);
+	return true;
+}
+
+void spiffsModelFree(SpiffsModel *model)
+{
+	free(model->state);
+	free(model->owner);
+	free(model->where);
+}
+
+void spiffsModelWrite(SpiffsModel *model, uint32_t offset, uint32_t size)
+{
+	uint32_t first = offset / PAGE_DATA, last = (offset + size - 1) / PAGE_DATA;
+	uint32_t firstIndex = indexOf(model, first), lastIndex = indexOf(model, last);
+
+	for (uint32_t span = first; span <= last; span++) rewrite(model, span, false);
+	for (uint32_t index = firstIndex; index <= lastIndex; index++) rewrite(model, index, false);
+}
@@ -0,0 +1,51 @@
+#ifndef HOST_SPIFFS_MODEL_H_
+#define HOST_SPIFFS_MODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "flash_emu.h"
+
+/*
+ Flash traffic of one SPIFFS file, for timing against the ring log
+
+ The SPIFFS sources are not part of this tree, so this replays what its
+ nucleus does to the flash with the ESP-IDF configuration (4 KB blocks,
+ 256 byte pages, CONFIG_SPIFFS_USE_MAGIC), on a FlashEmu so both stores
+ are timed alike:
+
+	- a block starts with one lookup page, 2 bytes per page naming its owner
+	- pages are copy on write: a changed data page is written anew, header,
+	  data, lookup entry and final flags, and the old one marked deleted
+	- the object index pages listing the changed data pages are rewritten
+	  the same way, the first one holds fewer entries than the others
+	- free pages are found by reading the lookup page of each block visited
+	- below two free blocks, garbage collection moves the live pages out of
+	  the block with most deleted ones, rewrites their index and erases it
+
+ VFS, the page cache and the CPU time of the scans are left out, so the
+ model flatters SPIFFS.
+*/
+
+typedef struct {
+	FlashEmu *flash;
+	uint32_t blocks;
+	uint32_t dataPages;	// Pages of the file
+	uint32_t indexPages;
+	uint8_t *state;		// Per physical page
+	int32_t *owner;		// Logical page held by each physical page, -1 for none
+	int32_t *where;		// Physical page of each logical page, -1 for none
+	uint32_t freeCursor;
+	uint32_t freePages;
+	int32_t gcBlock;	// Block being collected, -1 for none
+	uint64_t gcs;
+	uint64_t moved;
+} SpiffsModel;
+
+// Formats the flash and creates a file of fileSize bytes, like fwrite of zeros after fopen "w+b"
+bool spiffsModelInit(SpiffsModel *model, FlashEmu *flash, uint32_t fileSize);
+void spiffsModelFree(SpiffsModel *model);
+// fseek, fwrite and fflush of size bytes at offset
+void spiffsModelWrite(SpiffsModel *model, uint32_t offset, uint32_t size);
+
+#endif /* HOST_SPIFFS_MODEL_H_ */
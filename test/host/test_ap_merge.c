@@ -0,0 +1,280 @@
+/*
+ Merging of Wi-Fi scans into the access point list of the wifi manager
+
+ ap_merge_scan keeps one entry per SSID and authmode, sorted by RSSI,
+ ages out what is no longer seen and makes room in a full list by
+ dropping the stalest entries first. The scenarios check each rule, then
+ randomized scans over a small pool of access points, with mesh
+ duplicates and hidden networks, check the invariants after every merge.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ap_merge.h"
+#include "check.h"
+
+#define CAPACITY_MAX	128	// Kconfig range of WIFI_MANAGER_MAX_AP_NUM
+#define RANDOM_SCANS	20000
+#define POOL		40
+
+static wifi_manager_ap_t aps[CAPACITY_MAX];
+
+static wifi_ap_record_t record(const char *ssid, int auth, int rssi, int chan)
+{
+	wifi_ap_record_t r;
+	memset(&r, 0, sizeof(r));
+	strncpy((char *)r.ssid, ssid, sizeof(r.ssid) - 1);
+	r.authmode = auth;
+	r.rssi = rssi;
+	r.primary = chan;
+	return r;
+}
+
+static ap_list_t newList(uint16_t capacity, uint8_t maxAge)
+{
+	memset(aps, 0, sizeof(aps));
+	return (ap_list_t){ .aps = aps, .count = 0, .capacity = capacity, .max_age = maxAge };
+}
+
+static const wifi_manager_ap_t *find(const ap_list_t *list, const char *ssid, int auth)
+{
+	for (int i = 0; i < list->count; i++) {
+		if (strcmp((const char *)list->aps[i].ssid, ssid) == 0 && list->aps[i].auth == auth) return &list->aps[i];
+	}
+	return NULL;
+}
+
+static void testDedupe(void)
+{
+	ap_list_t list = newList(8, 2);
+	wifi_ap_record_t scan[] = {
+		record("mesh", WIFI_AUTH_WPA2_PSK, -70, 1),
+		record("mesh", WIFI_AUTH_WPA2_PSK, -40, 6),
+		record("mesh", WIFI_AUTH_WPA2_PSK, -55, 11),
+		record("mesh", WIFI_AUTH_OPEN, -80, 3),
+		record("", WIFI_AUTH_OPEN, -10, 1),
+		record("cafe", WIFI_AUTH_OPEN, -60, 9),
+	};
+	CHECK(ap_merge_scan(&list, scan, sizeof(scan) / sizeof(scan[0])));
+
+	// One entry per SSID and authmode, the strongest record with its channel, no hidden network
+	CHECK_EQ(list.count, 3);
+	CHECK(strcmp((const char *)list.aps[0].ssid, "mesh") == 0);
+	CHECK_EQ(list.aps[0].rssi, -40);
+	CHECK_EQ(list.aps[0].chan, 6);
+	CHECK(strcmp((const char *)list.aps[1].ssid, "cafe") == 0);
+	CHECK(find(&list, "mesh", WIFI_AUTH_OPEN) != NULL);
+	CHECK(find(&list, "", WIFI_AUTH_OPEN) == NULL);
+	for (int i = 0; i < list.count; i++) CHECK_EQ(list.aps[i].age, 0);
+
+	// A 32 byte SSID has no terminator in the record
+	wifi_ap_record_t full = record("", WIFI_AUTH_OPEN, -50, 1);
+	memset(full.ssid, 'x', AP_MERGE_SSID_SIZE);
+	wifi_ap_record_t again = full;
+	again.rssi = -90;
+	wifi_ap_record_t two[] = { full, again };
+	CHECK(ap_merge_scan(&list, two, 2));
+	CHECK_EQ(list.count, 4);
+	char ssid[AP_MERGE_SSID_SIZE + 1];
+	memset(ssid, 'x', AP_MERGE_SSID_SIZE);
+	ssid[AP_MERGE_SSID_SIZE] = '\0';
+	CHECK(find(&list, ssid, WIFI_AUTH_OPEN) != NULL);
+}
+
+static void testAgeing(void)
+{
+	ap_list_t list = newList(8, 2);
+	wifi_ap_record_t first[] = { record("a", WIFI_AUTH_OPEN, -50, 1), record("b", WIFI_AUTH_OPEN, -60, 1) };
+	CHECK(ap_merge_scan(&list, first, 2));
+
+	// Seen again right away: the RSSI is averaged
+	wifi_ap_record_t second[] = { record("a", WIFI_AUTH_OPEN, -70, 2) };
+	CHECK(ap_merge_scan(&list, second, 1));
+	CHECK_EQ(find(&list, "a", WIFI_AUTH_OPEN)->rssi, -60);
+	CHECK_EQ(find(&list, "a", WIFI_AUTH_OPEN)->chan, 2);
+	CHECK_EQ(find(&list, "b", WIFI_AUTH_OPEN)->age, 1);
+
+	// b stays for max_age scans, then goes
+	CHECK(ap_merge_scan(&list, second, 1));
+	CHECK_EQ(find(&list, "b", WIFI_AUTH_OPEN)->age, 2);
+	CHECK(ap_merge_scan(&list, second, 1));
+	CHECK(find(&list, "b", WIFI_AUTH_OPEN) == NULL);
+	CHECK_EQ(list.count, 1);
+
+	// Back after a gap: the new RSSI as it is
+	wifi_ap_record_t back[] = { record("b", WIFI_AUTH_OPEN, -30, 1) };
+	CHECK(ap_merge_scan(&list, back, 1));
+	CHECK(ap_merge_scan(&list, back, 0));
+	wifi_ap_record_t later[] = { record("a", WIFI_AUTH_OPEN, -90, 1) };
+	CHECK(ap_merge_scan(&list, later, 1));
+	CHECK_EQ(find(&list, "a", WIFI_AUTH_OPEN)->rssi, -90);
+
+	// Age 0 is the last scan only
+	list = newList(8, 0);
+	CHECK(ap_merge_scan(&list, first, 2));
+	CHECK(ap_merge_scan(&list, second, 1));
+	CHECK_EQ(list.count, 1);
+	CHECK(ap_merge_scan(&list, second, 0));
+	CHECK_EQ(list.count, 0);
+}
+
+static void testEviction(void)
+{
+	ap_list_t list = newList(4, 5);
+	wifi_ap_record_t old[] = {
+		record("old1", WIFI_AUTH_OPEN, -40, 1),
+		record("old2", WIFI_AUTH_OPEN, -80, 1),
+	};
+	CHECK(ap_merge_scan(&list, old, 2));
+	wifi_ap_record_t mid[] = {
+		record("mid1", WIFI_AUTH_OPEN, -50, 1),
+		record("mid2", WIFI_AUTH_OPEN, -90, 1),
+	};
+	CHECK(ap_merge_scan(&list, mid, 2));
+	CHECK_EQ(list.count, 4);
+
+	// Full: the stalest go first, the weakest of equal age before the other
+	wifi_ap_record_t scan[] = {
+		record("mid1", WIFI_AUTH_OPEN, -95, 1),
+		record("mid2", WIFI_AUTH_OPEN, -90, 1),
+		record("new1", WIFI_AUTH_OPEN, -60, 1),
+	};
+	CHECK(ap_merge_scan(&list, scan, 3));
+	CHECK_EQ(list.count, 4);
+	CHECK(find(&list, "old2", WIFI_AUTH_OPEN) == NULL);
+	CHECK(find(&list, "old1", WIFI_AUTH_OPEN) != NULL);
+	CHECK(find(&list, "new1", WIFI_AUTH_OPEN) != NULL);
+
+	wifi_ap_record_t next[] = { record("mid1", WIFI_AUTH_OPEN, -95, 1), record("new2", WIFI_AUTH_OPEN, -70, 1) };
+	CHECK(ap_merge_scan(&list, next, 2));
+	CHECK(find(&list, "old1", WIFI_AUTH_OPEN) == NULL);
+	CHECK(find(&list, "mid2", WIFI_AUTH_OPEN) != NULL);
+	CHECK(find(&list, "new2", WIFI_AUTH_OPEN) != NULL);
+
+	// Access points of this scan always stay, the weakest newcomers are dropped
+	wifi_ap_record_t crowd[6];
+	char names[6][8];
+	for (int i = 0; i < 6; i++) {
+		snprintf(names[i], sizeof(names[i]), "c%d", i);
+		crowd[i] = record(names[i], WIFI_AUTH_WPA2_PSK, -30 - i, 1);
+	}
+	CHECK(ap_merge_scan(&list, crowd, 6));
+	CHECK_EQ(list.count, 4);
+	for (int i = 0; i < 4; i++) CHECK(strcmp((const char *)list.aps[i].ssid, names[i]) == 0);
+
+	// Evicted ones come back as new entries, never twice
+	CHECK(ap_merge_scan(&list, old, 2));
+	CHECK(ap_merge_scan(&list, old, 2));
+	CHECK_EQ(list.count, 4);
+	CHECK_EQ(find(&list, "old1", WIFI_AUTH_OPEN)->rssi, -40);
+	CHECK_EQ(find(&list, "old1", WIFI_AUTH_OPEN)->age, 0);
+}
+
+static uint32_t seed = 1;
+
+static uint32_t random32(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return seed >> 8;
+}
+
+// Invariants of the list after merging scan, against the list before
+static void checkMerge(const ap_list_t *before, const ap_list_t *after, const wifi_ap_record_t *scan, int count)
+{
+	// Distinct access points of the scan, all listed while they fit
+	int distinct = 0;
+	for (int r = 0; r < count; r++) {
+		if (scan[r].ssid[0] == '\0') continue;
+		int first = 1;
+		for (int k = 0; k < r; k++) {
+			if (scan[k].authmode == scan[r].authmode && strcmp((const char *)scan[k].ssid, (const char *)scan[r].ssid) == 0) first = 0;
+		}
+		distinct += first;
+	}
+
+	CHECK(after->count <= after->capacity);
+	for (int i = 0; i < after->count; i++) {
+		const wifi_manager_ap_t *ap = &after->aps[i];
+		CHECK(ap->age <= after->max_age);
+		CHECK(ap->ssid[0] != '\0');
+		if (i > 0) CHECK(after->aps[i - 1].rssi >= ap->rssi);
+		for (int k = 0; k < i; k++) {
+			CHECK(!(after->aps[k].auth == ap->auth && strcmp((const char *)after->aps[k].ssid, (const char *)ap->ssid) == 0));
+		}
+
+		// Seen now: the best record of the scan, averaged when it was seen by the previous scan too
+		int best = -128, seen = 0;
+		for (int r = 0; r < count; r++) {
+			if (scan[r].authmode == ap->auth && strcmp((const char *)scan[r].ssid, (const char *)ap->ssid) == 0) {
+				if (scan[r].rssi > best) best = scan[r].rssi;
+				seen = 1;
+			}
+		}
+		CHECK_EQ(ap->age == 0, seen);
+		const wifi_manager_ap_t *prev = find(before, (const char *)ap->ssid, ap->auth);
+		if (!seen) {
+			CHECK(prev != NULL);
+			if (prev) CHECK_EQ(ap->age, prev->age + 1);
+		}
+		else if (prev && prev->age == 0 && ap->rssi != (prev->rssi + best) / 2) {
+			// only when it was pushed out earlier in the same merge and came back as a newcomer
+			CHECK_EQ(ap->rssi, best);
+			CHECK(before->count + distinct >= after->capacity);
+		}
+		else if (!(prev && prev->age == 0)) {
+			CHECK_EQ(ap->rssi, best);
+		}
+	}
+
+	int listedNow = 0;
+	for (int i = 0; i < after->count; i++) listedNow += after->aps[i].age == 0;
+	CHECK_EQ(listedNow, distinct < after->capacity ? distinct : after->capacity);
+
+	// Old ones only go when too old or for a newcomer
+	for (int i = 0; i < before->count; i++) {
+		const wifi_manager_ap_t *ap = &before->aps[i];
+		if (ap->age < after->max_age && find(after, (const char *)ap->ssid, ap->auth) == NULL) CHECK(before->count + distinct >= after->capacity);
+	}
+}
+
+static void testRandom(void)
+{
+	static wifi_manager_ap_t copy[CAPACITY_MAX];
+	static wifi_ap_record_t scan[2 * CAPACITY_MAX];
+	static wifi_ap_record_t sorted[2 * CAPACITY_MAX];
+	char pool[POOL][12];
+	for (int i = 0; i < POOL; i++) snprintf(pool[i], sizeof(pool[i]), "net%02d", i);
+
+	int failures = checkFailures;
+	ap_list_t list = newList(1, 0);
+	for (int n = 0; n < RANDOM_SCANS && checkFailures == failures; n++) {
+		// A fresh list now and then, sizes up to the Kconfig maximum
+		if (n % 500 == 0) {
+			uint16_t capacity = (n % 5000 == 0) ? CAPACITY_MAX : 1 + random32() % 16;
+			list = newList(capacity, random32() % 4);
+		}
+		int count = random32() % (2 * list.capacity + 1);
+		for (int r = 0; r < count; r++) {
+			int k = random32() % POOL;
+			scan[r] = record((random32() % 16) ? pool[k] : "", (k & 1) ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK, -30 - (int)(random32() % 70), 1 + random32() % 13);
+			// the same SSID with another authmode now and then
+			if (random32() % 8 == 0) scan[r].authmode = WIFI_AUTH_WPA_WPA2_PSK;
+		}
+		memcpy(copy, aps, sizeof(copy));
+		ap_list_t before = list;
+		before.aps = copy;
+		memcpy(sorted, scan, count * sizeof(wifi_ap_record_t));
+		CHECK(ap_merge_scan(&list, sorted, count));
+		checkMerge(&before, &list, scan, count);
+	}
+}
+
+int main(void)
+{
+	testDedupe();
+	testAgeing();
+	testEviction();
+	testRandom();
+	return checkResult();
+}
@@ -0,0 +1,292 @@
+/*
+ The wifi manager's config record against an in-memory NVS blob
+
+ config_record_save and config_record_load with records the way firmware
+ versions write them: the current layout, an earlier one without the
+ settings and a later one with fields appended. The store can fail the
+ next write and counts the writes, a save that changes nothing must not
+ write.
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include "config_record.h"
+#include "check.h"
+
+typedef struct {
+	uint8_t blob[CONFIG_RECORD_MAX_SIZE + 16];
+	size_t size;	// 0 when there is no blob
+	int writes;
+	esp_err_t failNext;	// returned by the next write instead of writing
+} Store;
+
+static esp_err_t storeRead(void *ctx, void *record, size_t *size)
+{
+	Store *store = ctx;
+	if (store->size == 0) return ESP_ERR_NOT_FOUND;
+	if (store->size > *size) return ESP_ERR_INVALID_SIZE;	// like ESP_ERR_NVS_INVALID_LENGTH
+	memcpy(record, store->blob, store->size);
+	*size = store->size;
+	return ESP_OK;
+}
+
+static esp_err_t storeWrite(void *ctx, const void *record, size_t size)
+{
+	Store *store = ctx;
+	if (store->failNext != ESP_OK) {
+		esp_err_t err = store->failNext;
+		store->failNext = ESP_OK;
+		return err;
+	}
+	memcpy(store->blob, record, size);
+	store->size = size;
+	store->writes++;
+	return ESP_OK;
+}
+
+// The layouts of three firmware versions
+typedef struct {
+	config_record_header_t header;
+	uint8_t ssid[32];
+	uint8_t password[64];
+} EarlierRecord;
+
+typedef struct {
+	uint8_t channel;
+	uint8_t hidden;
+	uint16_t bandwidth;
+} Settings;
+
+typedef struct {
+	config_record_header_t header;
+	uint8_t ssid[32];
+	uint8_t password[64];
+	Settings settings;
+} Record;
+
+typedef struct {
+	Record current;
+	uint8_t lte[40];
+} LaterRecord;
+
+static Store store;
+static config_record_storage_t storage = { .ctx = &store, .read = storeRead, .write = storeWrite };
+
+// What the wifi manager keeps across reboots, fresh on every boot
+static config_record_t boot(uint16_t version)
+{
+	return (config_record_t){ .version = version, .min_size = sizeof(EarlierRecord), .storage = &storage };
+}
+
+static Record defaults(void)
+{
+	Record r;
+	memset(&r, 0, sizeof(r));
+	r.settings = (Settings){ .channel = 1, .hidden = 0, .bandwidth = 2 };
+	return r;
+}
+
+static Record configured(const char *ssid, const char *password)
+{
+	Record r = defaults();
+	strncpy((char *)r.ssid, ssid, sizeof(r.ssid));
+	strncpy((char *)r.password, password, sizeof(r.password));
+	r.settings.channel = 11;
+	return r;
+}
+
+static void testRoundTrip(void)
+{
+	memset(&store, 0, sizeof(store));
+	config_record_t config = boot(1);
+	Record r = defaults();
+	CHECK(!config_record_load(&config, &r, sizeof(r)));
+
+	Record saved = configured("home", "secret");
+	CHECK_EQ(config_record_save(&config, &saved, sizeof(saved)), ESP_OK);
+	CHECK_EQ(store.writes, 1);
+	CHECK_EQ(store.size, sizeof(Record));
+
+	// Unchanged: no write, in the same session and after a reboot
+	CHECK_EQ(config_record_save(&config, &saved, sizeof(saved)), ESP_OK);
+	CHECK_EQ(store.writes, 1);
+	config = boot(1);
+	CHECK(config_record_load(&config, &r, sizeof(r)));
+	CHECK(memcmp(r.ssid, saved.ssid, sizeof(r.ssid)) == 0);
+	CHECK(memcmp(r.password, saved.password, sizeof(r.password)) == 0);
+	CHECK_EQ(r.settings.channel, 11);
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK_EQ(store.writes, 1);
+
+	// Changed: written
+	r.settings.hidden = 1;
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK_EQ(store.writes, 2);
+}
+
+static void testFailedWrite(void)
+{
+	memset(&store, 0, sizeof(store));
+	config_record_t config = boot(1);
+	Record r = configured("home", "secret");
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+
+	// The failed save leaves the stored record, the next save of the same config retries
+	Record changed = configured("office", "secret2");
+	store.failNext = ESP_ERR_NO_MEM;
+	CHECK_EQ(config_record_save(&config, &changed, sizeof(changed)), ESP_ERR_NO_MEM);
+	CHECK_EQ(store.writes, 1);
+	CHECK(memcmp(((Record *)store.blob)->ssid, "home", 5) == 0);
+	CHECK_EQ(config_record_save(&config, &changed, sizeof(changed)), ESP_OK);
+	CHECK_EQ(store.writes, 2);
+	CHECK(memcmp(((Record *)store.blob)->ssid, "office", 7) == 0);
+
+	// And a failed first save of a session too
+	config = boot(1);
+	Record loaded = defaults();
+	CHECK(config_record_load(&config, &loaded, sizeof(loaded)));
+	store.failNext = ESP_FAIL;
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_FAIL);
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK_EQ(store.writes, 3);
+}
+
+static void testCorrupted(void)
+{
+	Record r = configured("home", "secret");
+
+	// Every bit of the stored record matters, header included
+	for (size_t bit = 0; bit < sizeof(Record) * 8; bit++) {
+		memset(&store, 0, sizeof(store));
+		config_record_t config = boot(1);
+		CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+		store.blob[bit / 8] ^= 1 << (bit % 8);
+
+		config = boot(1);
+		Record loaded = defaults();
+		bool ok = config_record_load(&config, &loaded, sizeof(loaded));
+		CHECK(!ok);
+		if (ok) {
+			printf("bit %zu flipped and still accepted\n", bit);
+			break;
+		}
+		// Left at the defaults, and the next save replaces the bad record
+		CHECK_EQ(loaded.settings.channel, 1);
+		CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+		CHECK_EQ(store.writes, 2);
+		config = boot(1);
+		CHECK(config_record_load(&config, &loaded, sizeof(loaded)));
+	}
+
+	// Cut short, too short, too long for the buffer
+	config_record_t config = boot(1);
+	Record loaded = defaults();
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	store.size = sizeof(Record) - 1;
+	CHECK(!config_record_load(&config, &loaded, sizeof(loaded)));
+	store.size = sizeof(config_record_header_t);
+	CHECK(!config_record_load(&config, &loaded, sizeof(loaded)));
+	store.size = 2;
+	CHECK(!config_record_load(&config, &loaded, sizeof(loaded)));
+	store.size = CONFIG_RECORD_MAX_SIZE + 1;
+	CHECK(!config_record_load(&config, &loaded, sizeof(loaded)));
+	CHECK_EQ(loaded.settings.channel, 1);
+
+	// Erased behind our back: the next save must not be skipped as unchanged
+	memset(&store, 0, sizeof(store));
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK(config_record_load(&config, &loaded, sizeof(loaded)));
+	store.size = 0;
+	CHECK(!config_record_load(&config, &loaded, sizeof(loaded)));
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK_EQ(store.size, sizeof(Record));
+}
+
+static void testVersion(void)
+{
+	memset(&store, 0, sizeof(store));
+	config_record_t next = boot(2);
+	Record r = configured("home", "secret");
+	CHECK_EQ(config_record_save(&next, &r, sizeof(r)), ESP_OK);
+
+	// An incompatible layout is ignored
+	config_record_t config = boot(1);
+	Record loaded = defaults();
+	CHECK(!config_record_load(&config, &loaded, sizeof(loaded)));
+	CHECK_EQ(loaded.ssid[0], 0);
+	CHECK_EQ(config_record_save(&config, &loaded, sizeof(loaded)), ESP_OK);
+	CHECK_EQ(((config_record_header_t *)store.blob)->version, 1);
+}
+
+static void testEarlierFirmware(void)
+{
+	memset(&store, 0, sizeof(store));
+	config_record_t earlier = boot(1);
+	EarlierRecord old;
+	memset(&old, 0, sizeof(old));
+	strcpy((char *)old.ssid, "home");
+	strcpy((char *)old.password, "secret");
+	CHECK_EQ(config_record_save(&earlier, &old, sizeof(old)), ESP_OK);
+	CHECK_EQ(store.size, sizeof(EarlierRecord));
+
+	// Known fields are read, the settings it did not have keep their defaults
+	config_record_t config = boot(1);
+	Record r = defaults();
+	r.settings.channel = 6;
+	CHECK(config_record_load(&config, &r, sizeof(r)));
+	CHECK(strcmp((char *)r.ssid, "home") == 0);
+	CHECK(strcmp((char *)r.password, "secret") == 0);
+	CHECK_EQ(r.settings.channel, 6);
+	CHECK_EQ(r.settings.bandwidth, 2);
+
+	// Saving grows it to the current layout
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK_EQ(store.size, sizeof(Record));
+	CHECK_EQ(store.writes, 2);
+}
+
+static void testLaterFirmware(void)
+{
+	memset(&store, 0, sizeof(store));
+	config_record_t later = boot(1);
+	LaterRecord next;
+	memset(&next, 0, sizeof(next));
+	next.current = configured("home", "secret");
+	for (size_t i = 0; i < sizeof(next.lte); i++) next.lte[i] = 0xA0 + i;
+	CHECK_EQ(config_record_save(&later, &next, sizeof(next)), ESP_OK);
+
+	// Read as far as known
+	config_record_t config = boot(1);
+	Record r = defaults();
+	CHECK(config_record_load(&config, &r, sizeof(r)));
+	CHECK(strcmp((char *)r.ssid, "home") == 0);
+	CHECK_EQ(r.header.size, sizeof(LaterRecord));
+
+	// Unchanged is still no write, a change keeps the appended fields as they were
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK_EQ(store.writes, 1);
+	strcpy((char *)r.password, "changed");
+	CHECK_EQ(config_record_save(&config, &r, sizeof(r)), ESP_OK);
+	CHECK_EQ(store.writes, 2);
+	CHECK_EQ(store.size, sizeof(LaterRecord));
+	CHECK(memcmp(((LaterRecord *)store.blob)->lte, next.lte, sizeof(next.lte)) == 0);
+
+	// And the later firmware reads both back
+	later = boot(1);
+	LaterRecord back;
+	memset(&back, 0, sizeof(back));
+	CHECK(config_record_load(&later, &back, sizeof(back)));
+	CHECK(strcmp((char *)back.current.password, "changed") == 0);
+	CHECK(memcmp(back.lte, next.lte, sizeof(next.lte)) == 0);
+}
+
+int main(void)
+{
+	testRoundTrip();
+	testFailedWrite();
+	testCorrupted();
+	testVersion();
+	testEarlierFirmware();
+	testLaterFirmware();
+	return checkResult();
+}
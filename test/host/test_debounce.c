@@ -0,0 +1,220 @@
+/*
+ Button debounce state machine, driven by synthetic edge traces
+
+ replay() stands in for button.c: the level is fed on every edge and again
+ when the one-shot timer armed for debounceDeadline() expires, optionally
+ late. Times are in microseconds, with the configuration of button.h.
+*/
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "button.h"
+#include "check.h"
+
+#define MS	1000
+
+typedef struct {
+	int64_t at;
+	bool pressed;
+} Edge;
+
+typedef struct {
+	button_event_type_t type;
+	int64_t timestamp;
+} Event;
+
+#define MAX_EVENTS	256
+
+static Event events[MAX_EVENTS];
+static int eventCount;
+
+static const debounce_config_t repeating = { DEBOUNCE * MS, LONG_PRESS * MS, REPEAT_PERIOD * MS };
+static const debounce_config_t single = { DEBOUNCE * MS, LONG_PRESS * MS, 0 };
+
+static void step(debounce_state_t * state, const debounce_config_t * config, bool pressed, int64_t now)
+{
+	button_event_type_t type;
+	int64_t timestamp;
+	while((type = debounceUpdate(state, config, pressed, now, &timestamp)) != BUTTON_EVENT_NONE) {
+		if (eventCount < MAX_EVENTS) {
+			events[eventCount].type = type;
+			events[eventCount].timestamp = timestamp;
+			eventCount++;
+		}
+	}
+}
+
+// Edges in time order, then nothing until end. The timer fires latency after its deadline.
+static void replay(const debounce_config_t * config, const Edge * edges, int count, int64_t end, int64_t latency)
+{
+	debounce_state_t state;
+	bool pressed = false;
+	int next = 0;
+
+	debounceInit(&state);
+	eventCount = 0;
+	for(;;) {
+		int64_t deadline = debounceDeadline(&state, config);
+		int64_t timerAt = (deadline >= 0) ? deadline + latency : -1;
+		if (next < count && (timerAt < 0 || edges[next].at <= timerAt)) {
+			pressed = edges[next].pressed;
+			step(&state, config, pressed, edges[next].at);
+			next++;
+		} else if (timerAt >= 0 && timerAt <= end) {
+			step(&state, config, pressed, timerAt);
+		} else {
+			break;
+		}
+	}
+}
+
+static int countEvents(button_event_type_t type)
+{
+	int count = 0;
+	for(int i=0;i<eventCount;i++) {
+		if (events[i].type == type) count++;
+	}
+	return count;
+}
+
+// A short tap with contact chatter on both edges is one press and one release
+static void testBouncyTap(void)
+{
+	static const Edge trace[] = {
+		{ 1000, true }, { 1300, false }, { 1900, true }, { 2100, false }, { 2600, true },
+		{ 200*MS, false }, { 200*MS + 400, true }, { 200*MS + 700, false },
+	};
+	replay(&repeating, trace, sizeof(trace) / sizeof(trace[0]), 2000*MS, 0);
+	CHECK_EQ(eventCount, 2);
+	CHECK_EQ(events[0].type, BUTTON_EVENT_PRESS);
+	CHECK_EQ(events[0].timestamp, 2600);
+	CHECK_EQ(events[1].type, BUTTON_EVENT_RELEASE);
+	CHECK_EQ(events[1].timestamp, 200*MS + 700);
+}
+
+// Spikes shorter than the debounce time never become presses
+static void testGlitches(void)
+{
+	static const Edge trace[] = {
+		{ 10*MS, true }, { 10*MS + 100, false },
+		{ 100*MS, true }, { 100*MS + (DEBOUNCE-1)*MS, false },
+		{ 500*MS, true }, { 500*MS + 3*MS, false }, { 500*MS + 5*MS, true }, { 500*MS + 6*MS, false },
+	};
+	replay(&repeating, trace, sizeof(trace) / sizeof(trace[0]), 2000*MS, 0);
+	CHECK_EQ(eventCount, 0);
+}
+
+// Held for 1.5 s: press, long press at 800 ms, a repeat every 150 ms, release
+static void testLongPressRepeat(void)
+{
+	static const Edge trace[] = { { 0, true }, { 1500*MS, false } };
+	replay(&repeating, trace, 2, 3000*MS, 0);
+	// repeats at 950, 1100, 1250, 1400 ms
+	CHECK_EQ(eventCount, 1 + 1 + 4 + 1);
+	CHECK_EQ(events[0].type, BUTTON_EVENT_PRESS);
+	CHECK_EQ(events[0].timestamp, 0);
+	CHECK_EQ(events[1].type, BUTTON_EVENT_LONG_PRESS);
+	CHECK_EQ(events[1].timestamp, LONG_PRESS*MS);
+	for(int i=0;i<4;i++) {
+		CHECK_EQ(events[2+i].type, BUTTON_EVENT_REPEAT);
+		CHECK_EQ(events[2+i].timestamp, (LONG_PRESS + REPEAT_PERIOD * (i + 1)) * MS);
+	}
+	CHECK_EQ(events[6].type, BUTTON_EVENT_RELEASE);
+	CHECK_EQ(events[6].timestamp, 1500*MS);
+
+	// BUTTON_ENTER has no auto repeat
+	replay(&single, trace, 2, 3000*MS, 0);
+	CHECK_EQ(eventCount, 3);
+	CHECK_EQ(countEvents(BUTTON_EVENT_REPEAT), 0);
+	CHECK_EQ(countEvents(BUTTON_EVENT_LONG_PRESS), 1);
+}
+
+// A release that bounces back while held resumes the repeats instead of releasing
+static void testBouncyHold(void)
+{
+	static const Edge trace[] = {
+		{ 0, true }, { 1000*MS, false }, { 1000*MS + 2*MS, true }, { 1300*MS, false },
+	};
+	replay(&repeating, trace, sizeof(trace) / sizeof(trace[0]), 3000*MS, 0);
+	CHECK_EQ(countEvents(BUTTON_EVENT_PRESS), 1);
+	CHECK_EQ(countEvents(BUTTON_EVENT_LONG_PRESS), 1);
+	// 950, 1100, 1250 ms, undisturbed by the bounce at 1000 ms
+	CHECK_EQ(countEvents(BUTTON_EVENT_REPEAT), 3);
+	CHECK_EQ(countEvents(BUTTON_EVENT_RELEASE), 1);
+	CHECK_EQ(events[eventCount-1].timestamp, 1300*MS);
+}
+
+// A late timer delivers every missed deadline at once, stamped when it was due.
+// Repeats still pending when the release edge comes first are dropped.
+static void testLateTimer(void)
+{
+	static const Edge trace[] = { { 0, true }, { 1500*MS, false } };
+	const int64_t latency = 320*MS;
+	replay(&repeating, trace, 2, 3000*MS, 0);
+	Event expected[MAX_EVENTS];
+	int expectedCount = 0;
+	for(int i=0;i<eventCount;i++) {
+		if (events[i].type == BUTTON_EVENT_REPEAT && events[i].timestamp + latency > trace[1].at) continue;
+		expected[expectedCount++] = events[i];
+	}
+	// the 1250 and 1400 ms repeats
+	CHECK_EQ(eventCount - expectedCount, 2);
+
+	replay(&repeating, trace, 2, 3000*MS, latency);
+	CHECK_EQ(eventCount, expectedCount);
+	int wrong = 0;
+	for(int i=0;i<eventCount && i<expectedCount;i++) {
+		if (events[i].type != expected[i].type || events[i].timestamp != expected[i].timestamp) wrong++;
+	}
+	CHECK_EQ(wrong, 0);
+}
+
+// Random presses with up to 6 chatter edges at each transition
+static void testRandomTrace(void)
+{
+	static Edge trace[4096];
+	int count = 0, presses = 0;
+	int64_t lastPress[64], lastRelease[64];
+	int64_t t = 0;
+
+	srand(9);
+	while(presses < 64) {
+		for(int level=1;level>=0;level--) {
+			int chatter = rand() % 4;
+			for(int i=0;i<chatter;i++) {
+				trace[count++] = (Edge){ t, level };
+				t += 100 + rand() % 2000;
+				trace[count++] = (Edge){ t, !level };
+				t += 100 + rand() % 2000;
+			}
+			trace[count++] = (Edge){ t, level };
+			if (level) lastPress[presses] = t; else lastRelease[presses] = t;
+			// held for 60..700 ms: below the long press; released for 60..300 ms
+			t += (level ? 60 + rand() % 640 : 60 + rand() % 240) * MS;
+		}
+		presses++;
+	}
+	replay(&repeating, trace, count, t + 1000*MS, rand() % 3000);
+	CHECK_EQ(eventCount, 2 * presses);
+	int wrong = 0;
+	for(int i=0;i<presses;i++) {
+		if (events[2*i].type != BUTTON_EVENT_PRESS || events[2*i].timestamp != lastPress[i]) wrong++;
+		if (events[2*i+1].type != BUTTON_EVENT_RELEASE || events[2*i+1].timestamp != lastRelease[i]) wrong++;
+	}
+	CHECK_EQ(wrong, 0);
+}
+
+int main(void)
+{
+	testBouncyTap();
+	testGlitches();
+	testLongPressRepeat();
+	testBouncyHold();
+	testLateTimer();
+	testRandomTrace();
+	return checkResult();
+}
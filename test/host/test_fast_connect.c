@@ -0,0 +1,304 @@
+/*
+ Fast reconnect of the wifi manager against a fake radio and flash
+
+ The fake radio holds a few access points. A connection pinned to a BSSID
+ listens on its one channel, any other scans all 13, then the handshake
+ is checked against the access point's passphrase, or its PMK when the
+ password is 64 hex digits. The flash holds one fast_connect_cache_t.
+
+	- first boot: full scan, the access point and its PMK are remembered
+	- reboot: straight to the BSSID and channel, PMK reused, nothing derived
+	  or written
+	- access point moved or gone: the pinned attempt fails and the full scan
+	  follows at once
+	- password changed on the access point: the record is dropped
+	- open and WPA3 networks keep no PMK, forgetting clears the flash
+*/
+#include <stdio.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#include "fast_connect.h"
+#include "mbedtls/pkcs5.h"
+#include "check.h"
+
+#define CHANNELS	13
+#define MAX_APS	4
+
+typedef struct {
+	uint8_t bssid[6];
+	const char *ssid;
+	const char *passphrase;
+	uint8_t channel;
+	int8_t rssi;
+	wifi_auth_mode_t authmode;
+	bool up;
+} FakeAp;
+
+typedef struct {
+	FakeAp aps[MAX_APS];
+	wifi_config_t config;		// Last set_config
+	uint8_t reason;			// Outcome of the last connect, 0 for connected
+	wifi_ap_record_t joined;
+	int connects;
+	int channelsScanned;
+	fast_connect_cache_t flash;
+	bool flashWritten;
+	int stores;
+} Radio;
+
+static Radio radio;
+
+static void pmkOf(const FakeAp *ap, uint8_t *pmk)
+{
+	PKCS5_PBKDF2_HMAC_SHA1(ap->passphrase, strlen(ap->passphrase), (const uint8_t *)ap->ssid, strlen(ap->ssid), 4096,
+		FAST_CONNECT_PMK_SIZE, pmk);
+}
+
+static bool keyMatches(const FakeAp *ap, const uint8_t *password)
+{
+	char hex[2 * FAST_CONNECT_PMK_SIZE + 1];
+	uint8_t pmk[FAST_CONNECT_PMK_SIZE];
+
+	if (ap->authmode == WIFI_AUTH_OPEN) return true;
+	if (strncmp((const char *)password, ap->passphrase, 64) == 0) return true;
+	if (ap->authmode == WIFI_AUTH_WPA3_PSK) return false;	// SAE needs the passphrase
+	pmkOf(ap, pmk);
+	for (int i = 0; i < FAST_CONNECT_PMK_SIZE; i++) sprintf(&hex[2 * i], "%02x", pmk[i]);
+	return memcmp(password, hex, 64) == 0;
+}
+
+static esp_err_t setConfig(void *ctx, wifi_config_t *config)
+{
+	Radio *r = ctx;
+	r->config = *config;
+	return ESP_OK;
+}
+
+static esp_err_t connect(void *ctx)
+{
+	Radio *r = ctx;
+	const wifi_sta_config_t *sta = &r->config.sta;
+	const FakeAp *found = NULL;
+
+	r->connects++;
+	r->channelsScanned += sta->bssid_set ? 1 : CHANNELS;
+	for (int i = 0; i < MAX_APS; i++) {
+		const FakeAp *ap = &r->aps[i];
+		if (!ap->up || strncmp(ap->ssid, (const char *)sta->ssid, sizeof(sta->ssid)) != 0) continue;
+		if (sta->bssid_set && (memcmp(ap->bssid, sta->bssid, 6) != 0 || ap->channel != sta->channel)) continue;
+		if (found == NULL || ap->rssi > found->rssi) found = ap;
+	}
+	if (found == NULL) {
+		r->reason = WIFI_REASON_NO_AP_FOUND;
+	} else if (!keyMatches(found, sta->password)) {
+		r->reason = WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT;
+	} else {
+		r->reason = 0;
+		memset(&r->joined, 0, sizeof(r->joined));
+		memcpy(r->joined.bssid, found->bssid, 6);
+		r->joined.primary = found->channel;
+		r->joined.rssi = found->rssi;
+		r->joined.authmode = found->authmode;
+	}
+	return ESP_OK;
+}
+
+static esp_err_t getApInfo(void *ctx, wifi_ap_record_t *ap)
+{
+	Radio *r = ctx;
+	*ap = r->joined;
+	return ESP_OK;
+}
+
+static esp_err_t load(void *ctx, fast_connect_cache_t *cache)
+{
+	Radio *r = ctx;
+	if (!r->flashWritten) return ESP_ERR_NOT_FOUND;
+	*cache = r->flash;
+	return ESP_OK;
+}
+
+static esp_err_t store(void *ctx, const fast_connect_cache_t *cache)
+{
+	Radio *r = ctx;
+	r->flash = *cache;
+	r->flashWritten = true;
+	r->stores++;
+	return ESP_OK;
+}
+
+static const fast_connect_driver_t driver = { &radio, setConfig, connect, getApInfo, load, store };
+
+static wifi_config_t credentials(const char *ssid, const char *password)
+{
+	wifi_config_t config;
+	memset(&config, 0, sizeof(config));
+	strncpy((char *)config.sta.ssid, ssid, sizeof(config.sta.ssid));
+	strncpy((char *)config.sta.password, password, sizeof(config.sta.password));
+	return config;
+}
+
+// What the wifi manager does with the STA events until connected or given up
+static bool join(const wifi_config_t *config)
+{
+	CHECK_EQ(fast_connect_start(config), ESP_OK);
+	while (radio.reason != 0) {
+		if (!fast_connect_on_disconnected(radio.reason)) return false;
+	}
+	fast_connect_on_connected(config);
+	CHECK_EQ(fast_connect_get_state(), FAST_CONNECT_IDLE);
+	return true;
+}
+
+static void reboot(void)
+{
+	radio.connects = radio.channelsScanned = 0;
+	fast_connect_init(&driver);
+}
+
+static bool fullScan(void)
+{
+	return !radio.config.sta.bssid_set && radio.config.sta.channel == 0 && radio.config.sta.scan_method == WIFI_ALL_CHANNEL_SCAN;
+}
+
+static void testDerive(void)
+{
+	// IEEE 802.11i-2004 H.4 test vector
+	static const uint8_t expected[FAST_CONNECT_PMK_SIZE] = {
+		0xf4, 0x2c, 0x6f, 0xc5, 0x2d, 0xf0, 0xeb, 0xef, 0x9e, 0xbb, 0x4b, 0x90, 0xb3, 0x8a, 0x5f, 0x90,
+		0x2e, 0x83, 0xfe, 0x1b, 0x13, 0x5a, 0x70, 0xe2, 0x3a, 0xed, 0x76, 0x2e, 0x97, 0x10, 0xa1, 0x2e,
+	};
+	wifi_config_t config = credentials("IEEE", "password");
+	uint8_t pmk[FAST_CONNECT_PMK_SIZE];
+
+	CHECK_EQ(fast_connect_derive_pmk(&config, pmk), ESP_OK);
+	CHECK(memcmp(pmk, expected, sizeof(pmk)) == 0);
+}
+
+static void testHome(void)
+{
+	wifi_config_t home = credentials("home", "hunter2hunter2");
+	uint8_t pmk[FAST_CONNECT_PMK_SIZE];
+
+	radio.aps[0] = (FakeAp){ { 0x24, 0x0a, 0xc4, 0, 0, 1 }, "home", "hunter2hunter2", 6, -48, WIFI_AUTH_WPA2_PSK, true };
+	radio.aps[1] = (FakeAp){ { 0x24, 0x0a, 0xc4, 0, 0, 2 }, "home", "hunter2hunter2", 1, -70, WIFI_AUTH_WPA2_PSK, true };
+	pmkOf(&radio.aps[0], pmk);
+
+	// First boot: nothing remembered, full scan with the passphrase, the best access point is kept with its PMK
+	reboot();
+	unsigned derived = mbedtlsPbkdf2Runs;
+	CHECK(join(&home));
+	CHECK_EQ(radio.connects, 1);
+	CHECK_EQ(radio.channelsScanned, CHANNELS);
+	CHECK_EQ(radio.stores, 1);
+	CHECK_EQ(radio.flash.version, FAST_CONNECT_CACHE_VERSION);
+	CHECK_EQ(radio.flash.channel, 6);
+	CHECK_EQ(radio.flash.bssid[5], 1);
+	CHECK(radio.flash.pmk_set && memcmp(radio.flash.pmk, pmk, sizeof(pmk)) == 0);
+	CHECK_EQ(mbedtlsPbkdf2Runs, derived + 1);
+
+	// Reboot: pinned to the BSSID on its channel, the PMK as password, no derivation and no flash write
+	reboot();
+	derived = mbedtlsPbkdf2Runs;
+	CHECK_EQ(fast_connect_start(&home), ESP_OK);
+	CHECK_EQ(fast_connect_get_state(), FAST_CONNECT_TARGETED);
+	CHECK(radio.config.sta.bssid_set && radio.config.sta.bssid[5] == 1);
+	CHECK_EQ(radio.config.sta.channel, 6);
+	CHECK_EQ(radio.config.sta.scan_method, WIFI_FAST_SCAN);
+	CHECK_EQ(radio.reason, 0);
+	fast_connect_on_connected(&home);
+	CHECK_EQ(radio.connects, 1);
+	CHECK_EQ(radio.channelsScanned, 1);
+	CHECK_EQ(radio.stores, 1);
+	CHECK_EQ(mbedtlsPbkdf2Runs, derived);
+
+	// Access point down: the pinned attempt misses, the full scan with the passphrase follows, record moves
+	radio.aps[0].up = false;
+	reboot();
+	CHECK(join(&home));
+	CHECK(fullScan());
+	CHECK(strcmp((const char *)radio.config.sta.password, "hunter2hunter2") == 0);
+	CHECK_EQ(radio.connects, 2);
+	CHECK_EQ(radio.channelsScanned, 1 + CHANNELS);
+	CHECK_EQ(radio.flash.bssid[5], 2);
+	CHECK_EQ(radio.flash.channel, 1);
+	CHECK_EQ(radio.stores, 2);
+	// Same credentials, same network: the PMK is carried over
+	CHECK(radio.flash.pmk_set && memcmp(radio.flash.pmk, pmk, sizeof(pmk)) == 0);
+	CHECK_EQ(mbedtlsPbkdf2Runs, derived);
+
+	// Nothing there at all: both attempts fail, the record stays for when it comes back
+	radio.aps[1].up = false;
+	reboot();
+	CHECK(!join(&home));
+	CHECK_EQ(radio.connects, 2);
+	CHECK_EQ(fast_connect_get_state(), FAST_CONNECT_IDLE);
+	radio.aps[1].up = true;
+	reboot();
+	CHECK(join(&home));
+	CHECK_EQ(radio.connects, 1);
+
+	// Password changed on the access point: pinned and full attempts fail, the record is dropped
+	radio.aps[1].passphrase = "correcthorse";
+	reboot();
+	CHECK(!join(&home));
+	CHECK_EQ(fast_connect_start(&home), ESP_OK);
+	CHECK(fullScan());
+	fast_connect_on_disconnected(radio.reason);
+
+	// New password entered: full scan, new PMK derived and remembered
+	wifi_config_t changed = credentials("home", "correcthorse");
+	derived = mbedtlsPbkdf2Runs;
+	reboot();
+	CHECK(join(&changed));
+	CHECK_EQ(radio.connects, 1);
+	CHECK_EQ(mbedtlsPbkdf2Runs, derived + 1);
+	pmkOf(&radio.aps[1], pmk);
+	CHECK(radio.flash.pmk_set && memcmp(radio.flash.pmk, pmk, sizeof(pmk)) == 0);
+	reboot();
+	CHECK(join(&changed));
+	CHECK_EQ(radio.channelsScanned, 1);
+	radio.aps[0].up = radio.aps[1].up = false;
+}
+
+static void testOtherSecurity(void)
+{
+	wifi_config_t cafe = credentials("cafe", "");
+	wifi_config_t lab = credentials("lab", "longpassword");
+
+	// Open: pinned, nothing to derive
+	radio.aps[2] = (FakeAp){ { 0x24, 0x0a, 0xc4, 0, 0, 3 }, "cafe", "", 11, -60, WIFI_AUTH_OPEN, true };
+	reboot();
+	CHECK(join(&cafe));
+	CHECK(!radio.flash.pmk_set);
+	reboot();
+	CHECK(join(&cafe));
+	CHECK_EQ(radio.channelsScanned, 1);
+	CHECK_EQ(radio.config.sta.password[0], 0);
+
+	// WPA3: SAE has no reusable PMK, the pinned attempt carries the passphrase
+	radio.aps[3] = (FakeAp){ { 0x24, 0x0a, 0xc4, 0, 0, 4 }, "lab", "longpassword", 3, -55, WIFI_AUTH_WPA3_PSK, true };
+	reboot();
+	CHECK(join(&lab));
+	CHECK(!radio.flash.pmk_set);
+	reboot();
+	CHECK(join(&lab));
+	CHECK_EQ(radio.connects, 1);
+	CHECK_EQ(radio.channelsScanned, 1);
+
+	// Forgotten: a version 0 record that is never loaded back
+	fast_connect_forget();
+	CHECK_EQ(radio.flash.version, 0);
+	reboot();
+	CHECK(join(&lab));
+	CHECK_EQ(radio.channelsScanned, CHANNELS);
+}
+
+int main(void)
+{
+	testDerive();
+	testHome();
+	testOtherSecurity();
+	return checkResult();
+}
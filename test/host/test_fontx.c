@@ -0,0 +1,122 @@
+/*
+ FONTX lookup: embedded images against the file path
+
+ The image is loaded the way EMBED_FILES links it, as one block of bytes
+ between a start and an end pointer.
+*/
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "fontx.h"
+#include "check.h"
+
+static uint8_t * loadImage(const char * path, size_t * size)
+{
+	FILE * f = fopen(path, "rb");
+	if (f == NULL) return NULL;
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t * image = malloc(*size);
+	if (image != NULL && fread(image, 1, *size, f) != *size) {
+		free(image);
+		image = NULL;
+	}
+	fclose(f);
+	return image;
+}
+
+// Every ANK code gives the same glyph from flash as from the file (whole table or LRU cache)
+static void testSameGlyphs(const char * path, uint8_t width, uint8_t height)
+{
+	FontxFile fromFile[2], fromMem[2];
+	size_t size;
+	uint8_t * image = loadImage(path, &size);
+	CHECK(image != NULL);
+	if (image == NULL) return;
+
+	InitFontx(fromFile, path, "");
+	InitFontxMem(fromMem, "mem", image, image + size);
+	uint8_t pw, ph;
+	CHECK(GetFontxMetrics(fromMem, &pw, &ph));
+	CHECK_EQ(pw, width);
+	CHECK_EQ(ph, height);
+
+	int mismatches = 0;
+	size_t glyphSize = (width + 7) / 8 * height;
+	// Twice round, the second pass hits the LRU slots of the 32 dot font
+	for(int pass=0;pass<2;pass++) {
+		for(int code=0;code<FontxAnkGlyphs;code++) {
+			const uint8_t * a;
+			const uint8_t * b;
+			uint8_t wa, ha, wb, hb;
+			bool okA = GetFontxGlyph(fromFile, code, &a, &wa, &ha);
+			bool okB = GetFontxGlyph(fromMem, code, &b, &wb, &hb);
+			if (!okA || !okB || wa != wb || ha != hb || memcmp(a, b, glyphSize) != 0) mismatches++;
+			// Glyphs are read in place from the image
+			if (okB && (b < image + 17 || b + glyphSize > image + size)) mismatches++;
+		}
+	}
+	CHECK_EQ(mismatches, 0);
+
+	// GetFontx copies the same pattern out
+	uint8_t copy[FontxGlyphBufSize];
+	const uint8_t * glyph;
+	CHECK(GetFontx(fromMem, 'A', copy, &pw, &ph));
+	CHECK(GetFontxGlyph(fromMem, 'A', &glyph, NULL, NULL));
+	CHECK(memcmp(copy, glyph, glyphSize) == 0);
+
+	CloseFontx(&fromFile[0]);
+	CloseFontx(&fromMem[0]);
+	free(image);
+}
+
+static void testCorruptImages(void)
+{
+	FontxFile fx[2];
+	size_t size;
+	const uint8_t * glyph;
+	uint8_t * image = loadImage(REPO_ROOT "/font/ILGH16XB.FNT", &size);
+	CHECK(image != NULL);
+	if (image == NULL) return;
+
+	// Zero width or height: rejected before the glyph count divides by the glyph size
+	for(int field=14;field<=15;field++) {
+		uint8_t saved = image[field];
+		image[field] = 0;
+		InitFontxMem(fx, "zero", image, image + size);
+		CHECK(!OpenFontx(&fx[0]));
+		CHECK(!GetFontxGlyph(fx, 'A', &glyph, NULL, NULL));
+		CHECK(!GetFontxMetrics(fx, NULL, NULL));
+		CloseFontx(&fx[0]);
+		image[field] = saved;
+	}
+
+	// Not a FONTX image, or shorter than its header
+	InitFontxMem(fx, "short", image, image + 10);
+	CHECK(!OpenFontx(&fx[0]));
+	image[0] = 'X';
+	InitFontxMem(fx, "magic", image, image + size);
+	CHECK(!OpenFontx(&fx[0]));
+	image[0] = 'F';
+
+	// A truncated table only serves the glyphs it holds
+	InitFontxMem(fx, "truncated", image, image + 17 + 16 * 'A');
+	CHECK(OpenFontx(&fx[0]));
+	CHECK(GetFontxGlyph(fx, 'A' - 1, &glyph, NULL, NULL));
+	CHECK(!GetFontxGlyph(fx, 'A', &glyph, NULL, NULL));
+	CloseFontx(&fx[0]);
+	free(image);
+}
+
+int main(void)
+{
+	testSameGlyphs(REPO_ROOT "/font/ILGH16XB.FNT", 8, 16);
+	testSameGlyphs(REPO_ROOT "/font/ILGH24XB.FNT", 12, 24);
+	testSameGlyphs(REPO_ROOT "/font/ILGH32XB.FNT", 16, 32);
+	testCorruptImages();
+	return checkResult();
+}
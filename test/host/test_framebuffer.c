@@ -0,0 +1,154 @@
+/*
+ Shadow frame buffer and dirty-rectangle flush, counted on the fake SPI bus
+
+ The panel is the GUI one: ILI9341, 240x320, RGB565.
+*/
+#include <string.h>
+#include <stdint.h>
+
+#include "ili9340.h"
+#include "spi_fake.h"
+#include "check.h"
+
+#define WIDTH	240
+#define HEIGHT	320
+#define DC_GPIO	2
+
+#define FRAME_BYTES	(WIDTH * HEIGHT * 2)
+#define BURSTS(bytes)	(((bytes) + TFT_MAX_TRANSFER - 1) / TFT_MAX_TRANSFER)
+
+// Data bytes of the last transfers, in bus order
+static uint8_t captured[FRAME_BYTES + 64];
+static size_t capturedSize;
+
+static void capture(void * ctx, int mode, const uint8_t * data, size_t size)
+{
+	if (mode == 0) return;
+	if (capturedSize + size > sizeof(captured)) return;
+	memcpy(&captured[capturedSize], data, size);
+	capturedSize += size;
+}
+
+static void resetBus(void)
+{
+	spi_fake_reset_stats();
+	capturedSize = 0;
+}
+
+// A window is 3 commands and 2 address transfers of 4 bytes
+#define WINDOW_TRANSACTIONS	5
+#define WINDOW_DATA_BYTES	8
+
+static void testFirstFlush(TFT_t * dev)
+{
+	// Enabling starts from a black frame that is entirely dirty
+	CHECK(lcdEnableFrameBuffer(dev));
+	resetBus();
+	lcdFlush(dev);
+	CHECK_EQ(spi_fake.transactions, WINDOW_TRANSACTIONS + BURSTS(FRAME_BYTES));
+	CHECK_EQ(spi_fake.data_bytes, WINDOW_DATA_BYTES + FRAME_BYTES);
+
+	// Nothing changed, nothing to send
+	resetBus();
+	lcdFlush(dev);
+	CHECK_EQ(spi_fake.transactions, 0);
+}
+
+static void testSmallRect(TFT_t * dev)
+{
+	resetBus();
+	lcdDrawFillRect(dev, 20, 30, 29, 39, RED);
+	CHECK_EQ(spi_fake.transactions, 0);
+	lcdFlush(dev);
+	CHECK_EQ(spi_fake.transactions, WINDOW_TRANSACTIONS + 1);
+	CHECK_EQ(spi_fake.data_bytes, WINDOW_DATA_BYTES + 10 * 10 * 2);
+
+	// The pixels go out big-endian after the two address transfers
+	int wrong = 0;
+	for(size_t i=WINDOW_DATA_BYTES;i<capturedSize;i+=2) {
+		if (captured[i] != (RED >> 8) || captured[i+1] != (RED & 0xFF)) wrong++;
+	}
+	CHECK_EQ(wrong, 0);
+}
+
+static void testDisjointRects(TFT_t * dev)
+{
+	// Far apart changes are flushed as separate windows, not as their bounding box
+	resetBus();
+	lcdDrawPixel(dev, 0, 0, WHITE);
+	lcdDrawFillRect(dev, 200, 300, 209, 309, BLUE);
+	lcdFlush(dev);
+	CHECK_EQ(spi_fake.transactions, 2 * (WINDOW_TRANSACTIONS + 1));
+	CHECK_EQ(spi_fake.data_bytes, 2 * WINDOW_DATA_BYTES + 2 + 10 * 10 * 2);
+
+	// Overlapping draws are merged into one window
+	resetBus();
+	lcdDrawFillRect(dev, 50, 50, 69, 59, GREEN);
+	lcdDrawFillRect(dev, 60, 50, 79, 59, GREEN);
+	lcdFlush(dev);
+	CHECK_EQ(spi_fake.transactions, WINDOW_TRANSACTIONS + 1);
+	CHECK_EQ(spi_fake.data_bytes, WINDOW_DATA_BYTES + 30 * 10 * 2);
+}
+
+static void testFullWidthRows(TFT_t * dev)
+{
+	// Full width bands are contiguous in the frame buffer and go out in DMA sized bursts
+	resetBus();
+	lcdDrawFillRect(dev, 0, 100, WIDTH-1, 139, YELLOW);
+	lcdFlush(dev);
+	CHECK_EQ(spi_fake.transactions, WINDOW_TRANSACTIONS + BURSTS(WIDTH * 40 * 2));
+	CHECK_EQ(spi_fake.data_bytes, WINDOW_DATA_BYTES + WIDTH * 40 * 2);
+}
+
+// A menu row: background bar and a 16 character label, drawn directly and through the frame buffer
+static void testMenuRow(TFT_t * dev)
+{
+	FontxFile fx[2];
+	uint8_t text[] = "Sensor config   ";
+
+	InitFontx(fx, REPO_ROOT "/font/ILGH16XB.FNT", "");
+	lcdSetFontDirection(dev, DIRECTION90);
+	lcdSetFontFill(dev, WHITE);
+
+	lcdDisableFrameBuffer(dev);
+	resetBus();
+	lcdDrawFillRect(dev, 150, 0, 170, HEIGHT-1, WHITE);
+	lcdDrawString(dev, fx, 152, 300, text, BLACK);
+	uint32_t directTransactions = spi_fake.transactions;
+	uint64_t directBytes = spi_fake.bytes;
+
+	CHECK(lcdEnableFrameBuffer(dev));
+	lcdFlush(dev);
+	resetBus();
+	lcdDrawFillRect(dev, 150, 0, 170, HEIGHT-1, WHITE);
+	lcdDrawString(dev, fx, 152, 300, text, BLACK);
+	lcdFlush(dev);
+	uint32_t bufferedTransactions = spi_fake.transactions;
+	uint64_t bufferedBytes = spi_fake.bytes;
+
+	printf("menu row: direct %u transactions %llu bytes, frame buffer %u transactions %llu bytes\n",
+		directTransactions, (unsigned long long)directBytes, bufferedTransactions, (unsigned long long)bufferedBytes);
+	// One window for the whole row, its pixels in as few bursts as the staging buffers allow
+	CHECK(bufferedTransactions < directTransactions);
+	CHECK_EQ(bufferedBytes, 3 + WINDOW_DATA_BYTES + 21 * HEIGHT * 2);
+	lcdUnsetFontFill(dev);
+	CloseFontx(&fx[0]);
+}
+
+int main(void)
+{
+	TFT_t dev;
+
+	spi_fake.dc_gpio = DC_GPIO;
+	spi_fake.sink = capture;
+	spi_master_init(&dev, 23, 18, 14, DC_GPIO, -1, -1, -1, -1, -1, -1, -1);
+	lcdInit(&dev, 0x9341, WIDTH, HEIGHT, 0, 0);
+
+	testFirstFlush(&dev);
+	testSmallRect(&dev);
+	testDisjointRects(&dev);
+	testFullWidthRows(&dev);
+	testMenuRow(&dev);
+	lcdDisableFrameBuffer(&dev);
+	return checkResult();
+}
@@ -0,0 +1,63 @@
+/*
+ If-None-Match handling of the wifi manager's web server
+
+ http_etag_match decides between a 304 and the whole gzipped asset. The
+ ETags tested against are the ones web_assets.py generates for the build,
+ a quoted hash of each file.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "http_etag.h"
+#include "web_assets.h"
+#include "check.h"
+
+static const char *const etags[] = { index_html_etag, code_js_etag, style_css_etag };
+
+static void testHeader(const char *etag)
+{
+	char header[256];
+
+	// Plain, weak, wildcard
+	CHECK(http_etag_match(etag, etag));
+	snprintf(header, sizeof(header), "W/%s", etag);
+	CHECK(http_etag_match(header, etag));
+	CHECK(http_etag_match("*", etag));
+	CHECK(!http_etag_match("", etag));
+
+	// Anywhere in a list, quoted tags may hold commas
+	snprintf(header, sizeof(header), "\"abc\", \"x,y\" ,%s", etag);
+	CHECK(http_etag_match(header, etag));
+	snprintf(header, sizeof(header), "\"x,%.*s\"", (int)strlen(etag) - 1, etag + 1);
+	CHECK(!http_etag_match(header, etag));
+	snprintf(header, sizeof(header), "\"a\",\tW/%s", etag);
+	CHECK(http_etag_match(header, etag));
+
+	// Prefixes, extensions, missing quotes and a torn header do not match
+	snprintf(header, sizeof(header), "%.*s\"", (int)strlen(etag) - 2, etag);
+	CHECK(!http_etag_match(header, etag));
+	snprintf(header, sizeof(header), "%.*sX\"", (int)strlen(etag) - 1, etag);
+	CHECK(!http_etag_match(header, etag));
+	snprintf(header, sizeof(header), "%.*s", (int)strlen(etag) - 2, etag + 1);
+	CHECK(!http_etag_match(header, etag));
+	snprintf(header, sizeof(header), "%.*s", (int)strlen(etag) - 1, etag);
+	CHECK(!http_etag_match(header, etag));
+	CHECK(!http_etag_match("\"unterminated, *", etag));
+}
+
+int main(void)
+{
+	int count = sizeof(etags) / sizeof(etags[0]);
+
+	for (int i = 0; i < count; i++) {
+		// A quoted 64 bit hash, unique per asset
+		CHECK_EQ(strlen(etags[i]), 18);
+		CHECK(etags[i][0] == '"' && etags[i][17] == '"');
+		for (int k = 0; k < count; k++) {
+			CHECK_EQ(http_etag_match(etags[k], etags[i]), i == k);
+		}
+		testHeader(etags[i]);
+	}
+	return checkResult();
+}
@@ -0,0 +1,204 @@
+/*
+ JPEG display: decode_jpeg_draw and decode_jpeg against a stub tjpgd
+
+ shim/tjpgd.c emits the MCU rects of an uncompressed test image the way the
+ ROM decoder does, 1/2^N reduced, so every pixel is known. Images are drawn
+ into the gateway's 128x160 ST7735 in the simulator: native size, 1/2,
+ 1/8 and then resampled, with partial MCUs, and clipped at the panel edge.
+ The panel must hold exactly the expected source pixels, the rest the
+ background. An origin off the panel must be refused without a transfer.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ili9340.h"
+#include "tft_sim.h"
+#include "decode_jpeg.h"
+#include "resample.h"
+#include "check.h"
+
+#define WIDTH	128
+#define HEIGHT	160
+#define BACKGROUND	0x1234
+
+#define rgb565(r, g, b) ((((r) & 0xF8) << 8) | (((g) & 0xFC) << 3) | ((b) >> 3))
+
+typedef struct {
+	const char *name;
+	uint16_t width;
+	uint16_t height;
+	uint8_t mcu;	// MCU width and height
+	uint16_t x;	// where it is drawn
+	uint16_t y;
+	uint16_t boxWidth;
+	uint16_t boxHeight;
+	uint8_t scale;	// tjpgd reduction expected
+	bool resampled;	// still too large after it
+} Case;
+
+static const Case cases[] = {
+	{ "native", 100, 70, 16, 10, 20, WIDTH, HEIGHT, 0, false },
+	{ "native, 8x8 MCUs", 37, 53, 8, 0, 0, WIDTH, HEIGHT, 0, false },
+	{ "half", 256, 300, 16, 0, 0, WIDTH, HEIGHT, 1, false },
+	{ "quarter, partial MCUs", 250, 330, 16, 0, 0, WIDTH, HEIGHT, 2, false },
+	{ "eighth and resampled", 1200, 1000, 16, 0, 0, WIDTH, HEIGHT, 3, true },
+	{ "box", 900, 200, 16, 13, 7, 100, 60, 3, true },
+	{ "clipped at the corner", 100, 70, 16, 120, 150, WIDTH, HEIGHT, 3, true },
+};
+
+typedef struct {
+	uint16_t width;
+	uint16_t height;
+	uint8_t *rgb;
+} Image;
+
+static Image makeImage(uint16_t width, uint16_t height)
+{
+	Image image = { width, height, malloc((size_t)width * height * 3) };
+	uint32_t seed = width * 31u + height;
+	for (size_t i = 0; i < (size_t)width * height * 3; i++) {
+		seed = seed * 1103515245u + 12345u;
+		image.rgb[i] = seed >> 24;
+	}
+	return image;
+}
+
+static bool writeImage(const char *path, const Image *image, uint8_t mcu)
+{
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) return false;
+	uint8_t header[10] = { 'T', 'J', 'P', 'G', image->width, image->width >> 8, image->height, image->height >> 8, mcu, mcu };
+	fwrite(header, 1, sizeof(header), f);
+	fwrite(image->rgb, 3, (size_t)image->width * image->height, f);
+	return fclose(f) == 0;
+}
+
+static uint16_t sourcePixel(const Image *image, uint32_t x, uint32_t y)
+{
+	const uint8_t *p = &image->rgb[((size_t)y * image->width + x) * 3];
+	return rgb565(p[0], p[1], p[2]);
+}
+
+static void checkDraw(TFT_t *dev, TFTSim *sim, const Case *c, const Image *image, const char *path)
+{
+	int width = (c->x + c->boxWidth > WIDTH) ? WIDTH - c->x : c->boxWidth;
+	int height = (c->y + c->boxHeight > HEIGHT) ? HEIGHT - c->y : c->boxHeight;
+	resample_t rs;
+	resampleInit(&rs, c->width >> c->scale, c->height >> c->scale, width, height, RESAMPLE_NEAREST);
+	CHECK_EQ(!resampleIsIdentity(&rs), c->resampled);
+
+	lcdFillScreen(dev, BACKGROUND);
+	uint16_t imageWidth = 0, imageHeight = 0;
+	CHECK_EQ(decode_jpeg_draw(dev, (char *)path, c->x, c->y, c->boxWidth, c->boxHeight, &imageWidth, &imageHeight), ESP_OK);
+	CHECK_EQ(imageWidth, rs.dstWidth);
+	CHECK_EQ(imageHeight, rs.dstHeight);
+	CHECK(!dev->_pipeline);
+
+	// Each panel pixel is the first reduced pixel that maps to it
+	int wrong = 0;
+	for (int y = 0; y < HEIGHT; y++) {
+		for (int x = 0; x < WIDTH; x++) {
+			int dx = x - c->x, dy = y - c->y;
+			uint16_t pixel = BACKGROUND;
+			if (dx >= 0 && dy >= 0 && dx < rs.dstWidth && dy < rs.dstHeight) {
+				pixel = sourcePixel(image, resampleUnmap(&rs, dx) << c->scale, resampleUnmap(&rs, dy) << c->scale);
+			}
+			if (tft_sim_get_pixel(sim, x, y) != pixel) wrong++;
+		}
+	}
+	if (wrong) {
+		printf("%s (%dx%d) at %d,%d: %d pixels differ\n", c->name, c->width, c->height, c->x, c->y, wrong);
+		CHECK(false);
+	}
+	resampleFree(&rs);
+}
+
+static void checkMatrix(const Case *c, const Image *image, const char *path)
+{
+	// Nothing is clipped here, the reduction is for the whole box
+	uint8_t scale = 0;
+	while (scale < 3 && (c->width > c->boxWidth << scale || c->height > c->boxHeight << scale)) scale++;
+	resample_t rs;
+	resampleInit(&rs, c->width >> scale, c->height >> scale, c->boxWidth, c->boxHeight, RESAMPLE_NEAREST);
+
+	pixel_jpeg **pixels;
+	uint16_t imageWidth = 0, imageHeight = 0;
+	CHECK_EQ(decode_jpeg(&pixels, (char *)path, c->boxWidth, c->boxHeight, &imageWidth, &imageHeight), ESP_OK);
+	CHECK_EQ(imageWidth, rs.dstWidth);
+	CHECK_EQ(imageHeight, rs.dstHeight);
+
+	// Each reduced pixel lands on the one it maps to, the last one wins
+	int wrong = 0;
+	for (int y = 0; y < imageHeight; y++) {
+		for (int x = 0; x < imageWidth; x++) {
+			uint32_t sx = resampleUnmap(&rs, x + 1) - 1, sy = resampleUnmap(&rs, y + 1) - 1;
+			if (sx >= rs.srcWidth) sx = rs.srcWidth - 1;
+			if (sy >= rs.srcHeight) sy = rs.srcHeight - 1;
+			if (pixels[y][x] != sourcePixel(image, sx << scale, sy << scale)) wrong++;
+		}
+	}
+	if (wrong) {
+		printf("%s (%dx%d) into %dx%d: %d pixels differ\n", c->name, c->width, c->height, c->boxWidth, c->boxHeight, wrong);
+		CHECK(false);
+	}
+	release_image(&pixels, c->boxWidth, c->boxHeight);
+	resampleFree(&rs);
+}
+
+static void checkErrors(TFT_t *dev, TFTSim *sim, const char *path)
+{
+	uint16_t w, h;
+
+	// Off the panel: nothing allocated, nothing sent
+	tft_sim_reset_stats(sim);
+	CHECK_EQ(decode_jpeg_draw(dev, (char *)path, WIDTH, 0, WIDTH, HEIGHT, &w, &h), ESP_ERR_INVALID_ARG);
+	CHECK_EQ(decode_jpeg_draw(dev, (char *)path, 0, HEIGHT, WIDTH, HEIGHT, &w, &h), ESP_ERR_INVALID_ARG);
+	CHECK_EQ(decode_jpeg_draw(dev, (char *)path, 0xFFFF, 0xFFFF, WIDTH, HEIGHT, &w, &h), ESP_ERR_INVALID_ARG);
+	CHECK_EQ(sim->bytes, 0);
+
+	CHECK_EQ(decode_jpeg_draw(dev, "missing.tjpg", 0, 0, WIDTH, HEIGHT, &w, &h), ESP_ERR_NOT_FOUND);
+	pixel_jpeg **pixels;
+	CHECK_EQ(decode_jpeg(&pixels, "missing.tjpg", WIDTH, HEIGHT, &w, &h), ESP_ERR_NOT_FOUND);
+
+	FILE *f = fopen("bad.tjpg", "wb");
+	fputs("JFIF and then some", f);
+	fclose(f);
+	CHECK_EQ(decode_jpeg_draw(dev, "bad.tjpg", 0, 0, WIDTH, HEIGHT, &w, &h), ESP_ERR_NOT_SUPPORTED);
+	CHECK_EQ(decode_jpeg(&pixels, "bad.tjpg", WIDTH, HEIGHT, &w, &h), ESP_ERR_NOT_SUPPORTED);
+
+	// Cut off in the pixel data
+	Image image = makeImage(64, 64);
+	writeImage("short.tjpg", &image, 16);
+	CHECK_EQ(truncate("short.tjpg", 10 + 64 * 40 * 3), 0);
+	CHECK_EQ(decode_jpeg_draw(dev, "short.tjpg", 0, 0, WIDTH, HEIGHT, &w, &h), ESP_ERR_NOT_SUPPORTED);
+	CHECK(!dev->_pipeline);
+	free(image.rgb);
+}
+
+int main(void)
+{
+	static TFTSim sim;
+	TFT_t dev;
+
+	CHECK(tft_sim_init(&sim, WIDTH, HEIGHT, 40 * 1000 * 1000));
+	TFT_Transport transport = { .ctx = &sim, .write = tft_sim_write };
+	lcdAttachTransport(&dev, &transport);
+	lcdInit(&dev, 0x7735, WIDTH, HEIGHT, 0, 0);
+
+	for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		const Case *c = &cases[i];
+		char path[64];
+		snprintf(path, sizeof(path), "case%d.tjpg", i);
+		Image image = makeImage(c->width, c->height);
+		CHECK(writeImage(path, &image, c->mcu));
+		checkDraw(&dev, &sim, c, &image, path);
+		checkMatrix(c, &image, path);
+		free(image.rgb);
+	}
+	checkErrors(&dev, &sim, "case0.tjpg");
+
+	tft_sim_free(&sim);
+	return checkResult();
+}
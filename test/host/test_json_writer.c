@@ -0,0 +1,136 @@
+/*
+ JSON output of the wifi manager's status and scan pages
+
+ json_writer_t appends into a fixed buffer. Strings are escaped in one
+ pass, a write that does not fit leaves the output cut at the last whole
+ write and rewinding drops what came after a mark. The buffers are
+ allocated to their exact size so the sanitizer build sees any write past
+ the end.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "json.h"
+#include "check.h"
+
+static void testEscaping(void)
+{
+	char buf[256];
+	json_writer_t writer;
+
+	json_writer_init(&writer, buf, sizeof(buf));
+	CHECK(json_write_string(&writer, (const unsigned char *)"a\"b\\c/d\b\f\n\r\t\x01\x1f\x7f\xc3\xa9", SIZE_MAX));
+	CHECK(strcmp(buf, "\"a\\\"b\\\\c/d\\b\\f\\n\\r\\t\\u0001\\u001f\x7f\xc3\xa9\"") == 0);
+	CHECK_EQ(writer.len, strlen(buf));
+
+	// Every control character is escaped
+	for (int c = 1; c < 32; c++) {
+		unsigned char in[2] = { c, 0 };
+		json_writer_init(&writer, buf, sizeof(buf));
+		CHECK(json_write_string(&writer, in, SIZE_MAX));
+		CHECK(strchr(buf + 1, c) == NULL);
+		CHECK(buf[1] == '\\');
+	}
+
+	// A 32 byte SSID field without a terminator, and no string at all
+	unsigned char ssid[32];
+	memset(ssid, 'x', sizeof(ssid));
+	json_writer_init(&writer, buf, sizeof(buf));
+	CHECK(json_write_string(&writer, ssid, sizeof(ssid)));
+	CHECK_EQ(writer.len, sizeof(ssid) + 2);
+	CHECK(json_write_str(&writer, ","));
+	CHECK(json_write_string(&writer, NULL, SIZE_MAX));
+	CHECK(strcmp(buf + sizeof(ssid) + 2, ",\"\"") == 0);
+
+	json_writer_init(&writer, buf, sizeof(buf));
+	CHECK(json_write_int(&writer, 0));
+	CHECK(json_write_str(&writer, ","));
+	CHECK(json_write_int(&writer, -42));
+	CHECK(json_write_str(&writer, ","));
+	CHECK(json_write_int(&writer, INT_MAX));
+	CHECK(json_write_str(&writer, ","));
+	CHECK(json_write_int(&writer, INT_MIN));
+	CHECK(strcmp(buf, "0,-42,2147483647,-2147483648") == 0);
+}
+
+static void testTruncation(void)
+{
+	const char *want = "{\"ssid\":\"a\\nb\"}";
+	size_t full = strlen(want);
+
+	// Every buffer size up to the one that fits
+	for (size_t size = 0; size <= full + 1; size++) {
+		char *buf = malloc(size ? size : 1);
+		json_writer_t writer;
+		json_writer_init(&writer, buf, size);
+		bool ok = json_write_str(&writer, "{\"ssid\":");
+		size_t mark = writer.len;
+		ok = json_write_string(&writer, (const unsigned char *)"a\nb", SIZE_MAX) && ok;
+		ok = json_write_str(&writer, "}") && ok;
+
+		CHECK_EQ(ok, size == full + 1);
+		CHECK_EQ(writer.overflow, !ok);
+		if (size > 0) {
+			CHECK_EQ(strlen(buf), writer.len);
+			CHECK(strncmp(buf, want, writer.len) == 0);
+		}
+		// Never half a string: the output ends before or after it
+		if (!ok) CHECK(writer.len == 0 || writer.len == mark || writer.len == full - 1);
+
+		// Overflow is sticky until a rewind
+		CHECK_EQ(json_write_raw(&writer, "", 0), ok);
+		free(buf);
+	}
+
+	char out[8];
+	CHECK(json_print_string((const unsigned char *)"a\tb", (unsigned char *)out, sizeof(out)));
+	CHECK(strcmp(out, "\"a\\tb\"") == 0);
+	CHECK(!json_print_string((const unsigned char *)"a\tbc", (unsigned char *)out, 7));
+	CHECK(strcmp(out, "") == 0);
+	CHECK(!json_print_string((const unsigned char *)"", (unsigned char *)out, 0));
+	CHECK(!json_print_string((const unsigned char *)"", NULL, sizeof(out)));
+}
+
+static void testRewind(void)
+{
+	// Drop an element that did not fit and close the list, as the scan page does
+	char *buf = malloc(16);
+	json_writer_t writer;
+	json_writer_init(&writer, buf, 16);
+	CHECK(json_write_str(&writer, "["));
+	CHECK(json_write_string(&writer, (const unsigned char *)"one", SIZE_MAX));
+	size_t mark = writer.len;
+	CHECK(json_write_str(&writer, ","));
+	CHECK(!json_write_string(&writer, (const unsigned char *)"too long to fit", SIZE_MAX));
+	CHECK(writer.overflow);
+	json_writer_rewind(&writer, mark);
+	CHECK(!writer.overflow);
+	CHECK(json_write_str(&writer, "]"));
+	CHECK(strcmp(buf, "[\"one\"]") == 0);
+
+	// Forward is not a rewind
+	json_writer_rewind(&writer, writer.len + 1);
+	CHECK(strcmp(buf, "[\"one\"]") == 0);
+	json_writer_rewind(&writer, 0);
+	CHECK_EQ(writer.len, 0);
+	CHECK(strcmp(buf, "") == 0);
+	free(buf);
+
+	// A writer without a buffer stays without one
+	json_writer_init(&writer, NULL, 0);
+	CHECK(writer.overflow);
+	json_writer_rewind(&writer, 0);
+	CHECK(!json_write_str(&writer, ""));
+	CHECK_EQ(writer.len, 0);
+}
+
+int main(void)
+{
+	testEscaping();
+	testTruncation();
+	testRewind();
+	return checkResult();
+}
@@ -0,0 +1,118 @@
+/*
+ Queued transfers and the frame buffer
+
+ The fake bus runs deferred: a queued transfer reads its memory only when the
+ driver fetches its result, as late as the DMA could. After lcdFlush the GUI
+ draws again right away (gui.c releases guiMutex), that must not change what
+ reaches the panel.
+*/
+#include <string.h>
+#include <stdint.h>
+
+#include "ili9340.h"
+#include "spi_fake.h"
+#include "check.h"
+
+#define WIDTH	240
+#define HEIGHT	320
+#define DC_GPIO	2
+
+// Pixel data in bus order, i.e. data following a Memory Write command
+static uint8_t captured[WIDTH * HEIGHT * 2];
+static size_t capturedSize;
+static uint8_t lastCommand;
+
+static void capture(void * ctx, int mode, const uint8_t * data, size_t size)
+{
+	if (mode == 0) {
+		lastCommand = data[size-1];
+		return;
+	}
+	if (lastCommand != 0x2C && lastCommand != 0x22) return;
+	if (capturedSize + size > sizeof(captured)) return;
+	memcpy(&captured[capturedSize], data, size);
+	capturedSize += size;
+}
+
+static int countWrong(uint16_t color)
+{
+	int wrong = 0;
+	for(size_t i=0;i+1<capturedSize;i+=2) {
+		if (captured[i] != (color >> 8) || captured[i+1] != (color & 0xFF)) wrong++;
+	}
+	return wrong;
+}
+
+static void initPanel(TFT_t * dev, uint16_t model, int width, int height)
+{
+	spi_fake.defer = false;
+	spi_master_init(dev, 23, 18, 14, DC_GPIO, -1, -1, -1, -1, -1, -1, -1);
+	lcdInit(dev, model, width, height, 0, 0);
+	lcdEnablePipeline(dev);
+	CHECK(lcdEnableFrameBuffer(dev));
+	lcdFlush(dev);
+	lcdSync(dev);
+	spi_fake.defer = true;
+}
+
+// Draw, flush, draw over the same area at once, then let the bus drain
+static void flushThenRedraw(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+	lcdDrawFillRect(dev, x1, y1, x2, y2, RED);
+	capturedSize = 0;
+	lcdFlush(dev);
+	lcdDrawFillRect(dev, x1, y1, x2, y2, BLUE);
+	lcdSync(dev);
+	CHECK_EQ(capturedSize, (x2 - x1 + 1) * (y2 - y1 + 1) * 2);
+	CHECK_EQ(countWrong(RED), 0);
+	lcdFlush(dev);
+	lcdSync(dev);
+}
+
+static void testFullWidth(void)
+{
+	TFT_t dev;
+	initPanel(&dev, 0x9341, WIDTH, HEIGHT);
+	flushThenRedraw(&dev, 0, 100, WIDTH-1, 139);
+	CHECK(spi_fake.in_flight_max <= TFT_QUEUE_SIZE);
+	spi_fake.defer = false;
+	lcdDisableFrameBuffer(&dev);
+}
+
+static void testIli9225(void)
+{
+	TFT_t dev;
+	initPanel(&dev, 0x9225, 176, 220);
+	flushThenRedraw(&dev, 10, 20, 49, 59);
+	spi_fake.defer = false;
+	lcdDisableFrameBuffer(&dev);
+}
+
+// Partial rows are gathered into staging buffers, so the flush may return with transfers in flight
+static void testPartialRows(void)
+{
+	TFT_t dev;
+	initPanel(&dev, 0x9341, WIDTH, HEIGHT);
+	lcdDrawFillRect(&dev, 10, 10, 109, 69, RED);
+	capturedSize = 0;
+	lcdFlush(&dev);
+	CHECK(spi_fake.in_flight > 0);
+	lcdDrawFillRect(&dev, 10, 10, 109, 69, BLUE);
+	lcdSync(&dev);
+	CHECK_EQ(spi_fake.in_flight, 0);
+	CHECK_EQ(capturedSize, 100 * 60 * 2);
+	CHECK_EQ(countWrong(RED), 0);
+	spi_fake.defer = false;
+	lcdDisableFrameBuffer(&dev);
+}
+
+int main(void)
+{
+	spi_fake.dc_gpio = DC_GPIO;
+	spi_fake.sink = capture;
+
+	testFullWidth();
+	testIli9225();
+	testPartialRows();
+	return checkResult();
+}
@@ -0,0 +1,179 @@
+/*
+ RCU snapshots of the wifi manager under pthreads
+
+ One writer publishes snapshots like wifi_manager.c does: refcounted, sized
+ to their content, retired through rcu.c. Reader threads look at the
+ current one inside read sections, some keep a reference across sections
+ like an HTTP response does and hold it for a while. Reclaimed snapshots are
+ poisoned before they are freed, so a reader seeing one too early finds
+ its content broken (and AddressSanitizer the access).
+
+ Every read must find an intact snapshot, versions seen by a reader only
+ go up, and once the last one is unpublished everything is freed.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "rcu.h"
+#include "check.h"
+
+#define READERS	2
+#define PUBLISHES	100000	// at least, and until the readers have read this many times
+#define MIN_READS	200000
+#define MAX_LEN	3200		// JSON_ACCESS_POINTS_SIZE
+
+typedef struct {
+	uint32_t version;
+	_Atomic uint32_t refs;
+	size_t len;
+	char data[];
+} Snapshot;
+
+typedef struct {
+	unsigned seed;
+	uint64_t reads;
+	uint64_t held;
+	uint64_t broken;
+	uint64_t backwards;
+} Reader;
+
+static rcu_domain_t domain;
+static rcu_ptr_t slot;
+static _Atomic int stop;
+static _Atomic uint64_t created, freed, reads;
+
+static size_t lengthOf(uint32_t version)
+{
+	return 8 + (version * 2654435761u >> 8) % (MAX_LEN - 8);
+}
+
+static Snapshot *create(uint32_t version)
+{
+	size_t len = lengthOf(version);
+	Snapshot *snapshot = malloc(sizeof(Snapshot) + len + 1);
+	snapshot->version = version;
+	atomic_init(&snapshot->refs, 0);
+	snapshot->len = len;
+	snprintf(snapshot->data, 9, "%08x", (unsigned)version);
+	memset(snapshot->data + 8, 'a' + version % 26, len - 8);
+	snapshot->data[len] = '\0';
+	atomic_fetch_add(&created, 1);
+	return snapshot;
+}
+
+static bool intact(const Snapshot *snapshot)
+{
+	char head[9];
+	snprintf(head, sizeof(head), "%08x", (unsigned)snapshot->version);
+	if (snapshot->len != lengthOf(snapshot->version) || memcmp(snapshot->data, head, 8) != 0) return false;
+	for (size_t i = 8; i < snapshot->len; i++) {
+		if (snapshot->data[i] != 'a' + snapshot->version % 26) return false;
+	}
+	return snapshot->data[snapshot->len] == '\0';
+}
+
+static bool reclaim(void *ptr)
+{
+	Snapshot *snapshot = ptr;
+	if (atomic_load(&snapshot->refs) != 0) return false;
+	memset(snapshot, 0xA5, sizeof(Snapshot) + snapshot->len + 1);
+	free(snapshot);
+	atomic_fetch_add(&freed, 1);
+	return true;
+}
+
+static void *readerThread(void *arg)
+{
+	Reader *reader = arg;
+	Snapshot *held = NULL;
+	uint32_t last = 0;
+
+	while (!atomic_load(&stop)) {
+		uint32_t token = rcu_read_lock(&domain);
+		Snapshot *snapshot = rcu_dereference(&slot);
+		if (snapshot != NULL) {
+			// A snapshot freed and its memory reused while being read changes version
+			uint32_t version = snapshot->version;
+			// Preempted in the read section, the writer keeps publishing meanwhile
+			if (rand_r(&reader->seed) % 32 == 0) sched_yield();
+			if (!intact(snapshot) || snapshot->version != version) reader->broken++;
+			if (version < last) reader->backwards++;
+			last = version;
+			// Keep one past the read section now and then, like a response being sent
+			if (held == NULL && rand_r(&reader->seed) % 8 == 0) {
+				atomic_fetch_add(&snapshot->refs, 1);
+				held = snapshot;
+			}
+		}
+		rcu_read_unlock(&domain, token);
+		reader->reads++;
+		atomic_fetch_add(&reads, 1);
+
+		if (held != NULL && rand_r(&reader->seed) % 16 == 0) {
+			if (!intact(held)) reader->broken++;
+			atomic_fetch_sub(&held->refs, 1);
+			held = NULL;
+			reader->held++;
+		}
+		if (rand_r(&reader->seed) % 64 == 0) sched_yield();
+	}
+	if (held != NULL) atomic_fetch_sub(&held->refs, 1);
+	return NULL;
+}
+
+static double nowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(void)
+{
+	pthread_t threads[READERS];
+	Reader readers[READERS] = { 0 };
+	double worstUs = 0;
+	uint32_t version = 1;
+
+	rcu_init(&domain, reclaim);
+	rcu_publish(&domain, &slot, create(version));
+	for (int i = 0; i < READERS; i++) {
+		readers[i].seed = i + 1;
+		pthread_create(&threads[i], NULL, readerThread, &readers[i]);
+	}
+
+	// Publishing only waits when RCU_MAX_RETIRED versions are all still held
+	while (version < PUBLISHES || atomic_load(&reads) < MIN_READS) {
+		Snapshot *snapshot = create(++version);
+		double start = nowUs();
+		rcu_publish(&domain, &slot, snapshot);
+		double us = nowUs() - start;
+		if (us > worstUs) worstUs = us;
+		CHECK(domain.retired_count <= RCU_MAX_RETIRED);
+	}
+	atomic_store(&stop, 1);
+
+	uint64_t held = 0;
+	for (int i = 0; i < READERS; i++) {
+		pthread_join(threads[i], NULL);
+		CHECK_EQ(readers[i].broken, 0);
+		CHECK_EQ(readers[i].backwards, 0);
+		CHECK(readers[i].reads > 0);
+		held += readers[i].held;
+	}
+
+	// Unpublished, the last version goes too
+	rcu_publish(&domain, &slot, NULL);
+	rcu_synchronize(&domain);
+	CHECK_EQ(domain.retired_count, 0);
+	CHECK_EQ(atomic_load(&domain.readers[0]) + atomic_load(&domain.readers[1]), 0);
+	CHECK_EQ(atomic_load(&created), version);
+	CHECK_EQ(atomic_load(&freed), version);
+	printf("%u publishes, %llu reads, %llu references held past a read section, slowest publish %.0f us\n",
+		(unsigned)version, (unsigned long long)atomic_load(&reads), (unsigned long long)held, worstUs);
+	return checkResult();
+}
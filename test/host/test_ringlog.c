@@ -0,0 +1,177 @@
+/*
+ Ring log on the file-backed flash emulator, with power cuts
+
+ The basic cases check the API contract and that recovery reads only the
+ sector headers and the newest sector. The power cut run appends, peeks
+ and acknowledges records of varying size until a cut scheduled at a
+ random byte, reopens the log and checks, 400 times over:
+
+	- an append or ack that returned ESP_OK is never lost
+	- every record returned is intact, in sequence order, without gaps
+	  other than the one record the cut tore
+	- records are only lost to a full log, and then counted in log.lost
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ringlog.h"
+#include "flash_emu.h"
+#include "check.h"
+
+#define SECTORS	8
+#define ROUNDS	400
+
+static void fill(uint8_t *data, uint32_t seq, uint16_t size)
+{
+	for (int i = 0; i < size; i++) data[i] = (uint8_t)(seq * 31 + i * 7 + size);
+}
+
+// Mostly small records, some close to the largest a sector takes
+static uint16_t sizeOf(uint32_t seq)
+{
+	uint32_t x = seq * 2654435761u;
+	return (x >> 8) % ((x & 1) ? 64 : 1500);
+}
+
+static bool intact(const uint8_t *data, uint32_t seq, uint16_t size)
+{
+	uint8_t want[RINGLOG_SECTOR_SIZE];
+	fill(want, seq, size);
+	return size == sizeOf(seq) && memcmp(data, want, size) == 0;
+}
+
+static void testBasics(FlashEmu *emu)
+{
+	static ringlog_t log;
+	uint8_t data[RINGLOG_SECTOR_SIZE];
+	uint16_t size;
+	uint32_t seq;
+
+	// Never erased flash has no valid sector and gets formatted, the first sector is opened
+	CHECK_EQ(ringlogOpen(&log, &emu->ops), ESP_OK);
+	CHECK_EQ(emu->erases, SECTORS + 1);
+	CHECK_EQ(ringlogPending(&log), 0);
+	CHECK_EQ(ringlogPeek(&log, data, sizeof(data), &size, &seq), ESP_ERR_NOT_FOUND);
+
+	for (uint32_t i = 0; i < 20; i++) {
+		fill(data, i, sizeOf(i));
+		CHECK_EQ(ringlogAppend(&log, data, sizeOf(i), &seq), ESP_OK);
+		CHECK_EQ(seq, i);
+	}
+	CHECK_EQ(ringlogAppend(&log, data, RINGLOG_MAX_RECORD + 1, &seq), ESP_ERR_INVALID_SIZE);
+	CHECK_EQ(ringlogPending(&log), 20);
+	CHECK_EQ(ringlogAck(&log, 20), ESP_ERR_INVALID_ARG);
+
+	// Peek stays on a record until it is acknowledged
+	CHECK_EQ(ringlogPeek(&log, data, sizeof(data), &size, &seq), ESP_OK);
+	CHECK_EQ(seq, 0);
+	CHECK_EQ(ringlogPeek(&log, data, sizeof(data), &size, &seq), ESP_OK);
+	CHECK_EQ(seq, 0);
+	CHECK(intact(data, seq, size));
+	for (uint32_t i = 0; i < 5; i++) {
+		CHECK_EQ(ringlogPeek(&log, data, sizeof(data), &size, &seq), ESP_OK);
+		CHECK_EQ(seq, i);
+		CHECK_EQ(ringlogAck(&log, seq), ESP_OK);
+	}
+	CHECK_EQ(ringlogPending(&log), 15);
+	uint32_t first = 5;
+	while (sizeOf(first) < 8) first++;
+	CHECK_EQ(ringlogAck(&log, first - 1), ESP_OK);
+	CHECK_EQ(ringlogPeek(&log, data, 4, &size, &seq), ESP_ERR_INVALID_SIZE);
+
+	// Recovery reads the sector headers and the records of the newest sector only
+	flashEmuResetStats(emu);
+	CHECK_EQ(ringlogOpen(&log, &emu->ops), ESP_OK);
+	CHECK(emu->readBytes <= SECTORS * RINGLOG_SECTOR_HEADER + 2 * RINGLOG_SECTOR_SIZE);
+	CHECK_EQ(emu->programs, 0);
+	CHECK_EQ(emu->erases, 0);
+	CHECK_EQ(ringlogPending(&log), 20 - first);
+	CHECK_EQ(ringlogPeek(&log, data, sizeof(data), &size, &seq), ESP_OK);
+	CHECK_EQ(seq, first);
+	CHECK(intact(data, seq, size));
+
+	// Overflow drops the oldest sector and counts what was not consumed
+	CHECK_EQ(ringlogFormat(&log), ESP_OK);
+	uint32_t appended = 0;
+	for (; appended < SECTORS * 4; appended++) {
+		fill(data, appended, 1500);
+		ringlogAppend(&log, data, 1500, NULL);
+	}
+	CHECK(log.lost > 0);
+	CHECK_EQ(ringlogPending(&log) + log.lost, appended);
+	CHECK_EQ(ringlogPeek(&log, data, sizeof(data), &size, &seq), ESP_OK);
+	CHECK_EQ(seq, log.lost);
+}
+
+static void testPowerCuts(FlashEmu *emu)
+{
+	static ringlog_t log;
+	uint8_t data[RINGLOG_SECTOR_SIZE];
+	uint32_t okAck = 0, lastOkSeq = 0, records = 0, lost = 0;
+	bool appended = false;
+	unsigned seed = 18;
+
+	memset(&log, 0, sizeof(log));
+	CHECK_EQ(ringlogOpen(&log, &emu->ops), ESP_OK);
+	CHECK_EQ(ringlogFormat(&log), ESP_OK);
+	for (int round = 0; round < ROUNDS; round++) {
+		// Three appends to one consumer step, so the log fills up now and then
+		flashEmuCutAfter(emu, rand_r(&seed) % 60000, round + 1);
+		while (!emu->dead) {
+			uint16_t size;
+			uint32_t seq;
+			if (rand_r(&seed) % 4) {
+				size = sizeOf(log.nextSeq);
+				fill(data, log.nextSeq, size);
+				if (ringlogAppend(&log, data, size, &seq) == ESP_OK) {
+					appended = true;
+					lastOkSeq = seq;
+					records++;
+				}
+			} else if (ringlogPeek(&log, data, sizeof(data), &size, &seq) == ESP_OK) {
+				CHECK(intact(data, seq, size));
+				CHECK((int32_t)(seq - log.ackSeq) >= 0);
+				if (ringlogAck(&log, seq) == ESP_OK) okAck = seq + 1;
+			}
+		}
+		lost += log.lost;
+
+		flashEmuPowerOn(emu);
+		CHECK_EQ(ringlogOpen(&log, &emu->ops), ESP_OK);
+		// Acks only move forward, a full log pushes them on
+		CHECK((int32_t)(log.ackSeq - okAck) >= 0);
+		if (appended) CHECK((int32_t)(log.nextSeq - (lastOkSeq + 1)) >= 0);
+
+		// Drain a copy: intact records in order, only the torn one may be missing
+		static ringlog_t copy;
+		copy = log;
+		uint32_t expect = log.ackSeq;
+		uint16_t size;
+		uint32_t seq;
+		while (ringlogPeek(&copy, data, sizeof(data), &size, &seq) == ESP_OK) {
+			if (!intact(data, seq, size) || (int32_t)(seq - expect) < 0 ||
+				(seq != expect && !(seq == expect + 1 && expect == lastOkSeq + 1))) {
+				printf("round %d: record %u after %u, last good append %u\n", round, seq, expect, lastOkSeq);
+				CHECK(false);
+			}
+			expect = seq + 1;
+			copy.ackSeq = seq + 1;
+		}
+		CHECK(expect == log.nextSeq || expect + 1 == log.nextSeq);
+		okAck = log.ackSeq;
+	}
+	printf("%d power cuts, %u records appended, %u lost to a full log, %llu erases\n",
+		ROUNDS, records, lost, (unsigned long long)emu->erases);
+}
+
+int main(void)
+{
+	FlashEmu emu;
+	CHECK(flashEmuOpen(&emu, "test_ringlog.flash", SECTORS * RINGLOG_SECTOR_SIZE));
+	if (emu.file == NULL) return checkResult();
+	testBasics(&emu);
+	testPowerCuts(&emu);
+	flashEmuClose(&emu);
+	return checkResult();
+}
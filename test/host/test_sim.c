@@ -0,0 +1,216 @@
+/*
+ Display simulator: GRAM decoding, per-command counters and the GUI menu screens
+
+ Frames are written as PNG files to the working directory (the build tree under ctest).
+*/
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "ili9340.h"
+#include "tft_sim.h"
+#include "widget.h"
+#include "menu.h"
+#include "spi_fake.h"
+#include "check.h"
+
+#define DC_GPIO	2
+#define FREQUENCY	SPI_MASTER_FREQ_40M
+
+// ST7735 panel of the gateway, menu.c lays the GUI out on it
+#define GUI_WIDTH	128
+#define GUI_HEIGHT	160
+
+static FontxFile fx16[2];
+
+static int countPixels(TFTSim * sim, uint16_t color)
+{
+	int count = 0;
+	for(int i=0;i<sim->width*sim->height;i++) {
+		if (sim->gram[i] == color) count++;
+	}
+	return count;
+}
+
+static void testFillScreen(void)
+{
+	static TFTSim sim;
+	TFT_t dev;
+
+	CHECK(tft_sim_init(&sim, 240, 320, FREQUENCY));
+	TFT_Transport transport = { .ctx = &sim, .write = tft_sim_write };
+	lcdAttachTransport(&dev, &transport);
+	lcdInit(&dev, 0x9341, 240, 320, 0, 0);
+
+	tft_sim_reset_stats(&sim);
+	lcdFillScreen(&dev, RED);
+	// One window, then the repeated colour run in TFT_MAX_TRANSFER bursts
+	CHECK_EQ(sim.commands[0x2A].count, 1);
+	CHECK_EQ(sim.commands[0x2B].count, 1);
+	CHECK_EQ(sim.commands[0x2C].count, 1);
+	CHECK_EQ(sim.commands[0x2C].transactions, 38);
+	CHECK_EQ(sim.commands[0x2C].bytes, 240 * 320 * 2);
+	CHECK_EQ(sim.transactions, 3 + 2 + 38);
+	CHECK_EQ(sim.pixels, 240 * 320);
+	CHECK_EQ(countPixels(&sim, RED), 240 * 320);
+	// 3 command, 8 address and 153600 pixel bytes at 40 MHz
+	CHECK_EQ(sim.wire_ns / 1000, 30722);
+
+	// A filled 9 glyph label is one window per glyph
+	lcdSetFontDirection(&dev, DIRECTION90);
+	lcdSetFontFill(&dev, WHITE);
+	tft_sim_reset_stats(&sim);
+	lcdDrawString(&dev, fx16, 200, 10, (uint8_t *)"Hello sim", BLACK);
+	CHECK_EQ(sim.commands[0x2C].count, 9);
+	CHECK_EQ(sim.commands[0x2C].bytes, 9 * 8 * 16 * 2);
+	CHECK_EQ(sim.clipped, 0);
+	CHECK(countPixels(&sim, BLACK) > 0);
+	CHECK(tft_sim_write_png(&sim, "sim_fill.png"));
+	tft_sim_free(&sim);
+}
+
+static void drawScene(TFT_t * dev)
+{
+	lcdFillScreen(dev, BG_COLOR);
+	lcdDrawFillRect(dev, 10, 20, 60, 90, BLUE);
+	lcdDrawLine(dev, 0, 0, 127, 159, RED);
+	lcdDrawCircle(dev, 64, 80, 30, GREEN);
+	lcdSetFontDirection(dev, DIRECTION0);
+	lcdDrawString(dev, fx16, 4, 130, (uint8_t *)"ESP path", BLACK);
+}
+
+// The simulator behind the fake ESP SPI driver sees the same GRAM and commands as behind a transport
+static void testSpiPathMatches(void)
+{
+	static TFTSim viaTransport;
+	static TFTSim viaSpi;
+	TFT_t dev;
+
+	CHECK(tft_sim_init(&viaTransport, GUI_WIDTH, GUI_HEIGHT, FREQUENCY));
+	TFT_Transport transport = { .ctx = &viaTransport, .write = tft_sim_write };
+	lcdAttachTransport(&dev, &transport);
+	lcdInit(&dev, 0x7735, GUI_WIDTH, GUI_HEIGHT, 0, 0);
+	drawScene(&dev);
+
+	CHECK(tft_sim_init(&viaSpi, GUI_WIDTH, GUI_HEIGHT, FREQUENCY));
+	spi_fake_reset();
+	spi_fake.dc_gpio = DC_GPIO;
+	spi_fake.ctx = &viaSpi;
+	spi_fake.sink = tft_sim_write;
+	spi_master_init(&dev, 23, 18, 14, DC_GPIO, -1, -1, -1, -1, -1, -1, -1);
+	lcdInit(&dev, 0x7735, GUI_WIDTH, GUI_HEIGHT, 0, 0);
+	lcdEnablePipeline(&dev);
+	drawScene(&dev);
+	lcdSync(&dev);
+	spi_fake.sink = NULL;
+
+	CHECK(memcmp(viaTransport.gram, viaSpi.gram, GUI_WIDTH * GUI_HEIGHT * 2) == 0);
+	CHECK_EQ(viaSpi.transactions, viaTransport.transactions);
+	CHECK_EQ(viaSpi.bytes, viaTransport.bytes);
+	CHECK(memcmp(viaTransport.commands, viaSpi.commands, sizeof(viaSpi.commands)) == 0);
+	tft_sim_free(&viaTransport);
+	tft_sim_free(&viaSpi);
+}
+
+static void report(const char * name, TFTSim * sim)
+{
+	printf("%-22s transactions=%5" PRIu32 " bytes=%6" PRIu64 " wire=%5" PRIu64 "us\n",
+		name, sim->transactions, sim->bytes, sim->wire_ns / 1000);
+}
+
+// gui.c's actions behind the menu entries, WiFi on and nothing else connected
+TickType_t dispListScreen(FontxFile *fx, int8_t option, menuScreen curScreen) { return 0; }
+void handleOnOffWiFiFunc(void) {}
+const char *labelOnOffWiFiFunc(void) { return "Turn off"; }
+bool statusWiFiFunc(void) { return true; }
+bool statusLTEFunc(void) { return false; }
+bool statusBLEFunc(void) { return false; }
+
+// The menu screens of the GUI task through menu.c, as dispListScreen binds and renders them
+static void testMenuScreens(void)
+{
+	static TFTSim sim;
+	static menu_view_t view;
+	TFT_t dev;
+
+	CHECK(tft_sim_init(&sim, GUI_WIDTH, GUI_HEIGHT, FREQUENCY));
+	sim.overhead_ns = 2000; // queueing a transaction on the ESP32
+	TFT_Transport transport = { .ctx = &sim, .write = tft_sim_write };
+	lcdAttachTransport(&dev, &transport);
+	lcdInit(&dev, 0x7735, GUI_WIDTH, GUI_HEIGHT, 0, 0);
+	lcdSetFontDirection(&dev, DIRECTION90);
+	CHECK(lcdEnableFrameBuffer(&dev));
+
+	menuBuildTree(&view, fx16, GUI_WIDTH, GUI_HEIGHT);
+	menuBindStatus(&view, true, "Connected");
+	menuBindList(&view, &mainScreen, 0);
+	for(int i=0;i<MENU_LIST_ROWS;i++) {
+		CHECK(strcmp(view.rows[i].text, mainScreen.subMenus[i].label) == 0);
+		// Rows stay on the panel, right of each other below the status bar
+		CHECK(view.rows[i].x1 < view.rows[i].x2 && view.rows[i].x2 < X_START);
+		if (i > 0) CHECK(view.rows[i].x2 < view.rows[i - 1].x1 + 4);
+	}
+
+	tft_sim_reset_stats(&sim);
+	CHECK_EQ(widgetRender(&dev, &view.root), 3 + MENU_LIST_ROWS);
+	lcdFlush(&dev);
+	report("main menu, first frame", &sim);
+	CHECK_EQ(sim.commands[0x2C].bytes, GUI_WIDTH * GUI_HEIGHT * 2);
+	CHECK(countPixels(&sim, GREEN) > 0);
+	CHECK(tft_sim_write_png(&sim, "sim_menu.png"));
+	uint64_t fullFrame = sim.bytes;
+
+	// BUTTON_DOWN
+	tft_sim_reset_stats(&sim);
+	menuBindList(&view, &mainScreen, 1);
+	CHECK_EQ(widgetRender(&dev, &view.root), 2);
+	lcdFlush(&dev);
+	report("selection moved", &sim);
+	CHECK(sim.bytes < fullFrame / 2);
+	CHECK(countPixels(&sim, WHITE_SMOKE) > 0);
+	CHECK(tft_sim_write_png(&sim, "sim_menu_down.png"));
+
+	tft_sim_reset_stats(&sim);
+	menuBindStatus(&view, false, "Disconnected");
+	CHECK_EQ(widgetRender(&dev, &view.root), 1);
+	lcdFlush(&dev);
+	report("status bar update", &sim);
+	CHECK(sim.bytes < fullFrame / 4);
+	CHECK_EQ(countPixels(&sim, GREEN), 0);
+
+	// BUTTON_ENTER on Connection Config: every row relabelled, the selected one with its status
+	const menuScreen *conn = &mainScreen.subMenus[0];
+	tft_sim_reset_stats(&sim);
+	menuBindList(&view, conn, 0);
+	CHECK_EQ(widgetRender(&dev, &view.root), conn->numOfSubMenus);
+	lcdFlush(&dev);
+	report("connection screen", &sim);
+	char text[WIDGET_TEXT_SIZE];
+	snprintf(text, sizeof(text), "%s <ON>", conn->subMenus[0].label);
+	CHECK(strcmp(view.rows[0].text, text) == 0);
+	CHECK(strcmp(view.rows[1].text, conn->subMenus[1].label) == 0);
+
+	// And on WiFi: a dynamic label, fewer entries than rows leave the last one hidden
+	const menuScreen *wifi = &conn->subMenus[0];
+	menuBindList(&view, wifi, 0);
+	widgetRender(&dev, &view.root);
+	lcdFlush(&dev);
+	CHECK(strcmp(view.rows[0].text, "Turn off") == 0);
+	CHECK(wifi->numOfSubMenus < MENU_LIST_ROWS);
+	CHECK(!view.rows[MENU_LIST_ROWS - 1].visible);
+	CHECK(tft_sim_write_png(&sim, "sim_menu_wifi.png"));
+
+	lcdDisableFrameBuffer(&dev);
+	tft_sim_free(&sim);
+}
+
+int main(void)
+{
+	InitFontx(fx16, REPO_ROOT "/font/ILGH16XB.FNT", "");
+
+	testFillScreen();
+	testSpiPathMatches();
+	testMenuScreens();
+	CloseFontx(&fx16[0]);
+	return checkResult();
+}
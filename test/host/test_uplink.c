@@ -0,0 +1,330 @@
+/*
+ Batched uplink against a broker stand-in, with the backlog in RAM flash
+
+ The sensor side is ingest.c with main.c's three sources (1 ms, 500 us,
+ 5 ms) on a virtual clock: producers every 10 ms tick, a drain every 20 ms,
+ uplinkProcess every 50 ms. Each reading has a value of its own, so the
+ broker decodes every batch and can tell lost and duplicated samples.
+
+	live	every sample arrives once, batches close on age and fit the limit
+	outage	batches go to the backlog and are forwarded at UPLINK_DRAIN_RATE
+	refused	a failed publish stores the batch instead of losing it
+	restart	the backlog survives reopening the ring log and uplinkInit
+	full	a long outage overwrites the oldest batches and counts them
+	no log	without a backlog, offline batches are counted but not stored
+	ring	samples beyond UPLINK_RING_SIZE are counted as dropped
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uplink.h"
+#include "check.h"
+
+#define MS	1000
+#define SOURCES	3
+#define FLASH_SECTORS	64
+#define MAX_VALUE	(1 << 24)	// floats hold integers exactly up to here
+
+typedef struct {
+	uint8_t data[FLASH_SECTORS * RINGLOG_SECTOR_SIZE];
+} RamFlash;
+
+static esp_err_t ramRead(void *ctx, uint32_t offset, void *data, size_t size)
+{
+	memcpy(data, ((RamFlash *)ctx)->data + offset, size);
+	return ESP_OK;
+}
+
+static esp_err_t ramWrite(void *ctx, uint32_t offset, const void *data, size_t size)
+{
+	uint8_t *flash = ((RamFlash *)ctx)->data + offset;
+	for (size_t i = 0; i < size; i++) flash[i] &= ((const uint8_t *)data)[i];
+	return ESP_OK;
+}
+
+static esp_err_t ramErase(void *ctx, uint32_t offset, size_t size)
+{
+	memset(((RamFlash *)ctx)->data + offset, 0xFF, size);
+	return ESP_OK;
+}
+
+static RamFlash ram;
+static const ringlog_flash_t flash = { &ram, sizeof(ram.data), ramRead, ramWrite, ramErase };
+static ringlog_t backlog;
+
+// Broker stand-in: decodes and checks every batch it accepts
+typedef struct {
+	bool up;
+	bool refuse;		// connected, but publish fails
+	uint8_t *seen;		// per value, times delivered
+	uint32_t samples;
+	uint32_t batches;
+	uint64_t bytes;
+	uint32_t bad;
+	uint32_t maxCount;
+	int64_t maxSpan;
+	uint32_t lastSeq;
+} Broker;
+
+static Broker broker;
+
+static bool brokerConnected(void *ctx)
+{
+	return ((Broker *)ctx)->up;
+}
+
+static bool brokerPublish(void *ctx, const uint8_t *data, size_t size)
+{
+	Broker *b = ctx;
+	if (!b->up || b->refuse) return false;
+	const uplink_batch_header_t *header = (const uplink_batch_header_t *)data;
+	if (size > UPLINK_BATCH_BYTES || header->version != UPLINK_BATCH_VERSION || header->encoding != UPLINK_ENCODING_TSC) {
+		b->bad++;
+		return true;
+	}
+	tsc_decoder_t dec;
+	sensor_sample_t sample;
+	uint32_t count = 0;
+	int64_t first = 0, last = 0;
+	tscDecoderInit(&dec, data + sizeof(*header), size - sizeof(*header), header->count, header->baseTime);
+	while (tscDecode(&dec, &sample)) {
+		uint32_t value = (uint32_t)sample.value;
+		if (value >= MAX_VALUE || sample.source >= SOURCES) {
+			b->bad++;
+			continue;
+		}
+		b->seen[value]++;
+		if (count == 0) first = sample.timestamp;
+		last = sample.timestamp;
+		count++;
+	}
+	if (count != header->count || first != header->baseTime) b->bad++;
+	if (count > b->maxCount) b->maxCount = count;
+	if (last - first > b->maxSpan) b->maxSpan = last - first;
+	b->samples += count;
+	b->batches++;
+	b->bytes += size;
+	b->lastSeq = header->seq;
+	return true;
+}
+
+static const uplink_transport_t transport = { &broker, brokerConnected, brokerPublish };
+
+static uint32_t nextValue;
+
+static bool countRead(sensor_source_t *src, sensor_sample_t *sample)
+{
+	sample->channel = nextValue & 3;
+	sample->value = (float)(nextValue++ % MAX_VALUE);
+	return true;
+}
+
+static ingest_t ingest;
+static int64_t now;
+
+static void setup(ringlog_t *log)
+{
+	static const uint32_t periods[SOURCES] = { 1000, 500, 5000 };
+	memset(broker.seen, 0, MAX_VALUE);
+	broker.samples = broker.batches = broker.bad = broker.maxCount = 0;
+	broker.bytes = 0;
+	broker.maxSpan = 0;
+	broker.up = true;
+	broker.refuse = false;
+	nextValue = 0;
+	now = 1000000;
+	ingestInit(&ingest, uplinkSensorHandler, NULL);
+	for (int i = 0; i < SOURCES; i++) ingestAddSource(&ingest, "count", periods[i], countRead, NULL);
+	uplinkInit(&transport, log);
+}
+
+// Run the firmware schedule for ms milliseconds, producing when sampling is set
+static void run(int ms, bool sampling)
+{
+	for (int t = 0; t < ms; t += 10, now += 10 * MS) {
+		if (sampling) {
+			for (int i = 0; i < SOURCES; i++) ingestPoll(&ingest.sources[i], now);
+		}
+		if (t % 20 == 0) ingestDrain(&ingest, now);
+		if (t % 50 == 0) uplinkProcess(now);
+	}
+}
+
+// Every value produced so far delivered exactly once
+static void checkDelivery(const char *name)
+{
+	uint32_t missing = 0, twice = 0;
+	for (uint32_t v = 0; v < nextValue; v++) {
+		if (broker.seen[v] == 0) missing++;
+		if (broker.seen[v] > 1) twice++;
+	}
+	if (missing || twice || broker.bad) {
+		printf("%s: %u missing, %u twice, %u bad\n", name, missing, twice, broker.bad);
+		CHECK(false);
+	}
+}
+
+static void testLive(void)
+{
+	uplink_stats_t stats;
+	ringlogFormat(&backlog);
+	setup(&backlog);
+	run(10000, true);
+	run(2000, false);
+	uplinkGetStats(&stats);
+	checkDelivery("live");
+	CHECK_EQ(broker.samples, nextValue);
+	CHECK_EQ(stats.batches, stats.published);
+	CHECK_EQ(stats.stored, 0);
+	CHECK_EQ(stats.dropped, 0);
+	CHECK_EQ(broker.lastSeq, stats.batches - 1);
+	// Closed on age: one second of samples plus what a drain and a run add
+	CHECK(broker.maxSpan <= (UPLINK_BATCH_TIME + 20 + UPLINK_POLL_PERIOD) * MS);
+	printf("live: %u samples in %u batches, %.2f bytes/sample\n", broker.samples, broker.batches,
+		(double)broker.bytes / broker.samples);
+}
+
+static void testOutage(void)
+{
+	uplink_stats_t stats;
+	ringlogFormat(&backlog);
+	setup(&backlog);
+	run(5000, true);
+	broker.up = false;
+	run(10000, true);
+	uplinkGetStats(&stats);
+	CHECK(stats.stored >= 9);
+	CHECK_EQ(stats.backlog, stats.stored);
+	uint32_t stored = stats.stored;
+
+	// Back online: the backlog drains at UPLINK_DRAIN_RATE while live data goes on
+	broker.up = true;
+	run(1000, true);
+	uplinkGetStats(&stats);
+	CHECK(stats.forwarded >= UPLINK_DRAIN_RATE - 1 && stats.forwarded <= UPLINK_DRAIN_RATE);
+	CHECK(stats.published > 0);
+	run(stored * 1000 / UPLINK_DRAIN_RATE, true);
+	run(2000, false);
+	uplinkGetStats(&stats);
+	CHECK_EQ(stats.forwarded, stored);
+	CHECK_EQ(stats.backlog, 0);
+	CHECK_EQ(stats.overwritten, 0);
+	checkDelivery("outage");
+	printf("outage: %u batches stored, all forwarded\n", stored);
+}
+
+static void testRefused(void)
+{
+	uplink_stats_t stats;
+	ringlogFormat(&backlog);
+	setup(&backlog);
+	run(2000, true);
+	broker.refuse = true;
+	run(3000, true);
+	uplinkGetStats(&stats);
+	CHECK(stats.stored > 0);
+	broker.refuse = false;
+	run(3000, true);
+	run(2000, false);
+	uplinkGetStats(&stats);
+	CHECK_EQ(stats.backlog, 0);
+	checkDelivery("refused");
+}
+
+static void testRestart(void)
+{
+	uplink_stats_t stats;
+	ringlogFormat(&backlog);
+	setup(&backlog);
+	broker.up = false;
+	run(5000, true);
+	run(2000, false);
+	uplinkGetStats(&stats);
+	uint32_t stored = stats.stored;
+	CHECK(stored > 0);
+
+	// Reboot: the log is found again on flash, the uplink starts over
+	static ringlog_t reopened;
+	CHECK_EQ(ringlogOpen(&reopened, &flash), ESP_OK);
+	uplinkInit(&transport, &reopened);
+	uplinkGetStats(&stats);
+	CHECK_EQ(stats.backlog, stored);
+	broker.up = true;
+	run(stored * 1000 / UPLINK_DRAIN_RATE + 1000, false);
+	uplinkGetStats(&stats);
+	CHECK_EQ(stats.forwarded, stored);
+	CHECK_EQ(stats.backlog, 0);
+	checkDelivery("restart");
+}
+
+static void testFull(void)
+{
+	uplink_stats_t stats;
+	ringlogFormat(&backlog);
+	setup(&backlog);
+	broker.up = false;
+	run(120000, true);
+	run(2000, false);
+	uplinkGetStats(&stats);
+	CHECK(stats.overwritten > 0);
+	CHECK_EQ(stats.backlog + stats.overwritten, stats.stored);
+
+	// The newest batches are the ones kept
+	uint32_t backlogCount = stats.backlog;
+	broker.up = true;
+	run(backlogCount * 1000 / UPLINK_DRAIN_RATE + 1000, false);
+	uplinkGetStats(&stats);
+	CHECK_EQ(stats.forwarded, backlogCount);
+	CHECK_EQ(broker.seen[nextValue - 1], 1);
+	CHECK_EQ(broker.seen[0], 0);
+	printf("full: %u batches kept, %u overwritten\n", backlogCount, stats.overwritten);
+}
+
+static void testNoLog(void)
+{
+	uplink_stats_t stats;
+	setup(NULL);
+	broker.up = false;
+	run(5000, true);
+	run(2000, false);
+	uplinkGetStats(&stats);
+	CHECK(stats.batches > 0);
+	CHECK_EQ(stats.stored, 0);
+	CHECK_EQ(stats.published, 0);
+	CHECK_EQ(stats.backlog, 0);
+}
+
+static void testRing(void)
+{
+	static sensor_sample_t samples[UPLINK_RING_SIZE + 100];
+	uplink_stats_t stats;
+	setup(NULL);
+	for (int i = 0; i < UPLINK_RING_SIZE + 100; i++) {
+		samples[i].timestamp = now + i * MS;
+		samples[i].value = (float)i;
+	}
+	uplinkSensorHandler(samples, UPLINK_RING_SIZE - 10, NULL);
+	uplinkSensorHandler(samples + UPLINK_RING_SIZE - 10, 110, NULL);
+	uplinkGetStats(&stats);
+	CHECK_EQ(stats.dropped, 100);
+	nextValue = UPLINK_RING_SIZE;
+	run(2000, false);
+	checkDelivery("ring");
+}
+
+int main(void)
+{
+	broker.seen = malloc(MAX_VALUE);
+	memset(ram.data, 0xFF, sizeof(ram.data));
+	CHECK_EQ(ringlogOpen(&backlog, &flash), ESP_OK);
+	testLive();
+	testOutage();
+	testRefused();
+	testRestart();
+	testFull();
+	testNoLog();
+	testRing();
+	free(broker.seen);
+	return checkResult();
+}
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Convert images to the panel native R565 container read by main/decode_raw.c.
+
+    python tools/imgpack.py splash.png -o spiffs/splash.r565
+    python tools/imgpack.py icons/*.png -o spiffs/ --encoding auto --max 240x320
+
+Header, 16 bytes, little-endian:
+    char     magic[4]   "R565"
+    uint16   width
+    uint16   height
+    uint8    encoding   0 raw, 1 rle, 2 palette
+    uint8    reserved
+    uint16   colors     palette entries (palette encoding only)
+    uint32   size       bytes following the header
+
+raw:     width*height big-endian RGB565 pixels, ready for the panel
+rle:     packets of big-endian RGB565 pixels
+palette: colors big-endian RGB565 entries, then packets of 8-bit indices
+
+A packet starts with a control byte c: c < 0x80 is followed by c+1 literal
+elements, c >= 0x80 by one element repeated c-0x7f times. Packets run
+across rows.
+
+Needs Pillow to read the source images.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"R565"
+ENC_RAW = 0
+ENC_RLE = 1
+ENC_PALETTE = 2
+ENCODINGS = {"raw": ENC_RAW, "rle": ENC_RLE, "palette": ENC_PALETTE}
+MAX_RUN = 128
+
+
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def rle_encode(elements, pack):
+    """Packets for a list of elements, pack() turns one element into bytes."""
+    out = bytearray()
+    i = 0
+    n = len(elements)
+    while i < n:
+        run = 1
+        while i + run < n and run < MAX_RUN and elements[i + run] == elements[i]:
+            run += 1
+        if run >= 2:
+            out.append(0x7F + run)
+            out += pack(elements[i])
+            i += run
+            continue
+        # literals up to the next run of 2
+        start = i
+        while i < n and i - start < MAX_RUN:
+            if i + 1 < n and elements[i + 1] == elements[i]:
+                break
+            i += 1
+        out.append(i - start - 1)
+        for e in elements[start:i]:
+            out += pack(e)
+    return bytes(out)
+
+
+def encode(pixels, width, height, encoding):
+    """pixels: width*height RGB565 values, row by row. Returns the whole file."""
+    be16 = lambda v: struct.pack(">H", v)
+    colors = 0
+    if encoding == ENC_RAW:
+        body = b"".join(be16(p) for p in pixels)
+    elif encoding == ENC_RLE:
+        body = rle_encode(pixels, be16)
+    elif encoding == ENC_PALETTE:
+        palette = sorted(set(pixels))
+        if len(palette) > 256:
+            raise ValueError("%d colors, palette encoding takes at most 256" % len(palette))
+        index = {c: i for i, c in enumerate(palette)}
+        colors = len(palette)
+        body = b"".join(be16(c) for c in palette) + rle_encode([index[p] for p in pixels], lambda v: bytes((v,)))
+    else:
+        raise ValueError("unknown encoding %r" % encoding)
+    header = struct.pack("<4sHHBBHI", MAGIC, width, height, encoding, 0, colors, len(body))
+    return header + body
+
+
+def encode_smallest(pixels, width, height):
+    best = None
+    for encoding in (ENC_RAW, ENC_RLE, ENC_PALETTE):
+        try:
+            data = encode(pixels, width, height, encoding)
+        except ValueError:
+            continue
+        if best is None or len(data) < len(best):
+            best = data
+    return best
+
+
+def load_pixels(path, max_size, background):
+    from PIL import Image
+
+    image = Image.open(path)
+    if max_size and (image.width > max_size[0] or image.height > max_size[1]):
+        image.thumbnail(max_size, Image.BOX)
+    if image.mode in ("RGBA", "LA", "P"):
+        image = image.convert("RGBA")
+        flat = Image.new("RGBA", image.size, background + (255,))
+        flat.alpha_composite(image)
+        image = flat
+    image = image.convert("RGB")
+    return image.width, image.height, [rgb565(*p) for p in image.getdata()]
+
+
+def parse_size(text):
+    w, h = text.lower().split("x")
+    return int(w), int(h)
+
+
+def parse_color(text):
+    v = int(text.lstrip("#"), 16)
+    return (v >> 16) & 0xFF, (v >> 8) & 0xFF, v & 0xFF
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack images as panel native RGB565 (R565) files")
+    parser.add_argument("images", nargs="+")
+    parser.add_argument("-o", "--output", required=True, help="output file, or directory for several images")
+    parser.add_argument("-e", "--encoding", choices=["auto"] + list(ENCODINGS), default="auto")
+    parser.add_argument("--max", type=parse_size, help="shrink to fit WxH")
+    parser.add_argument("--background", type=parse_color, default=(0, 0, 0), help="RRGGBB under transparent pixels")
+    args = parser.parse_args()
+
+    to_dir = len(args.images) > 1 or os.path.isdir(args.output)
+    for path in args.images:
+        width, height, pixels = load_pixels(path, args.max, args.background)
+        if args.encoding == "auto":
+            data = encode_smallest(pixels, width, height)
+        else:
+            data = encode(pixels, width, height, ENCODINGS[args.encoding])
+        out = args.output
+        if to_dir:
+            out = os.path.join(args.output, os.path.splitext(os.path.basename(path))[0] + ".r565")
+        with open(out, "wb") as f:
+            f.write(data)
+        print("%s: %dx%d %s %d bytes (raw %d)" % (out, width, height,
+              ["raw", "rle", "palette"][data[8]], len(data), 16 + width * height * 2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())